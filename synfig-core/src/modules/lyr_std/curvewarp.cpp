@@ -42,6 +42,7 @@
 #include <synfig/paramdesc.h>
 #include <synfig/surface.h>
 #include <synfig/valuenode.h>
+#include <synfig/rendering/common/task/taskdistort.h>
 #include <ETL/calculus>
 
 #endif
@@ -151,6 +152,24 @@ find_closest_to_bline(bool fast, const std::vector<BLinePoint>& bline,const Poin
 	return ret;
 }
 
+namespace {
+
+//! Calls CurveWarp::transform() of the copy of layer
+class CurveWarpDistortion: public rendering::Distortion
+{
+public:
+	etl::handle<const CurveWarp> layer;
+
+protected:
+	virtual bool map_vfunc(const Point &point, Point &source_point) const
+	{
+		source_point = layer->transform(point);
+		return std::isfinite(source_point[0]) && std::isfinite(source_point[1]);
+	}
+};
+
+} // end of anonimous namespace
+
 /* === M E T H O D S ======================================================= */
 
 inline void
@@ -440,6 +459,26 @@ CurveWarp::get_color(Context context, const Point &point)const
 	return context.get_color(transform(point));
 }
 
+rendering::Task::Handle
+CurveWarp::build_rendering_task_vfunc(Context context)const
+{
+	// transform() reads parameters, so layer is copied like in Layer::build_rendering_task_vfunc()
+	etl::handle<CurveWarpDistortion> distortion(new CurveWarpDistortion());
+	distortion->layer = etl::handle<const CurveWarp>::cast_dynamic(clone(NULL));
+	if (!distortion->layer)
+		return Layer::build_rendering_task_vfunc(context);
+
+	rendering::Task::Handle sub_task = context.build_rendering_task();
+	if (!sub_task)
+		return sub_task;
+
+	rendering::TaskDistort::Handle task_distort(new rendering::TaskDistort());
+	task_distort->distortion = distortion;
+	task_distort->interpolation = Color::INTERPOLATION_CUBIC;
+	task_distort->sub_task() = sub_task;
+	return task_distort;
+}
+
 RendDesc
 CurveWarp::get_sub_renddesc_vfunc(const RendDesc &renddesc) const
 {
@@ -50,6 +50,7 @@
 #include <synfig/canvas.h>
 #include <synfig/canvasfilenaming.h>
 #include <synfig/filesystem.h>
+#include <synfig/importerframecache.h>
 
 #include <synfig/rendering/software/surfacesw.h>
 
@@ -86,6 +87,23 @@ Import::~Import()
 {
 }
 
+Layer::Handle
+Import::clone(etl::loose_handle<Canvas> canvas, const GUID& deriv_guid)const
+{
+	Layer::Handle ret = Layer_Bitmap::clone(canvas, deriv_guid);
+
+	// share already opened file and loaded frame with the clone,
+	// so it will not be reloaded when the canvas is set
+	if (etl::handle<Import> import = etl::handle<Import>::cast_dynamic(ret))
+	{
+		import->independent_filename = independent_filename;
+		import->importer = importer;
+		import->rendering_surface = rendering_surface;
+	}
+
+	return ret;
+}
+
 void
 Import::on_canvas_set()
 {
@@ -224,7 +242,11 @@ Import::load_resources_vfunc(IndependentContext context, Time time)const
 {
 	Time time_offset=param_time_offset.get(Time());
 	if(get_amount() && importer && importer->is_animated())
+	{
 		rendering_surface = new rendering::SurfaceResource(
 			importer->get_frame(get_canvas()->rend_desc(), time+time_offset) );
+		// decode the next frames while this one is rendered
+		ImporterFrameCache::instance().prefetch(importer, get_canvas()->rend_desc(), time+time_offset);
+	}
 	context.load_resources(time);
 }
@@ -76,6 +76,8 @@ public:
 
 	virtual void on_canvas_set();
 
+	virtual Layer::Handle clone(etl::loose_handle<Canvas> canvas, const GUID& deriv_guid=GUID())const;
+
 	virtual void set_time_vfunc(IndependentContext context, Time time)const;
 	virtual void load_resources_vfunc(IndependentContext context, Time time)const;
 };
@@ -47,6 +47,7 @@
 #include <synfig/value.h>
 #include <synfig/valuenode.h>
 #include <synfig/transform.h>
+#include <synfig/rendering/common/task/taskdistort.h>
 
 #endif
 
@@ -66,6 +67,44 @@ SYNFIG_LAYER_SET_VERSION(InsideOut,"0.1");
 
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+class InsideOutDistortion: public rendering::Distortion
+{
+public:
+	Point origin;
+
+	//! inversion is its own inverse, so the same bounds are valid in both directions
+	Rect inversion_bounds(const Rect &rect) const
+	{
+		const Real dx = std::max(Real(0), std::max(rect.minx - origin[0], origin[0] - rect.maxx));
+		const Real dy = std::max(Real(0), std::max(rect.miny - origin[1], origin[1] - rect.maxy));
+		const Real dist = sqrt(dx*dx + dy*dy);
+		if (dist <= real_precision<Real>())
+			return Rect::infinite();
+		return Rect(origin).expand(1/dist);
+	}
+
+protected:
+	virtual bool map_vfunc(const Point &point, Point &source_point) const
+	{
+		Point pos(point-origin);
+		Real inv_mag=pos.inv_mag();
+		source_point = pos*inv_mag*inv_mag + origin;
+		return std::isfinite(source_point[0]) && std::isfinite(source_point[1]);
+	}
+
+	virtual Rect map_bounds_vfunc(const Rect &rect) const
+		{ return inversion_bounds(rect); }
+	virtual Rect calc_bounds_vfunc(const Rect &source_bounds) const
+		{ return inversion_bounds(source_bounds); }
+
+	virtual bool hash_params_vfunc(rendering::TaskHash &hash) const
+		{ hash.add(origin); return true; }
+};
+
+} // end of anonimous namespace
+
 /* === M E T H O D S ======================================================= */
 
 InsideOut::InsideOut():
@@ -123,6 +162,22 @@ InsideOut::get_color(Context context, const Point &p)const
 	return context.get_color(invpos+origin);
 }
 
+rendering::Task::Handle
+InsideOut::build_rendering_task_vfunc(Context context)const
+{
+	rendering::Task::Handle sub_task = context.build_rendering_task();
+	if (!sub_task)
+		return sub_task;
+
+	etl::handle<InsideOutDistortion> distortion(new InsideOutDistortion());
+	distortion->origin = param_origin.get(Point());
+
+	rendering::TaskDistort::Handle task_distort(new rendering::TaskDistort());
+	task_distort->distortion = distortion;
+	task_distort->sub_task() = sub_task;
+	return task_distort;
+}
+
 
 class lyr_std::InsideOut_Trans : public Transform
 {
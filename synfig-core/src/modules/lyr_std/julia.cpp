@@ -43,6 +43,7 @@
 #include <synfig/paramdesc.h>
 #include <synfig/renddesc.h>
 #include <synfig/value.h>
+#include <synfig/rendering/common/task/taskescapetime.h>
 
 #endif
 
@@ -96,6 +97,138 @@ color_neg_flip(Color &color)
 	}
 }
 
+namespace {
+
+class ContextSource: public rendering::EscapeTime::Source
+{
+public:
+	const Context &context;
+	explicit ContextSource(const Context &context): context(context) { }
+	virtual Color get_color(const Point &point) const
+		{ return context.get_color(point); }
+};
+
+class JuliaEscapeTime: public rendering::EscapeTime
+{
+public:
+	Color icolor;
+	Color ocolor;
+	Angle color_shift;
+	bool distort_inside;
+	bool shade_inside;
+	bool solid_inside;
+	bool invert_inside;
+	bool color_inside;
+	bool distort_outside;
+	bool shade_outside;
+	bool solid_outside;
+	bool invert_outside;
+	bool color_outside;
+	bool color_cycle;
+	bool smooth_outside;
+
+	JuliaEscapeTime():
+		color_shift(Angle::deg(0)),
+		distort_inside(), shade_inside(), solid_inside(), invert_inside(), color_inside(),
+		distort_outside(), shade_outside(), solid_outside(), invert_outside(), color_outside(),
+		color_cycle(), smooth_outside() { }
+
+protected:
+	virtual Color shade_vfunc(const Point &pos, const Orbit &orbit, int iterations, const Source &source) const
+	{
+		const Real zr = orbit.zr, zi = orbit.zi;
+		const ColorReal mag = orbit.mag;
+		Color ret;
+
+		if (orbit.escaped())
+		{
+			ColorReal depth;
+			if(smooth_outside)
+			{
+				// Darco's original mandelbrot smoothing algo
+				// depth=((Point::value_type)i+(2.0-sqrt(mag))/PI);
+
+				// Linas Vepstas algo (Better than darco's)
+				// See (http://linas.org/art-gallery/escape/smooth.html)
+				depth= (ColorReal)orbit.escape - log(log(sqrt(mag))) / LOG_OF_2;
+
+				// Clamp
+				if(depth<0) depth=0;
+			}
+			else
+				depth=static_cast<ColorReal>(orbit.escape);
+
+			if(solid_outside)
+				ret=ocolor;
+			else
+				if(distort_outside)
+					ret=source.get_color(Point(zr,zi));
+				else
+					ret=source.get_color(pos);
+
+			if(invert_outside)
+				ret=~ret;
+
+			if(color_outside)
+				ret=ret.set_uv(zr,zi).clamped_negative();
+
+			if(color_cycle)
+				ret=ret.rotate_uv(color_shift.operator*(depth)).clamped_negative();
+
+			if(shade_outside)
+			{
+				ColorReal alpha=depth/static_cast<ColorReal>(iterations);
+				ret=(ocolor-ret)*alpha+ret;
+			}
+			return ret;
+		}
+
+		if(solid_inside)
+			ret=icolor;
+		else
+			if(distort_inside)
+				ret=source.get_color(Point(zr,zi));
+			else
+				ret=source.get_color(pos);
+
+		if(invert_inside)
+			ret=~ret;
+
+		if(color_inside)
+			ret=ret.set_uv(zr,zi).clamped_negative();
+
+		if(shade_inside)
+			ret=(icolor-ret)*mag+ret;
+
+		return ret;
+	}
+
+	virtual bool uses_source_vfunc() const
+		{ return !solid_inside || !solid_outside; }
+
+	virtual bool hash_params_vfunc(rendering::TaskHash &hash) const
+	{
+		hash.add(icolor);
+		hash.add(ocolor);
+		hash.add(Angle::rad(color_shift).get());
+		hash.add(distort_inside);
+		hash.add(shade_inside);
+		hash.add(solid_inside);
+		hash.add(invert_inside);
+		hash.add(color_inside);
+		hash.add(distort_outside);
+		hash.add(shade_outside);
+		hash.add(solid_outside);
+		hash.add(invert_outside);
+		hash.add(color_outside);
+		hash.add(color_cycle);
+		hash.add(smooth_outside);
+		return true;
+	}
+};
+
+} // end of anonimous namespace
+
 /* === M E T H O D S ======================================================= */
 
 Julia::Julia():
@@ -228,116 +361,52 @@ Julia::get_sub_renddesc_vfunc(const RendDesc &renddesc) const
 Color
 Julia::get_color(Context context, const Point &pos)const
 {
-	Color icolor=param_icolor.get(Color());
-	Color ocolor=param_ocolor.get(Color());
-	Angle color_shift=param_color_shift.get(Angle());
-	int iterations=param_iterations.get(int());
-	Point seed=param_seed.get(Point());
-	bool distort_inside=param_distort_inside.get(bool());
-	bool shade_inside=param_shade_inside.get(bool());
-	bool solid_inside=param_solid_inside.get(bool());
-	bool invert_inside=param_invert_inside.get(bool());
-	bool color_inside=param_color_inside.get(bool());
-	bool distort_outside=param_distort_outside.get(bool());
-	bool shade_outside=param_shade_outside.get(bool());
-	bool solid_outside=param_solid_outside.get(bool());
-	bool invert_outside=param_invert_outside.get(bool());
-	bool color_outside=param_color_outside.get(bool());
-
-	bool color_cycle=param_color_cycle.get(bool());
-	bool smooth_outside=param_smooth_outside.get(bool());
-	bool broken=param_broken.get(bool());
-
-	Real
-		cr, ci,
-		zr, zi,
-		zr_hold;
-
-	ColorReal
-		depth, mag(0);
-
-	Color
-		ret;
-
-	cr=seed[0];
-	ci=seed[1];
-	zr=pos[0];
-	zi=pos[1];
-
-	for(int i=0;i<iterations;i++)
-	{
-		// Perform complex multiplication
-		zr_hold=zr;
-		zr=zr*zr-zi*zi + cr;
-		zi=zr_hold*zi*2 + ci;
-
-		// Use "broken" algorithm, if requested (looks weird)
-		if(broken)zr+=zi;
-
-		// Calculate Magnitude
-		mag=zr*zr+zi*zi;
-
-		if(mag>4)
-		{
-			if(smooth_outside)
-			{
-				// Darco's original mandelbrot smoothing algo
-				// depth=((Point::value_type)i+(2.0-sqrt(mag))/PI);
-
-				// Linas Vepstas algo (Better than darco's)
-				// See (http://linas.org/art-gallery/escape/smooth.html)
-				depth= (ColorReal)i - log(log(sqrt(mag))) / LOG_OF_2;
-
-				// Clamp
-				if(depth<0) depth=0;
-			}
-			else
-				depth=static_cast<ColorReal>(i);
-
-			if(solid_outside)
-				ret=ocolor;
-			else
-				if(distort_outside)
-					ret=context.get_color(Point(zr,zi));
-				else
-					ret=context.get_color(pos);
-
-			if(invert_outside)
-				ret=~ret;
-
-			if(color_outside)
-				ret=ret.set_uv(zr,zi).clamped_negative();
-
-			if(color_cycle)
-				ret=ret.rotate_uv(color_shift.operator*(depth)).clamped_negative();
-
-			if(shade_outside)
-			{
-				ColorReal alpha=depth/static_cast<ColorReal>(iterations);
-				ret=(ocolor-ret)*alpha+ret;
-			}
-			return ret;
-		}
-	}
-
-	if(solid_inside)
-		ret=icolor;
-	else
-		if(distort_inside)
-			ret=context.get_color(Point(zr,zi));
-		else
-			ret=context.get_color(pos);
-
-	if(invert_inside)
-		ret=~ret;
-
-	if(color_inside)
-		ret=ret.set_uv(zr,zi).clamped_negative();
+	rendering::EscapeTime::Handle escape_time = create_escape_time();
+	rendering::EscapeTime::Orbit orbit;
+	escape_time->iterate_row(pos, Vector(), &orbit, 1);
+	return escape_time->shade(pos, orbit, escape_time->iterations, ContextSource(context));
+}
 
-	if(shade_inside)
-		ret=(icolor-ret)*mag+ret;
+rendering::EscapeTime::Handle
+Julia::create_escape_time() const
+{
+	etl::handle<JuliaEscapeTime> escape_time(new JuliaEscapeTime());
+	escape_time->formula = rendering::EscapeTime::JULIA;
+	escape_time->iterations = param_iterations.get(int());
+	escape_time->seed = param_seed.get(Point());
+	escape_time->bailout = 4;
+	escape_time->broken = param_broken.get(bool());
+
+	escape_time->icolor = param_icolor.get(Color());
+	escape_time->ocolor = param_ocolor.get(Color());
+	escape_time->color_shift = param_color_shift.get(Angle());
+	escape_time->distort_inside = param_distort_inside.get(bool());
+	escape_time->shade_inside = param_shade_inside.get(bool());
+	escape_time->solid_inside = param_solid_inside.get(bool());
+	escape_time->invert_inside = param_invert_inside.get(bool());
+	escape_time->color_inside = param_color_inside.get(bool());
+	escape_time->distort_outside = param_distort_outside.get(bool());
+	escape_time->shade_outside = param_shade_outside.get(bool());
+	escape_time->solid_outside = param_solid_outside.get(bool());
+	escape_time->invert_outside = param_invert_outside.get(bool());
+	escape_time->color_outside = param_color_outside.get(bool());
+	escape_time->color_cycle = param_color_cycle.get(bool());
+	escape_time->smooth_outside = param_smooth_outside.get(bool());
+	return escape_time;
+}
 
-	return ret;
+rendering::Task::Handle
+Julia::build_rendering_task_vfunc(Context context) const
+{
+	const RendDesc desc = get_sub_renddesc(RendDesc());
+
+	rendering::TaskEscapeTime::Handle task(new rendering::TaskEscapeTime());
+	task->escape_time = create_escape_time();
+	task->context_rect = Rect(desc.get_tl(), desc.get_br());
+	task->context_size = VectorInt(desc.get_w(), desc.get_h());
+	if (task->escape_time->uses_source())
+		task->sub_task() = context.build_rendering_task();
+	return task;
 }
 
 Layer::Vocab
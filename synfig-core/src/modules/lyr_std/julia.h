@@ -34,6 +34,7 @@
 #include <synfig/color.h>
 #include <synfig/vector.h>
 #include <synfig/angle.h>
+#include <synfig/rendering/primitive/escapetime.h>
 
 /* === M A C R O S ========================================================= */
 
@@ -93,7 +94,7 @@ private:
 	ValueBase param_broken;
 	Real lp;
 
-
+	rendering::EscapeTime::Handle create_escape_time() const;
 
 public:
 	Julia();
@@ -105,6 +106,7 @@ public:
 
 protected:
 	virtual RendDesc get_sub_renddesc_vfunc(const RendDesc &renddesc) const;
+	virtual rendering::Task::Handle build_rendering_task_vfunc(Context context) const;
 };
 
 }; // END of namespace lyr_std
@@ -42,6 +42,7 @@
 #include <synfig/paramdesc.h>
 #include <synfig/renddesc.h>
 #include <synfig/value.h>
+#include <synfig/rendering/common/task/taskescapetime.h>
 
 #endif
 
@@ -95,6 +96,146 @@ color_neg_flip(Color &color)
 	}
 }
 
+namespace {
+
+class ContextSource: public rendering::EscapeTime::Source
+{
+public:
+	const Context &context;
+	explicit ContextSource(const Context &context): context(context) { }
+	virtual Color get_color(const Point &point) const
+		{ return context.get_color(point); }
+};
+
+class MandelbrotEscapeTime: public rendering::EscapeTime
+{
+public:
+	Real lp;
+
+	bool distort_inside;
+	bool shade_inside;
+	bool solid_inside;
+	bool invert_inside;
+	Gradient gradient_inside;
+	Real gradient_offset_inside;
+	bool gradient_loop_inside;
+
+	bool distort_outside;
+	bool shade_outside;
+	bool solid_outside;
+	bool invert_outside;
+	Gradient gradient_outside;
+	bool smooth_outside;
+	Real gradient_offset_outside;
+	Real gradient_scale_outside;
+
+	MandelbrotEscapeTime():
+		lp(),
+		distort_inside(), shade_inside(), solid_inside(), invert_inside(),
+		gradient_offset_inside(), gradient_loop_inside(),
+		distort_outside(), shade_outside(), solid_outside(), invert_outside(),
+		smooth_outside(), gradient_offset_outside(), gradient_scale_outside() { }
+
+protected:
+	virtual Color shade_vfunc(const Point &pos, const Orbit &orbit, int iterations, const Source &source) const
+	{
+		const Real zr = orbit.zr, zi = orbit.zi;
+		const ColorReal mag = orbit.mag;
+		Color ret;
+
+		if (orbit.escaped())
+		{
+			ColorReal depth;
+			if(smooth_outside)
+			{
+				// Darco's original mandelbrot smoothing algo
+				// depth=((Point::value_type)i+(2.0-sqrt(mag))/PI);
+
+				// Linas Vepstas algo (Better than darco's)
+				// See (http://linas.org/art-gallery/escape/smooth.html)
+				depth= (ColorReal)orbit.escape + LOG_OF_2*lp - log(log(sqrt(mag))) / LOG_OF_2;
+
+				// Clamp
+				if(depth<0) depth=0;
+			}
+			else
+				depth=static_cast<ColorReal>(orbit.escape);
+
+			ColorReal amount(depth/static_cast<ColorReal>(iterations));
+			amount=amount*gradient_scale_outside+gradient_offset_outside;
+			amount-=floor(amount);
+
+			if(solid_outside)
+				ret=gradient_outside(amount);
+			else
+			{
+				if(distort_outside)
+					ret=source.get_color(Point(pos[0]+zr,pos[1]+zi));
+				else
+					ret=source.get_color(pos);
+
+				if(invert_outside)
+					ret=~ret;
+
+				if(shade_outside)
+					ret=Color::blend(gradient_outside(amount), ret, 1.0);
+			}
+
+			return ret;
+		}
+
+		ColorReal amount(std::fabs(mag+gradient_offset_inside));
+		if(gradient_loop_inside)
+			amount-=floor(amount);
+
+		if(solid_inside)
+			ret=gradient_inside(amount);
+		else
+		{
+			if(distort_inside)
+				ret=source.get_color(Point(pos[0]+zr,pos[1]+zi));
+			else
+				ret=source.get_color(pos);
+
+			if(invert_inside)
+				ret=~ret;
+
+			if(shade_inside)
+				ret=Color::blend(gradient_inside(amount), ret, 1.0);
+		}
+
+		return ret;
+	}
+
+	virtual bool uses_source_vfunc() const
+		{ return !solid_inside || !solid_outside; }
+
+	virtual bool hash_params_vfunc(rendering::TaskHash &hash) const
+	{
+		hash.add(lp);
+		hash.add(distort_inside);
+		hash.add(shade_inside);
+		hash.add(solid_inside);
+		hash.add(invert_inside);
+		for(Gradient::const_iterator i = gradient_inside.begin(); i != gradient_inside.end(); ++i)
+			{ hash.add(i->pos); hash.add(i->color); }
+		hash.add(gradient_offset_inside);
+		hash.add(gradient_loop_inside);
+		hash.add(distort_outside);
+		hash.add(shade_outside);
+		hash.add(solid_outside);
+		hash.add(invert_outside);
+		for(Gradient::const_iterator i = gradient_outside.begin(); i != gradient_outside.end(); ++i)
+			{ hash.add(i->pos); hash.add(i->color); }
+		hash.add(smooth_outside);
+		hash.add(gradient_offset_outside);
+		hash.add(gradient_scale_outside);
+		return true;
+	}
+};
+
+} // end of anonimous namespace
+
 /* === M E T H O D S ======================================================= */
 
 Mandelbrot::Mandelbrot():
@@ -310,116 +451,51 @@ Mandelbrot::get_sub_renddesc_vfunc(const RendDesc &renddesc) const
 Color
 Mandelbrot::get_color(Context context, const Point &pos)const
 {
-	int iterations=param_iterations.get(int());
-	Real bailout=param_bailout.get(Real());
-	bool broken=param_broken.get(bool());
-
-	bool distort_inside=param_distort_inside.get(bool());
-	bool shade_inside=param_shade_inside.get(bool());
-	bool solid_inside=param_solid_inside.get(bool());
-	bool invert_inside=param_invert_inside.get(bool());
-	Gradient gradient_inside=param_gradient_inside.get(Gradient());
-	Real gradient_offset_inside=param_gradient_offset_inside.get(Real());
-	bool gradient_loop_inside=param_gradient_loop_inside.get(bool());
-
-	bool distort_outside=param_distort_outside.get(bool());
-	bool shade_outside=param_shade_outside.get(bool());
-	bool solid_outside=param_solid_outside.get(bool());
-	bool invert_outside=param_invert_outside.get(bool());
-	Gradient gradient_outside=param_gradient_outside.get(Gradient());
-	bool smooth_outside=param_smooth_outside.get(bool());
-	Real gradient_offset_outside=param_gradient_offset_outside.get(Real());
-	Real gradient_scale_outside=param_gradient_scale_outside.get(Real());
-	
-	Real
-		cr, ci,
-		zr, zi,
-		zr_hold;
-
-	ColorReal
-		depth, mag(0);
-
-	Color
-		ret;
-
-
-	zr=zi=0;
-	cr=pos[0];
-	ci=pos[1];
-
-	for(int i=0;i<iterations;i++)
-	{
-		// Perform complex multiplication
-		zr_hold=zr;
-		zr=zr*zr-zi*zi + cr;
-		if(broken)zr+=zi; // Use "broken" algorithm, if requested (looks weird)
-		zi=zr_hold*zi*2 + ci;
-
-
-		// Calculate Magnitude
-		mag=zr*zr+zi*zi;
-
-		if(mag>bailout)
-		{
-			if(smooth_outside)
-			{
-				// Darco's original mandelbrot smoothing algo
-				// depth=((Point::value_type)i+(2.0-sqrt(mag))/PI);
-
-				// Linas Vepstas algo (Better than darco's)
-				// See (http://linas.org/art-gallery/escape/smooth.html)
-				depth= (ColorReal)i + LOG_OF_2*lp - log(log(sqrt(mag))) / LOG_OF_2;
-
-				// Clamp
-				if(depth<0) depth=0;
-			}
-			else
-				depth=static_cast<ColorReal>(i);
-
-			ColorReal amount(depth/static_cast<ColorReal>(iterations));
-			amount=amount*gradient_scale_outside+gradient_offset_outside;
-			amount-=floor(amount);
-
-			if(solid_outside)
-				ret=gradient_outside(amount);
-			else
-			{
-				if(distort_outside)
-					ret=context.get_color(Point(pos[0]+zr,pos[1]+zi));
-				else
-					ret=context.get_color(pos);
-
-				if(invert_outside)
-					ret=~ret;
-
-				if(shade_outside)
-					ret=Color::blend(gradient_outside(amount), ret, 1.0);
-			}
-
-
-			return ret;
-		}
-	}
-
-	ColorReal amount(std::fabs(mag+gradient_offset_inside));
-	if(gradient_loop_inside)
-		amount-=floor(amount);
-
-	if(solid_inside)
-		ret=gradient_inside(amount);
-	else
-	{
-		if(distort_inside)
-			ret=context.get_color(Point(pos[0]+zr,pos[1]+zi));
-		else
-			ret=context.get_color(pos);
-
-		if(invert_inside)
-			ret=~ret;
+	rendering::EscapeTime::Handle escape_time = create_escape_time();
+	rendering::EscapeTime::Orbit orbit;
+	escape_time->iterate_row(pos, Vector(), &orbit, 1);
+	return escape_time->shade(pos, orbit, escape_time->iterations, ContextSource(context));
+}
 
-		if(shade_inside)
-			ret=Color::blend(gradient_inside(amount), ret, 1.0);
-	}
+rendering::EscapeTime::Handle
+Mandelbrot::create_escape_time() const
+{
+	etl::handle<MandelbrotEscapeTime> escape_time(new MandelbrotEscapeTime());
+	escape_time->formula = rendering::EscapeTime::MANDELBROT;
+	escape_time->iterations = param_iterations.get(int());
+	escape_time->bailout = param_bailout.get(Real());
+	escape_time->broken = param_broken.get(bool());
+	escape_time->lp = lp;
+
+	escape_time->distort_inside = param_distort_inside.get(bool());
+	escape_time->shade_inside = param_shade_inside.get(bool());
+	escape_time->solid_inside = param_solid_inside.get(bool());
+	escape_time->invert_inside = param_invert_inside.get(bool());
+	escape_time->gradient_inside = param_gradient_inside.get(Gradient());
+	escape_time->gradient_offset_inside = param_gradient_offset_inside.get(Real());
+	escape_time->gradient_loop_inside = param_gradient_loop_inside.get(bool());
+
+	escape_time->distort_outside = param_distort_outside.get(bool());
+	escape_time->shade_outside = param_shade_outside.get(bool());
+	escape_time->solid_outside = param_solid_outside.get(bool());
+	escape_time->invert_outside = param_invert_outside.get(bool());
+	escape_time->gradient_outside = param_gradient_outside.get(Gradient());
+	escape_time->smooth_outside = param_smooth_outside.get(bool());
+	escape_time->gradient_offset_outside = param_gradient_offset_outside.get(Real());
+	escape_time->gradient_scale_outside = param_gradient_scale_outside.get(Real());
+	return escape_time;
+}
 
-	return ret;
+rendering::Task::Handle
+Mandelbrot::build_rendering_task_vfunc(Context context) const
+{
+	const RendDesc desc = get_sub_renddesc(RendDesc());
+
+	rendering::TaskEscapeTime::Handle task(new rendering::TaskEscapeTime());
+	task->escape_time = create_escape_time();
+	task->context_rect = Rect(desc.get_tl(), desc.get_br());
+	task->context_size = VectorInt(desc.get_w(), desc.get_h());
+	if (task->escape_time->uses_source())
+		task->sub_task() = context.build_rendering_task();
+	return task;
 }
@@ -34,6 +34,7 @@
 #include <synfig/color.h>
 #include <synfig/angle.h>
 #include <synfig/gradient.h>
+#include <synfig/rendering/primitive/escapetime.h>
 
 /* === M A C R O S ========================================================= */
 
@@ -92,6 +93,8 @@ private:
 	//!Parameter: (Real)
 	ValueBase param_gradient_scale_outside;
 
+	rendering::EscapeTime::Handle create_escape_time() const;
+
 public:
 	Mandelbrot();
 
@@ -102,6 +105,7 @@ public:
 
 protected:
 	virtual RendDesc get_sub_renddesc_vfunc(const RendDesc &renddesc) const;
+	virtual rendering::Task::Handle build_rendering_task_vfunc(Context context) const;
 };
 
 }; // END of namespace lyr_std
@@ -48,6 +48,7 @@
 #include <synfig/transform.h>
 
 #include <synfig/curve_helper.h>
+#include <synfig/rendering/common/task/taskdistort.h>
 
 #endif
 
@@ -304,6 +305,68 @@ inline Point sphtrans(const Point &p, const Point &center, const Real &radius,
 	return sphtrans(p, center, radius, percent, type, tmp);
 }
 
+namespace {
+
+class SphereDistortion: public rendering::Distortion
+{
+public:
+	Point center;
+	Real radius;
+	Real percent;
+	int type;
+	bool clip;
+
+	SphereDistortion(): radius(), percent(), type(), clip() { }
+
+	//! points inside the sphere are moved inside the sphere only, and others are not moved,
+	//! so the same bounds are valid in both directions
+	Rect sphere_bounds(const Rect &rect) const
+	{
+		const Real r = fabs(radius);
+		Rect sphere;
+		switch(type)
+		{
+			case TYPE_NORMAL:
+				sphere = Rect(center).expand(r);
+				break;
+			case TYPE_DISTH:
+				sphere = Rect(center[0] - r, rect.miny, center[0] + r, rect.maxy);
+				break;
+			case TYPE_DISTV:
+				sphere = Rect(rect.minx, center[1] - r, rect.maxx, center[1] + r);
+				break;
+			default:
+				return rect;
+		}
+		return clip ? sphere : rect | sphere;
+	}
+
+protected:
+	virtual bool map_vfunc(const Point &point, Point &source_point) const
+	{
+		bool clipped;
+		source_point = sphtrans(point, center, radius, percent, type, clipped);
+		return !clip || !clipped;
+	}
+
+	virtual Rect map_bounds_vfunc(const Rect &rect) const
+		{ return sphere_bounds(rect); }
+	virtual Rect calc_bounds_vfunc(const Rect &source_bounds) const
+		{ return sphere_bounds(source_bounds); }
+
+	virtual bool hash_params_vfunc(rendering::TaskHash &hash) const
+	{
+		hash.add(center);
+		hash.add(radius);
+		hash.add(percent);
+		hash.add(type);
+		hash.add(clip);
+		return true;
+	}
+};
+
+} // end of anonimous namespace
+
 Layer::Handle
 Layer_SphereDistort::hit_check(Context context, const Point &pos)const
 {
@@ -632,3 +695,23 @@ Layer_SphereDistort::get_bounding_rect()const
 
 	return bounds;
 }
+
+rendering::Task::Handle
+Layer_SphereDistort::build_rendering_task_vfunc(Context context)const
+{
+	rendering::Task::Handle sub_task = context.build_rendering_task();
+	if (!sub_task)
+		return sub_task;
+
+	etl::handle<SphereDistortion> distortion(new SphereDistortion());
+	distortion->center = param_center.get(Vector());
+	distortion->radius = param_radius.get(double());
+	distortion->percent = param_amount.get(double());
+	distortion->type = param_type.get(int());
+	distortion->clip = param_clip.get(bool());
+
+	rendering::TaskDistort::Handle task_distort(new rendering::TaskDistort());
+	task_distort->distortion = distortion;
+	task_distort->sub_task() = sub_task;
+	return task_distort;
+}
@@ -42,6 +42,7 @@
 #include <synfig/renddesc.h>
 #include <synfig/value.h>
 #include <synfig/transform.h>
+#include <synfig/rendering/common/task/taskdistort.h>
 #include "twirl.h"
 
 #endif
@@ -62,6 +63,86 @@ SYNFIG_LAYER_SET_VERSION(Twirl,"0.1");
 
 /* === P R O C E D U R E S ================================================= */
 
+static Point
+twirl(const Point &pos, const Point &center, Real radius, const Angle &rotations,
+	bool distort_inside, bool distort_outside, bool reverse)
+{
+	Point centered(pos-center);
+	Real mag(centered.mag());
+
+	Angle a;
+
+	if((distort_inside || mag>radius) && (distort_outside || mag<radius))
+		a=rotations*((centered.mag()-radius)/radius);
+	else
+		return pos;
+
+	if(reverse)	a=-a;
+
+	const Real sin(Angle::sin(a).get());
+	const Real cos(Angle::cos(a).get());
+
+	Point twirled;
+	twirled[0]=cos*centered[0]-sin*centered[1];
+	twirled[1]=sin*centered[0]+cos*centered[1];
+
+	return twirled+center;
+}
+
+namespace {
+
+class TwirlDistortion: public rendering::Distortion
+{
+public:
+	Point center;
+	Real radius;
+	Angle rotations;
+	bool distort_inside;
+	bool distort_outside;
+
+	TwirlDistortion(): radius(), distort_inside(), distort_outside() { }
+
+	//! twirl keeps distance to center, so the same bounds are valid in both directions
+	Rect twirl_bounds(const Rect &rect) const
+	{
+		if (!distort_inside && !distort_outside)
+			return rect;
+		if (!distort_outside)
+			return rect | Rect(center).expand(fabs(radius));
+
+		Real max_mag = 0.0;
+		max_mag = std::max(max_mag, (Point(rect.minx, rect.miny) - center).mag());
+		max_mag = std::max(max_mag, (Point(rect.minx, rect.maxy) - center).mag());
+		max_mag = std::max(max_mag, (Point(rect.maxx, rect.miny) - center).mag());
+		max_mag = std::max(max_mag, (Point(rect.maxx, rect.maxy) - center).mag());
+		return rect | Rect(center).expand(max_mag);
+	}
+
+protected:
+	virtual bool map_vfunc(const Point &point, Point &source_point) const
+	{
+		source_point = twirl(point, center, radius, rotations, distort_inside, distort_outside, false);
+		return true;
+	}
+
+	virtual Rect map_bounds_vfunc(const Rect &rect) const
+		{ return twirl_bounds(rect); }
+	virtual Rect calc_bounds_vfunc(const Rect &source_bounds) const
+		{ return twirl_bounds(source_bounds); }
+
+	virtual bool hash_params_vfunc(rendering::TaskHash &hash) const
+	{
+		hash.add(center);
+		hash.add(radius);
+		hash.add(Angle::rad(rotations).get());
+		hash.add(distort_inside);
+		hash.add(distort_outside);
+		return true;
+	}
+};
+
+} // end of anonimous namespace
+
 /* === M E T H O D S ======================================================= */
 
 /* === E N T R Y P O I N T ================================================= */
@@ -145,32 +226,14 @@ Twirl::get_param_vocab()const
 Point
 Twirl::distort(const Point &pos,bool reverse)const
 {
-	Point center=param_center.get(Point());
-	Real radius=param_radius.get(Real());
-	Angle rotations=param_rotations.get(Angle());
-	bool distort_inside=param_distort_inside.get(bool());
-	bool distort_outside=param_distort_outside.get(bool());
-	
-	Point centered(pos-center);
-	Real mag(centered.mag());
-
-	Angle a;
-
-	if((distort_inside || mag>radius) && (distort_outside || mag<radius))
-		a=rotations*((centered.mag()-radius)/radius);
-	else
-		return pos;
-
-	if(reverse)	a=-a;
-
-	const Real sin(Angle::sin(a).get());
-	const Real cos(Angle::cos(a).get());
-
-	Point twirled;
-	twirled[0]=cos*centered[0]-sin*centered[1];
-	twirled[1]=sin*centered[0]+cos*centered[1];
-
-	return twirled+center;
+	return twirl(
+		pos,
+		param_center.get(Point()),
+		param_radius.get(Real()),
+		param_rotations.get(Angle()),
+		param_distort_inside.get(bool()),
+		param_distort_outside.get(bool()),
+		reverse );
 }
 
 Layer::Handle
@@ -279,5 +342,20 @@ Twirl::get_sub_renddesc_vfunc(const RendDesc &renddesc) const
 }
 
 rendering::Task::Handle
-Twirl::build_rendering_task_vfunc(Context context) const
-	{ return Layer::build_rendering_task_vfunc(context); }
+Twirl::build_composite_fork_task_vfunc(ContextParams /* context_params */, rendering::Task::Handle sub_task)const
+{
+	if (!sub_task)
+		return sub_task;
+
+	etl::handle<TwirlDistortion> distortion(new TwirlDistortion());
+	distortion->center = param_center.get(Point());
+	distortion->radius = param_radius.get(Real());
+	distortion->rotations = param_rotations.get(Angle());
+	distortion->distort_inside = param_distort_inside.get(bool());
+	distortion->distort_outside = param_distort_outside.get(bool());
+
+	rendering::TaskDistort::Handle task_distort(new rendering::TaskDistort());
+	task_distort->distortion = distortion;
+	task_distort->sub_task() = sub_task->clone_recursive();
+	return task_distort;
+}
@@ -49,7 +49,9 @@
 #if HAVE_FCNTL_H
  #include <fcntl.h>
 #endif
+#include <cmath>
 #include <iostream>
+#include <ETL/clock>
 #endif
 
 /* === M A C R O S ========================================================= */
@@ -64,6 +66,11 @@ using namespace etl;
  #define WIN32_PIPE_TO_PROCESSES
 #endif
 
+//! Number of recently decoded frames kept to scrub backwards
+#define FRAME_CACHE_SIZE 8
+//! Frames ahead of current position which are decoded instead of restart of the session
+#define MAX_SKIP_FRAMES 48
+
 /* === G L O B A L S ======================================================= */
 
 SYNFIG_IMPORTER_INIT(ffmpeg_mptr);
@@ -79,114 +86,115 @@ bool ffmpeg_mptr::is_animated()
 	return true;
 }
 
-bool
-ffmpeg_mptr::seek_to(const Time& time)
+void
+ffmpeg_mptr::stop_session()
 {
-	//if(frame<cur_frame || !file)
-	//{
-		if(file)
-		{
+	if(file)
+	{
 #if defined(WIN32_PIPE_TO_PROCESSES)
-			_pclose(file);
+		_pclose(file);
 #elif defined(UNIX_PIPE_TO_PROCESSES)
-			fclose(file);
-			int status;
-			waitpid(pid,&status,0);
+		fclose(file);
+		int status;
+		waitpid(pid,&status,0);
 #endif
-		}
-		
-		// FIXME: 24 fps is hardcoded now, but in fact we have to get it from canvas
-		//float position = (frame+1)/24; // ffmpeg didn't work with 0 frame
-		//float position = 1000/24; // ffmpeg didn't work with 0 frame
-		const std::string position = time.get_string(Time::FORMAT_NORMAL);
+		file = NULL;
+	}
+	cur_frame = -1;
+}
+
+bool
+ffmpeg_mptr::seek_to(int frame)
+{
+	stop_session();
+
+	// ffmpeg resamples the video to the frame rate of the session,
+	// so each frame read from the pipe is the next frame of the canvas
+	const std::string position = Time(frame/fps).get_string(Time::FORMAT_NORMAL);
+	const std::string rate = strprintf("%d/1000", (int)std::floor(fps*1000.f + 0.5f));
 
 #if defined(WIN32_PIPE_TO_PROCESSES)
 
-		std::string command;
-		
-		String binary_path = synfig::get_binary_path("");
-		if (binary_path != "")
-			binary_path = etl::dirname(binary_path)+ETL_DIRECTORY_SEPARATOR;
-		binary_path += "ffmpeg.exe";
+	std::string command;
+
+	String binary_path = synfig::get_binary_path("");
+	if (binary_path != "")
+		binary_path = etl::dirname(binary_path)+ETL_DIRECTORY_SEPARATOR;
+	binary_path += "ffmpeg.exe";
 
-		command=strprintf("\"%s\" -ss %s -i \"%s\" -vframes 1 -an -f image2pipe -vcodec ppm -\n", binary_path.c_str(), position.c_str(), identifier.filename.c_str());
-		
-		// This covers the dumb cmd.exe behavior.
-		// See: http://eli.thegreenplace.net/2011/01/28/on-spaces-in-the-paths-of-programs-and-files-on-windows/
-		command = "\"" + command + "\"";
+	command=strprintf("\"%s\" -nostdin -ss %s -i \"%s\" -an -r %s -f image2pipe -vcodec ppm -\n", binary_path.c_str(), position.c_str(), identifier.filename.c_str(), rate.c_str());
 
-		file=_popen(command.c_str(),POPEN_BINARY_READ_TYPE);
+	// This covers the dumb cmd.exe behavior.
+	// See: http://eli.thegreenplace.net/2011/01/28/on-spaces-in-the-paths-of-programs-and-files-on-windows/
+	command = "\"" + command + "\"";
+
+	file=_popen(command.c_str(),POPEN_BINARY_READ_TYPE);
 
 #elif defined(UNIX_PIPE_TO_PROCESSES)
 
-		int p[2];
+	int p[2];
 
-		if (pipe(p)) {
-			std::cerr<<"Unable to open pipe to ffmpeg (no pipe)"<<std::endl;
-			return false;
-		};
+	if (pipe(p)) {
+		std::cerr<<"Unable to open pipe to ffmpeg (no pipe)"<<std::endl;
+		return false;
+	};
 
-		pid = fork();
+	pid = fork();
 
-		if (pid == -1) {
-			std::cerr<<"Unable to open pipe to ffmpeg (pid == -1)"<<std::endl;
-			return false;
-		}
+	if (pid == -1) {
+		std::cerr<<"Unable to open pipe to ffmpeg (pid == -1)"<<std::endl;
+		return false;
+	}
 
-		if (pid == 0){
-			// Child process
-			// Close pipein, not needed
-			close(p[0]);
-			// Dup pipein to stdout
-			if( dup2( p[1], STDOUT_FILENO ) == -1 ){
-				std::cerr<<"Unable to open pipe to ffmpeg (dup2( p[1], STDOUT_FILENO ) == -1)"<<std::endl;
-				return false;
-			}
-			// Close the unneeded pipein
-			close(p[1]);
-			/*std::string command = strprintf("\"%s\" -ss '%s' -i \"%s\" -vframes 1 -an -f image2pipe -vcodec ppm -\n", "ffmpeg", position2, identifier.filename.c_str());
-			synfig::warning("ffmpeg command: '%s'", command.c_str());*/
-			execlp("ffmpeg", "ffmpeg", "-ss", position.c_str(), "-i", identifier.filename.c_str(), "-vframes", "1","-an", "-f", "image2pipe", "-vcodec", "ppm", "-", (const char *)NULL);
-			// We should never reach here unless the exec failed
-			std::cerr<<"Unable to open pipe to ffmpeg (exec failed)"<<std::endl;
-			_exit(1);
-		} else {
-			// Parent process
-			// Close pipeout, not needed
-			close(p[1]);
-			// Save pipein to file handle, will read from it later
-			file = fdopen(p[0], "rb");
+	if (pid == 0){
+		// Child process
+		// Close pipein, not needed
+		close(p[0]);
+		// Dup pipein to stdout
+		if( dup2( p[1], STDOUT_FILENO ) == -1 ){
+			std::cerr<<"Unable to open pipe to ffmpeg (dup2( p[1], STDOUT_FILENO ) == -1)"<<std::endl;
+			return false;
 		}
+		// Close the unneeded pipein
+		close(p[1]);
+		execlp("ffmpeg", "ffmpeg", "-nostdin", "-ss", position.c_str(), "-i", identifier.filename.c_str(), "-an", "-r", rate.c_str(), "-f", "image2pipe", "-vcodec", "ppm", "-", (const char *)NULL);
+		// We should never reach here unless the exec failed
+		std::cerr<<"Unable to open pipe to ffmpeg (exec failed)"<<std::endl;
+		_exit(1);
+	} else {
+		// Parent process
+		// Close pipeout, not needed
+		close(p[1]);
+		// Save pipein to file handle, will read from it later
+		file = fdopen(p[0], "rb");
+	}
 
 #else
 	#error There are no known APIs for creating child processes
 #endif
 
-		if(!file)
-		{
-			std::cerr<<"Unable to open pipe to ffmpeg"<<std::endl;
-			return false;
-		}
-		cur_frame=-1;
-	//}
-
-	//while(cur_frame<frame-1)
-	//{
-	//	cerr<<"Seeking to..."<<frame<<'('<<cur_frame<<')'<<endl;
-	//	if(!grab_frame())
-	//		return false;
-	//}
+	if(!file)
+	{
+		std::cerr<<"Unable to open pipe to ffmpeg"<<std::endl;
+		return false;
+	}
+	cur_frame=frame;
+	++sessions_count;
 	return true;
 }
 
 bool
-ffmpeg_mptr::grab_frame(void)
+ffmpeg_mptr::grab_frame(Frame &frame)
 {
 	if(!file)
 	{
 		std::cerr<<"unable to open "<<identifier.filename.c_str()<<std::endl;
 		return false;
 	}
+
+	etl::clock timer;
+	timer.reset();
+
 	int w,h;
 	float divisor;
 	char cookie[2];
@@ -204,31 +212,31 @@ ffmpeg_mptr::grab_frame(void)
 	}
 
 	fgetc(file);
-	fscanf(file,"%d %d\n",&w,&h);
-	fscanf(file,"%f",&divisor);
+	if (fscanf(file,"%d %d\n",&w,&h) != 2 || fscanf(file,"%f",&divisor) != 1)
+		return false;
 	fgetc(file);
 
-	if(feof(file))
+	if(feof(file) || w <= 0 || h <= 0)
 		return false;
 
-	frame.set_wh(w, h);
-	const ColorReal k = 1/255.0;
-	for(int y = 0; y < frame.get_h(); ++y)
-		for(int x = 0; x < frame.get_w(); ++x)
-		{
-			if(feof(file))
-				return false;
-			ColorReal r = k*(unsigned char)fgetc(file);
-			ColorReal g = k*(unsigned char)fgetc(file);
-			ColorReal b = k*(unsigned char)fgetc(file);
-			frame[y][x] = Color(r, g, b);
-		}
-	cur_frame++;
+	// read whole raster at once
+	frame.w = w;
+	frame.h = h;
+	frame.data.resize(3*(size_t)w*(size_t)h);
+	if (fread(&frame.data.front(), 1, frame.data.size(), file) != frame.data.size())
+		return false;
+
+	frame.index = cur_frame++;
+	++decoded_frames_count;
+	decode_time += timer();
 	return true;
 }
 
 ffmpeg_mptr::ffmpeg_mptr(const synfig::FileSystem::Identifier &identifier):
-	synfig::Importer(identifier)
+	synfig::Importer(identifier),
+	sessions_count(),
+	decoded_frames_count(),
+	decode_time()
 {
 #ifdef HAVE_TERMIOS_H
 	tcgetattr (0, &oldtty);
@@ -240,30 +248,70 @@ ffmpeg_mptr::ffmpeg_mptr(const synfig::FileSystem::Identifier &identifier):
 
 ffmpeg_mptr::~ffmpeg_mptr()
 {
-	if(file)
-	{
-#if defined(WIN32_PIPE_TO_PROCESSES)
-		_pclose(file);
-#elif defined(UNIX_PIPE_TO_PROCESSES)
-		fclose(file);
-		int status;
-		waitpid(pid,&status,0);
-#endif
-	}
+	stop_session();
 #ifdef HAVE_TERMIOS_H
 	tcsetattr(0,TCSANOW,&oldtty);
 #endif
+	if (decoded_frames_count)
+		synfig::info("ffmpeg_mptr: %s: decoded %d frames in %d session(s), %f seconds, %.1f frames/sec",
+			identifier.filename.c_str(),
+			decoded_frames_count,
+			sessions_count,
+			decode_time,
+			decode_time > 0.0 ? decoded_frames_count/decode_time : 0.0 );
 }
 
 bool
-ffmpeg_mptr::get_frame(synfig::Surface &surface, const synfig::RendDesc &/*renddesc*/, Time time, synfig::ProgressCallback *)
+ffmpeg_mptr::get_frame(synfig::Surface &surface, const synfig::RendDesc &renddesc, Time time, synfig::ProgressCallback *)
 {
-	synfig::warning("time: %f", (float)time);
-	if(!seek_to(time))
-		return false;
-	if(!grab_frame())
-		return false;
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// frames are numbered in frame rate of the canvas
+	float rate = renddesc.get_frame_rate() > 0.f ? renddesc.get_frame_rate() : fps;
+	if (std::fabs(rate - fps) > 1e-5)
+	{
+		stop_session();
+		frames.clear();
+		fps = rate;
+	}
+	int index = std::max(0, (int)std::floor((double)time*fps + 0.5));
+
+	// look for recently decoded frame
+	const Frame *found = NULL;
+	for(std::deque<Frame>::const_iterator i = frames.begin(); i != frames.end(); ++i)
+		if (i->index == index)
+			{ found = &*i; break; }
+
+	if (!found)
+	{
+		// restart the session if frame is behind or too far ahead
+		if (!file || index < cur_frame || index > cur_frame + MAX_SKIP_FRAMES)
+			if (!seek_to(index))
+				return false;
 
-	surface=frame;
+		while(cur_frame <= index)
+		{
+			if (frames.size() >= FRAME_CACHE_SIZE)
+				frames.pop_front();
+			frames.push_back(Frame());
+			if (!grab_frame(frames.back()))
+			{
+				frames.pop_back();
+				stop_session();
+				return false;
+			}
+		}
+		found = &frames.back();
+	}
+
+	surface.set_wh(found->w, found->h);
+	const ColorReal k = 1/255.0;
+	const unsigned char *src = &found->data.front();
+	for(int y = 0; y < found->h; ++y)
+	{
+		Color *dst = surface[y];
+		for(int x = 0; x < found->w; ++x, src += 3)
+			dst[x] = Color(k*src[0], k*src[1], k*src[2]);
+	}
 	return true;
 }
@@ -33,6 +33,9 @@
 #include <synfig/importer.h>
 #include <sys/types.h>
 #include <cstdio>
+#include <deque>
+#include <mutex>
+#include <vector>
 #ifdef HAVE_TERMIOS_H
 #include <termios.h>
 #endif
@@ -44,24 +47,49 @@
 
 /* === C L A S S E S & S T R U C T S ======================================= */
 
+/*!	\class ffmpeg_mptr
+**	\brief Imports frames of video files through ffmpeg process.
+**	One ffmpeg process (decoder session) streams frames sequentially
+**	through a pipe, it is restarted only when requested frame is before
+**	the recently decoded frames or too far ahead of the current position.
+*/
 class ffmpeg_mptr : public synfig::Importer
 {
 	SYNFIG_IMPORTER_MODULE_EXT
 public:
+	//! Raw RGB frame read from ffmpeg
+	struct Frame
+	{
+		int index;
+		int w, h;
+		std::vector<unsigned char> data;
+		Frame(): index(-1), w(), h() { }
+	};
+
 private:
 #ifdef HAVE_FORK
 	pid_t pid = -1;
 #endif
 	FILE *file;
+	//! index of the next frame which will be read from the session
 	int cur_frame;
-	synfig::Surface frame;
+	//! frame rate of the session, frame index is time*fps
 	float fps;
+	//! recently decoded frames to scrub backwards without restart of the session
+	std::deque<Frame> frames;
+	std::mutex mutex;
 #ifdef HAVE_TERMIOS_H
 	struct termios oldtty;
 #endif
 
-	bool seek_to(const synfig::Time& time);
-	bool grab_frame(void);
+	// statistics
+	int sessions_count;
+	int decoded_frames_count;
+	double decode_time;
+
+	bool seek_to(int frame);
+	void stop_session();
+	bool grab_frame(Frame &frame);
 
 public:
 	ffmpeg_mptr(const synfig::FileSystem::Identifier &identifier);
@@ -44,6 +44,7 @@
 #include <synfig/angle.h>
 
 #include "conicalgradient.h"
+#include "taskgradient.h"
 
 #endif
 
@@ -254,3 +255,16 @@ ConicalGradient::accelerated_render(Context context,Surface *surface,int quality
 
 	return true;
 }
+
+rendering::Task::Handle
+ConicalGradient::build_composite_task_vfunc(ContextParams /*context_params*/)const
+{
+	Point center = param_center.get(Point());
+	Angle angle = param_angle.get(Angle());
+
+	TaskConicalGradient::Handle task(new TaskConicalGradient());
+	task->gradient = compiled_gradient;
+	task->angle = Angle::rot(angle).get();
+	task->transformation->matrix = Matrix().set_translate(center);
+	return task;
+}
@@ -34,6 +34,7 @@
 #endif
 
 #include "lineargradient.h"
+#include "taskgradient.h"
 
 #include <synfig/localization.h>
 
@@ -268,3 +269,18 @@ LinearGradient::accelerated_render(Context context,Surface *surface,int quality,
 	return true;
 }
 
+rendering::Task::Handle
+LinearGradient::build_composite_task_vfunc(ContextParams context_params)const
+{
+	Params params;
+	fill_params(params);
+
+	Vector axis = params.p2 - params.p1;
+	if (approximate_zero(axis.mag_squared()))
+		return Layer_Composite::build_composite_task_vfunc(context_params);
+
+	TaskLinearGradient::Handle task(new TaskLinearGradient());
+	task->gradient = params.gradient;
+	task->transformation->matrix = Matrix(axis, axis.perp(), params.p1);
+	return task;
+}
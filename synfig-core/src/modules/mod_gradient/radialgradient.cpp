@@ -44,6 +44,7 @@
 #include <synfig/value.h>
 
 #include "radialgradient.h"
+#include "taskgradient.h"
 
 #endif
 
@@ -242,4 +243,16 @@ RadialGradient::accelerated_render(Context context,Surface *surface,int quality,
 	return true;
 }
 
+rendering::Task::Handle
+RadialGradient::build_composite_task_vfunc(ContextParams context_params)const
+{
+	Point center = param_center.get(Point());
+	Real radius = param_radius.get(Real());
+	if (!approximate_greater(radius, Real(0)))
+		return Layer_Composite::build_composite_task_vfunc(context_params);
 
+	TaskRadialGradient::Handle task(new TaskRadialGradient());
+	task->gradient = compiled_gradient;
+	task->transformation->matrix = Matrix(Vector(radius, 0.0), Vector(0.0, radius), center);
+	return task;
+}
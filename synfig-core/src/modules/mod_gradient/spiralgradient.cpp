@@ -44,6 +44,7 @@
 #include <synfig/value.h>
 
 #include "spiralgradient.h"
+#include "taskgradient.h"
 
 #endif
 
@@ -251,6 +252,18 @@ SpiralGradient::accelerated_render(Context context,Surface *surface,int quality,
 	return true;
 }
 
-
-
-
+rendering::Task::Handle
+SpiralGradient::build_composite_task_vfunc(ContextParams context_params)const
+{
+	Point center = param_center.get(Point());
+	Real radius = param_radius.get(Real());
+	if (!approximate_greater(radius, Real(0)))
+		return Layer_Composite::build_composite_task_vfunc(context_params);
+
+	TaskSpiralGradient::Handle task(new TaskSpiralGradient());
+	task->gradient = compiled_gradient;
+	task->angle = Angle::rot(param_angle.get(Angle())).get();
+	task->clockwise = param_clockwise.get(bool());
+	task->transformation->matrix = Matrix(Vector(radius, 0.0), Vector(0.0, radius), center);
+	return task;
+}
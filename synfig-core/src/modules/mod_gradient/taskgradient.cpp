@@ -0,0 +1,399 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file taskgradient.cpp
+**	\brief Rendering tasks for gradient layers
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <ETL/handle>
+
+#include <synfig/real.h>
+#include <synfig/surface.h>
+#include <synfig/rendering/common/task/taskblend.h>
+#include <synfig/rendering/software/task/tasksw.h>
+
+#include "taskgradient.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+rendering::Task::Token TaskGradient::token(
+	DescAbstract<TaskGradient>("Gradient") );
+rendering::Task::Token TaskLinearGradient::token(
+	DescAbstract<TaskLinearGradient, TaskGradient>("LinearGradient") );
+rendering::Task::Token TaskRadialGradient::token(
+	DescAbstract<TaskRadialGradient, TaskGradient>("RadialGradient") );
+rendering::Task::Token TaskConicalGradient::token(
+	DescAbstract<TaskConicalGradient, TaskGradient>("ConicalGradient") );
+rendering::Task::Token TaskSpiralGradient::token(
+	DescAbstract<TaskSpiralGradient, TaskGradient>("SpiralGradient") );
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+//! Lookup table of averaged gradient colors.
+//! CompiledGradient::average() searches the segment for each call,
+//! so colors are precalculated for the whole gradient and interpolated.
+//! When supersample width is not fixed the tables are built on demand
+//! for the power of two widths and interpolated like mipmap levels.
+//! Tables are safe to read from several threads.
+class GradientLUT: public etl::shared_object
+{
+public:
+	typedef etl::handle<GradientLUT> Handle;
+
+	enum {
+		MIN_SIZE = 64,
+		MAX_SIZE = 16384,
+		LEVELS   = 14 //!< supersample width from 1 to 2^-13
+	};
+
+private:
+	struct Level {
+		Real t0, k;  // index = (t - t0)*k
+		int size;
+		std::vector<Color> colors; // alpha premulted, size + 1 entries
+		std::once_flag once;
+		Level(): t0(), k(), size() { }
+	};
+
+	const CompiledGradient gradient;
+	const Real supersample;
+	Level fixed;
+	mutable Level levels[LEVELS];
+
+	void build(Level &level, Real supersample) const
+	{
+		bool repeat = gradient.get_repeat();
+		Real t0 = repeat ? 0.0 : -supersample;
+		Real length = repeat ? 1.0 : 1.0 + 2.0*supersample;
+		int size = (int)std::ceil(8.0*length/std::max(supersample, real_low_precision<Real>()));
+		size = std::max((int)MIN_SIZE, std::min((int)MAX_SIZE, size));
+
+		level.t0 = t0;
+		level.k = size/length;
+		level.size = size;
+		level.colors.resize(size + 1);
+
+		Real step = length/size;
+		Real half = 0.5*supersample;
+		for(int i = 0; i <= size; ++i) {
+			Real t = t0 + i*step;
+			Color c = gradient.average(t - half, t + half);
+			level.colors[i] = c.premult_alpha();
+		}
+	}
+
+	static Color get_premulted(const Level &level, Real t, bool repeat)
+	{
+		Real u = repeat ? (t - std::floor(t))*level.k : (t - level.t0)*level.k;
+		if (!(u > 0.0)) u = 0.0; // also catches NaN
+		if (u > level.size) u = level.size;
+		int i = std::min((int)u, level.size - 1);
+		ColorReal f = ColorReal(u - i);
+
+		const Color &a = level.colors[i];
+		const Color &b = level.colors[i + 1];
+		return a + (b - a)*f;
+	}
+
+	static Color demult(const Color &c)
+	{
+		if (approximate_equal_lp(c.get_a(), ColorReal(0)))
+			return Color();
+		return c.demult_alpha();
+	}
+
+	const Level& get_level(int index) const
+	{
+		Level &level = levels[index];
+		std::call_once(level.once, &GradientLUT::build, this, std::ref(level), std::ldexp(1.0, -index));
+		return level;
+	}
+
+public:
+	//! \a supersample is the fixed supersample width, or zero if it is not fixed
+	GradientLUT(const CompiledGradient &gradient, Real supersample):
+		gradient(gradient), supersample(supersample)
+		{ if (supersample) build(fixed, supersample); }
+
+	Real get_supersample() const
+		{ return supersample; }
+
+	//! color for the fixed supersample width
+	Color get(Real t) const
+		{ return demult(get_premulted(fixed, t, gradient.get_repeat())); }
+
+	//! color for any supersample width,
+	//! interpolated between two nearest levels
+	Color get(Real t, Real supersample) const
+	{
+		bool repeat = gradient.get_repeat();
+		int index = supersample > 0.0 ? -std::ilogb(supersample) : (int)LEVELS;
+		if (index >= (int)LEVELS)
+			return demult(get_premulted(get_level(LEVELS - 1), t, repeat));
+		if (index <= 0)
+			return demult(get_premulted(get_level(0), t, repeat));
+
+		// supersample is in range [2^-index, 2^(1-index))
+		ColorReal f = ColorReal(std::ldexp(supersample, index) - 1.0);
+		Color a = get_premulted(get_level(index), t, repeat);
+		Color b = get_premulted(get_level(index - 1), t, repeat);
+		return demult(a + (b - a)*f);
+	}
+};
+
+
+//! Common part of software gradient tasks
+class TaskGradientSW: public rendering::TaskSW,
+	public rendering::TaskInterfaceBlendToTarget,
+	public rendering::TaskInterfaceSplit
+{
+private:
+	//! Lookup table of the task, parts of split task are copies
+	//! and share it, so it is built by the first part which runs
+	class SharedLUT: public etl::shared_object
+	{
+	public:
+		std::mutex mutex;
+		GradientLUT::Handle lut;
+	};
+
+	etl::handle<SharedLUT> shared_lut;
+
+	GradientLUT::Handle get_lut(const TaskGradient &task, Real supersample) const
+	{
+		std::lock_guard<std::mutex> lock(shared_lut->mutex);
+		GradientLUT::Handle &lut = shared_lut->lut;
+		if (!lut)
+			lut = new GradientLUT(task.gradient, supersample);
+		// parts of split task have the same pixel size, but other copies of task may not
+		if (!approximate_equal_lp(lut->get_supersample(), supersample))
+			return new GradientLUT(task.gradient, supersample);
+		return lut;
+	}
+
+public:
+	TaskGradientSW(): shared_lut(new SharedLUT()) { }
+
+	virtual void on_target_set_as_source() {
+		rendering::Task *task = dynamic_cast<rendering::Task*>(this);
+		assert(task);
+		rendering::Task::Handle &subtask = task->sub_task(0);
+		if ( subtask
+		  && subtask->target_surface == task->target_surface
+		  && !Color::is_straight(blend_method) )
+		{
+			task->trunc_by_bounds();
+			subtask->source_rect = task->source_rect;
+			subtask->target_rect = task->target_rect;
+		}
+	}
+
+	virtual Color::BlendMethodFlags get_supported_blend_methods() const
+		{ return Color::BLEND_METHODS_ALL; }
+
+protected:
+	//! Returns supersample width if it is the same for all pixels, or zero otherwise
+	virtual Real get_fixed_supersample(const Vector &/* pixel_size */) const
+		{ return 0.0; }
+
+	//! Calculates colors for the row of pixels,
+	//! \a p is the position of first pixel in the unit space of gradient
+	virtual void fill_row(const GradientLUT &lut, const Vector &pixel_size, Vector p, const Vector &dx, Color *row, int count) const = 0;
+
+	bool run_gradient(const TaskGradient &task) const
+	{
+		if (!task.is_valid())
+			return true;
+
+		Vector ppu = task.get_pixels_per_unit();
+
+		Matrix bounds_transfromation;
+		bounds_transfromation.m00 = ppu[0];
+		bounds_transfromation.m11 = ppu[1];
+		bounds_transfromation.m20 = task.target_rect.minx - ppu[0]*task.source_rect.minx;
+		bounds_transfromation.m21 = task.target_rect.miny - ppu[1]*task.source_rect.miny;
+
+		Matrix matrix = bounds_transfromation * task.transformation->matrix;
+		if (!matrix.is_invertible())
+			return true;
+		Matrix inv_matrix = matrix.get_inverted();
+
+		const RectInt &r = task.target_rect;
+		int tw = r.get_width();
+		Vector dx = inv_matrix.axis_x();
+		Vector dy = inv_matrix.axis_y();
+		Vector p = inv_matrix.get_transformed( Vector((Real)r.minx, (Real)r.miny) );
+		Vector pixel_size(dx.mag(), dy.mag());
+
+		GradientLUT::Handle lut = get_lut(task, get_fixed_supersample(pixel_size));
+
+		LockWrite la(&task);
+		if (!la)
+			return false;
+
+		synfig::Surface &surface = la->get_surface();
+		std::vector<Color> row(tw);
+		for(int y = r.miny; y < r.maxy; ++y, p += dy) {
+			fill_row(*lut, pixel_size, p, dx, &row.front(), tw);
+			Color *dest = surface[y] + r.minx;
+			if (blend)
+				Color::blend_span(dest, &row.front(), tw, amount, blend_method);
+			else
+				std::copy(row.begin(), row.end(), dest);
+		}
+
+		return true;
+	}
+};
+
+
+class TaskLinearGradientSW: public TaskLinearGradient, public TaskGradientSW
+{
+public:
+	typedef etl::handle<TaskLinearGradientSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const
+		{ return run_gradient(*this); }
+
+protected:
+	virtual Real get_fixed_supersample(const Vector &pixel_size) const
+		{ return pixel_size[0]; }
+
+	virtual void fill_row(const GradientLUT &lut, const Vector&, Vector p, const Vector &dx, Color *row, int count) const
+	{
+		for(Color *end = row + count; row < end; ++row, p += dx)
+			*row = lut.get(p[0]);
+	}
+};
+
+
+class TaskRadialGradientSW: public TaskRadialGradient, public TaskGradientSW
+{
+public:
+	typedef etl::handle<TaskRadialGradientSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const
+		{ return run_gradient(*this); }
+
+protected:
+	virtual Real get_fixed_supersample(const Vector &pixel_size) const
+		{ return 1.2*pixel_size[0]; }
+
+	virtual void fill_row(const GradientLUT &lut, const Vector&, Vector p, const Vector &dx, Color *row, int count) const
+	{
+		for(Color *end = row + count; row < end; ++row, p += dx)
+			*row = lut.get(p.mag());
+	}
+};
+
+
+class TaskConicalGradientSW: public TaskConicalGradient, public TaskGradientSW
+{
+public:
+	typedef etl::handle<TaskConicalGradientSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const
+		{ return run_gradient(*this); }
+
+protected:
+	virtual void fill_row(const GradientLUT &lut, const Vector &pixel_size, Vector p, const Vector &dx, Color *row, int count) const
+	{
+		const Real k = 1.0/(2.0*PI);
+		const Real half_pw = 0.5*pixel_size[0];
+		const Real half_ph = 0.5*pixel_size[1];
+		for(Color *end = row + count; row < end; ++row, p += dx) {
+			Real t = std::atan2(-p[1], p[0])*k + angle;
+			Real supersample = std::fabs(p[0]) < half_pw && std::fabs(p[1]) < half_ph
+			                 ? 0.5 : pixel_size[0]*k/p.mag();
+			*row = lut.get(t, supersample);
+		}
+	}
+};
+
+
+class TaskSpiralGradientSW: public TaskSpiralGradient, public TaskGradientSW
+{
+public:
+	typedef etl::handle<TaskSpiralGradientSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const
+		{ return run_gradient(*this); }
+
+protected:
+	virtual void fill_row(const GradientLUT &lut, const Vector &pixel_size, Vector p, const Vector &dx, Color *row, int count) const
+	{
+		const Real k = 1.0/(2.0*PI);
+		const Real pw = 1.41421*pixel_size[0];
+		for(Color *end = row + count; row < end; ++row, p += dx) {
+			Real dist = p.mag();
+			Real rot = std::atan2(-p[1], p[0])*k + angle;
+			Real t = clockwise ? dist + rot : dist - rot;
+			Real supersample = std::max(0.00001, (pw + pw*k/dist)*0.5);
+			*row = lut.get(t, supersample);
+		}
+	}
+};
+
+} // END of anonymous namespace
+
+rendering::Task::Token TaskLinearGradientSW::token(
+	DescReal<TaskLinearGradientSW, TaskLinearGradient>("LinearGradientSW") );
+rendering::Task::Token TaskRadialGradientSW::token(
+	DescReal<TaskRadialGradientSW, TaskRadialGradient>("RadialGradientSW") );
+rendering::Task::Token TaskConicalGradientSW::token(
+	DescReal<TaskConicalGradientSW, TaskConicalGradient>("ConicalGradientSW") );
+rendering::Task::Token TaskSpiralGradientSW::token(
+	DescReal<TaskSpiralGradientSW, TaskSpiralGradient>("SpiralGradientSW") );
+
+/* === M E T H O D S ======================================================= */
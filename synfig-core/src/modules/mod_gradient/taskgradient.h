@@ -0,0 +1,112 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file taskgradient.h
+**	\brief Rendering tasks for gradient layers
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_TASKGRADIENT_H
+#define __SYNFIG_TASKGRADIENT_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <synfig/gradient.h>
+#include <synfig/rendering/task.h>
+#include <synfig/rendering/common/task/tasktransformation.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+using namespace synfig;
+
+//! Base of gradient tasks.
+//! Gradient is defined in its own unit space, \a transformation maps it to the layer space.
+class TaskGradient: public rendering::Task, public rendering::TaskInterfaceTransformation
+{
+public:
+	typedef etl::handle<TaskGradient> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	CompiledGradient gradient;
+	rendering::Holder<rendering::TransformationAffine> transformation;
+
+	virtual rendering::Transformation::Handle get_transformation() const
+		{ return transformation.handle(); }
+};
+
+
+//! Gradient position is the x coordinate
+class TaskLinearGradient: public TaskGradient
+{
+public:
+	typedef etl::handle<TaskLinearGradient> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+};
+
+
+//! Gradient position is the distance from origin
+class TaskRadialGradient: public TaskGradient
+{
+public:
+	typedef etl::handle<TaskRadialGradient> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+};
+
+
+//! Gradient position is the angle around origin (in rotations)
+class TaskConicalGradient: public TaskGradient
+{
+public:
+	typedef etl::handle<TaskConicalGradient> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	Real angle; //!< in rotations
+
+	TaskConicalGradient(): angle() { }
+};
+
+
+//! Gradient position is the distance from origin plus or minus the angle (in rotations)
+class TaskSpiralGradient: public TaskGradient
+{
+public:
+	typedef etl::handle<TaskSpiralGradient> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	Real angle; //!< in rotations
+	bool clockwise;
+
+	TaskSpiralGradient(): angle(), clockwise() { }
+};
+
+/* === E N D =============================================================== */
+
+#endif
@@ -33,7 +33,10 @@
 #	include <config.h>
 #endif
 
+#include <vector>
+
 #include <glib/gstdio.h>
+#include <synfig/general.h>
 #include "trgt_jpeg.h"
 #endif
 
@@ -51,6 +54,55 @@ SYNFIG_TARGET_SET_VERSION(jpeg_trgt,"0.1");
 
 /* === M E T H O D S ======================================================= */
 
+//! Whole converted frame, written into its own file by a thread of ThreadPool
+class jpeg_trgt::FrameJob: public Target_Scanline::EncodeJob
+{
+public:
+	String filename;
+	int w, h;
+	int quality;
+	std::vector<unsigned char> pixels;
+
+	FrameJob(): w(), h(), quality() { }
+
+	unsigned char* get_row(int y)
+		{ return &pixels[(size_t)y*w*3]; }
+
+	virtual bool run()
+	{
+		FILE *file = g_fopen(filename.c_str(), POPEN_BINARY_WRITE_TYPE);
+		if (!file)
+		{
+			synfig::error("jpeg_trgt: unable to open file '%s'", filename.c_str());
+			return false;
+		}
+
+		struct jpeg_compress_struct cinfo;
+		struct jpeg_error_mgr jerr;
+		cinfo.err = jpeg_std_error(&jerr);
+		jpeg_create_compress(&cinfo);
+		jpeg_stdio_dest(&cinfo, file);
+
+		cinfo.image_width = w;
+		cinfo.image_height = h;
+		cinfo.input_components = 3;
+		cinfo.in_color_space = JCS_RGB;
+		jpeg_set_defaults(&cinfo);
+		jpeg_set_quality(&cinfo, quality, TRUE);
+		jpeg_start_compress(&cinfo, TRUE);
+
+		for(int y = 0; y < h; ++y)
+		{
+			JSAMPROW row = get_row(y);
+			jpeg_write_scanlines(&cinfo, &row, 1);
+		}
+
+		jpeg_finish_compress(&cinfo);
+		jpeg_destroy_compress(&cinfo);
+		return fclose(file) == 0;
+	}
+};
+
 jpeg_trgt::jpeg_trgt(const char *Filename, const synfig::TargetParam &params):
 	file(nullptr),
 	quality(95),
@@ -62,7 +114,8 @@ jpeg_trgt::jpeg_trgt(const char *Filename, const synfig::TargetParam &params):
 	filename(Filename),
 	buffer(nullptr),
 	color_buffer(nullptr),
-	sequence_separator(params.sequence_separator)
+	sequence_separator(params.sequence_separator),
+	frame_row()
 {
 	set_alpha_mode(TARGET_ALPHA_MODE_FILL);
 }
@@ -101,6 +154,9 @@ jpeg_trgt::start_frame(synfig::ProgressCallback *callback)
 
 	if(file && file!=stdout)
 		fclose(file);
+	file=nullptr;
+	frame_job.reset();
+
 	if(filename=="-")
 	{
 		if(callback)callback->task(strprintf("(stdout) %d",imagecount).c_str());
@@ -112,8 +168,25 @@ jpeg_trgt::start_frame(synfig::ProgressCallback *callback)
 						   sequence_separator +
 						   etl::strprintf("%04d",imagecount) +
 						   filename_extension(filename));
-		file=g_fopen(newfilename.c_str(),POPEN_BINARY_WRITE_TYPE);
 		if(callback)callback->task(newfilename);
+
+		// the whole frame is collected and compressed in background
+		if (is_encoding_async())
+		{
+			frame_job = new FrameJob();
+			frame_job->filename = newfilename;
+			frame_job->w = w;
+			frame_job->h = h;
+			frame_job->quality = quality;
+			frame_job->pixels.resize((size_t)w*h*3);
+			frame_row = 0;
+
+			delete [] color_buffer;
+			color_buffer=new Color[w];
+			return true;
+		}
+
+		file=g_fopen(newfilename.c_str(),POPEN_BINARY_WRITE_TYPE);
 	}
 	else
 	{
@@ -163,6 +236,19 @@ jpeg_trgt::start_frame(synfig::ProgressCallback *callback)
 void
 jpeg_trgt::end_frame()
 {
+	if (frame_job)
+	{
+		if (frame_row == frame_job->h)
+			enqueue_encode_job(frame_job);
+		else
+		{
+			synfig::error("jpeg_trgt: frame '%s' is incomplete (%d of %d rows), it is not written",
+				frame_job->filename.c_str(), frame_row, frame_job->h);
+			set_encoding_failed();
+		}
+		frame_job.reset();
+	}
+
 	if(ready)
 	{
 		jpeg_finish_compress(&cinfo);
@@ -185,6 +271,14 @@ jpeg_trgt::start_scanline(int /*scanline*/)
 bool
 jpeg_trgt::end_scanline()
 {
+	if (frame_job)
+	{
+		if (frame_row >= frame_job->h)
+			return false;
+		color_to_pixelformat(frame_job->get_row(frame_row++), color_buffer, PF_RGB, nullptr, desc.get_w());
+		return true;
+	}
+
 	if(!file || !ready)
 		return false;
 
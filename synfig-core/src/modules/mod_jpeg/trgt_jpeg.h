@@ -49,6 +49,8 @@ class jpeg_trgt : public synfig::Target_Scanline
 {
 	SYNFIG_TARGET_MODULE_EXT
 private:
+	class FrameJob;
+
 	FILE *file;
 	int /*w,h,*/quality;
 	struct jpeg_compress_struct cinfo;
@@ -61,6 +63,9 @@ private:
 	unsigned char *buffer;
 	synfig::Color *color_buffer;
 	synfig::String sequence_separator;
+	//! Frame collected for encoding in background, see Target_Scanline::set_encoding_queue()
+	etl::handle<FrameJob> frame_job;
+	int frame_row;
 public:
 	jpeg_trgt(const char *filename, const synfig::TargetParam& /* params */);
 	virtual ~jpeg_trgt();
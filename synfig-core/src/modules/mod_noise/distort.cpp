@@ -44,6 +44,9 @@
 #include <synfig/paramdesc.h>
 #include <synfig/renddesc.h>
 #include <synfig/value.h>
+#include <synfig/rendering/common/task/taskdistort.h>
+#include <algorithm>
+#include <cassert>
 #include <ctime>
 
 #endif
@@ -62,6 +65,146 @@ SYNFIG_LAYER_SET_VERSION(NoiseDistort,"0.0");
 
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+class NoiseDistortion: public rendering::Distortion
+{
+public:
+	enum { BLOCK = 64 };
+
+	Vector displacement;
+	Vector size;
+	RandomNoise random;
+	int smooth;
+	int detail;
+	Real speed;
+	bool turbulent;
+	Time time;
+
+	NoiseDistortion(
+		const Vector &displacement,
+		const Vector &size,
+		int seed,
+		int smooth,
+		int detail,
+		Real speed,
+		bool turbulent,
+		const Time &time_mark
+	):
+		displacement(displacement),
+		size(size),
+		smooth((!speed && smooth == (int)(RandomNoise::SMOOTH_SPLINE)) ? (int)(RandomNoise::SMOOTH_FAST_SPLINE) : smooth),
+		detail(detail),
+		speed(speed),
+		turbulent(turbulent),
+		time(speed*time_mark)
+	{
+		random.set_seed(seed);
+	}
+
+	Point distort(const Point &point) const
+	{
+		Point result;
+		distort_block(&point, &result, 1);
+		return result;
+	}
+
+	//! Same as distort() for \a count points, each octave of noise is evaluated
+	//! for all points at once, see RandomNoise::operator()
+	void distort_block(const Point *points, Point *results, int count) const
+	{
+		assert(count <= BLOCK);
+		const RandomNoise::SmoothType smooth_type = RandomNoise::SmoothType(smooth);
+		const float ftime = time;
+
+		float x[BLOCK], y[BLOCK], noise0[BLOCK], noise1[BLOCK];
+		Vector vect[BLOCK];
+
+		for(int k = 0; k < count; ++k)
+		{
+			x[k] = points[k][0]/size[0]*(1<<detail);
+			y[k] = points[k][1]/size[1]*(1<<detail);
+			vect[k] = Vector(0,0);
+		}
+
+		for(int i = 0; i < detail; ++i)
+		{
+			random(smooth_type, 0+(detail-i)*5, x, y, ftime, noise0, count);
+			random(smooth_type, 1+(detail-i)*5, x, y, ftime, noise1, count);
+
+			for(int k = 0; k < count; ++k)
+			{
+				vect[k][0]=noise0[k]+vect[k][0]*0.5;
+				vect[k][1]=noise1[k]+vect[k][1]*0.5;
+
+				if (vect[k][0] < -1) vect[k][0] = -1;
+				if (vect[k][0] >  1) vect[k][0] =  1;
+
+				if (vect[k][1] < -1) vect[k][1] = -1;
+				if (vect[k][1] >  1) vect[k][1] =  1;
+
+				if(turbulent)
+				{
+					vect[k][0]=std::fabs(vect[k][0]);
+					vect[k][1]=std::fabs(vect[k][1]);
+				}
+
+				x[k]/=2.0f;
+				y[k]/=2.0f;
+			}
+		}
+
+		for(int k = 0; k < count; ++k)
+		{
+			if(!turbulent)
+			{
+				vect[k][0]=vect[k][0]/2.0f+0.5f;
+				vect[k][1]=vect[k][1]/2.0f+0.5f;
+			}
+			vect[k][0]=(vect[k][0]-0.5f)*displacement[0];
+			vect[k][1]=(vect[k][1]-0.5f)*displacement[1];
+
+			results[k] = points[k]+vect[k];
+		}
+	}
+
+protected:
+	virtual bool map_vfunc(const Point &point, Point &source_point) const
+		{ source_point = distort(point); return true; }
+
+	virtual void map_row_vfunc(const Point &point, const Vector &step, Point *source_points, bool *mapped, int count) const
+	{
+		Point points[BLOCK];
+		for(int i = 0; i < count; i += BLOCK) {
+			const int block_count = std::min((int)BLOCK, count - i);
+			for(int k = 0; k < block_count; ++k)
+				points[k] = point + step*(i + k);
+			distort_block(points, source_points + i, block_count);
+		}
+		std::fill(mapped, mapped + count, true);
+	}
+
+	virtual Rect map_bounds_vfunc(const Rect &rect) const
+		{ return Rect(rect).expand_x(fabs(displacement[0])).expand_y(fabs(displacement[1])); }
+	virtual Rect calc_bounds_vfunc(const Rect &source_bounds) const
+		{ return Rect(source_bounds).expand_x(fabs(displacement[0])).expand_y(fabs(displacement[1])); }
+
+	virtual bool hash_params_vfunc(rendering::TaskHash &hash) const
+	{
+		hash.add(displacement);
+		hash.add(size);
+		hash.add(random.get_seed());
+		hash.add(smooth);
+		hash.add(detail);
+		hash.add(speed);
+		hash.add(turbulent);
+		hash.add((Real)time);
+		return true;
+	}
+};
+
+} // end of anonimous namespace
+
 /* === M E T H O D S ======================================================= */
 
 NoiseDistort::NoiseDistort():
@@ -81,54 +224,16 @@ NoiseDistort::NoiseDistort():
 inline Point
 NoiseDistort::point_func(const Point &point)const
 {
-	Vector displacement=param_displacement.get(Vector());
-	Vector size=param_size.get(Vector());
-	RandomNoise random;
-	random.set_seed(param_random.get(int()));
-	int smooth_=param_smooth.get(int());
-	int detail=param_detail.get(int());
-	Real speed=param_speed.get(Real());
-	bool turbulent=param_turbulent.get(bool());
-	
-	float x(point[0]/size[0]*(1<<detail));
-	float y(point[1]/size[1]*(1<<detail));
-	
-	int i;
-	Time time = speed*get_time_mark();
-	int temp_smooth(smooth_);
-	int smooth((!speed && temp_smooth == (int)(RandomNoise::SMOOTH_SPLINE)) ? (int)(RandomNoise::SMOOTH_FAST_SPLINE) : temp_smooth);
-	
-	Vector vect(0,0);
-	for(i=0;i<detail;i++)
-	{
-		vect[0]=random(RandomNoise::SmoothType(smooth),0+(detail-i)*5,x,y,time)+vect[0]*0.5;
-		vect[1]=random(RandomNoise::SmoothType(smooth),1+(detail-i)*5,x,y,time)+vect[1]*0.5;
-		
-		if (vect[0] < -1) vect[0] = -1;
-		if (vect[0] >  1) vect[0] =  1;
-		
-		if (vect[1] < -1) vect[1] = -1;
-		if (vect[1] >  1) vect[1] =  1;
-		
-		if(turbulent)
-		{
-			vect[0]=std::fabs(vect[0]);
-			vect[1]=std::fabs(vect[1]);
-		}
-		
-		x/=2.0f;
-		y/=2.0f;
-	}
-	
-	if(!turbulent)
-	{
-		vect[0]=vect[0]/2.0f+0.5f;
-		vect[1]=vect[1]/2.0f+0.5f;
-	}
-	vect[0]=(vect[0]-0.5f)*displacement[0];
-	vect[1]=(vect[1]-0.5f)*displacement[1];
-	
-	return point+vect;
+	return NoiseDistortion(
+		param_displacement.get(Vector()),
+		param_size.get(Vector()),
+		param_random.get(int()),
+		param_smooth.get(int()),
+		param_detail.get(int()),
+		param_speed.get(Real()),
+		param_turbulent.get(bool()),
+		get_time_mark()
+	).distort(point);
 }
 
 inline Color
@@ -344,5 +449,21 @@ NoiseDistort::accelerated_render(Context context,Surface *surface,int quality, c
 */
 
 rendering::Task::Handle
-NoiseDistort::build_rendering_task_vfunc(Context context) const
-	{ return Layer::build_rendering_task_vfunc(context); }
+NoiseDistort::build_composite_fork_task_vfunc(ContextParams /* context_params */, rendering::Task::Handle sub_task)const
+{
+	if (!sub_task)
+		return sub_task;
+
+	rendering::TaskDistort::Handle task_distort(new rendering::TaskDistort());
+	task_distort->distortion = new NoiseDistortion(
+		param_displacement.get(Vector()),
+		param_size.get(Vector()),
+		param_random.get(int()),
+		param_smooth.get(int()),
+		param_detail.get(int()),
+		param_speed.get(Real()),
+		param_turbulent.get(bool()),
+		get_time_mark() );
+	task_distort->sub_task() = sub_task->clone_recursive();
+	return task_distort;
+}
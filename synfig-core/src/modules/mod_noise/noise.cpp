@@ -45,7 +45,12 @@
 #include <synfig/renddesc.h>
 #include <synfig/surface.h>
 #include <synfig/value.h>
+#include <synfig/rendering/common/task/taskblend.h>
+#include <synfig/rendering/common/task/tasktransformation.h>
+#include <synfig/rendering/software/task/tasksw.h>
+#include <algorithm>
 #include <ctime>
+#include <vector>
 
 #endif
 
@@ -63,137 +68,320 @@ SYNFIG_LAYER_SET_VERSION(Noise,"0.0");
 
 /* === P R O C E D U R E S ================================================= */
 
-/* === M E T H O D S ======================================================= */
+namespace {
 
-Noise::Noise():
-	Layer_Composite(1.0,Color::BLEND_COMPOSITE),
-	param_gradient(ValueBase(Gradient(Color::black(), Color::white()))),
-	param_random(ValueBase(int(time(NULL)))),
-	param_size(ValueBase(Vector(1,1))),
-	param_smooth(ValueBase(int(RandomNoise::SMOOTH_COSINE))),
-	param_detail(ValueBase(int(4))),
-	param_speed(ValueBase(Real(0))),
-	param_turbulent(ValueBase(bool(false))),
-	param_do_alpha(ValueBase(bool(false))),
-	param_super_sample(ValueBase(bool(false)))
+//! Parameters of noise, copied from layer for rendering.
+//! Points are processed in blocks, so each octave is evaluated
+//! for the whole block by RandomNoise and simple loops over arrays.
+class NoiseGenerator
 {
-	//displacement=Vector(1,1);
-	//do_displacement=false;
-	SET_INTERPOLATION_DEFAULTS();
-	SET_STATIC_DEFAULTS();
-}
+public:
+	enum { BLOCK = 64 };
 
-
-
-void
-Noise::compile()
-	{ compiled_gradient.set(param_gradient.get(Gradient()) ); }
-
-inline Color
-Noise::color_func(const Point &point, float pixel_size,Context /*context*/)const
-{
-	Vector size=param_size.get(Vector());
 	RandomNoise random;
-	random.set_seed(param_random.get(int()));
-	int smooth_=param_smooth.get(int());
-	int detail=param_detail.get(int());
-	Real speed=param_speed.get(Real());
-	bool turbulent=param_turbulent.get(bool());
-	bool do_alpha=param_do_alpha.get(bool());
-	bool super_sample=param_super_sample.get(bool());
-	
-
-	Color ret(0,0,0,0);
-
-	float x(point[0]/size[0]*(1<<detail));
-	float y(point[1]/size[1]*(1<<detail));
-	float x2(0),y2(0);
+	Vector size;
+	int smooth;
+	int detail;
+	float time;
+	bool turbulent;
+	bool do_alpha;
+	bool super_sample;
+
+	NoiseGenerator(): smooth(), detail(), time(), turbulent(), do_alpha(), super_sample() { }
+
+	NoiseGenerator(
+		int seed,
+		const Vector &size,
+		int smooth,
+		int detail,
+		Real speed,
+		bool turbulent,
+		bool do_alpha,
+		bool super_sample,
+		const Time &time_mark
+	):
+		size(size),
+		smooth((!speed && smooth == (int)RandomNoise::SMOOTH_SPLINE) ? (int)RandomNoise::SMOOTH_FAST_SPLINE : smooth),
+		detail(detail),
+		time(),
+		turbulent(turbulent),
+		do_alpha(do_alpha),
+		super_sample(super_sample)
+	{
+		random.set_seed(seed);
+		Time t;
+		t = speed*time_mark;
+		time = t;
+	}
 
-	if(super_sample&&pixel_size)
+	//! Colors for \a count points, \a pixel_size is used for supersampling
+	void fill(const CompiledGradient &gradient, const Point *points, float pixel_size, Color *colors, int count) const
 	{
-		x2=(point[0]+pixel_size)/size[0]*(1<<detail);
-		y2=(point[1]+pixel_size)/size[1]*(1<<detail);
+		for(int i = 0; i < count; i += BLOCK)
+			fill_block(gradient, points + i, pixel_size, colors + i, std::min((int)BLOCK, count - i));
 	}
 
-	int i;
-	Time time;
-	time=speed*get_time_mark();
-	int smooth((!speed && smooth_ == (int)RandomNoise::SMOOTH_SPLINE) ? (int)RandomNoise::SMOOTH_FAST_SPLINE : smooth_);
+private:
+	void fill_block(const CompiledGradient &gradient, const Point *points, float pixel_size, Color *colors, int count) const
+	{
+		const RandomNoise::SmoothType smooth_type = RandomNoise::SmoothType(smooth);
+		const bool supersample = super_sample && pixel_size;
 
-	float ftime(time);
+		float x[BLOCK], y[BLOCK], x2[BLOCK], y2[BLOCK], noise[BLOCK];
+		float amount[BLOCK], amount2[BLOCK], amount3[BLOCK], alpha[BLOCK];
 
-	{
-		float amount=0.0f;
-		float amount2=0.0f;
-		float amount3=0.0f;
-		float alpha=0.0f;
-		for(i=0;i<detail;i++)
+		for(int k = 0; k < count; ++k)
 		{
-			amount=random(RandomNoise::SmoothType(smooth),0+(detail-i)*5,x,y,ftime)+amount*0.5;
-			if (amount < -1) amount = -1;
-			if (amount >  1) amount =  1;
+			x[k] = points[k][0]/size[0]*(1<<detail);
+			y[k] = points[k][1]/size[1]*(1<<detail);
+			amount[k] = amount2[k] = amount3[k] = alpha[k] = 0.0f;
+		}
+		if (supersample)
+		{
+			for(int k = 0; k < count; ++k)
+			{
+				x2[k] = (points[k][0]+pixel_size)/size[0]*(1<<detail);
+				y2[k] = (points[k][1]+pixel_size)/size[1]*(1<<detail);
+			}
+		}
+
+		for(int i = 0; i < detail; ++i)
+		{
+			const int subseed = 0+(detail-i)*5;
+
+			random(smooth_type, subseed, x, y, time, noise, count);
+			for(int k = 0; k < count; ++k)
+			{
+				amount[k] = noise[k] + amount[k]*0.5;
+				if (amount[k] < -1) amount[k] = -1;
+				if (amount[k] >  1) amount[k] =  1;
+			}
 
-			if(super_sample&&pixel_size)
+			if (supersample)
 			{
-				amount2=random(RandomNoise::SmoothType(smooth),0+(detail-i)*5,x2,y,ftime)+amount2*0.5;
-				if (amount2 < -1) amount2 = -1;
-				if (amount2 >  1) amount2 =  1;
+				random(smooth_type, subseed, x2, y, time, noise, count);
+				for(int k = 0; k < count; ++k)
+				{
+					amount2[k] = noise[k] + amount2[k]*0.5;
+					if (amount2[k] < -1) amount2[k] = -1;
+					if (amount2[k] >  1) amount2[k] =  1;
+				}
 
-				amount3=random(RandomNoise::SmoothType(smooth),0+(detail-i)*5,x,y2,ftime)+amount3*0.5;
-				if (amount3 < -1) amount3 = -1;
-				if (amount3 >  1) amount3 =  1;
+				random(smooth_type, subseed, x, y2, time, noise, count);
+				for(int k = 0; k < count; ++k)
+				{
+					amount3[k] = noise[k] + amount3[k]*0.5;
+					if (amount3[k] < -1) amount3[k] = -1;
+					if (amount3[k] >  1) amount3[k] =  1;
+				}
 
-				if(turbulent)
+				if (turbulent)
 				{
-					amount2=std::fabs(amount2);
-					amount3=std::fabs(amount3);
+					for(int k = 0; k < count; ++k)
+					{
+						amount2[k] = std::fabs(amount2[k]);
+						amount3[k] = std::fabs(amount3[k]);
+					}
 				}
 
-				x2*=0.5f;
-				y2*=0.5f;
+				for(int k = 0; k < count; ++k)
+				{
+					x2[k] *= 0.5f;
+					y2[k] *= 0.5f;
+				}
 			}
 
-			if(do_alpha)
+			if (do_alpha)
 			{
-				alpha=random(RandomNoise::SmoothType(smooth),3+(detail-i)*5,x,y,ftime)+alpha*0.5;
-				if (alpha < -1) alpha = -1;
-				if (alpha > 1) alpha = 1;
+				random(smooth_type, 3+subseed, x, y, time, noise, count);
+				for(int k = 0; k < count; ++k)
+				{
+					alpha[k] = noise[k] + alpha[k]*0.5;
+					if (alpha[k] < -1) alpha[k] = -1;
+					if (alpha[k] >  1) alpha[k] =  1;
+				}
 			}
 
-			if(turbulent)
+			if (turbulent)
 			{
-				amount=std::fabs(amount);
-				alpha=std::fabs(alpha);
+				for(int k = 0; k < count; ++k)
+				{
+					amount[k] = std::fabs(amount[k]);
+					alpha[k] = std::fabs(alpha[k]);
+				}
 			}
 
-			x*=0.5f;
-			y*=0.5f;
-			//ftime*=0.5f;
+			for(int k = 0; k < count; ++k)
+			{
+				x[k] *= 0.5f;
+				y[k] *= 0.5f;
+			}
 		}
 
-		if(!turbulent)
+		for(int k = 0; k < count; ++k)
 		{
-			amount=amount/2.0f+0.5f;
-			alpha=alpha/2.0f+0.5f;
-
-			if(super_sample&&pixel_size)
+			if (!turbulent)
 			{
-				amount2=amount2/2.0f+0.5f;
-				amount3=amount3/2.0f+0.5f;
+				amount[k] = amount[k]/2.0f+0.5f;
+				alpha[k] = alpha[k]/2.0f+0.5f;
+
+				if (supersample)
+				{
+					amount2[k] = amount2[k]/2.0f+0.5f;
+					amount3[k] = amount3[k]/2.0f+0.5f;
+				}
+			}
+
+			if (supersample) {
+				Real da = std::max(amount3[k], std::max(amount[k], amount2[k])) - std::min(amount3[k], std::min(amount[k], amount2[k]));
+				colors[k] = gradient.average(amount[k] - da, amount[k] + da);
+			} else {
+				colors[k] = gradient.color(amount[k]);
 			}
+
+			if (do_alpha)
+				colors[k].set_a(colors[k].get_a()*(alpha[k]));
+		}
+	}
+};
+
+
+class TaskNoise: public rendering::Task, public rendering::TaskInterfaceTransformation
+{
+public:
+	typedef etl::handle<TaskNoise> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	CompiledGradient gradient;
+	NoiseGenerator generator;
+	rendering::Holder<rendering::TransformationAffine> transformation;
+
+	virtual rendering::Transformation::Handle get_transformation() const
+		{ return transformation.handle(); }
+};
+
+
+class TaskNoiseSW: public TaskNoise, public rendering::TaskSW,
+	public rendering::TaskInterfaceBlendToTarget,
+	public rendering::TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskNoiseSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual void on_target_set_as_source() {
+		Task::Handle &subtask = sub_task(0);
+		if ( subtask
+		  && subtask->target_surface == target_surface
+		  && !Color::is_straight(blend_method) )
+		{
+			trunc_by_bounds();
+			subtask->source_rect = source_rect;
+			subtask->target_rect = target_rect;
 		}
+	}
+
+	virtual Color::BlendMethodFlags get_supported_blend_methods() const
+		{ return Color::BLEND_METHODS_ALL; }
+
+	virtual bool run(RunParams&) const {
+		if (!is_valid())
+			return true;
+
+		Vector ppu = get_pixels_per_unit();
+
+		Matrix bounds_transfromation;
+		bounds_transfromation.m00 = ppu[0];
+		bounds_transfromation.m11 = ppu[1];
+		bounds_transfromation.m20 = target_rect.minx - ppu[0]*source_rect.minx;
+		bounds_transfromation.m21 = target_rect.miny - ppu[1]*source_rect.miny;
+
+		Matrix matrix = bounds_transfromation * transformation->matrix;
+		if (!matrix.is_invertible())
+			return true;
+		Matrix inv_matrix = matrix.get_inverted();
+
+		int tw = target_rect.get_width();
+		Vector dx = inv_matrix.axis_x();
+		Vector dy = inv_matrix.axis_y();
+		Vector p = inv_matrix.get_transformed( Vector((Real)target_rect.minx, (Real)target_rect.miny) );
+		float pixel_size((dx.mag() + dy.mag())*0.5f);
 
-		if(super_sample && pixel_size) {
-			Real da = std::max(amount3, std::max(amount,amount2)) - std::min(amount3, std::min(amount,amount2));
-			ret = compiled_gradient.average(amount - da, amount + da);
-		} else {
-			ret = compiled_gradient.color(amount);
+		LockWrite la(this);
+		if (!la)
+			return false;
+
+		synfig::Surface &surface = la->get_surface();
+		std::vector<Point> points(tw);
+		std::vector<Color> row(tw);
+		for(int y = target_rect.miny; y < target_rect.maxy; ++y, p += dy) {
+			Point q = p;
+			for(int x = 0; x < tw; ++x, q += dx)
+				points[x] = q;
+			generator.fill(gradient, &points.front(), pixel_size, &row.front(), tw);
+
+			Color *dest = surface[y] + target_rect.minx;
+			if (blend)
+				Color::blend_span(dest, &row.front(), tw, amount, blend_method);
+			else
+				std::copy(row.begin(), row.end(), dest);
 		}
 
-		if(do_alpha)
-			ret.set_a(ret.get_a()*(alpha));
+		return true;
 	}
-	return ret;
+};
+
+rendering::Task::Token TaskNoise::token(
+	DescAbstract<TaskNoise>("Noise") );
+rendering::Task::Token TaskNoiseSW::token(
+	DescReal<TaskNoiseSW, TaskNoise>("NoiseSW") );
+
+} // end of anonymous namespace
+
+/* === M E T H O D S ======================================================= */
+
+Noise::Noise():
+	Layer_Composite(1.0,Color::BLEND_COMPOSITE),
+	param_gradient(ValueBase(Gradient(Color::black(), Color::white()))),
+	param_random(ValueBase(int(time(NULL)))),
+	param_size(ValueBase(Vector(1,1))),
+	param_smooth(ValueBase(int(RandomNoise::SMOOTH_COSINE))),
+	param_detail(ValueBase(int(4))),
+	param_speed(ValueBase(Real(0))),
+	param_turbulent(ValueBase(bool(false))),
+	param_do_alpha(ValueBase(bool(false))),
+	param_super_sample(ValueBase(bool(false)))
+{
+	//displacement=Vector(1,1);
+	//do_displacement=false;
+	SET_INTERPOLATION_DEFAULTS();
+	SET_STATIC_DEFAULTS();
+}
+
+
+
+void
+Noise::compile()
+	{ compiled_gradient.set(param_gradient.get(Gradient()) ); }
+
+inline Color
+Noise::color_func(const Point &point, float pixel_size,Context /*context*/)const
+{
+	Color color;
+	NoiseGenerator(
+		param_random.get(int()),
+		param_size.get(Vector()),
+		param_smooth.get(int()),
+		param_detail.get(int()),
+		param_speed.get(Real()),
+		param_turbulent.get(bool()),
+		param_do_alpha.get(bool()),
+		param_super_sample.get(bool()),
+		get_time_mark()
+	).fill(compiled_gradient, &point, pixel_size, &color, 1);
+	return color;
 }
 
 inline float
@@ -352,17 +540,35 @@ Noise::accelerated_render(Context context,Surface *surface,int quality, const Re
 	if(quality>=8)
 		supersampleradius=0;
 
-	if(get_amount()==1.0 && get_blend_method()==Color::BLEND_STRAIGHT)
+	const NoiseGenerator generator(
+		param_random.get(int()),
+		param_size.get(Vector()),
+		param_smooth.get(int()),
+		param_detail.get(int()),
+		param_speed.get(Real()),
+		param_turbulent.get(bool()),
+		param_do_alpha.get(bool()),
+		param_super_sample.get(bool()),
+		get_time_mark() );
+	std::vector<Point> points(w);
+	std::vector<Color> row(w);
+
+	for(y=0,pos[1]=tl[1];y<h;y++,pen.inc_y(),pen.dec_x(x),pos[1]+=ph)
 	{
-		for(y=0,pos[1]=tl[1];y<h;y++,pen.inc_y(),pen.dec_x(x),pos[1]+=ph)
-			for(x=0,pos[0]=tl[0];x<w;x++,pen.inc_x(),pos[0]+=pw)
-				pen.put_value(color_func(pos,supersampleradius,context));
-	}
-	else
-	{
-		for(y=0,pos[1]=tl[1];y<h;y++,pen.inc_y(),pen.dec_x(x),pos[1]+=ph)
-			for(x=0,pos[0]=tl[0];x<w;x++,pen.inc_x(),pos[0]+=pw)
-				pen.put_value(Color::blend(color_func(pos,supersampleradius,context),pen.get_value(),get_amount(),get_blend_method()));
+		for(x=0,pos[0]=tl[0];x<w;x++,pos[0]+=pw)
+			points[x]=pos;
+		generator.fill(compiled_gradient, &points.front(), supersampleradius, &row.front(), w);
+
+		if(get_amount()==1.0 && get_blend_method()==Color::BLEND_STRAIGHT)
+		{
+			for(x=0;x<w;x++,pen.inc_x())
+				pen.put_value(row[x]);
+		}
+		else
+		{
+			for(x=0;x<w;x++,pen.inc_x())
+				pen.put_value(Color::blend(row[x],pen.get_value(),get_amount(),get_blend_method()));
+		}
 	}
 
 	// Mark our progress as finished
@@ -371,3 +577,22 @@ Noise::accelerated_render(Context context,Surface *surface,int quality, const Re
 
 	return true;
 }
+
+
+rendering::Task::Handle
+Noise::build_composite_task_vfunc(ContextParams /*context_params*/)const
+{
+	TaskNoise::Handle task(new TaskNoise());
+	task->gradient = compiled_gradient;
+	task->generator = NoiseGenerator(
+		param_random.get(int()),
+		param_size.get(Vector()),
+		param_smooth.get(int()),
+		param_detail.get(int()),
+		param_speed.get(Real()),
+		param_turbulent.get(bool()),
+		param_do_alpha.get(bool()),
+		param_super_sample.get(bool()),
+		get_time_mark() );
+	return task;
+}
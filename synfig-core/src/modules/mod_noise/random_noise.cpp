@@ -47,71 +47,123 @@
 
 /* === P R O C E D U R E S ================================================= */
 
-/* === M E T H O D S ======================================================= */
+namespace {
+
+//! Slots of time in lattice: t-1, t, t+1, t+2 and zero time of non-animated spline
+enum {
+	T_PREV  = 0,
+	T_CUR   = 1,
+	T_NEXT  = 2,
+	T_NEXT2 = 3,
+	T_ZERO  = 4,
+	T_COUNT = 5
+};
 
 void
-RandomNoise::set_seed(int x)
+calc_times(int t, int loop, int *times)
 {
-	seed_=x;
+	if (loop)
+	{
+		times[T_CUR  ] = t % loop;                   if (times[T_CUR  ] <  0   ) times[T_CUR  ] += loop;
+		times[T_PREV ] = times[T_CUR] - 1;           if (times[T_PREV ] <  0   ) times[T_PREV ] += loop;
+		times[T_NEXT ] = times[T_CUR] + 1;           if (times[T_NEXT ] >= loop) times[T_NEXT ] -= loop;
+		times[T_NEXT2] = times[T_NEXT] + 1;          if (times[T_NEXT2] >= loop) times[T_NEXT2] -= loop;
+	}
+	else
+	{
+		times[T_CUR  ] = t;
+		times[T_PREV ] = t - 1;
+		times[T_NEXT ] = t + 1;
+		times[T_NEXT2] = t + 2;
+	}
+	times[T_ZERO] = 0;
 }
 
-float
-RandomNoise::operator()(const int salt,const int x,const int y,const int t)const
+//! Values of lattice around the cell (x, y), calculated for each request
+class LatticeDirect
 {
-	static const unsigned int a(21870);
-	static const unsigned int b(11213);
-	static const unsigned int c(36979);
-	static const unsigned int d(31337);
-
-	quick_rng rng(
-		( static_cast<unsigned int>(x+y)        * a ) ^
-		( static_cast<unsigned int>(y+t)        * b ) ^
-		( static_cast<unsigned int>(t+x)        * c ) ^
-		( static_cast<unsigned int>(seed_+salt) * d )
-	);
-
-	return rng.f() * 2.0f - 1.0f;
-}
-
-float
-RandomNoise::operator()(SmoothType smooth,int subseed,float xf,float yf,float tf,int loop)const
+	const RandomNoise &noise;
+	const int subseed;
+	const int *times;
+	const int x, y;
+
+public:
+	LatticeDirect(const RandomNoise &noise, int subseed, const int *times, int x, int y):
+		noise(noise), subseed(subseed), times(times), x(x), y(y) { }
+
+	float operator()(int i, int j, int k) const
+		{ return noise(subseed, x + i, y + j, times[k]); }
+};
+
+//! Values of lattice around the cell, shared by all points of the same cell.
+//! Only the values which are required by the smooth type are calculated.
+class LatticeCache
 {
-	int x((int)floor(xf));
-	int y((int)floor(yf));
-	int t((int)floor(tf));
-	int t_1, t0, t1, t2;
-
-	if (loop)
+	const RandomNoise &noise;
+	const int subseed;
+	const int *times;
+	int first_time, last_time;
+	int lo, hi;
+	int x, y;
+	bool valid;
+	float values[T_COUNT][4][4];
+
+public:
+	LatticeCache(const RandomNoise &noise, int subseed, const int *times, RandomNoise::SmoothType smooth, bool animated):
+		noise(noise), subseed(subseed), times(times), x(), y(), valid()
 	{
-		t0  = t % loop;	if (t0  <  0   ) t0  += loop;
-		t_1 = t0 - 1;	if (t_1 <  0   ) t_1 += loop;
-		t1  = t0 + 1;	if (t1  >= loop) t1  -= loop;
-		t2  = t1 + 1;	if (t2  >= loop) t2  -= loop;
+		switch(smooth)
+		{
+		case RandomNoise::SMOOTH_CUBIC:
+		case RandomNoise::SMOOTH_SPLINE:
+			first_time = T_PREV; last_time = T_NEXT2; lo = -1; hi = 2; break;
+		case RandomNoise::SMOOTH_FAST_SPLINE:
+			first_time = last_time = T_ZERO; lo = -1; hi = 2; break;
+		case RandomNoise::SMOOTH_COSINE:
+		case RandomNoise::SMOOTH_LINEAR:
+			first_time = T_CUR; last_time = animated ? T_NEXT : T_CUR; lo = 0; hi = 1; break;
+		default:
+			first_time = last_time = T_CUR; lo = hi = 0; break;
+		}
 	}
-	else
+
+	void set_cell(int x, int y)
 	{
-		t0  = t;
-		t_1 = t - 1;
-		t1  = t + 1;
-		t2  = t + 2;
+		if (valid && x == this->x && y == this->y)
+			return;
+		this->x = x;
+		this->y = y;
+		valid = true;
+		for(int k = first_time; k <= last_time; ++k)
+			for(int j = lo; j <= hi; ++j)
+				for(int i = lo; i <= hi; ++i)
+					values[k][j + 1][i + 1] = noise(subseed, x + i, y + j, times[k]);
 	}
 
-	// synfig::info("%s:%d tf %.2f loop %d fraction %.2f ( -1,0,1,2 : %2d %2d %2d %2d)", __FILE__, __LINE__, tf, loop, tf-t, t_1, t0, t1, t2);
+	float operator()(int i, int j, int k) const
+		{ return values[k][j + 1][i + 1]; }
+};
 
+//! Smooth noise at point (xf, yf, tf) in cell (x, y, t),
+//! \a lattice gives the random values at offsets from the cell
+template<typename Lattice>
+float
+interpolate(const Lattice &lattice, RandomNoise::SmoothType smooth, float xf, float yf, float tf, int x, int y, int t)
+{
 	switch(smooth)
 	{
-	case SMOOTH_CUBIC:	// cubic
+	case RandomNoise::SMOOTH_CUBIC:	// cubic
 		{
-			#define f(j,i,k)	((*this)(subseed,i,j,k))
+			#define f(j,i,k)	(lattice(i,j,k))
 			//Using catmull rom interpolation because it doesn't blur at all
 			// ( http://www.gamedev.net/reference/articles/article1497.asp )
 			//bezier curve with intermediate ctrl pts: 0.5/3(p(i+1) - p(i-1)) and similar
 			float xfa [4], tfa[4];
 
 			//precalculate indices (all clamped) and offset
-			const int xa[] = {x-1,x,x+1,x+2};
-			const int ya[] = {y-1,y,y+1,y+2};
-			const int ta[] = {t_1,t0,t1,t2};
+			const int xa[] = {-1,0,1,2};
+			const int ya[] = {-1,0,1,2};
+			const int ta[] = {T_PREV,T_CUR,T_NEXT,T_NEXT2};
 
 			const float dx(xf-x);
 			const float dy(yf-y);
@@ -159,12 +211,13 @@ RandomNoise::operator()(SmoothType smooth,int subseed,float xf,float yf,float tf
 		break;
 
 
-	case SMOOTH_FAST_SPLINE:	// Fast Spline (non-animated)
+	case RandomNoise::SMOOTH_FAST_SPLINE:	// Fast Spline (non-animated)
 		{
 #define P(x)		(((x)>0)?((x)*(x)*(x)):0.0f)
-#define R(x)		( P(x+2) - 4.0f*P(x+1) + 6.0f*P(x) - 4.0f*P(x-1) )*(1.0f/6.0f)
-#define F(i,j)		((*this)(subseed,i+x,j+y)*(R((i)-a)*R(b-(j))))
-#define FT(i,j,k,l)	((*this)(subseed,i+x,j+y,l)*(R((i)-a)*R(b-(j))*R((k)-c)))
+#define Q(x)		( P(x+2) - 4.0f*P(x+1) + 6.0f*P(x) - 4.0f*P(x-1) )
+#define R(x)		Q(x)*(1.0f/6.0f)
+#define F(i,j)		(lattice(i,j,T_ZERO)*(ra[(i)+1]*qb[(j)+1]*(1.0f/6.0f)))
+#define FT(i,j,k,l)	(lattice(i,j,l)*(ra[(i)+1]*qb[(j)+1]*(1.0f/6.0f)*qc[(k)+1]*(1.0f/6.0f)))
 #define Z(i,j)		ret+=F(i,j)
 #define ZT(i,j,k,l) ret+=FT(i,j,k,l)
 #define X(i,j)		// placeholder... To make box more symmetric
@@ -172,6 +225,11 @@ RandomNoise::operator()(SmoothType smooth,int subseed,float xf,float yf,float tf
 
 		float a(xf-x), b(yf-y);
 
+		// weights of columns and rows, calculated once for all terms,
+		// products keep the order of operations of R(i-a)*R(b-j)
+		const float ra[] = { R((-1)-a), R((0)-a), R((1)-a), R((2)-a) };
+		const float qb[] = { Q(b-(-1)), Q(b-(0)), Q(b-(1)), Q(b-(2)) };
+
 		// Interpolate
 		float ret(F(0,0));
 		Z(-1,-1); Z(-1, 0); Z(-1, 1); Z(-1, 2);
@@ -182,73 +240,64 @@ RandomNoise::operator()(SmoothType smooth,int subseed,float xf,float yf,float tf
 		return ret;
 	}
 
-	case SMOOTH_SPLINE:	// Spline (animated)
+	case RandomNoise::SMOOTH_SPLINE:	// Spline (animated)
 		{
 			float a(xf-x), b(yf-y), c(tf-t);
 
-			// Interpolate
-			float ret(FT(0,0,0,t0));
-			ZT(-1,-1,-1,t_1); ZT(-1, 0,-1,t_1); ZT(-1, 1,-1,t_1); ZT(-1, 2,-1,t_1);
-			ZT( 0,-1,-1,t_1); ZT( 0, 0,-1,t_1); ZT( 0, 1,-1,t_1); ZT( 0, 2,-1,t_1);
-			ZT( 1,-1,-1,t_1); ZT( 1, 0,-1,t_1); ZT( 1, 1,-1,t_1); ZT( 1, 2,-1,t_1);
-			ZT( 2,-1,-1,t_1); ZT( 2, 0,-1,t_1); ZT( 2, 1,-1,t_1); ZT( 2, 2,-1,t_1);
-
-			ZT(-1,-1, 0,t0 ); ZT(-1, 0, 0,t0 ); ZT(-1, 1, 0,t0 ); ZT(-1, 2, 0,t0 );
-			ZT( 0,-1, 0,t0 ); XT( 0, 0, 0,t0 ); ZT( 0, 1, 0,t0 ); ZT( 0, 2, 0,t0 );
-			ZT( 1,-1, 0,t0 ); ZT( 1, 0, 0,t0 ); ZT( 1, 1, 0,t0 ); ZT( 1, 2, 0,t0 );
-			ZT( 2,-1, 0,t0 ); ZT( 2, 0, 0,t0 ); ZT( 2, 1, 0,t0 ); ZT( 2, 2, 0,t0 );
-
-			ZT(-1,-1, 1,t1 ); ZT(-1, 0, 1,t1 ); ZT(-1, 1, 1,t1 ); ZT(-1, 2, 1,t1 );
-			ZT( 0,-1, 1,t1 ); ZT( 0, 0, 1,t1 ); ZT( 0, 1, 1,t1 ); ZT( 0, 2, 1,t1 );
-			ZT( 1,-1, 1,t1 ); ZT( 1, 0, 1,t1 ); ZT( 1, 1, 1,t1 ); ZT( 1, 2, 1,t1 );
-			ZT( 2,-1, 1,t1 ); ZT( 2, 0, 1,t1 ); ZT( 2, 1, 1,t1 ); ZT( 2, 2, 1,t1 );
-
-			ZT(-1,-1, 2,t2 ); ZT(-1, 0, 2,t2 ); ZT(-1, 1, 2,t2 ); ZT(-1, 2, 2,t2 );
-			ZT( 0,-1, 2,t2 ); ZT( 0, 0, 2,t2 ); ZT( 0, 1, 2,t2 ); ZT( 0, 2, 2,t2 );
-			ZT( 1,-1, 2,t2 ); ZT( 1, 0, 2,t2 ); ZT( 1, 1, 2,t2 ); ZT( 1, 2, 2,t2 );
-			ZT( 2,-1, 2,t2 ); ZT( 2, 0, 2,t2 ); ZT( 2, 1, 2,t2 ); ZT( 2, 2, 2,t2 );
+			// weights of columns, rows and frames
+			const float ra[] = { R((-1)-a), R((0)-a), R((1)-a), R((2)-a) };
+			const float qb[] = { Q(b-(-1)), Q(b-(0)), Q(b-(1)), Q(b-(2)) };
+			const float qc[] = { Q((-1)-c), Q((0)-c), Q((1)-c), Q((2)-c) };
 
-			return ret;
-
-/*
-
-			float dx=xf-x;
-			float dy=yf-y;
-			float dt=tf-t;
+			// Interpolate
+			float ret(FT(0,0,0,T_CUR));
+			ZT(-1,-1,-1,T_PREV); ZT(-1, 0,-1,T_PREV); ZT(-1, 1,-1,T_PREV); ZT(-1, 2,-1,T_PREV);
+			ZT( 0,-1,-1,T_PREV); ZT( 0, 0,-1,T_PREV); ZT( 0, 1,-1,T_PREV); ZT( 0, 2,-1,T_PREV);
+			ZT( 1,-1,-1,T_PREV); ZT( 1, 0,-1,T_PREV); ZT( 1, 1,-1,T_PREV); ZT( 1, 2,-1,T_PREV);
+			ZT( 2,-1,-1,T_PREV); ZT( 2, 0,-1,T_PREV); ZT( 2, 1,-1,T_PREV); ZT( 2, 2,-1,T_PREV);
+
+			ZT(-1,-1, 0,T_CUR ); ZT(-1, 0, 0,T_CUR ); ZT(-1, 1, 0,T_CUR ); ZT(-1, 2, 0,T_CUR );
+			ZT( 0,-1, 0,T_CUR ); XT( 0, 0, 0,T_CUR ); ZT( 0, 1, 0,T_CUR ); ZT( 0, 2, 0,T_CUR );
+			ZT( 1,-1, 0,T_CUR ); ZT( 1, 0, 0,T_CUR ); ZT( 1, 1, 0,T_CUR ); ZT( 1, 2, 0,T_CUR );
+			ZT( 2,-1, 0,T_CUR ); ZT( 2, 0, 0,T_CUR ); ZT( 2, 1, 0,T_CUR ); ZT( 2, 2, 0,T_CUR );
+
+			ZT(-1,-1, 1,T_NEXT ); ZT(-1, 0, 1,T_NEXT ); ZT(-1, 1, 1,T_NEXT ); ZT(-1, 2, 1,T_NEXT );
+			ZT( 0,-1, 1,T_NEXT ); ZT( 0, 0, 1,T_NEXT ); ZT( 0, 1, 1,T_NEXT ); ZT( 0, 2, 1,T_NEXT );
+			ZT( 1,-1, 1,T_NEXT ); ZT( 1, 0, 1,T_NEXT ); ZT( 1, 1, 1,T_NEXT ); ZT( 1, 2, 1,T_NEXT );
+			ZT( 2,-1, 1,T_NEXT ); ZT( 2, 0, 1,T_NEXT ); ZT( 2, 1, 1,T_NEXT ); ZT( 2, 2, 1,T_NEXT );
+
+			ZT(-1,-1, 2,T_NEXT2); ZT(-1, 0, 2,T_NEXT2); ZT(-1, 1, 2,T_NEXT2); ZT(-1, 2, 2,T_NEXT2);
+			ZT( 0,-1, 2,T_NEXT2); ZT( 0, 0, 2,T_NEXT2); ZT( 0, 1, 2,T_NEXT2); ZT( 0, 2, 2,T_NEXT2);
+			ZT( 1,-1, 2,T_NEXT2); ZT( 1, 0, 2,T_NEXT2); ZT( 1, 1, 2,T_NEXT2); ZT( 1, 2, 2,T_NEXT2);
+			ZT( 2,-1, 2,T_NEXT2); ZT( 2, 0, 2,T_NEXT2); ZT( 2, 1, 2,T_NEXT2); ZT( 2, 2, 2,T_NEXT2);
 
-			float ret=0;
-			int i,j,h;
-			for(h=-1;h<=2;h++)
-				for(i=-1;i<=2;i++)
-					for(j=-1;j<=2;j++)
-						ret+=(*this)(subseed,i+x,j+y,h+t)*(R(i-dx)*R(j-dy)*R(h-dt));
 			return ret;
-*/
 		}
 		break;
+#undef XT
+#undef ZT
+#undef FT
 #undef X
 #undef Z
 #undef F
 #undef P
+#undef Q
 #undef R
 
-	case SMOOTH_COSINE:
+	case RandomNoise::SMOOTH_COSINE:
 	if((float)t==tf)
 	{
-		int x((int)floor(xf));
-		int y((int)floor(yf));
 		float a=xf-x;
 		float b=yf-y;
 		a=(1.0f-cos(a*PI))*0.5f;
 		b=(1.0f-cos(b*PI))*0.5f;
 		float c=1.0-a;
 		float d=1.0-b;
-		int x2=x+1,y2=y+1;
 		return
-			(*this)(subseed,x,y,t0)*(c*d)+
-			(*this)(subseed,x2,y,t0)*(a*d)+
-			(*this)(subseed,x,y2,t0)*(c*b)+
-			(*this)(subseed,x2,y2,t0)*(a*b);
+			lattice(0,0,T_CUR)*(c*d)+
+			lattice(1,0,T_CUR)*(a*d)+
+			lattice(0,1,T_CUR)*(c*b)+
+			lattice(1,1,T_CUR)*(a*b);
 	}
 	else
 	{
@@ -267,33 +316,28 @@ RandomNoise::operator()(SmoothType smooth,int subseed,float xf,float yf,float tf
 		float e=1.0-b;
 		float f=1.0-c;
 
-		int x2=x+1,y2=y+1;
-
 		return
-			(*this)(subseed,x,y,t0)*(d*e*f)+
-			(*this)(subseed,x2,y,t0)*(a*e*f)+
-			(*this)(subseed,x,y2,t0)*(d*b*f)+
-			(*this)(subseed,x2,y2,t0)*(a*b*f)+
-			(*this)(subseed,x,y,t1)*(d*e*c)+
-			(*this)(subseed,x2,y,t1)*(a*e*c)+
-			(*this)(subseed,x,y2,t1)*(d*b*c)+
-			(*this)(subseed,x2,y2,t1)*(a*b*c);
+			lattice(0,0,T_CUR )*(d*e*f)+
+			lattice(1,0,T_CUR )*(a*e*f)+
+			lattice(0,1,T_CUR )*(d*b*f)+
+			lattice(1,1,T_CUR )*(a*b*f)+
+			lattice(0,0,T_NEXT)*(d*e*c)+
+			lattice(1,0,T_NEXT)*(a*e*c)+
+			lattice(0,1,T_NEXT)*(d*b*c)+
+			lattice(1,1,T_NEXT)*(a*b*c);
 	}
-	case SMOOTH_LINEAR:
+	case RandomNoise::SMOOTH_LINEAR:
 	if((float)t==tf)
 	{
-		int x((int)floor(xf));
-		int y((int)floor(yf));
 		float a=xf-x;
 		float b=yf-y;
 		float c=1.0-a;
 		float d=1.0-b;
-		int x2=x+1,y2=y+1;
 		return
-			(*this)(subseed,x,y,t0)*(c*d)+
-			(*this)(subseed,x2,y,t0)*(a*d)+
-			(*this)(subseed,x,y2,t0)*(c*b)+
-			(*this)(subseed,x2,y2,t0)*(a*b);
+			lattice(0,0,T_CUR)*(c*d)+
+			lattice(1,0,T_CUR)*(a*d)+
+			lattice(0,1,T_CUR)*(c*b)+
+			lattice(1,1,T_CUR)*(a*b);
 	}
 	else
 	{
@@ -306,20 +350,77 @@ RandomNoise::operator()(SmoothType smooth,int subseed,float xf,float yf,float tf
 		float e=1.0-b;
 		float f=1.0-c;
 
-		int x2=x+1,y2=y+1;
-
 		return
-			(*this)(subseed,x,y,t0)*(d*e*f)+
-			(*this)(subseed,x2,y,t0)*(a*e*f)+
-			(*this)(subseed,x,y2,t0)*(d*b*f)+
-			(*this)(subseed,x2,y2,t0)*(a*b*f)+
-			(*this)(subseed,x,y,t1)*(d*e*c)+
-			(*this)(subseed,x2,y,t1)*(a*e*c)+
-			(*this)(subseed,x,y2,t1)*(d*b*c)+
-			(*this)(subseed,x2,y2,t1)*(a*b*c);
+			lattice(0,0,T_CUR )*(d*e*f)+
+			lattice(1,0,T_CUR )*(a*e*f)+
+			lattice(0,1,T_CUR )*(d*b*f)+
+			lattice(1,1,T_CUR )*(a*b*f)+
+			lattice(0,0,T_NEXT)*(d*e*c)+
+			lattice(1,0,T_NEXT)*(a*e*c)+
+			lattice(0,1,T_NEXT)*(d*b*c)+
+			lattice(1,1,T_NEXT)*(a*b*c);
 	}
 	default:
-	case SMOOTH_DEFAULT:
-		return (*this)(subseed,x,y,t0);
+	case RandomNoise::SMOOTH_DEFAULT:
+		return lattice(0,0,T_CUR);
+	}
+}
+
+} // end of anonymous namespace
+
+/* === M E T H O D S ======================================================= */
+
+void
+RandomNoise::set_seed(int x)
+{
+	seed_=x;
+}
+
+float
+RandomNoise::operator()(const int salt,const int x,const int y,const int t)const
+{
+	static const unsigned int a(21870);
+	static const unsigned int b(11213);
+	static const unsigned int c(36979);
+	static const unsigned int d(31337);
+
+	quick_rng rng(
+		( static_cast<unsigned int>(x+y)        * a ) ^
+		( static_cast<unsigned int>(y+t)        * b ) ^
+		( static_cast<unsigned int>(t+x)        * c ) ^
+		( static_cast<unsigned int>(seed_+salt) * d )
+	);
+
+	return rng.f() * 2.0f - 1.0f;
+}
+
+float
+RandomNoise::operator()(SmoothType smooth,int subseed,float xf,float yf,float tf,int loop)const
+{
+	int x((int)floor(xf));
+	int y((int)floor(yf));
+	int t((int)floor(tf));
+	int times[T_COUNT];
+	calc_times(t, loop, times);
+
+	// synfig::info("%s:%d tf %.2f loop %d fraction %.2f ( -1,0,1,2 : %2d %2d %2d %2d)", __FILE__, __LINE__, tf, loop, tf-t, times[T_PREV], times[T_CUR], times[T_NEXT], times[T_NEXT2]);
+
+	return interpolate(LatticeDirect(*this, subseed, times, x, y), smooth, xf, yf, tf, x, y, t);
+}
+
+void
+RandomNoise::operator()(SmoothType smooth,int subseed,const float *xf,const float *yf,float tf,float *results,int count,int loop)const
+{
+	int t((int)floor(tf));
+	int times[T_COUNT];
+	calc_times(t, loop, times);
+
+	LatticeCache lattice(*this, subseed, times, smooth, (float)t != tf);
+	for(int i = 0; i < count; ++i)
+	{
+		int x((int)floor(xf[i]));
+		int y((int)floor(yf[i]));
+		lattice.set_cell(x, y);
+		results[i] = interpolate(lattice, smooth, xf[i], yf[i], tf, x, y, t);
 	}
 }
@@ -59,6 +59,10 @@ public:
 
 	float operator()(int subseed,int x,int y=0, int t=0)const;
 	float operator()(SmoothType smooth,int subseed,float x,float y=0,float t=0,int loop=0)const;
+
+	//! Smooth noise for \a count points (x[i], y[i]) at time \a t, same as the function above.
+	//! Random values of lattice are calculated once for the neighbour points of the same cell.
+	void operator()(SmoothType smooth,int subseed,const float *x,const float *y,float t,float *results,int count,int loop=0)const;
 };
 
 /* === E N D =============================================================== */
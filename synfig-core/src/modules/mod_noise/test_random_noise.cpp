@@ -0,0 +1,73 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file test_random_noise.cpp
+**	\brief Test evaluation of RandomNoise by rows
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+
+#include <vector>
+
+#include "random_noise.h"
+
+#include "test_base.h"
+
+using namespace synfig;
+
+static const int width = 256;
+static const int rows = 16;
+static const int detail = 4;
+
+//! octaves of RandomNoise evaluated by rows should be exactly the same as per-point evaluation
+static void
+check_rows(RandomNoise::SmoothType smooth, float time)
+{
+	RandomNoise random;
+	random.set_seed(12345);
+
+	std::vector<float> x(width), y(width), row(width);
+	for(int r = 0; r < rows; ++r) {
+		for(int i = 0; i < detail; ++i) {
+			const float k = (float)(1 << (detail - i))/width;
+			for(int c = 0; c < width; ++c)
+				{ x[c] = c*k; y[c] = r*k*4.f; }
+			random(smooth, (detail - i)*5, &x.front(), &y.front(), time, &row.front(), width);
+			for(int c = 0; c < width; ++c)
+				ASSERT_EQUAL(random(smooth, (detail - i)*5, x[c], y[c], time), row[c]);
+		}
+	}
+}
+
+void test_rows_are_equal_to_points() {
+	for(int i = RandomNoise::SMOOTH_DEFAULT; i <= RandomNoise::SMOOTH_FAST_SPLINE; ++i) {
+		check_rows((RandomNoise::SmoothType)i, 0.f);
+		check_rows((RandomNoise::SmoothType)i, 1.25f);
+	}
+}
+
+int main() {
+
+	TEST_SUITE_BEGIN()
+		TEST_FUNCTION(test_rows_are_equal_to_points);
+	TEST_SUITE_END()
+
+	return tst_exit_status;
+}
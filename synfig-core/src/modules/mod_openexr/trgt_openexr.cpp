@@ -35,6 +35,8 @@
 
 #include "trgt_openexr.h"
 #include <cstdio>
+#include <exception>
+#include <synfig/general.h>
 #endif
 
 /* === M A C R O S ========================================================= */
@@ -51,10 +53,37 @@ SYNFIG_TARGET_SET_VERSION(exr_trgt,"1.0.4");
 
 /* === M E T H O D S ======================================================= */
 
+//! Whole frame, written into its own file by a thread of ThreadPool
+class exr_trgt::FrameJob: public Target_Scanline::EncodeJob
+{
+public:
+	String filename;
+	float pixel_aspect;
+	etl::surface<Imf::Rgba> pixels;
+
+	FrameJob(): pixel_aspect() { }
+
+	virtual bool run()
+	{
+		try
+		{
+			Imf::RgbaOutputFile file(filename.c_str(), pixels.get_w(), pixels.get_h(), Imf::WRITE_RGBA, pixel_aspect);
+			file.setFrameBuffer(pixels[0], 1, pixels.get_w());
+			file.writePixels(pixels.get_h());
+		}
+		catch(const std::exception &e)
+		{
+			synfig::error("exr_trgt: unable to write file '%s': %s", filename.c_str(), e.what());
+			return false;
+		}
+		return true;
+	}
+};
+
 bool
 exr_trgt::ready()
 {
-	return (bool)exr_file;
+	return exr_file || frame_job;
 }
 
 exr_trgt::exr_trgt(const char *Filename, const synfig::TargetParam &params):
@@ -64,7 +93,8 @@ exr_trgt::exr_trgt(const char *Filename, const synfig::TargetParam &params):
 	filename(Filename),
 	exr_file(NULL),
 	buffer(NULL),
-	buffer_color(NULL)
+	buffer_color(NULL),
+	frame_rows()
 {
 	// OpenEXR uses linear gamma
 	sequence_separator = params.sequence_separator;
@@ -99,6 +129,9 @@ exr_trgt::start_frame(synfig::ProgressCallback *cb)
 
 	if(exr_file)
 		delete exr_file;
+	exr_file=NULL;
+	frame_job.reset();
+
 	if(multi_image)
 	{
 		frame_name = (filename_sans_extension(filename) +
@@ -112,9 +145,21 @@ exr_trgt::start_frame(synfig::ProgressCallback *cb)
 		frame_name=filename;
 		if(cb)cb->task(filename);
 	}
-	exr_file=new Imf::RgbaOutputFile(frame_name.c_str(),w,h,Imf::WRITE_RGBA,desc.get_pixel_aspect());
 	if(buffer_color) delete [] buffer_color;
 	buffer_color=new Color[w];
+
+	// the whole frame is collected and compressed in background
+	if (multi_image && is_encoding_async())
+	{
+		frame_job = new FrameJob();
+		frame_job->filename = frame_name;
+		frame_job->pixel_aspect = desc.get_pixel_aspect();
+		frame_job->pixels.set_wh(w,h);
+		frame_rows = 0;
+		return true;
+	}
+
+	exr_file=new Imf::RgbaOutputFile(frame_name.c_str(),w,h,Imf::WRITE_RGBA,desc.get_pixel_aspect());
 	//if(buffer) delete [] buffer;
 	//buffer=new Imf::Rgba[w];
 	out_surface.set_wh(w,h);
@@ -125,6 +170,19 @@ exr_trgt::start_frame(synfig::ProgressCallback *cb)
 void
 exr_trgt::end_frame()
 {
+	if (frame_job)
+	{
+		if (frame_rows == desc.get_h())
+			enqueue_encode_job(frame_job);
+		else
+		{
+			synfig::error("exr_trgt: frame '%s' is incomplete (%d of %d rows), it is not written",
+				frame_job->filename.c_str(), frame_rows, desc.get_h());
+			set_encoding_failed();
+		}
+		frame_job.reset();
+	}
+
 	if(exr_file)
 	{
 		exr_file->setFrameBuffer(out_surface[0],1,desc.get_w());
@@ -151,11 +209,15 @@ exr_trgt::end_scanline()
 	if(!ready())
 		return false;
 
+	etl::surface<Imf::Rgba> &surface = frame_job ? frame_job->pixels : out_surface;
+	if (frame_job)
+		++frame_rows;
+
 	int i;
 	for(i=0;i<desc.get_w();i++)
 	{
 //		Imf::Rgba &rgba=buffer[i];
-		Imf::Rgba &rgba=out_surface[scanline][i];
+		Imf::Rgba &rgba=surface[scanline][i];
 		Color &color=buffer_color[i];
 		rgba.r=color.get_r();
 		rgba.g=color.get_g();
@@ -47,6 +47,8 @@ class exr_trgt : public synfig::Target_Scanline
 {
 public:
 private:
+	class FrameJob;
+
 	bool multi_image;
 	int imagecount,scanline;
 	synfig::String filename;
@@ -57,6 +59,9 @@ private:
 
 	bool ready();
 	synfig::String sequence_separator;
+	//! Frame collected for encoding in background, see Target_Scanline::set_encoding_queue()
+	etl::handle<FrameJob> frame_job;
+	int frame_rows;
 public:
 	exr_trgt(const char *filename, const synfig::TargetParam& /* params */);
 	virtual ~exr_trgt();
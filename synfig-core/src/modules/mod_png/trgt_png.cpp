@@ -40,7 +40,9 @@
 #include <png.h>
 #include <cstdio>
 #include <ETL/misc>
+#include <algorithm>
 #include <string.h>
+#include <vector>
 
 #endif
 
@@ -56,8 +58,87 @@ SYNFIG_TARGET_SET_NAME(png_trgt,"png");
 SYNFIG_TARGET_SET_EXT(png_trgt,"png");
 SYNFIG_TARGET_SET_VERSION(png_trgt,"0.1");
 
+/* === P R O C E D U R E S ================================================= */
+
+static int
+parse_filters(const String &name)
+{
+	if (name.empty() || name == "none") return PNG_FILTER_NONE;
+	if (name == "sub")   return PNG_FILTER_SUB;
+	if (name == "up")    return PNG_FILTER_UP;
+	if (name == "avg")   return PNG_FILTER_AVG;
+	if (name == "paeth") return PNG_FILTER_PAETH;
+	if (name == "all")   return PNG_ALL_FILTERS;
+	synfig::warning("png_trgt: unknown filter '%s', using 'none'", name.c_str());
+	return PNG_FILTER_NONE;
+}
+
+static void
+png_job_error(png_struct * /* png_data */, const char *msg)
+	{ synfig::error(strprintf("png_trgt: error: %s",msg)); }
+
+static void
+png_job_warning(png_struct * /* png_data */, const char *msg)
+	{ synfig::warning(strprintf("png_trgt: warning: %s",msg)); }
+
 /* === M E T H O D S ======================================================= */
 
+//! Whole converted frame, written into its own file by a thread of ThreadPool
+class png_trgt::FrameJob: public Target_Scanline::EncodeJob
+{
+public:
+	String filename;
+	int w, h;
+	bool alpha;
+	RendDesc desc;
+	String title;
+	String description;
+	int compression_level;
+	int filters;
+	std::vector<unsigned char> pixels;
+
+	FrameJob(): w(), h(), alpha(), compression_level(-1), filters(PNG_FILTER_NONE) { }
+
+	unsigned char* get_row(int y)
+		{ return &pixels[(size_t)y*w*(alpha ? 4 : 3)]; }
+
+	virtual bool run()
+	{
+		FILE *file = g_fopen(filename.c_str(), POPEN_BINARY_WRITE_TYPE);
+		if (!file)
+		{
+			synfig::error("png_trgt: unable to open file '%s'", filename.c_str());
+			return false;
+		}
+
+		png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, png_job_error, png_job_warning);
+		png_infop info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+		if (!info_ptr)
+		{
+			synfig::error("Unable to setup PNG struct");
+			png_destroy_write_struct(&png_ptr, (png_infopp)NULL);
+			fclose(file);
+			return false;
+		}
+
+		if (setjmp(png_jmpbuf(png_ptr)))
+		{
+			png_destroy_write_struct(&png_ptr, &info_ptr);
+			fclose(file);
+			return false;
+		}
+
+		png_init_io(png_ptr, file);
+		write_info(png_ptr, info_ptr, w, h, alpha, desc, title, description, compression_level, filters);
+		for(int y = 0; y < h; ++y)
+			png_write_row(png_ptr, get_row(y));
+		png_write_end(png_ptr, info_ptr);
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+
+		return fclose(file) == 0;
+	}
+};
+
 void
 png_trgt::png_out_error(png_struct *png_data,const char *msg)
 {
@@ -87,7 +168,10 @@ png_trgt::png_trgt(const char *Filename, const synfig::TargetParam &params):
 	filename(Filename),
 	buffer(NULL),
 	color_buffer(NULL),
-	sequence_separator(params.sequence_separator)
+	sequence_separator(params.sequence_separator),
+	compression_level(std::min(params.compression_level, 9)),
+	filters(parse_filters(params.compression_filter)),
+	frame_row()
 { }
 
 png_trgt::~png_trgt()
@@ -115,6 +199,19 @@ png_trgt::set_rend_desc(RendDesc *given_desc)
 void
 png_trgt::end_frame()
 {
+	if (frame_job)
+	{
+		if (ready && frame_row == frame_job->h)
+			enqueue_encode_job(frame_job);
+		else
+		{
+			synfig::error("png_trgt: frame '%s' is incomplete (%d of %d rows), it is not written",
+				frame_job->filename.c_str(), frame_row, frame_job->h);
+			set_encoding_failed();
+		}
+		frame_job.reset();
+	}
+
 	if(ready && file)
 	{
 		png_write_end(png_ptr,info_ptr);
@@ -128,13 +225,75 @@ png_trgt::end_frame()
 	ready=false;
 }
 
+void
+png_trgt::write_info(
+	png_structp png_ptr,
+	png_infop info_ptr,
+	int w,
+	int h,
+	bool alpha,
+	const RendDesc &desc,
+	const String &title,
+	const String &description,
+	int compression_level,
+	int filters )
+{
+	png_set_filter(png_ptr,0,filters);
+	if (compression_level >= 0)
+		png_set_compression_level(png_ptr,compression_level);
+
+	if (alpha)
+		png_set_IHDR(png_ptr,info_ptr,w,h,8,PNG_COLOR_TYPE_RGBA,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_DEFAULT);
+	else
+		png_set_IHDR(png_ptr,info_ptr,w,h,8,PNG_COLOR_TYPE_RGB,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_DEFAULT);
+
+	// Write the physical size
+	png_set_pHYs(png_ptr,info_ptr,round_to_int(desc.get_x_res()),round_to_int(desc.get_y_res()),PNG_RESOLUTION_METER);
+	
+	// Explicit set gamma value to 2.2 (it's a default value)
+	png_set_gAMA(png_ptr,info_ptr,1/2.2);
+
+	char title_key      [] = "Title";
+	char description_key[] = "Description";
+	char software_key   [] = "Software";
+	char synfig         [] = "SYNFIG";
+
+	// Output any text info along with the file
+	png_text comments[3];
+	memset(comments, 0, sizeof(comments));
+
+	comments[0].compression = PNG_TEXT_COMPRESSION_NONE;
+	comments[0].key         = title_key;
+	comments[0].text        = const_cast<char *>(title.c_str());
+	comments[0].text_length = strlen(comments[0].text);
+
+	comments[1].compression = PNG_TEXT_COMPRESSION_NONE;
+	comments[1].key         = description_key;
+	comments[1].text        = const_cast<char *>(description.c_str());
+	comments[1].text_length = strlen(comments[1].text);
+
+	comments[2].compression = PNG_TEXT_COMPRESSION_NONE;
+	comments[2].key         = software_key;
+	comments[2].text        = synfig;
+	comments[2].text_length = strlen(comments[2].text);
+
+	png_set_text(png_ptr, info_ptr, comments, sizeof(comments)/sizeof(png_text));
+
+	png_write_info_before_PLTE(png_ptr, info_ptr);
+	png_write_info(png_ptr, info_ptr);
+}
+
 bool
 png_trgt::start_frame(synfig::ProgressCallback *callback)
 {
 	int w=desc.get_w(),h=desc.get_h();
+	bool alpha=get_alpha_mode()==TARGET_ALPHA_MODE_KEEP;
 
 	if(file && file!=stdout)
 		fclose(file);
+	file=NULL;
+	frame_job.reset();
+
 	if(filename=="-")
 	{
 		if(callback)callback->task(strprintf("(stdout) %d",imagecount).c_str());
@@ -146,8 +305,31 @@ png_trgt::start_frame(synfig::ProgressCallback *callback)
 						   sequence_separator +
 						   etl::strprintf("%04d",imagecount) +
 						   filename_extension(filename));
-		file=g_fopen(newfilename.c_str(),POPEN_BINARY_WRITE_TYPE);
 		if(callback)callback->task(newfilename);
+
+		// the whole frame is collected and compressed in background
+		if (is_encoding_async())
+		{
+			frame_job = new FrameJob();
+			frame_job->filename = newfilename;
+			frame_job->w = w;
+			frame_job->h = h;
+			frame_job->alpha = alpha;
+			frame_job->desc = desc;
+			frame_job->title = get_canvas()->get_name();
+			frame_job->description = get_canvas()->get_description();
+			frame_job->compression_level = compression_level;
+			frame_job->filters = filters;
+			frame_job->pixels.resize((size_t)w*h*(alpha ? 4 : 3));
+			frame_row = 0;
+
+			delete [] color_buffer;
+			color_buffer=new Color[w];
+			ready=true;
+			return true;
+		}
+
+		file=g_fopen(newfilename.c_str(),POPEN_BINARY_WRITE_TYPE);
 	}
 	else
 	{
@@ -189,48 +371,11 @@ png_trgt::start_frame(synfig::ProgressCallback *callback)
 		return false;
 	}
 	png_init_io(png_ptr,file);
-	png_set_filter(png_ptr,0,PNG_FILTER_NONE);
 
 	setjmp(png_jmpbuf(png_ptr));
-	if (get_alpha_mode()==TARGET_ALPHA_MODE_KEEP)
-		png_set_IHDR(png_ptr,info_ptr,w,h,8,PNG_COLOR_TYPE_RGBA,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_DEFAULT);
-	else
-		png_set_IHDR(png_ptr,info_ptr,w,h,8,PNG_COLOR_TYPE_RGB,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_DEFAULT);
-
-	// Write the physical size
-	png_set_pHYs(png_ptr,info_ptr,round_to_int(desc.get_x_res()),round_to_int(desc.get_y_res()),PNG_RESOLUTION_METER);
-	
-	// Explicit set gamma value to 2.2 (it's a default value)
-	png_set_gAMA(png_ptr,info_ptr,1/2.2);
-
-	char title      [] = "Title";
-	char description[] = "Description";
-	char software   [] = "Software";
-	char synfig     [] = "SYNFIG";
-
-	// Output any text info along with the file
-	png_text comments[3];
-	memset(comments, 0, sizeof(comments));
-
-	comments[0].compression = PNG_TEXT_COMPRESSION_NONE;
-	comments[0].key         = title;
-	comments[0].text        = const_cast<char *>(get_canvas()->get_name().c_str());
-	comments[0].text_length = strlen(comments[0].text);
-
-	comments[1].compression = PNG_TEXT_COMPRESSION_NONE;
-	comments[1].key         = description;
-	comments[1].text        = const_cast<char *>(get_canvas()->get_description().c_str());
-	comments[1].text_length = strlen(comments[1].text);
-
-	comments[2].compression = PNG_TEXT_COMPRESSION_NONE;
-	comments[2].key         = software;
-	comments[2].text        = synfig;
-	comments[2].text_length = strlen(comments[2].text);
-
-	png_set_text(png_ptr, info_ptr, comments, sizeof(comments)/sizeof(png_text));
-
-	png_write_info_before_PLTE(png_ptr, info_ptr);
-	png_write_info(png_ptr, info_ptr);
+	write_info(png_ptr, info_ptr, w, h, alpha, desc,
+		get_canvas()->get_name(), get_canvas()->get_description(),
+		compression_level, filters);
 	ready=true;
 	return true;
 }
@@ -244,10 +389,19 @@ png_trgt::start_scanline(int /*scanline*/)
 bool
 png_trgt::end_scanline()
 {
+	PixelFormat pf = get_alpha_mode()==TARGET_ALPHA_MODE_KEEP ? PF_RGB|PF_A : PF_RGB;
+
+	if (frame_job)
+	{
+		if (!ready || frame_row >= frame_job->h)
+			return false;
+		color_to_pixelformat(frame_job->get_row(frame_row++), color_buffer, pf, 0, desc.get_w());
+		return true;
+	}
+
 	if(!file || !ready)
 		return false;
 
-	PixelFormat pf = get_alpha_mode()==TARGET_ALPHA_MODE_KEEP ? PF_RGB|PF_A : PF_RGB;
 	color_to_pixelformat(buffer, color_buffer, pf, 0, desc.get_w());
 
 	setjmp(png_jmpbuf(png_ptr));
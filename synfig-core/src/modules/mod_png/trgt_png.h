@@ -45,6 +45,8 @@ class png_trgt : public synfig::Target_Scanline
 {
 	SYNFIG_TARGET_MODULE_EXT
 private:
+	class FrameJob;
+
 	FILE *file;
 	//int w,h;
 	png_structp png_ptr;
@@ -58,8 +60,27 @@ private:
 	unsigned char *buffer;
 	synfig::Color *color_buffer;
 	synfig::String sequence_separator;
+	int compression_level;
+	int filters;
+	//! frame which will be encoded in background, see Target_Scanline::enqueue_encode_job()
+	etl::handle<FrameJob> frame_job;
+	int frame_row;
+
+	//! Writes header of the image, used for both synchronous and background encoding
+	static void write_info(
+		png_structp png_ptr,
+		png_infop info_ptr,
+		int w,
+		int h,
+		bool alpha,
+		const synfig::RendDesc &desc,
+		const synfig::String &title,
+		const synfig::String &description,
+		int compression_level,
+		int filters );
+
 public:
-	png_trgt(const char *filename, const synfig::TargetParam& /* params */);
+	png_trgt(const char *filename, const synfig::TargetParam &params);
 	virtual ~png_trgt();
 
 	virtual bool set_rend_desc(synfig::RendDesc *desc);
@@ -91,6 +91,8 @@ Canvas::Canvas(const String &id):
 	id_			(id),
 	version_	(CURRENT_CANVAS_VERSION),
 	cur_time_	(0),
+	children_index_size_(0),
+	children_index_dirty_(false),
 	is_inline_	(false),
 	is_dirty_	(true),
 	outline_grow(0.0)
@@ -118,11 +120,11 @@ Canvas::~Canvas()
 	// before the canvas is destroyed
 
 	// the set_sub_canvas(0) ends up deleting the parent-child link,
-	// which deletes the current element from the set we're iterating
-	// through, so we have to make sure we've incremented the iterator
-	// before we mess with the pastecanvas
-	std::set<Node*>::iterator iter = parent_set.begin();
-	while (iter != parent_set.end())
+	// which deletes the current element from the parent set,
+	// so we iterate through a copy of it
+	const std::set<Node*> parents = get_parent_set();
+	std::set<Node*>::const_iterator iter = parents.begin();
+	while (iter != parents.end())
 	{
 		Layer_PasteCanvas* paste_canvas = dynamic_cast<Layer_PasteCanvas*>(*iter);
 		iter++;
@@ -428,6 +430,8 @@ Canvas::set_id(const String &x)
 	if(!valid_id(x))
 		throw std::runtime_error("Invalid ID");
 	id_=x;
+	if(parent_)
+		parent_->children_index_dirty_=true;
 	signal_id_changed_();
 }
 
@@ -786,13 +790,10 @@ Canvas::surefind_canvas(const String &id, String &warnings)
 	// request is for this immediate canvas
 	if(id.find_first_of(':')==std::string::npos)
 	{
-		Children::iterator iter;
-
 		// Search for the image in the image list,
 		// and return it if it is found
-		for(iter=children().begin();iter!=children().end();iter++)
-			if(id==(*iter)->get_id())
-				return *iter;
+		if (Handle child_canvas = find_child_canvas(id))
+			return child_canvas;
 
 		// Create a new canvas and return it
 		//synfig::warning("Implicitly creating canvas named "+id);
@@ -872,13 +873,10 @@ Canvas::find_canvas(const String &id, String &warnings)const
 	// request is for this immediate canvas
 	if(id.find_first_of(':')==std::string::npos)
 	{
-		Children::const_iterator iter;
-
 		// Search for the image in the image list,
 		// and return it if it is found
-		for(iter=children().begin();iter!=children().end();iter++)
-			if(id==(*iter)->get_id())
-				return *iter;
+		if (Handle child_canvas = find_child_canvas(id))
+			return child_canvas;
 
 		throw Exception::IDNotFound("Child Canvas in Parent Canvas: (child)"+id);
 	}
@@ -1087,6 +1085,7 @@ Canvas::new_child_canvas()
 
 	canvas->rend_desc()=rend_desc();
 	canvas->set_parent(this);
+	index_child_canvas(canvas);
 
 	return canvas;
 }
@@ -1104,6 +1103,7 @@ Canvas::new_child_canvas(const String &id)
 	canvas->set_id(id);
 	canvas->rend_desc()=rend_desc();
 	canvas->set_parent(this);
+	index_child_canvas(canvas);
 
 	return canvas;
 }
@@ -1133,6 +1133,7 @@ Canvas::add_child_canvas(Canvas::Handle child_canvas, const synfig::String& id)
 		child_canvas->id_=id;
 		children().push_back(child_canvas);
 		child_canvas->set_parent(this);
+		index_child_canvas(child_canvas);
 	}
 
 	return child_canvas;
@@ -1152,6 +1153,48 @@ Canvas::remove_child_canvas(Canvas::Handle child_canvas)
 
 	children().remove(child_canvas);
 	child_canvas->set_parent(nullptr);
+	children_index_.clear();
+	children_index_dirty_ = true;
+}
+
+Canvas::Handle
+Canvas::find_child_canvas(const String &id)const
+{
+	if (children_index_dirty_ || children_index_size_ != children_.size())
+		rebuild_children_index();
+
+	std::unordered_map<String, Handle>::const_iterator i = children_index_.find(id);
+	if (i == children_index_.end())
+		return Handle();
+	if (i->second->parent_ == this && i->second->id_ == id)
+		return i->second;
+
+	// the list was changed behind our back
+	rebuild_children_index();
+	i = children_index_.find(id);
+	return i == children_index_.end() ? Handle() : i->second;
+}
+
+void
+Canvas::index_child_canvas(const Handle &child_canvas)
+{
+	if (children_index_dirty_ || children_index_size_ + 1 != children_.size()) {
+		children_index_dirty_ = true;
+		return;
+	}
+	children_index_.insert(std::make_pair(child_canvas->get_id(), child_canvas));
+	++children_index_size_;
+}
+
+void
+Canvas::rebuild_children_index()const
+{
+	children_index_.clear();
+	// insert() keeps the first child with each id, as the linear search did
+	for(Children::const_iterator i = children_.begin(); i != children_.end(); ++i)
+		children_index_.insert(std::make_pair((*i)->get_id(), *i));
+	children_index_size_ = children_.size();
+	children_index_dirty_ = false;
 }
 
 void
@@ -1517,17 +1560,19 @@ Canvas::invoke_signal_value_node_child_removed(etl::handle<ValueNode> container,
 	signal_value_node_child_removed()(container, content);
 	Canvas::Handle canvas(this);
 #ifdef DEBUG_INVOKE_SVNCR
-	printf("%s:%d removed stuff from a canvas %lx with %zd parents\n", __FILE__, __LINE__, uintptr_t(canvas.get()), canvas->parent_set.size());
+	printf("%s:%d removed stuff from a canvas %lx with %zd parents\n", __FILE__, __LINE__, uintptr_t(canvas.get()), (size_t)canvas->parent_count());
 #endif
-	for (std::set<Node*>::iterator iter = canvas->parent_set.begin(); iter != canvas->parent_set.end(); iter++)
+	const std::set<Node*> parents = canvas->get_parent_set();
+	for (std::set<Node*>::const_iterator iter = parents.begin(); iter != parents.end(); iter++)
 	{
 		if (Layer* layer = dynamic_cast<Layer*>(*iter))
 		{
 #ifdef DEBUG_INVOKE_SVNCR
 			printf("it's a layer %lx\n", uintptr_t(layer));
-			printf("%s:%d it's a layer with %zd parents\n", __FILE__, __LINE__, layer->parent_set.size());
+			printf("%s:%d it's a layer with %zd parents\n", __FILE__, __LINE__, (size_t)layer->parent_count());
 #endif
-			for (std::set<Node*>::iterator iter = layer->parent_set.begin(); iter != layer->parent_set.end(); iter++)
+			const std::set<Node*> layer_parents = layer->get_parent_set();
+			for (std::set<Node*>::const_iterator iter = layer_parents.begin(); iter != layer_parents.end(); iter++)
 				if (Canvas* canvas = dynamic_cast<Canvas*>(*iter))
 				{
 #ifdef DEBUG_INVOKE_SVNCR
@@ -33,6 +33,7 @@
 
 #include <map>
 #include <list>
+#include <unordered_map>
 #include <ETL/handle>
 #include <sigc++/signal.h>
 #include <sigc++/connection.h>
@@ -244,6 +245,14 @@ private:
 	//! Map of external Canvases used in this Canvas
 	mutable std::map<String,Handle> externals_;
 
+	//! Index of child Canvases by id
+	/*!	children() is public, so the index is only trusted while it
+	**	matches the list, otherwise it is rebuilt on the next lookup.
+	**	\see find_child_canvas() */
+	mutable std::unordered_map<String, Handle> children_index_;
+	mutable size_t children_index_size_;
+	mutable bool children_index_dirty_;
+
 	//! This flag is set if this canvas is "inline"
 	bool is_inline_;
 
@@ -697,6 +706,12 @@ public:
 private:
 	//! Sets parent and raises on_parent_set event
 	void set_parent(const Canvas::LooseHandle &parent);
+	//! Returns the immediate child Canvas with the given \a id, or an empty handle
+	Handle find_child_canvas(const String &id)const;
+	//! Adds the last pushed child Canvas to the children index
+	void index_child_canvas(const Handle &child_canvas);
+	//! Rebuilds the children index from children()
+	void rebuild_children_index()const;
 	//! Adds a \layer to a group given by its \group string to the group
 	//! database
 	void add_group_pair(String group, etl::handle<Layer> layer);
@@ -324,6 +324,16 @@ public:
 	/* Other */
 	static Color blend(Color a, Color b, float amount, BlendMethod type=BLEND_COMPOSITE);
 
+	//! Blends a row of pixels: dest[i] = blend(src[i], dest[i], amount, type)
+	/*! Uses SIMD kernels for the most common methods when available,
+	**	results are equal to Color::blend() up to rounding errors */
+	static void blend_span(Color *dest, const Color *src, int count, float amount, BlendMethod type=BLEND_COMPOSITE);
+
+	//! Blends one color over a row of pixels with per-pixel coverage:
+	//! dest[i] = blend(src, dest[i], amount*coverage[i], type)
+	/*! Blending function is selected once per row, not per pixel */
+	static void blend_coverage_span(Color *dest, const Color &src, const float *coverage, int count, float amount, BlendMethod type=BLEND_COMPOSITE);
+
 	static bool is_onto(BlendMethod x)
 		{ return BLEND_METHODS_ONTO & (1 << x); }
 
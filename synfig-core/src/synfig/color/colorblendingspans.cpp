@@ -0,0 +1,455 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/color/colorblendingspans.cpp
+**	\brief Blending of rows of pixels
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+
+#include "color.h"
+#include "colorblendingfunctions.h"
+
+#endif
+
+/* === M A C R O S ========================================================= */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+ #define BLEND_SPAN_SSE2
+ #include <emmintrin.h>
+ // AVX2 code is compiled with function attributes and selected at runtime
+ #if defined(__clang__) || (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+  #define BLEND_SPAN_AVX2
+  #define BLEND_SPAN_TARGET_AVX2 __attribute__((target("avx2")))
+  #include <immintrin.h>
+ #endif
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+
+/* === T Y P E D E F S ===================================================== */
+
+namespace {
+
+typedef void (*BlendSpanFunc)(Color *dest, const Color *src, int count, float amount);
+typedef void (*BlendCoverageSpanFunc)(Color *dest, const Color &src, const float *coverage, int count, float amount);
+
+/* === P R O C E D U R E S ================================================= */
+
+//! Reference implementation, the blending function is inlined for each method
+template<Color (*func)(Color&, Color&, float)>
+void
+blend_span_generic(Color *dest, const Color *src, int count, float amount)
+{
+	for(Color *end = dest + count; dest < end; ++dest, ++src)
+	{
+		Color a = *src;
+		Color b = *dest;
+		*dest = func(a, b, amount);
+	}
+}
+
+//! Constant color with per-pixel amount, the blending function is inlined for each method
+template<Color (*func)(Color&, Color&, float)>
+void
+blend_coverage_span_generic(Color *dest, const Color &src, const float *coverage, int count, float amount)
+{
+	for(Color *end = dest + count; dest < end; ++dest, ++coverage)
+	{
+		// the same as in Color::blend()
+		const float k = amount * *coverage;
+		if (fabsf(k) <= COLOR_EPSILON) continue;
+		Color a = src;
+		Color b = *dest;
+		*dest = func(a, b, k);
+	}
+}
+
+#ifdef BLEND_SPAN_SSE2
+
+// Color is stored as four floats r, g, b, a, so one pixel fits into __m128.
+// Operations are done in the same order as in colorblendingfunctions.h,
+// and division is done as multiplication by reciprocal like Color::operator/=,
+// so results are equal to the reference functions or differ by rounding only.
+
+inline __m128 sse2_alpha(__m128 x)
+	{ return _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+inline __m128 sse2_select(__m128 mask, __m128 a, __m128 b)
+	{ return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+inline __m128 sse2_alpha_mask()
+	{ return _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0)); }
+
+inline __m128 sse2_abs_mask()
+	{ return _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)); }
+
+inline __m128 sse2_transparent()
+	{ Color c = Color::alpha(); return _mm_loadu_ps((const float*)&c); }
+
+//! COMPOSITE and ONTO
+template<bool onto>
+void
+blend_span_composite_sse2(Color *dest, const Color *src, int count, float amount)
+{
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 k = _mm_set1_ps(amount);
+	const __m128 epsilon = _mm_set1_ps(COLOR_EPSILON);
+	const __m128 alpha_mask = sse2_alpha_mask();
+	const __m128 abs_mask = sse2_abs_mask();
+	const __m128 transparent = sse2_transparent();
+
+	for(Color *end = dest + count; dest < end; ++dest, ++src)
+	{
+		__m128 s = _mm_loadu_ps((const float*)src);
+		__m128 d = _mm_loadu_ps((const float*)dest);
+
+		__m128 a_src = _mm_mul_ps(sse2_alpha(s), k);
+		__m128 a_dest = onto ? one : sse2_alpha(d);
+		__m128 a_inv = _mm_sub_ps(one, a_src);
+
+		__m128 c = _mm_add_ps(
+			_mm_mul_ps(s, a_src),
+			_mm_mul_ps(onto ? d : _mm_mul_ps(d, a_dest), a_inv) );
+		__m128 a_out = _mm_add_ps(a_src, _mm_mul_ps(a_dest, a_inv));
+
+		c = _mm_mul_ps(c, _mm_div_ps(one, a_out));
+		c = sse2_select(alpha_mask, a_out, c);
+		c = sse2_select(_mm_cmpgt_ps(_mm_and_ps(a_out, abs_mask), epsilon), c, transparent);
+		if (onto) c = sse2_select(alpha_mask, d, c);
+
+		_mm_storeu_ps((float*)dest, c);
+	}
+}
+
+void
+blend_span_straight_sse2(Color *dest, const Color *src, int count, float amount)
+{
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 k = _mm_set1_ps(amount);
+	const __m128 epsilon = _mm_set1_ps(COLOR_EPSILON);
+	const __m128 alpha_mask = sse2_alpha_mask();
+	const __m128 abs_mask = sse2_abs_mask();
+	const __m128 transparent = sse2_transparent();
+
+	for(Color *end = dest + count; dest < end; ++dest, ++src)
+	{
+		__m128 s = _mm_loadu_ps((const float*)src);
+		__m128 d = _mm_loadu_ps((const float*)dest);
+		__m128 a_s = sse2_alpha(s);
+		__m128 a_d = sse2_alpha(d);
+
+		__m128 a_out = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(a_s, a_d), k), a_d);
+		__m128 dd = _mm_mul_ps(d, a_d);
+		__m128 c = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(s, a_s), dd), k), dd);
+
+		c = _mm_mul_ps(c, _mm_div_ps(one, a_out));
+		c = sse2_select(alpha_mask, a_out, c);
+		c = sse2_select(_mm_cmpgt_ps(_mm_and_ps(a_out, abs_mask), epsilon), c, transparent);
+
+		_mm_storeu_ps((float*)dest, c);
+	}
+}
+
+void
+blend_span_add_composite_sse2(Color *dest, const Color *src, int count, float amount)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 k = _mm_set1_ps(amount);
+	const __m128 epsilon = _mm_set1_ps(1e-8f);
+	const __m128 alpha_mask = sse2_alpha_mask();
+	const __m128 abs_mask = sse2_abs_mask();
+
+	for(Color *end = dest + count; dest < end; ++dest, ++src)
+	{
+		__m128 s = _mm_loadu_ps((const float*)src);
+		__m128 d = _mm_loadu_ps((const float*)dest);
+
+		__m128 a_d = sse2_alpha(d);
+		__m128 a_s = _mm_mul_ps(sse2_alpha(s), k);
+		__m128 a_out = _mm_max_ps(_mm_min_ps(_mm_add_ps(a_d, a_s), one), zero);
+		__m128 valid = _mm_cmpgt_ps(_mm_and_ps(a_out, abs_mask), epsilon);
+		__m128 a_inv = _mm_and_ps(valid, _mm_div_ps(one, a_out));
+
+		__m128 c = _mm_add_ps(
+			_mm_mul_ps(d, _mm_mul_ps(a_d, a_inv)),
+			_mm_mul_ps(s, _mm_mul_ps(a_s, a_inv)) );
+		c = sse2_select(alpha_mask, a_out, c);
+
+		_mm_storeu_ps((float*)dest, c);
+	}
+}
+
+#endif // BLEND_SPAN_SSE2
+
+#ifdef BLEND_SPAN_AVX2
+
+// Two pixels per __m256, the tail is processed by SSE2 functions.
+
+BLEND_SPAN_TARGET_AVX2 inline __m256 avx2_alpha(__m256 x)
+	{ return _mm256_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+BLEND_SPAN_TARGET_AVX2 inline __m256 avx2_select(__m256 mask, __m256 a, __m256 b)
+	{ return _mm256_blendv_ps(b, a, mask); }
+
+BLEND_SPAN_TARGET_AVX2 inline __m256 avx2_set_alpha(__m256 x, __m256 a)
+	{ return _mm256_blend_ps(x, a, 0x88); }
+
+BLEND_SPAN_TARGET_AVX2 inline __m256 avx2_abs(__m256 x)
+	{ return _mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff))); }
+
+BLEND_SPAN_TARGET_AVX2 inline __m256 avx2_transparent()
+	{ Color c = Color::alpha(); __m128 x = _mm_loadu_ps((const float*)&c); return _mm256_insertf128_ps(_mm256_castps128_ps256(x), x, 1); }
+
+template<bool onto>
+BLEND_SPAN_TARGET_AVX2 void
+blend_span_composite_avx2(Color *dest, const Color *src, int count, float amount)
+{
+	const __m256 one = _mm256_set1_ps(1.f);
+	const __m256 k = _mm256_set1_ps(amount);
+	const __m256 epsilon = _mm256_set1_ps(COLOR_EPSILON);
+	const __m256 transparent = avx2_transparent();
+
+	int pairs = count/2;
+	for(Color *end = dest + 2*pairs; dest < end; dest += 2, src += 2)
+	{
+		__m256 s = _mm256_loadu_ps((const float*)src);
+		__m256 d = _mm256_loadu_ps((const float*)dest);
+
+		__m256 a_src = _mm256_mul_ps(avx2_alpha(s), k);
+		__m256 a_dest = onto ? one : avx2_alpha(d);
+		__m256 a_inv = _mm256_sub_ps(one, a_src);
+
+		__m256 c = _mm256_add_ps(
+			_mm256_mul_ps(s, a_src),
+			_mm256_mul_ps(onto ? d : _mm256_mul_ps(d, a_dest), a_inv) );
+		__m256 a_out = _mm256_add_ps(a_src, _mm256_mul_ps(a_dest, a_inv));
+
+		c = _mm256_mul_ps(c, _mm256_div_ps(one, a_out));
+		c = avx2_set_alpha(c, a_out);
+		c = avx2_select(_mm256_cmp_ps(avx2_abs(a_out), epsilon, _CMP_GT_OQ), c, transparent);
+		if (onto) c = avx2_set_alpha(c, d);
+
+		_mm256_storeu_ps((float*)dest, c);
+	}
+	if (count % 2)
+		blend_span_composite_sse2<onto>(dest, src, 1, amount);
+}
+
+BLEND_SPAN_TARGET_AVX2 void
+blend_span_straight_avx2(Color *dest, const Color *src, int count, float amount)
+{
+	const __m256 one = _mm256_set1_ps(1.f);
+	const __m256 k = _mm256_set1_ps(amount);
+	const __m256 epsilon = _mm256_set1_ps(COLOR_EPSILON);
+	const __m256 transparent = avx2_transparent();
+
+	int pairs = count/2;
+	for(Color *end = dest + 2*pairs; dest < end; dest += 2, src += 2)
+	{
+		__m256 s = _mm256_loadu_ps((const float*)src);
+		__m256 d = _mm256_loadu_ps((const float*)dest);
+		__m256 a_s = avx2_alpha(s);
+		__m256 a_d = avx2_alpha(d);
+
+		__m256 a_out = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(a_s, a_d), k), a_d);
+		__m256 dd = _mm256_mul_ps(d, a_d);
+		__m256 c = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(s, a_s), dd), k), dd);
+
+		c = _mm256_mul_ps(c, _mm256_div_ps(one, a_out));
+		c = avx2_set_alpha(c, a_out);
+		c = avx2_select(_mm256_cmp_ps(avx2_abs(a_out), epsilon, _CMP_GT_OQ), c, transparent);
+
+		_mm256_storeu_ps((float*)dest, c);
+	}
+	if (count % 2)
+		blend_span_straight_sse2(dest, src, 1, amount);
+}
+
+BLEND_SPAN_TARGET_AVX2 void
+blend_span_add_composite_avx2(Color *dest, const Color *src, int count, float amount)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.f);
+	const __m256 k = _mm256_set1_ps(amount);
+	const __m256 epsilon = _mm256_set1_ps(1e-8f);
+
+	int pairs = count/2;
+	for(Color *end = dest + 2*pairs; dest < end; dest += 2, src += 2)
+	{
+		__m256 s = _mm256_loadu_ps((const float*)src);
+		__m256 d = _mm256_loadu_ps((const float*)dest);
+
+		__m256 a_d = avx2_alpha(d);
+		__m256 a_s = _mm256_mul_ps(avx2_alpha(s), k);
+		__m256 a_out = _mm256_max_ps(_mm256_min_ps(_mm256_add_ps(a_d, a_s), one), zero);
+		__m256 valid = _mm256_cmp_ps(avx2_abs(a_out), epsilon, _CMP_GT_OQ);
+		__m256 a_inv = _mm256_and_ps(valid, _mm256_div_ps(one, a_out));
+
+		__m256 c = _mm256_add_ps(
+			_mm256_mul_ps(d, _mm256_mul_ps(a_d, a_inv)),
+			_mm256_mul_ps(s, _mm256_mul_ps(a_s, a_inv)) );
+		c = avx2_set_alpha(c, a_out);
+
+		_mm256_storeu_ps((float*)dest, c);
+	}
+	if (count % 2)
+		blend_span_add_composite_sse2(dest, src, 1, amount);
+}
+
+#endif // BLEND_SPAN_AVX2
+
+//! Table of span functions for all blend methods, selected once for current CPU
+class BlendSpanTable
+{
+public:
+	BlendSpanFunc funcs[Color::BLEND_END];
+	BlendCoverageSpanFunc coverage_funcs[Color::BLEND_END];
+
+	BlendSpanTable()
+	{
+		const BlendSpanFunc generic[Color::BLEND_END] =
+		{
+			blend_span_generic< blendfunc_COMPOSITE<Color> >,	// 0
+			blend_span_generic< blendfunc_STRAIGHT<Color> >,
+			blend_span_generic< blendfunc_BRIGHTEN<Color> >,
+			blend_span_generic< blendfunc_DARKEN<Color> >,
+			blend_span_generic< blendfunc_ADD<Color> >,
+			blend_span_generic< blendfunc_SUBTRACT<Color> >,		// 5
+			blend_span_generic< blendfunc_MULTIPLY<Color> >,
+			blend_span_generic< blendfunc_DIVIDE<Color> >,
+			blend_span_generic< blendfunc_COLOR<Color> >,
+			blend_span_generic< blendfunc_HUE<Color> >,
+			blend_span_generic< blendfunc_SATURATION<Color> >,	// 10
+			blend_span_generic< blendfunc_LUMINANCE<Color> >,
+			blend_span_generic< blendfunc_BEHIND<Color> >,
+			blend_span_generic< blendfunc_ONTO<Color> >,
+			blend_span_generic< blendfunc_ALPHA_BRIGHTEN<Color> >,
+			blend_span_generic< blendfunc_ALPHA_DARKEN<Color> >,	// 15
+			blend_span_generic< blendfunc_SCREEN<Color> >,
+			blend_span_generic< blendfunc_HARD_LIGHT<Color> >,
+			blend_span_generic< blendfunc_DIFFERENCE<Color> >,
+			blend_span_generic< blendfunc_ALPHA_OVER<Color> >,
+			blend_span_generic< blendfunc_OVERLAY<Color> >,		// 20
+			blend_span_generic< blendfunc_STRAIGHT_ONTO<Color> >,
+			blend_span_generic< blendfunc_ADD_COMPOSITE<Color> >,
+			blend_span_generic< blendfunc_ALPHA<Color> >,
+		};
+		for(int i = 0; i < Color::BLEND_END; ++i)
+			funcs[i] = generic[i];
+
+		const BlendCoverageSpanFunc coverage_generic[Color::BLEND_END] =
+		{
+			blend_coverage_span_generic< blendfunc_COMPOSITE<Color> >,	// 0
+			blend_coverage_span_generic< blendfunc_STRAIGHT<Color> >,
+			blend_coverage_span_generic< blendfunc_BRIGHTEN<Color> >,
+			blend_coverage_span_generic< blendfunc_DARKEN<Color> >,
+			blend_coverage_span_generic< blendfunc_ADD<Color> >,
+			blend_coverage_span_generic< blendfunc_SUBTRACT<Color> >,		// 5
+			blend_coverage_span_generic< blendfunc_MULTIPLY<Color> >,
+			blend_coverage_span_generic< blendfunc_DIVIDE<Color> >,
+			blend_coverage_span_generic< blendfunc_COLOR<Color> >,
+			blend_coverage_span_generic< blendfunc_HUE<Color> >,
+			blend_coverage_span_generic< blendfunc_SATURATION<Color> >,	// 10
+			blend_coverage_span_generic< blendfunc_LUMINANCE<Color> >,
+			blend_coverage_span_generic< blendfunc_BEHIND<Color> >,
+			blend_coverage_span_generic< blendfunc_ONTO<Color> >,
+			blend_coverage_span_generic< blendfunc_ALPHA_BRIGHTEN<Color> >,
+			blend_coverage_span_generic< blendfunc_ALPHA_DARKEN<Color> >,	// 15
+			blend_coverage_span_generic< blendfunc_SCREEN<Color> >,
+			blend_coverage_span_generic< blendfunc_HARD_LIGHT<Color> >,
+			blend_coverage_span_generic< blendfunc_DIFFERENCE<Color> >,
+			blend_coverage_span_generic< blendfunc_ALPHA_OVER<Color> >,
+			blend_coverage_span_generic< blendfunc_OVERLAY<Color> >,		// 20
+			blend_coverage_span_generic< blendfunc_STRAIGHT_ONTO<Color> >,
+			blend_coverage_span_generic< blendfunc_ADD_COMPOSITE<Color> >,
+			blend_coverage_span_generic< blendfunc_ALPHA<Color> >,
+		};
+		for(int i = 0; i < Color::BLEND_END; ++i)
+			coverage_funcs[i] = coverage_generic[i];
+
+		// SYNFIG_DISABLE_SIMD_BLEND allows to compare results with reference functions
+		if (getenv("SYNFIG_DISABLE_SIMD_BLEND"))
+			return;
+
+		#ifdef BLEND_SPAN_SSE2
+		funcs[Color::BLEND_COMPOSITE]     = blend_span_composite_sse2<false>;
+		funcs[Color::BLEND_ONTO]          = blend_span_composite_sse2<true>;
+		funcs[Color::BLEND_STRAIGHT]      = blend_span_straight_sse2;
+		funcs[Color::BLEND_ADD_COMPOSITE] = blend_span_add_composite_sse2;
+		#endif
+
+		#ifdef BLEND_SPAN_AVX2
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+		{
+			funcs[Color::BLEND_COMPOSITE]     = blend_span_composite_avx2<false>;
+			funcs[Color::BLEND_ONTO]          = blend_span_composite_avx2<true>;
+			funcs[Color::BLEND_STRAIGHT]      = blend_span_straight_avx2;
+			funcs[Color::BLEND_ADD_COMPOSITE] = blend_span_add_composite_avx2;
+		}
+		#endif
+	}
+
+	static const BlendSpanTable& instance()
+		{ static const BlendSpanTable table; return table; }
+};
+
+} // END of anonymous namespace
+
+/* === M E T H O D S ======================================================= */
+
+void
+Color::blend_span(Color *dest, const Color *src, int count, float amount, BlendMethod type)
+{
+	// the same as in Color::blend()
+	if (fabsf(amount) <= COLOR_EPSILON || count <= 0) return;
+
+	assert(type < BLEND_END);
+	assert(dest && src);
+
+	BlendSpanTable::instance().funcs[type](dest, src, count, amount);
+}
+
+void
+Color::blend_coverage_span(Color *dest, const Color &src, const float *coverage, int count, float amount, BlendMethod type)
+{
+	if (fabsf(amount) <= COLOR_EPSILON || count <= 0) return;
+
+	assert(type < BLEND_END);
+	assert(dest && coverage);
+
+	BlendSpanTable::instance().coverage_funcs[type](dest, src, coverage, count, amount);
+}
@@ -29,6 +29,12 @@
 
 #include "pixelformat.h"
 #include <cassert>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+ #define PIXELFORMAT_SSE2
+ #include <emmintrin.h>
+#endif
 
 using namespace synfig;
 
@@ -252,6 +258,113 @@ namespace {
 		if (bgr)  return     color2pf_image_partauto<false, false, true >(params);
 		return               color2pf_image_partauto<false, false, false>(params);
 	}
+
+
+#ifdef PIXELFORMAT_SSE2
+	inline __m128 sse2_select(__m128 mask, __m128 a, __m128 b)
+		{ return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+	inline __m128 sse2_alpha_mask()
+		{ return _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0)); }
+
+	//! Converts color into four integers placed in order of channels in memory
+	//! (the unused channel of three-channel formats is the last one),
+	//! gives the same values as color2pf_simple() or color2pf() with premulted alpha
+	template<int order, bool alpha_premult>
+	static inline __m128i
+	sse2_color2pf(const Color &src)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.f);
+		const __m128 c = _mm_loadu_ps((const float*)&src);
+		// NaN becomes zero here, like in clamp()
+		__m128 v = _mm_min_ps(_mm_max_ps(c, zero), one);
+		if (alpha_premult) {
+			// products are exact in float, so the result is the same as integer math of color2pf()
+			const __m128 ri = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(v, _mm_set1_ps(ColorReal(65535.99)))));
+			const __m128 ac = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(v, _mm_set1_ps(ColorReal(255.99)))));
+			const __m128 ai = _mm_add_ps(_mm_shuffle_ps(ac, ac, _MM_SHUFFLE(3, 3, 3, 3)), one);
+			v = sse2_select(sse2_alpha_mask(), ac, _mm_mul_ps(_mm_mul_ps(ri, ai), _mm_set1_ps(1.f/65536.f)));
+		} else {
+			// NaN is replaced like in Color::clamped()
+			v = sse2_select(_mm_cmpunord_ps(c, c), _mm_set_ps(1.f, .5f, .5f, .5f), v);
+			v = _mm_mul_ps(v, _mm_set1_ps(ColorReal(255.9)));
+		}
+		return _mm_cvttps_epi32(_mm_shuffle_ps(v, v, order));
+	}
+
+	template<int order, bool alpha_premult>
+	static inline __m128i
+	sse2_color2pf_pack(const Color *src, int count)
+	{
+		__m128i p[4];
+		for(int i = 0; i < 4; ++i)
+			p[i] = i < count ? sse2_color2pf<order, alpha_premult>(src[i]) : _mm_setzero_si128();
+		return _mm_packus_epi16(_mm_packs_epi32(p[0], p[1]), _mm_packs_epi32(p[2], p[3]));
+	}
+
+	template<int order, bool alpha_premult, int size>
+	static unsigned char*
+	sse2_color2pf_image(Color2PFParams params) {
+		while(params.height-- > 0) {
+			int i = 0;
+			if (size == 4)
+				for(; i + 4 <= params.width; i += 4, params.src += 4, params.dst += 16)
+					_mm_storeu_si128((__m128i*)params.dst, sse2_color2pf_pack<order, alpha_premult>(params.src, 4));
+
+			// three-channel pixels and the rest of row are converted through the buffer
+			for(; i < params.width; i += 4) {
+				const int count = params.width - i < 4 ? params.width - i : 4;
+				unsigned char buffer[16];
+				_mm_storeu_si128((__m128i*)buffer, sse2_color2pf_pack<order, alpha_premult>(params.src, count));
+				for(int j = 0; j < count; ++j, params.dst += size)
+					memcpy(params.dst, buffer + 4*j, size);
+				params.src += count;
+			}
+
+			params.dst += params.dst_stride_extra;
+			params.src += params.src_stride_extra;
+		}
+		return params.dst;
+	}
+
+	//! 8-bit RGB formats without gamma
+	static inline unsigned char*
+	sse2_color2pf_image_auto(const Color2PFParams &params) {
+		const bool bgr = FLAGS(params.pf, PF_BGR);
+		if (!FLAGS(params.pf, PF_A))
+			return bgr ? sse2_color2pf_image<_MM_SHUFFLE(3, 0, 1, 2), false, 3>(params)
+			           : sse2_color2pf_image<_MM_SHUFFLE(3, 2, 1, 0), false, 3>(params);
+		if (FLAGS(params.pf, PF_A_PREMULT)) {
+			if (FLAGS(params.pf, PF_A_START))
+				return bgr ? sse2_color2pf_image<_MM_SHUFFLE(0, 1, 2, 3), true, 4>(params)
+				           : sse2_color2pf_image<_MM_SHUFFLE(2, 1, 0, 3), true, 4>(params);
+			return bgr ? sse2_color2pf_image<_MM_SHUFFLE(3, 0, 1, 2), true, 4>(params)
+			           : sse2_color2pf_image<_MM_SHUFFLE(3, 2, 1, 0), true, 4>(params);
+		}
+		if (FLAGS(params.pf, PF_A_START))
+			return bgr ? sse2_color2pf_image<_MM_SHUFFLE(0, 1, 2, 3), false, 4>(params)
+			           : sse2_color2pf_image<_MM_SHUFFLE(2, 1, 0, 3), false, 4>(params);
+		return bgr ? sse2_color2pf_image<_MM_SHUFFLE(3, 0, 1, 2), false, 4>(params)
+		           : sse2_color2pf_image<_MM_SHUFFLE(3, 2, 1, 0), false, 4>(params);
+	}
+#endif
+
+
+	//! Uses SIMD for 8-bit RGB formats without gamma.
+	//! Results are the same as of color2pf_image_auto().
+	static inline unsigned char*
+	color2pf_image_fast(Color2PFParams params) {
+		if (FLAGS(params.pf, PF_RAW_COLOR))
+			return color2pf_image<color2pf_raw>(params);
+
+		#ifdef PIXELFORMAT_SSE2
+		if (!params.gamma && !FLAGS(params.pf, PF_GRAY))
+			return sse2_color2pf_image_auto(params);
+		#endif
+
+		return color2pf_image_auto(params);
+	}
 } // namespace
 
 namespace {
@@ -374,6 +487,68 @@ namespace {
 			return pf2color_image_partauto<false, true >(params);
 		return     pf2color_image_partauto<false, false>(params);
 	}
+
+
+#ifdef PIXELFORMAT_SSE2
+	//! Reads channels placed in memory in given order,
+	//! gives the same values as pf2color() for 8-bit RGBA formats
+	template<int order, bool alpha_premult>
+	static inline const unsigned char*
+	sse2_pf2color(
+		Color &dst,
+		const unsigned char *src )
+	{
+		unsigned int bytes;
+		memcpy(&bytes, src, sizeof(bytes));
+
+		const __m128i zero = _mm_setzero_si128();
+		const __m128 one = _mm_set1_ps(1.f);
+		const __m128i ints = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)bytes), zero), zero);
+		__m128 c = _mm_mul_ps(_mm_cvtepi32_ps(ints), _mm_set1_ps(ColorReal(1.0/255.0)));
+		c = _mm_shuffle_ps(c, c, order);
+
+		// see Color::demult_alpha()
+		if (alpha_premult) {
+			const Color transparent = Color::alpha();
+			const __m128 a = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3));
+			const __m128 demulted = sse2_select(sse2_alpha_mask(), c, _mm_mul_ps(c, _mm_div_ps(one, a)));
+			c = sse2_select(_mm_cmpeq_ps(a, _mm_setzero_ps()), _mm_loadu_ps((const float*)&transparent), demulted);
+		}
+
+		_mm_storeu_ps((float*)&dst, c);
+		return src + sizeof(bytes);
+	}
+
+	//! 8-bit RGBA formats
+	static inline const unsigned char*
+	sse2_pf2color_image_auto(const PF2ColorParams &params) {
+		const bool bgr = FLAGS(params.pf, PF_BGR);
+		if (FLAGS(params.pf, PF_A_PREMULT)) {
+			if (FLAGS(params.pf, PF_A_START))
+				return bgr ? pf2color_image< sse2_pf2color<_MM_SHUFFLE(0, 1, 2, 3), true> >(params)
+				           : pf2color_image< sse2_pf2color<_MM_SHUFFLE(0, 3, 2, 1), true> >(params);
+			return bgr ? pf2color_image< sse2_pf2color<_MM_SHUFFLE(3, 0, 1, 2), true> >(params)
+			           : pf2color_image< sse2_pf2color<_MM_SHUFFLE(3, 2, 1, 0), true> >(params);
+		}
+		if (FLAGS(params.pf, PF_A_START))
+			return bgr ? pf2color_image< sse2_pf2color<_MM_SHUFFLE(0, 1, 2, 3), false> >(params)
+			           : pf2color_image< sse2_pf2color<_MM_SHUFFLE(0, 3, 2, 1), false> >(params);
+		return bgr ? pf2color_image< sse2_pf2color<_MM_SHUFFLE(3, 0, 1, 2), false> >(params)
+		           : pf2color_image< sse2_pf2color<_MM_SHUFFLE(3, 2, 1, 0), false> >(params);
+	}
+#endif
+
+
+	//! Uses SIMD for 8-bit RGBA formats, results are the same as of pf2color_image_auto().
+	//! Three-channel formats are vectorized by compiler well enough.
+	static inline const unsigned char*
+	pf2color_image_fast(const PF2ColorParams &params) {
+		#ifdef PIXELFORMAT_SSE2
+		if (!FLAGS(params.pf, PF_RAW_COLOR) && !FLAGS(params.pf, PF_GRAY) && FLAGS(params.pf, PF_A))
+			return sse2_pf2color_image_auto(params);
+		#endif
+		return pf2color_image_auto(params);
+	}
 };
 
 
@@ -399,6 +574,25 @@ synfig::color_to_pixelformat(
 	int height,
 	int dst_stride,
 	int src_stride )
+{
+	assert(src_stride % sizeof(Color) == 0);
+	return color2pf_image_fast(Color2PFParams(
+		dst, src, pf, gamma, width, height,
+		dst_stride ? dst_stride - width*pixel_size(pf) : 0,
+		src_stride ? src_stride/sizeof(Color) - width  : 0 ));
+}
+
+
+unsigned char*
+synfig::color_to_pixelformat_reference(
+	unsigned char *dst,
+	const Color *src,
+	PixelFormat pf,
+	const Gamma *gamma,
+	int width,
+	int height,
+	int dst_stride,
+	int src_stride )
 {
 	assert(src_stride % sizeof(Color) == 0);
 	return color2pf_image_auto(Color2PFParams(
@@ -419,9 +613,27 @@ synfig::pixelformat_to_color(
 	int src_stride )
 {
 	assert(dst_stride % sizeof(Color) == 0);
-	return pf2color_image_auto(PF2ColorParams(
+	return pf2color_image_fast(PF2ColorParams(
 		dst, src, pf, width, height,
 		dst_stride ? dst_stride/sizeof(Color) - width  : 0,
 		src_stride ? src_stride - width*pixel_size(pf) : 0 ));
 	assert(src_stride % sizeof(Color) == 0);
 }
+
+
+const unsigned char*
+synfig::pixelformat_to_color_reference(
+	Color *dst,
+	const unsigned char *src,
+	PixelFormat pf,
+	int width,
+	int height,
+	int dst_stride,
+	int src_stride )
+{
+	assert(dst_stride % sizeof(Color) == 0);
+	return pf2color_image_auto(PF2ColorParams(
+		dst, src, pf, width, height,
+		dst_stride ? dst_stride/sizeof(Color) - width  : 0,
+		src_stride ? src_stride - width*pixel_size(pf) : 0 ));
+}
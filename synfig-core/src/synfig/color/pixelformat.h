@@ -94,6 +94,31 @@ pixelformat_to_color(
 	int dst_stride = 0,
 	int src_stride = 0 );
 
+//! The same as color_to_pixelformat(), but without SIMD,
+//! used to check results of the optimized conversion
+unsigned char*
+color_to_pixelformat_reference(
+	unsigned char *dst,
+	const Color *src,
+	PixelFormat pf,
+	const Gamma *gamma = NULL,
+	int width = 1,
+	int height = 1,
+	int dst_stride = 0,
+	int src_stride = 0 );
+
+//! The same as pixelformat_to_color(), but without SIMD,
+//! used to check results of the optimized conversion
+const unsigned char*
+pixelformat_to_color_reference(
+	Color *dst,
+	const unsigned char *src,
+	PixelFormat pf,
+	int width = 1,
+	int height = 1,
+	int dst_stride = 0,
+	int src_stride = 0 );
+
 } // synfig namespace
 
 #endif // __SYNFIG_COLOR_PIXELFORMAT_H
@@ -45,7 +45,9 @@
 #include "valuenode.h"
 #include "transformation.h"
 
+#include "layers/layer_duplicate.h"
 #include "layers/layer_pastecanvas.h"
+#include "threadpool.h"
 
 #include "rendering/task.h"
 
@@ -90,6 +92,37 @@ _print_profile_report()
 
 /* === P R O C E D U R E S ================================================= */
 
+//! Prepares cloned layer (and layers of its inline canvas) for evaluation,
+//! returns \c false if the layer still shares mutable state with the original one
+static bool
+prepare_snapshot_layer(const Layer::Handle &layer)
+{
+	// index of the duplicate is stored in the ValueNode_Duplicate which is shared between clones
+	bool isolated = !etl::handle<Layer_Duplicate>::cast_dynamic(layer);
+
+	// force evaluation of the clone even if the time is not changed
+	layer->clear_time_mark();
+
+	if (etl::handle<Layer_PasteCanvas> paste = etl::handle<Layer_PasteCanvas>::cast_dynamic(layer))
+	{
+		if (Canvas::Handle canvas = paste->get_sub_canvas())
+		{
+			// only inline canvases are cloned with the layer
+			if (!canvas->is_inline())
+				return false;
+			for(Canvas::const_iterator i = canvas->begin(); i != canvas->end(); ++i)
+				if (*i && !prepare_snapshot_layer(*i))
+					isolated = false;
+		}
+	}
+
+	return isolated;
+}
+
+static void
+build_snapshot_task(ContextSnapshot::Handle snapshot, rendering::Task::Handle *task)
+	{ *task = snapshot->build_rendering_task(); }
+
 /* === M E T H O D S ======================================================= */
 
 
@@ -423,3 +456,83 @@ Context::build_rendering_task() const
 	}
 }
 
+
+ContextSnapshot::ContextSnapshot(const Context &context, Time time):
+	params(context.get_params()),
+	time(time),
+	isolated(true),
+	evaluated(false),
+	built(false)
+{
+	// all layers are evaluated by evaluate(), don't evaluate them again while building
+	params.force_set_time = false;
+
+	for(IndependentContext i = context; *i; ++i)
+	{
+		if (!Context::active(params, **i))
+			continue;
+		Layer::Handle layer = (*i)->clone(NULL);
+		if (layer)
+		{
+			layer->set_canvas((*i)->get_canvas());
+			if (!prepare_snapshot_layer(layer))
+				isolated = false;
+		}
+		else
+		{
+			layer = *i;
+			isolated = false;
+		}
+		layers.push_back(layer);
+	}
+	layers.push_back(Layer::Handle());
+}
+
+void
+ContextSnapshot::evaluate()
+{
+	if (evaluated) return;
+	evaluated = true;
+
+	Context context = get_context();
+	if (*context)
+		context.set_time(time, true);
+}
+
+rendering::Task::Handle
+ContextSnapshot::build_rendering_task()
+{
+	if (!built)
+	{
+		evaluate();
+		task = get_context().build_rendering_task();
+		built = true;
+	}
+	return task;
+}
+
+void
+ContextSnapshot::build_rendering_tasks(const List &snapshots, rendering::Task::List &out_tasks)
+{
+	out_tasks.clear();
+	out_tasks.resize(snapshots.size());
+
+	bool parallel = snapshots.size() > 1;
+	for(List::const_iterator i = snapshots.begin(); i != snapshots.end(); ++i)
+		if (*i && !(*i)->is_isolated())
+			{ parallel = false; break; }
+
+	if (!parallel)
+	{
+		for(int i = 0; i < (int)snapshots.size(); ++i)
+			if (snapshots[i])
+				out_tasks[i] = snapshots[i]->build_rendering_task();
+		return;
+	}
+
+	ThreadPool::Group group;
+	for(int i = 0; i < (int)snapshots.size(); ++i)
+		if (snapshots[i])
+			group.enqueue( sigc::bind(sigc::ptr_fun(&build_snapshot_task), snapshots[i], &out_tasks[i]) );
+	group.run();
+}
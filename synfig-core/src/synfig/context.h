@@ -31,6 +31,8 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <vector>
+
 #include "canvas.h"
 #include "rect.h"
 #include "renddesc.h"
@@ -229,6 +231,60 @@ public:
 	
 }; // END of class Context
 
+/*!	\class ContextSnapshot
+**	\brief ContextSnapshot is an independent copy of the layers of a Context
+* evaluated at the given time.
+**	Snapshot holds clones of the layers (and of their inline canvases),
+* so evaluation of the snapshot and building of its rendering task
+* do not touch the layers of the original canvas. Snapshots of the same
+* context for different times (or for different states of ValueNode_Duplicate)
+* may be evaluated and built from different threads, if all of them
+* are isolated.
+**	Snapshot should be created in the thread which owns the canvas.
+**	\see Context */
+class ContextSnapshot: public etl::shared_object
+{
+public:
+	typedef etl::handle<ContextSnapshot> Handle;
+	typedef std::vector<Handle> List;
+
+private:
+	//! Cloned layers, ends with empty handle like the layers of Canvas
+	CanvasBase layers;
+	ContextParams params;
+	Time time;
+	//! Snapshot doesn't share mutable state with the original context
+	bool isolated;
+	bool evaluated;
+	bool built;
+	rendering::Task::Handle task;
+
+	ContextSnapshot(const ContextSnapshot&) = delete;
+	ContextSnapshot& operator=(const ContextSnapshot&) = delete;
+
+public:
+	//! Clones active layers of the \a context, does not evaluate them
+	ContextSnapshot(const Context &context, Time time);
+
+	//! Returns \c true if snapshot may be evaluated and built in any thread
+	bool is_isolated() const { return isolated; }
+	Time get_time() const { return time; }
+
+	//! Context to walk through the layers of the snapshot
+	Context get_context() const
+		{ return Context(layers.begin(), params); }
+
+	//! Sets time of the cloned layers, does nothing if snapshot is already evaluated
+	void evaluate();
+
+	//! Evaluates the snapshot and makes rendering task, task is built only once
+	rendering::Task::Handle build_rendering_task();
+
+	//! Builds tasks of all snapshots, in parallel if all of them are isolated.
+	//! \a out_tasks receives one task (may be empty) for each snapshot in the same order.
+	static void build_rendering_tasks(const List &snapshots, rendering::Task::List &out_tasks);
+}; // END of class ContextSnapshot
+
 }; // END of namespace synfig
 
 /* === E N D =============================================================== */
@@ -0,0 +1,331 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file trace.cpp
+**	\brief Runtime tracing of rendering
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <glib.h>
+
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include <synfig/general.h>
+
+#include "trace.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+using namespace debug;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+namespace {
+
+const int chunk_size = 4096;
+//! limits memory of trace to 256 MiB per thread, later events are dropped
+const int max_chunks = 1024;
+
+//! Events are appended by the owner thread only,
+//! the count is published after the event is written,
+//! so readers may see the chunk while it is filled
+struct Chunk
+{
+	Trace::Event events[chunk_size];
+	std::atomic<int> count;
+	std::atomic<Chunk*> next;
+
+	Chunk(): count(0), next(nullptr) { }
+};
+
+struct Buffer
+{
+	int thread_id;
+	String thread_name; //!< guarded by Registry::mutex
+	long long generation; //!< written by owner under Registry::mutex
+	Chunk *first;         //!< replaced by owner under Registry::mutex
+	Chunk *last;          //!< used by owner only
+	int chunks;           //!< used by owner only
+	bool finished;        //!< thread is exited, guarded by Registry::mutex
+
+	explicit Buffer(int thread_id):
+		thread_id(thread_id), generation(-1), first(), last(), chunks(), finished() { }
+	~Buffer()
+		{ free_chunks(); }
+
+	void free_chunks()
+	{
+		while(first)
+			{ Chunk *c = first; first = c->next; delete c; }
+		last = nullptr;
+		chunks = 0;
+	}
+};
+
+class Registry
+{
+public:
+	std::mutex mutex;
+	std::vector<Buffer*> buffers;
+	//! incremented by Trace::clear(), buffers of other generations are skipped
+	std::atomic<long long> generation;
+	std::atomic<long long> dropped;
+	int last_thread_id;
+
+	Registry(): generation(0), dropped(0), last_thread_id(0) { }
+
+	//! never deleted: threads may record events while static objects are destroyed
+	static Registry& instance()
+	{
+		static Registry *registry = new Registry();
+		return *registry;
+	}
+};
+
+//! Buffer of the current thread, it's released to Registry when thread exits
+struct LocalBuffer
+{
+	Buffer *buffer;
+
+	LocalBuffer(): buffer() { }
+	~LocalBuffer()
+	{
+		if (!buffer) return;
+		Registry &registry = Registry::instance();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		buffer->finished = true;
+	}
+
+	Buffer& get()
+	{
+		if (!buffer) {
+			Registry &registry = Registry::instance();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			buffer = new Buffer(++registry.last_thread_id);
+			registry.buffers.push_back(buffer);
+		}
+		return *buffer;
+	}
+};
+
+thread_local LocalBuffer local_buffer;
+
+} // end of anonimous namespace
+
+std::atomic<bool> Trace::enabled(false);
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+void
+write_string(std::ostream &stream, const char *s)
+{
+	stream << '"';
+	if (s)
+		for(; *s; ++s) {
+			const unsigned char c = *s;
+			if (c == '"' || c == '\\')
+				stream << '\\' << *s;
+			else
+			if (c < 0x20)
+				stream << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 15];
+			else
+				stream << *s;
+		}
+	stream << '"';
+}
+
+void
+write_event(std::ostream &stream, int thread_id, const Trace::Event &event)
+{
+	stream << ",\n{\"name\":";
+	write_string(stream, event.name);
+	stream << ",\"cat\":";
+	write_string(stream, event.category);
+	stream << ",\"ph\":\"X\",\"ts\":" << event.begin
+	       << ",\"dur\":" << (event.end - event.begin)
+	       << ",\"pid\":1,\"tid\":" << thread_id;
+
+	const bool has_rect = event.rect.is_valid();
+	if (has_rect || event.arg_name) {
+		stream << ",\"args\":{";
+		if (has_rect)
+			stream << "\"rect\":[" << event.rect.minx << ',' << event.rect.miny
+			       << ',' << event.rect.maxx << ',' << event.rect.maxy << ']';
+		if (event.arg_name) {
+			if (has_rect) stream << ',';
+			write_string(stream, event.arg_name);
+			stream << ':' << event.arg;
+		}
+		stream << '}';
+	}
+	stream << '}';
+}
+
+} // end of anonimous namespace
+
+/* === M E T H O D S ======================================================= */
+
+void
+Trace::Scope::init(const char *category, const char *name, const char *arg_name, long long arg)
+{
+	event.category = category;
+	event.name = name;
+	event.arg_name = arg_name;
+	event.arg = arg;
+	event.begin = now();
+	active = true;
+}
+
+long long
+Trace::now()
+	{ return g_get_monotonic_time(); }
+
+void
+Trace::add(const Event &event)
+{
+	Registry &registry = Registry::instance();
+	Buffer &buffer = local_buffer.get();
+
+	// buffer was cleared, lock is required to free chunks which may be read by save()
+	const long long generation = registry.generation;
+	if (buffer.generation != generation) {
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		buffer.free_chunks();
+		buffer.first = buffer.last = new Chunk();
+		buffer.chunks = 1;
+		buffer.generation = registry.generation;
+	}
+
+	Chunk *chunk = buffer.last;
+	int count = chunk->count.load(std::memory_order_relaxed);
+	if (count == chunk_size) {
+		if (buffer.chunks >= max_chunks)
+			{ ++registry.dropped; return; }
+		Chunk *next = new Chunk();
+		chunk->next.store(next, std::memory_order_release);
+		buffer.last = chunk = next;
+		++buffer.chunks;
+		count = 0;
+	}
+
+	chunk->events[count] = event;
+	chunk->count.store(count + 1, std::memory_order_release);
+}
+
+void
+Trace::set_thread_name(const String &name)
+{
+	Buffer &buffer = local_buffer.get();
+	Registry &registry = Registry::instance();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	buffer.thread_name = name;
+}
+
+void
+Trace::clear()
+{
+	Registry &registry = Registry::instance();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	++registry.generation;
+	registry.dropped = 0;
+
+	// buffers of live threads are freed by their owners at the next event
+	for(std::vector<Buffer*>::iterator i = registry.buffers.begin(); i != registry.buffers.end();)
+		if ((*i)->finished)
+			{ delete *i; i = registry.buffers.erase(i); }
+		else
+			++i;
+}
+
+long long
+Trace::count()
+{
+	Registry &registry = Registry::instance();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	long long count = 0;
+	for(std::vector<Buffer*>::const_iterator i = registry.buffers.begin(); i != registry.buffers.end(); ++i)
+		if ((*i)->generation == registry.generation)
+			for(const Chunk *c = (*i)->first; c; c = c->next.load(std::memory_order_acquire))
+				count += c->count.load(std::memory_order_acquire);
+	return count;
+}
+
+bool
+Trace::save(const String &filename)
+{
+	std::ofstream stream(filename.c_str(), std::ios_base::out | std::ios_base::trunc);
+	if (!stream) {
+		error("Trace: cannot open file for writing: %s", filename.c_str());
+		return false;
+	}
+
+	Registry &registry = Registry::instance();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+	       << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"synfig\"}}";
+	long long count = 0;
+	for(std::vector<Buffer*>::const_iterator i = registry.buffers.begin(); i != registry.buffers.end(); ++i) {
+		const Buffer &buffer = **i;
+
+		// names are kept by clear(), threads are named once at start
+		if (!buffer.thread_name.empty()) {
+			stream << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.thread_id
+			       << ",\"args\":{\"name\":";
+			write_string(stream, buffer.thread_name.c_str());
+			stream << "}}";
+		}
+
+		if (buffer.generation != registry.generation)
+			continue;
+		for(const Chunk *c = buffer.first; c; c = c->next.load(std::memory_order_acquire)) {
+			const int n = c->count.load(std::memory_order_acquire);
+			for(int j = 0; j < n; ++j)
+				write_event(stream, buffer.thread_id, c->events[j]);
+			count += n;
+		}
+	}
+	stream << "\n]}\n";
+
+	if (registry.dropped)
+		warning("Trace: %lld events are dropped, buffers are full", (long long)registry.dropped);
+	info("Trace: %lld events are written to %s", count, filename.c_str());
+	return stream.good();
+}
+
+/* === E N T R Y P O I N T ================================================= */
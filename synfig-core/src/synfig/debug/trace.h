@@ -0,0 +1,121 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file trace.h
+**	\brief Runtime tracing of rendering
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_DEBUG_TRACE_H
+#define __SYNFIG_DEBUG_TRACE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <atomic>
+
+#include <synfig/rect.h>
+#include <synfig/string.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig {
+namespace debug {
+
+//! Runtime tracing of rendering, disabled by default.
+//! Each thread appends events to its own buffer without locks,
+//! the whole trace may be saved in Chrome trace format
+//! (chrome://tracing, https://ui.perfetto.dev).
+//! Names of events are not copied, so they should be string literals
+//! or names of tokens, which live until exit of process.
+class Trace {
+public:
+	struct Event
+	{
+		const char *category;
+		const char *name;
+		long long begin;      //!< in microseconds, see now()
+		long long end;
+		RectInt rect;         //!< target rect of task, not saved when invalid
+		const char *arg_name; //!< name of optional numeric argument
+		long long arg;
+
+		Event(): category(), name(), begin(), end(), arg_name(), arg() { }
+	};
+
+	//! Records the event from construction to destruction,
+	//! nothing is recorded when tracing was disabled at construction
+	class Scope {
+	private:
+		Event event;
+		bool active;
+
+		Scope(const Scope&): active() { }
+		Scope& operator= (const Scope&) { return *this; }
+		void init(const char *category, const char *name, const char *arg_name, long long arg);
+
+	public:
+		Scope(const char *category, const char *name, const char *arg_name = nullptr, long long arg = 0):
+			active()
+			{ if (is_enabled()) init(category, name, arg_name, arg); }
+		Scope(const char *category, const char *name, const RectInt &rect, const char *arg_name = nullptr, long long arg = 0):
+			active()
+			{ if (is_enabled()) { event.rect = rect; init(category, name, arg_name, arg); } }
+
+		~Scope()
+			{ if (active) { event.end = now(); add(event); } }
+	};
+
+private:
+	static std::atomic<bool> enabled;
+
+public:
+	static bool is_enabled()
+		{ return enabled.load(std::memory_order_relaxed); }
+	static void set_enabled(bool x)
+		{ enabled = x; }
+
+	static long long now();
+
+	//! Appends event to the buffer of current thread
+	static void add(const Event &event);
+	//! Name of current thread in saved traces
+	static void set_thread_name(const String &name);
+
+	//! Drops all recorded events
+	static void clear();
+	//! Count of recorded events
+	static long long count();
+	//! Writes recorded events in Chrome trace format (JSON),
+	//! may be called while other threads are still recording
+	static bool save(const String &filename);
+};
+
+}; // END of namespace debug
+}; // END of namespace synfig
+
+/* === E N D =============================================================== */
+
+#endif
@@ -47,6 +47,7 @@
 
 #include "canvas.h"
 #include "importer.h"
+#include "importerframecache.h"
 #include "string.h"
 #include "surface.h"
 
@@ -65,6 +66,9 @@ using namespace synfig;
 Importer::Book* synfig::Importer::book_;
 
 static std::map<FileSystem::Identifier,Importer::LooseHandle> *__open_importers;
+//! importers may open other importers while decoding frames in background,
+//! destructor of importer which failed in constructor locks it again
+static std::recursive_mutex __open_importers_mutex;
 
 /* === P R O C E D U R E S ================================================= */
 
@@ -75,12 +79,19 @@ Importer::subsys_init()
 {
 	book_=new Book();
 	__open_importers=new std::map<FileSystem::Identifier,Importer::LooseHandle>();
+
+	// decoded frames of image sequences and videos, in megabytes
+	if (const char *s = getenv("SYNFIG_IMPORTER_CACHE_SIZE"))
+		ImporterFrameCache::instance().set_max_bytes((size_t)std::max(0, atoi(s))*1024*1024);
+	if (const char *s = getenv("SYNFIG_IMPORTER_PREFETCH_FRAMES"))
+		ImporterFrameCache::instance().set_prefetch_frames(atoi(s));
 	return true;
 }
 
 bool
 Importer::subsys_stop()
 {
+	ImporterFrameCache::instance().clear();
 	delete book_;
 	delete __open_importers;
 	return true;
@@ -103,6 +114,8 @@ Importer::open(const FileSystem::Identifier &identifier, bool force)
 		return nullptr;
 	}
 
+	std::lock_guard<std::recursive_mutex> lock(__open_importers_mutex);
+
 	// If we already have an importer open under that filename,
 	// then use it instead.
 	if(__open_importers->count(identifier))
@@ -143,7 +156,11 @@ Importer::open(const FileSystem::Identifier &identifier, bool force)
 
 void Importer::forget(const FileSystem::Identifier &identifier)
 {
-	__open_importers->erase(identifier);
+	{
+		std::lock_guard<std::recursive_mutex> lock(__open_importers_mutex);
+		__open_importers->erase(identifier);
+	}
+	ImporterFrameCache::instance().erase(identifier);
 }
 
 Importer::Importer(const FileSystem::Identifier &identifier):
@@ -155,30 +172,56 @@ Importer::Importer(const FileSystem::Identifier &identifier):
 Importer::~Importer()
 {
 	// Remove ourselves from the open importer list
+	std::lock_guard<std::recursive_mutex> lock(__open_importers_mutex);
 	std::map<FileSystem::Identifier,Importer::LooseHandle>::iterator iter;
 	for(iter=__open_importers->begin();iter!=__open_importers->end();)
 		if(iter->second==this)
 			__open_importers->erase(iter++); else ++iter;
+
+	// frames of the file may change after it's closed
+	ImporterFrameCache::instance().erase(identifier);
 }
 
 rendering::Surface::Handle
 Importer::get_frame(const RendDesc & /* renddesc */, const Time &time)
 {
+	std::lock_guard<std::mutex> lock(frame_mutex_);
+
 	if (last_surface_ && last_surface_->is_exists() && !is_animated())
 		return last_surface_;
 
+	// version is read before decoding, so a file changed meanwhile is decoded again next time
+	const Time frame_time = is_animated() ? time : Time(0);
+	const ImporterFrameCache::Version version = ImporterFrameCache::get_version(identifier);
+	if (rendering::Surface::Handle cached = ImporterFrameCache::instance().find(identifier, frame_time, version))
+		return cached;
+
 	Surface surface;
 	if(!get_frame(surface, RendDesc(), time))
 		warning(strprintf("Unable to get frame from \"%s\"", identifier.filename.c_str()));
 
+	rendering::Surface::Handle result;
 	const char *s = getenv("SYNFIG_PACK_IMAGES");
 	if (s == nullptr || atoi(s) != 0)
-		last_surface_ = new rendering::SurfaceSWPacked();
+		result = new rendering::SurfaceSWPacked();
 	else
-		last_surface_ = new rendering::SurfaceSW();
+		result = new rendering::SurfaceSW();
+
+	// frames stored in cache are not kept by importer, so they are freed when evicted
+	last_surface_.reset();
+	if (surface.is_valid()) {
+		result->assign(surface[0], surface.get_w(), surface.get_h());
+		if (ImporterFrameCache::instance().put(identifier, frame_time, version, result))
+			return result;
+	}
 
-	if (surface.is_valid())
-		last_surface_->assign(surface[0], surface.get_w(), surface.get_h());
+	return last_surface_ = result;
+}
 
-	return last_surface_;
+Importer::Handle
+Importer::get_frame_importer(const RendDesc & /* renddesc */, Time &time)
+{
+	if (!is_animated())
+		time = Time(0);
+	return this;
 }
@@ -31,6 +31,7 @@
 /* === H E A D E R S ======================================================= */
 
 #include <map>
+#include <mutex>
 
 #include <ETL/handle>
 
@@ -145,6 +146,8 @@ public:
 
 private:
 	rendering::Surface::Handle last_surface_;
+	//! frames may be decoded by threads of ImporterFrameCache::prefetch()
+	std::mutex frame_mutex_;
 
 protected:
 
@@ -165,8 +168,13 @@ public:
 	*/
 	virtual bool get_frame(Surface &surface, const RendDesc &renddesc, Time time, ProgressCallback *callback=nullptr) = 0;
 
+	//! Returns the frame from ImporterFrameCache, or decodes and stores it
 	virtual rendering::Surface::Handle get_frame(const RendDesc &renddesc, const Time &time);
 
+	//! Returns the importer which decodes the frame at \a time, and the time of frame in it.
+	//! Image sequences return importer of the single image (and zero time).
+	virtual Handle get_frame_importer(const RendDesc &renddesc, Time &time);
+
 	//! Returns \c true if the importer pays attention to the \a time parameter of get_frame()
 	virtual bool is_animated() { return false; }
 
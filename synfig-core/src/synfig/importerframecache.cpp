@@ -0,0 +1,332 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file importerframecache.cpp
+**	\brief ImporterFrameCache
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include "importerframecache.h"
+
+#include <glib/gstdio.h>
+#include <glibmm/convert.h>
+
+#include "general.h"
+#include "threadpool.h"
+
+#endif
+
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+//! default limit of memory of decoded frames, see Importer::subsys_init()
+static const size_t default_max_bytes = 256*1024*1024;
+static const int default_prefetch_frames = 2;
+
+//! set while thread of ThreadPool decodes a frame for prefetch()
+static thread_local bool prefetching = false;
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+ImporterFrameCache::ImporterFrameCache(size_t max_bytes):
+	max_bytes(max_bytes),
+	prefetch_frames(default_prefetch_frames)
+{ }
+
+ImporterFrameCache&
+ImporterFrameCache::instance()
+{
+	// never deleted: importers may be destroyed by static destructors
+	static ImporterFrameCache *cache = new ImporterFrameCache(default_max_bytes);
+	return *cache;
+}
+
+size_t
+ImporterFrameCache::get_max_bytes() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return max_bytes;
+}
+
+void
+ImporterFrameCache::set_max_bytes(size_t max_bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	this->max_bytes = max_bytes;
+	evict(0);
+}
+
+int
+ImporterFrameCache::get_prefetch_frames() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return prefetch_frames;
+}
+
+void
+ImporterFrameCache::set_prefetch_frames(int prefetch_frames)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	this->prefetch_frames = std::max(0, prefetch_frames);
+}
+
+void
+ImporterFrameCache::erase_entry(EntryMap::iterator i)
+{
+	stats.bytes -= i->second->bytes;
+	--stats.entries;
+	entries.erase(i->second);
+	entries_map.erase(i);
+}
+
+void
+ImporterFrameCache::evict(size_t required)
+{
+	while(!entries.empty() && stats.bytes + required > max_bytes) {
+		erase_entry(entries_map.find(entries.back().key));
+		++stats.evictions;
+	}
+}
+
+ImporterFrameCache::Version
+ImporterFrameCache::get_version(const FileSystem::Identifier &identifier)
+{
+	Version version;
+	if (!identifier.file_system)
+		return version;
+
+	// files inside of containers don't have real names, they are changed only with the container,
+	// and the importers are opened again then
+	const String uri = identifier.file_system->get_real_uri(identifier.filename);
+	if (uri.empty())
+		return version;
+
+	try {
+		GStatBuf buffer;
+		if (g_stat(Glib::filename_from_uri(uri).c_str(), &buffer) == 0) {
+			version.mtime = (long long)buffer.st_mtime;
+			version.size = (long long)buffer.st_size;
+		}
+	} catch(...) { }
+	return version;
+}
+
+rendering::Surface::Handle
+ImporterFrameCache::find(const FileSystem::Identifier &identifier, const Time &time, const Version &version)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!max_bytes)
+		return rendering::Surface::Handle();
+
+	EntryMap::iterator i = entries_map.find(Key(identifier, time));
+	if (i != entries_map.end() && i->second->version != version) {
+		// file is changed after the frame was decoded
+		erase_entry(i);
+		i = entries_map.end();
+	}
+	if (i == entries_map.end()) {
+		if (!prefetching) ++stats.misses;
+		return rendering::Surface::Handle();
+	}
+
+	if (!prefetching) {
+		++stats.hits;
+		if (i->second->prefetched)
+			{ ++stats.prefetch_hits; i->second->prefetched = false; }
+	}
+	entries.splice(entries.begin(), entries, i->second);
+	return i->second->surface;
+}
+
+bool
+ImporterFrameCache::put(const FileSystem::Identifier &identifier, const Time &time, const Version &version, const rendering::Surface::Handle &surface)
+{
+	if (!surface)
+		return false;
+	size_t bytes = sizeof(Entry) + surface->get_memory_size();
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// don't flush whole cache for a single frame
+	if (bytes > max_bytes/4)
+		return false;
+
+	const Key key(identifier, time);
+	EntryMap::iterator i = entries_map.find(key);
+	if (i != entries_map.end())
+		erase_entry(i);
+	evict(bytes);
+
+	Entry entry;
+	entry.key = key;
+	entry.version = version;
+	entry.surface = surface;
+	entry.bytes = bytes;
+	entry.prefetched = prefetching;
+	entries.push_front(entry);
+	entries_map[key] = entries.begin();
+
+	stats.bytes += bytes;
+	++stats.entries;
+	++stats.stores;
+	return true;
+}
+
+void
+ImporterFrameCache::erase(const FileSystem::Identifier &identifier)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for(EntryMap::iterator i = entries_map.begin(); i != entries_map.end();)
+		if (i->first.identifier == identifier)
+			erase_entry(i++); else ++i;
+}
+
+void
+ImporterFrameCache::run_job(PrefetchJob *job)
+{
+	prefetching = true;
+	try { job->importer->get_frame(job->renddesc, job->time); } catch(...) { }
+	prefetching = false;
+
+	ImporterFrameCache &cache = instance();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	job->done = true;
+	cache.cond.notify_all();
+}
+
+void
+ImporterFrameCache::release_jobs()
+{
+	JobList done_jobs;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for(JobList::iterator i = jobs.begin(); i != jobs.end();)
+			if ((*i)->done)
+				done_jobs.splice(done_jobs.end(), jobs, i++); else ++i;
+	}
+	// importers are released here, without lock
+}
+
+void
+ImporterFrameCache::prefetch(const Importer::Handle &importer, const RendDesc &renddesc, const Time &time)
+{
+	release_jobs();
+
+	const float fps = renddesc.get_frame_rate();
+	const int count = get_prefetch_frames();
+	if (!importer || !is_enabled() || count <= 0 || fps <= 0.f)
+		return;
+
+	for(int i = 1; i <= count; ++i) {
+		Time frame_time = time + Time(i/fps);
+		Importer::Handle frame_importer = importer->get_frame_importer(renddesc, frame_time);
+		if (!frame_importer)
+			continue;
+
+		const Key key(frame_importer->identifier, frame_time);
+		const Version version = get_version(frame_importer->identifier);
+		PrefetchJob::Handle job;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			EntryMap::const_iterator i = entries_map.find(key);
+			if (i != entries_map.end() && i->second->version == version)
+				continue;
+			bool queued = false;
+			for(JobList::const_iterator j = jobs.begin(); j != jobs.end() && !queued; ++j) {
+				const Key job_key((*j)->importer->identifier, (*j)->time);
+				queued = !(job_key < key) && !(key < job_key);
+			}
+			if (queued)
+				continue;
+
+			job = new PrefetchJob();
+			job->importer = frame_importer;
+			job->renddesc = renddesc;
+			job->time = frame_time;
+			jobs.push_back(job);
+			++stats.prefetches;
+		}
+		ThreadPool::instance().enqueue( sigc::bind( sigc::ptr_fun(&ImporterFrameCache::run_job), job.get() ));
+	}
+}
+
+void
+ImporterFrameCache::wait_prefetch()
+{
+	JobList done_jobs;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while(true) {
+			bool pending = false;
+			for(JobList::const_iterator i = jobs.begin(); i != jobs.end() && !pending; ++i)
+				pending = !(*i)->done;
+			if (!pending) break;
+			ThreadPool::instance().wait(cond, lock);
+		}
+		done_jobs.swap(jobs);
+	}
+}
+
+void
+ImporterFrameCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+	entries_map.clear();
+	stats.bytes = 0;
+	stats.entries = 0;
+}
+
+ImporterFrameCache::Stats
+ImporterFrameCache::get_stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Stats s = stats;
+	s.max_bytes = max_bytes;
+	return s;
+}
+
+void
+ImporterFrameCache::reset_stats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.hits = 0;
+	stats.misses = 0;
+	stats.stores = 0;
+	stats.evictions = 0;
+	stats.prefetches = 0;
+	stats.prefetch_hits = 0;
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,194 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file importerframecache.h
+**	\brief ImporterFrameCache Header
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_IMPORTERFRAMECACHE_H
+#define __SYNFIG_IMPORTERFRAMECACHE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <mutex>
+
+#include "importer.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig {
+
+//! Bounded LRU cache of decoded frames of all importers, keyed by file and time of frame
+//! (time is zero for still images, so every image of a sequence is a separate entry).
+//! Frames are dropped with the importer which decoded them, image sequences keep
+//! importers of their images, so scrubbing back and forth doesn't decode the same files again.
+//! Each frame remembers the version of the file, frames of changed files are not used.
+//! Upcoming frames may be decoded in background by ThreadPool, see prefetch().
+class ImporterFrameCache
+{
+public:
+	struct Stats
+	{
+		long long hits;          //!< count of found frames
+		long long misses;        //!< count of not found frames
+		long long stores;        //!< count of stored frames
+		long long evictions;     //!< count of frames removed to free the memory
+		long long prefetches;    //!< count of frames queued for decoding in background
+		long long prefetch_hits; //!< count of found frames which was decoded in background
+		long long entries;       //!< count of frames in cache
+		size_t bytes;            //!< memory used by frames
+		size_t max_bytes;        //!< memory limit
+
+		Stats():
+			hits(), misses(), stores(), evictions(), prefetches(), prefetch_hits(),
+			entries(), bytes(), max_bytes() { }
+	};
+
+	//! modification time and size of the file, zeros when the file is not on disk
+	struct Version
+	{
+		long long mtime;
+		long long size;
+
+		Version(): mtime(), size() { }
+
+		bool operator== (const Version &other) const
+			{ return mtime == other.mtime && size == other.size; }
+		bool operator!= (const Version &other) const
+			{ return !(*this == other); }
+	};
+
+private:
+	struct Key
+	{
+		FileSystem::Identifier identifier;
+		Time time;
+
+		Key() { }
+		Key(const FileSystem::Identifier &identifier, const Time &time):
+			identifier(identifier), time(time) { }
+
+		bool operator< (const Key &other) const
+		{
+			if (identifier < other.identifier) return true;
+			if (other.identifier < identifier) return false;
+			return time < other.time;
+		}
+	};
+
+	struct Entry
+	{
+		Key key;
+		Version version;
+		rendering::Surface::Handle surface;
+		size_t bytes;
+		bool prefetched; //!< decoded in background and not requested yet
+		Entry(): bytes(), prefetched() { }
+	};
+
+	class PrefetchJob: public etl::shared_object
+	{
+	public:
+		typedef etl::handle<PrefetchJob> Handle;
+		Importer::Handle importer;
+		RendDesc renddesc;
+		Time time;
+		std::atomic<bool> done;
+		PrefetchJob(): done(false) { }
+	};
+
+	typedef std::list<Entry> EntryList;
+	typedef std::map<Key, EntryList::iterator> EntryMap;
+	typedef std::list<PrefetchJob::Handle> JobList;
+
+	mutable std::mutex mutex;
+	std::condition_variable cond;
+
+	size_t max_bytes;
+	int prefetch_frames;
+	Stats stats;
+
+	//! recently used frames are in front
+	EntryList entries;
+	EntryMap entries_map;
+
+	//! jobs are released by thread which calls prefetch(),
+	//! so importers are never destroyed by threads of ThreadPool
+	JobList jobs;
+
+	explicit ImporterFrameCache(size_t max_bytes);
+
+	void erase_entry(EntryMap::iterator i);
+	void evict(size_t required);
+	void release_jobs();
+
+	static void run_job(PrefetchJob *job);
+
+public:
+	//! cache lives until exit of process, so importers may be freed at any time
+	static ImporterFrameCache& instance();
+
+	size_t get_max_bytes() const;
+	void set_max_bytes(size_t max_bytes);
+	bool is_enabled() const
+		{ return get_max_bytes() > 0; }
+
+	//! how many frames after the requested one are decoded in background
+	int get_prefetch_frames() const;
+	void set_prefetch_frames(int prefetch_frames);
+
+	//! Reads the version of the file, before it is decoded
+	static Version get_version(const FileSystem::Identifier &identifier);
+
+	//! Searches the decoded frame of the given version of the file, null on fail
+	rendering::Surface::Handle find(const FileSystem::Identifier &identifier, const Time &time, const Version &version);
+	//! Stores the decoded frame, it should not be modified anymore.
+	//! Returns false when the frame is not stored, because the cache is disabled or too small
+	bool put(const FileSystem::Identifier &identifier, const Time &time, const Version &version, const rendering::Surface::Handle &surface);
+	//! Removes all frames of the file, when it is reloaded or its importer is destroyed
+	void erase(const FileSystem::Identifier &identifier);
+
+	//! Queues decoding of frames which follow \a time (frames of \a renddesc),
+	//! should be called by the thread which owns the importer
+	void prefetch(const Importer::Handle &importer, const RendDesc &renddesc, const Time &time);
+	//! Waits for all queued frames, should be called before ThreadPool stops
+	void wait_prefetch();
+
+	void clear();
+	Stats get_stats() const;
+	void reset_stats();
+};
+
+}; // END of namespace synfig
+
+/* === E N D =============================================================== */
+
+#endif
@@ -171,23 +171,38 @@ Layer_Duplicate::build_rendering_task_vfunc(Context context) const
 	ColorReal amount = get_amount() * Context::z_depth_visibility(context.get_params(), *this);
 	Color::BlendMethod blend_method = get_blend_method();
 
-	rendering::Task::Handle task;
+	// index is stored in the ValueNode_Duplicate, so evaluate snapshot
+	// of the context for each index while the index is set,
+	// then build the tasks for all of the indices at once
+	ContextSnapshot::List snapshots;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		duplicate_param->reset_index(time_cur);
+		do
+		{
+			ContextSnapshot::Handle snapshot(new ContextSnapshot(context, time_cur));
+			snapshot->evaluate();
+			// not isolated snapshot shares layers with the next indices
+			if (!snapshot->is_isolated())
+				snapshot->build_rendering_task();
+			snapshots.push_back(snapshot);
+		}
+		while (duplicate_param->step(time_cur));
+	}
 
-	std::lock_guard<std::mutex> lock(mutex);
-	duplicate_param->reset_index(time_cur);
-	ContextParams dup_context_params(context.get_params());
-	dup_context_params.force_set_time = true;
-	Context dup_context(context, dup_context_params);
-	do
+	rendering::Task::List sub_tasks;
+	ContextSnapshot::build_rendering_tasks(snapshots, sub_tasks);
+
+	rendering::Task::Handle task;
+	for(rendering::Task::List::const_iterator i = sub_tasks.begin(); i != sub_tasks.end(); ++i)
 	{
 		rendering::TaskBlend::Handle task_blend(new rendering::TaskBlend());
 		task_blend->amount = amount;
 		task_blend->blend_method = blend_method;
 		task_blend->sub_task_a() = task;
-		task_blend->sub_task_b() = dup_context.build_rendering_task();
+		task_blend->sub_task_b() = *i;
 		task = task_blend;
 	}
-	while (duplicate_param->step(time_cur));
 
 	return task;
 }
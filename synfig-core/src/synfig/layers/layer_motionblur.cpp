@@ -199,7 +199,10 @@ Layer_MotionBlur::build_rendering_task_vfunc(Context context) const
 	}
 
 	Real k = 1.0/sum;
-	rendering::Task::Handle task;
+
+	// take independent snapshots of the context for each subsample,
+	// so they can be evaluated and built at the same time
+	ContextSnapshot::List snapshots(samples);
 	for(int i = 0; i < samples; i++)
 	{
 		if (fabs(scales[i]*k) < 1e-8)
@@ -207,13 +210,23 @@ Layer_MotionBlur::build_rendering_task_vfunc(Context context) const
 
 		Real pos = (Real)i/(Real)(samples - 1);
 		Real ipos = 1.0 - pos;
-		context.set_time(get_time_mark() - aperture*ipos);
+		snapshots[i] = new ContextSnapshot(context, get_time_mark() - aperture*ipos);
+	}
+
+	rendering::Task::List sub_tasks;
+	ContextSnapshot::build_rendering_tasks(snapshots, sub_tasks);
+
+	rendering::Task::Handle task;
+	for(int i = 0; i < samples; i++)
+	{
+		if (!snapshots[i])
+			continue;
 
 		rendering::TaskBlend::Handle task_blend(new rendering::TaskBlend());
 		task_blend->amount = scales[i]*k;
 		task_blend->blend_method = Color::BLEND_ADD_COMPOSITE;
 		task_blend->sub_task_a() = task;
-		task_blend->sub_task_b() = context.build_rendering_task();
+		task_blend->sub_task_b() = sub_tasks[i];
 		task = task_blend;
 	}
 
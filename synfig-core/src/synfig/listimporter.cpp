@@ -39,6 +39,7 @@
 #include <synfig/localization.h>
 
 #include "filesystemnative.h"
+#include "importerframecache.h"
 #include <synfig/rendering/software/surfacesw.h>
 
 
@@ -50,6 +51,7 @@ using namespace synfig;
 
 /* === M A C R O S ========================================================= */
 
+//! importers kept without ImporterFrameCache, each one keeps its last frame
 #define LIST_IMPORTER_CACHE_SIZE	20
 
 /* === G L O B A L S ======================================================= */
@@ -182,10 +184,16 @@ ListImporter::get_sub_importer(const RendDesc &renddesc, Time time, ProgressCall
 		return Importer::Handle();
 	}
 
+	// with the frame cache importers don't keep frames, so all of them are kept,
+	// and the frames are dropped with this importer
+	const size_t max_importers = ImporterFrameCache::instance().is_enabled()
+	                           ? filename_list.size() : LIST_IMPORTER_CACHE_SIZE;
+
+	std::lock_guard<std::mutex> lock(frame_cache_mutex);
 	for(std::list<Importer::Handle>::iterator i = frame_cache.begin(); i != frame_cache.end();)
 		if (*i == importer) i = frame_cache.erase(i); else ++i;
 
-	while (frame_cache.size() >= LIST_IMPORTER_CACHE_SIZE)
+	while (!frame_cache.empty() && frame_cache.size() >= max_importers)
 		frame_cache.pop_front();
 	frame_cache.push_back(importer);
 
@@ -206,6 +214,14 @@ ListImporter::get_frame(const RendDesc &renddesc, const Time &time)
 	return importer ? importer->get_frame(renddesc, 0) : new rendering::SurfaceSW();
 }
 
+Importer::Handle
+ListImporter::get_frame_importer(const RendDesc &renddesc, Time &time)
+{
+	Importer::Handle importer = get_sub_importer(renddesc, time, NULL);
+	time = Time(0);
+	return importer;
+}
+
 bool
 ListImporter::is_animated()
 {
@@ -33,8 +33,9 @@
 
 #include "importer.h"
 #include "surface.h"
-#include <vector>
 #include <list>
+#include <mutex>
+#include <vector>
 
 /* === M A C R O S ========================================================= */
 
@@ -53,7 +54,10 @@ class ListImporter : public Importer
 private:
 	float fps;
 	std::vector<String> filename_list;
+	//! recently used importers of images are at the back,
+	//! their decoded frames live in ImporterFrameCache while the importers are kept
 	std::list<Importer::Handle> frame_cache;
+	std::mutex frame_cache_mutex;
 
 	Importer::Handle get_sub_importer(const RendDesc &renddesc, Time time, ProgressCallback *cb);
 
@@ -64,6 +68,7 @@ public:
 
 	virtual bool get_frame(Surface &surface, const RendDesc &renddesc, Time time, ProgressCallback *cb=NULL);
 	virtual rendering::Surface::Handle get_frame(const RendDesc &renddesc, const Time &time);
+	virtual Importer::Handle get_frame_importer(const RendDesc &renddesc, Time &time);
 	virtual bool is_animated();
 
 };
@@ -41,11 +41,15 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <algorithm>
+#include <exception>
 #include <iostream>
 #include <map>
 #include <vector>
 #include <stdexcept>
 
+#include <libxml/parser.h>
+#include <libxml/SAX2.h>
 #include <libxml++/libxml++.h>
 #include <sigc++/bind.h>
 
@@ -2706,17 +2710,21 @@ CanvasParser::parse_canvas_defs(xmlpp::Element *element,Canvas::Handle canvas)
 	for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
 	{
 		xmlpp::Element *child(dynamic_cast<xmlpp::Element*>(*iter));
-		if(!child)
-			continue;
-		else
-		if(child->get_name()=="canvas")
-			parse_canvas(child, canvas);
-		else
-			parse_value_node(child,canvas);
+		if(child)
+			parse_canvas_def(child, canvas);
 	}
 	if (getenv("SYNFIG_DEBUG_LOAD_CANVAS")) printf("%s:%d parse_canvas_defs done\n", __FILE__, __LINE__);
 }
 
+void
+CanvasParser::parse_canvas_def(xmlpp::Element *element,Canvas::Handle canvas)
+{
+	if(element->get_name()=="canvas")
+		parse_canvas(element, canvas);
+	else
+		parse_value_node(element,canvas);
+}
+
 std::list<ValueNode::Handle>
 CanvasParser::parse_canvas_bones(xmlpp::Element *element,Canvas::Handle canvas)
 {
@@ -3121,9 +3129,9 @@ CanvasParser::parse_layer(xmlpp::Element *element,Canvas::Handle canvas)
 }
 
 Canvas::Handle
-CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,String filename)
+CanvasParser::parse_canvas_header(xmlpp::Element *element,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,String filename,bool &existing)
 {
-
+	existing=false;
 	if(element->get_name()!="canvas")
 	{
 		error_unexpected_element(element,element->get_name(),"canvas");
@@ -3169,7 +3177,10 @@ CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool in
 	{
 		GUID guid(element->get_attribute("guid")->get_value());
 		if(guid_cast<Canvas>(guid))
+		{
+			existing=true;
 			return guid_cast<Canvas>(guid);
+		}
 		else
 			canvas->set_guid(guid);
 	}
@@ -3289,151 +3300,150 @@ CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool in
 
 	canvas->rend_desc().set_flags(RendDesc::PX_ASPECT|RendDesc::IM_SPAN);
 
-	std::list<ValueNode::Handle> bone_list;
-	xmlpp::Element::NodeList list = element->get_children();
-	for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+	return canvas;
+}
+
+void
+CanvasParser::parse_canvas_child(xmlpp::Element *child,Canvas::Handle canvas)
+{
+	if(child->get_name()=="defs")
 	{
-		xmlpp::Element *child(dynamic_cast<xmlpp::Element*>(*iter));
-		if(child)
+		if(canvas->is_inline())
+			error(child,_("Group canvases cannot have a <defs> section"));
+		parse_canvas_defs(child, canvas);
+	}
+	else
+	if(child->get_name()=="bones")
+	{
+		if(canvas->is_inline())
+			error(child,_("Inline canvas cannot have a <bones> section"));
+		std::list<ValueNode::Handle> bones = parse_canvas_bones(child, canvas);
+		canvas_bones_[canvas.get()].splice(canvas_bones_[canvas.get()].end(), bones);
+	}
+	else
+	if(child->get_name()=="keyframe")
+	{
+		if(canvas->is_inline())
 		{
-			if(child->get_name()=="defs")
-			{
-				if(canvas->is_inline())
-					error(child,_("Group canvases cannot have a <defs> section"));
-				parse_canvas_defs(child, canvas);
-			}
-			else
-			if(child->get_name()=="bones")
-			{
-				if(canvas->is_inline())
-					error(child,_("Inline canvas cannot have a <bones> section"));
-				bone_list = parse_canvas_bones(child, canvas);
-			}
-			else
-			if(child->get_name()=="keyframe")
-			{
-				if(canvas->is_inline())
-				{
-					warning(child,_("Group canvases cannot have keyframes"));
-					continue;
-				}
+			warning(child,_("Group canvases cannot have keyframes"));
+			return;
+		}
 
-				canvas->keyframe_list().add(parse_keyframe(child,canvas));
-				canvas->keyframe_list().sync();
-			}
-			else
-			if(child->get_name()=="meta")
-			{
-				if(canvas->is_inline())
-				{
-					warning(child,_("Group canvases cannot have metadata"));
-					continue;
-				}
+		canvas->keyframe_list().add(parse_keyframe(child,canvas));
+		canvas->keyframe_list().sync();
+	}
+	else
+	if(child->get_name()=="meta")
+	{
+		if(canvas->is_inline())
+		{
+			warning(child,_("Group canvases cannot have metadata"));
+			return;
+		}
 
-				if(!child->get_attribute("name"))
-				{
-					warning(child,_("<meta> must have a name"));
-					continue;
-				}
+		if(!child->get_attribute("name"))
+		{
+			warning(child,_("<meta> must have a name"));
+			return;
+		}
 
-				if(!child->get_attribute("content"))
-				{
-					warning(child,_("<meta> must have content"));
-					continue;
-				}
-				
-				// In Synfig prior to version 1.0 we have messed decimal separator:
-				// some files use ".", but other ones use ","/
-				// Let's try to put a workaround for that.
-				std::vector<String> replacelist;
-				replacelist.push_back("background_first_color");
-				replacelist.push_back("background_second_color");
-				replacelist.push_back("background_size");
-				replacelist.push_back("grid_color");
-				replacelist.push_back("grid_size");
-				replacelist.push_back("jack_offset");
-				String content;
-				content=child->get_attribute("content")->get_value();
-				if(std::find(replacelist.begin(), replacelist.end(), child->get_attribute("name")->get_value()) != replacelist.end()) 
-				{
-					size_t index = 0;
-					while (true) {
-					     /* Locate the substring to replace. */
-					     index = content.find(',', index);
-					     if (index == std::string::npos) break;
+		if(!child->get_attribute("content"))
+		{
+			warning(child,_("<meta> must have content"));
+			return;
+		}
+		
+		// In Synfig prior to version 1.0 we have messed decimal separator:
+		// some files use ".", but other ones use ","/
+		// Let's try to put a workaround for that.
+		std::vector<String> replacelist;
+		replacelist.push_back("background_first_color");
+		replacelist.push_back("background_second_color");
+		replacelist.push_back("background_size");
+		replacelist.push_back("grid_color");
+		replacelist.push_back("grid_size");
+		replacelist.push_back("jack_offset");
+		String content;
+		content=child->get_attribute("content")->get_value();
+		if(std::find(replacelist.begin(), replacelist.end(), child->get_attribute("name")->get_value()) != replacelist.end()) 
+		{
+			size_t index = 0;
+			while (true) {
+			     /* Locate the substring to replace. */
+			     index = content.find(',', index);
+			     if (index == std::string::npos) break;
 
-					     /* Make the replacement. */
-					     content.replace(index, 1, ".");
+			     /* Make the replacement. */
+			     content.replace(index, 1, ".");
 
-					     /* Advance index forward so the next iteration doesn't pick it up as well. */
-					     index += 1;
-					}
-					
-				}
-				canvas->set_meta_data(child->get_attribute("name")->get_value(),content);
+			     /* Advance index forward so the next iteration doesn't pick it up as well. */
+			     index += 1;
 			}
-			else if(child->get_name()=="name")
-			{
-				xmlpp::Element::NodeList list = child->get_children();
+			
+		}
+		canvas->set_meta_data(child->get_attribute("name")->get_value(),content);
+	}
+	else if(child->get_name()=="name")
+	{
+		xmlpp::Element::NodeList list = child->get_children();
 
-				// If we don't have any name, warn
-				if(list.empty())
-					warning(child,_("blank \"name\" entity"));
+		// If we don't have any name, warn
+		if(list.empty())
+			warning(child,_("blank \"name\" entity"));
 
-				std::string tmp;
-				for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
-					if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
-				canvas->set_name(tmp);
-			}
-			else
-			if(child->get_name()=="desc")
-			{
+		std::string tmp;
+		for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+			if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
+		canvas->set_name(tmp);
+	}
+	else
+	if(child->get_name()=="desc")
+	{
 
-				xmlpp::Element::NodeList list = child->get_children();
+		xmlpp::Element::NodeList list = child->get_children();
 
-				// If we don't have any description, warn
-				if(list.empty())
-					warning(child,_("blank \"desc\" entity"));
+		// If we don't have any description, warn
+		if(list.empty())
+			warning(child,_("blank \"desc\" entity"));
 
-				std::string tmp;
-				for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
-					if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
-				canvas->set_description(tmp);
-			}
-			else
-			if(child->get_name()=="author")
-			{
+		std::string tmp;
+		for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+			if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
+		canvas->set_description(tmp);
+	}
+	else
+	if(child->get_name()=="author")
+	{
 
-				xmlpp::Element::NodeList list = child->get_children();
+		xmlpp::Element::NodeList list = child->get_children();
 
-				// If we don't have any description, warn
-				if(list.empty())
-					warning(child,_("blank \"author\" entity"));
+		// If we don't have any description, warn
+		if(list.empty())
+			warning(child,_("blank \"author\" entity"));
 
-				std::string tmp;
-				for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
-					if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
-				canvas->set_author(tmp);
-			}
-			else
-			if(child->get_name()=="layer")
-			{
-				//if(canvas->is_inline())
-				//	canvas->push_front(parse_layer(child,canvas->parent()));
-				//else
-					canvas->push_front(parse_layer(child,canvas));
-			}
-			else
-			{
-				printf("%s:%d\n", __FILE__, __LINE__);
-				error_unexpected_element(child,child->get_name());
-			}
-		}
-//		else
-//		if((child->get_name()=="text"||child->get_name()=="comment") && child->has_child_text())
-//			continue;
+		std::string tmp;
+		for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+			if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
+		canvas->set_author(tmp);
 	}
+	else
+	if(child->get_name()=="layer")
+	{
+		//if(canvas->is_inline())
+		//	canvas->push_front(parse_layer(child,canvas->parent()));
+		//else
+			canvas->push_front(parse_layer(child,canvas));
+	}
+	else
+	{
+		printf("%s:%d\n", __FILE__, __LINE__);
+		error_unexpected_element(child,child->get_name());
+	}
+}
 
+void
+CanvasParser::parse_canvas_footer(xmlpp::Element *element,Canvas::Handle canvas)
+{
 	if(canvas->value_node_list().placeholder_count())
 	{
 		String nodes;
@@ -3450,6 +3460,26 @@ CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool in
 	}
 
 	canvas->set_version(CURRENT_CANVAS_VERSION);
+	canvas_bones_.erase(canvas.get());
+}
+
+Canvas::Handle
+CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,String filename)
+{
+	bool existing;
+	Canvas::Handle canvas(parse_canvas_header(element,parent,inline_,identifier,filename,existing));
+	if(!canvas || existing)
+		return canvas;
+
+	xmlpp::Element::NodeList list = element->get_children();
+	for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+	{
+		xmlpp::Element *child(dynamic_cast<xmlpp::Element*>(*iter));
+		if(child)
+			parse_canvas_child(child, canvas);
+	}
+
+	parse_canvas_footer(element, canvas);
 	return canvas;
 }
 
@@ -3476,6 +3506,143 @@ CanvasParser::show_canvas_map(String file, int line, String text)
 }
 #endif	// _DEBUG
 
+namespace synfig {
+
+/*!	\class CanvasStreamParser
+**	\brief Feeds CanvasParser with the root canvas of a file one child at a time
+**
+**	The DOM holds the attributes of the root <canvas> and the subtree of the
+**	currently open top-level element only. Each subtree is converted as soon as
+**	its element closes, and then freed. Entries of <defs> are handled separately,
+**	so large definition sections are not kept in memory either.
+*/
+class CanvasStreamParser: public xmlpp::SaxParser
+{
+	CanvasParser &parser;
+	const FileSystem::Identifier &identifier;
+	String filename;
+
+	xmlpp::Document document;
+	xmlpp::Element *root;
+	xmlpp::Element *current;
+
+	Canvas::Handle canvas;
+	bool skip; //!< children are not parsed, if the canvas was not created or is already loaded
+	std::exception_ptr exception;
+
+public:
+	CanvasStreamParser(CanvasParser &parser, const FileSystem::Identifier &identifier, const String &filename):
+		parser(parser), identifier(identifier), filename(filename),
+		root(), current(), skip()
+	{ }
+
+	Canvas::Handle parse(std::istream &stream)
+	{
+		try
+		{
+			parse_stream(stream);
+		}
+		catch(...)
+		{
+			if (!exception) throw;
+		}
+		if (exception)
+			std::rethrow_exception(exception);
+		return root && !current ? canvas : Canvas::Handle();
+	}
+
+protected:
+	virtual void on_start_element(const Glib::ustring &name, const AttributeList &attributes)
+	{
+		if (exception) return;
+		try
+		{
+			xmlpp::Element *element = current ? current->add_child(name)
+			                        : root    ? root->add_child(name)
+			                        : document.create_root_node(name);
+			element->cobj()->line = (unsigned short)std::min(xmlSAX2GetLineNumber(context_), 65535);
+			for(AttributeList::const_iterator i = attributes.begin(); i != attributes.end(); ++i)
+				element->set_attribute(i->name, i->value);
+
+			if (!root)
+			{
+				root = element;
+				canvas = parser.parse_canvas_header(root, 0, false, identifier, filename, skip);
+				if (!canvas)
+					skip = true;
+			}
+			else
+			{
+				current = element;
+			}
+		}
+		catch(...) { stop(); }
+	}
+
+	virtual void on_end_element(const Glib::ustring & /* name */)
+	{
+		if (exception) return;
+		try
+		{
+			if (!current)
+			{
+				if (!skip)
+					parser.parse_canvas_footer(root, canvas);
+				return;
+			}
+
+			xmlpp::Element *parent = current->get_parent();
+			if (parent == root)
+			{
+				if (!skip)
+					parser.parse_canvas_child(current, canvas);
+				root->remove_child(current);
+				current = nullptr;
+			}
+			else
+			if (parent->get_parent() == root && parent->get_name() == "defs")
+			{
+				if (!skip)
+					parser.parse_canvas_def(current, canvas);
+				parent->remove_child(current);
+				current = parent;
+			}
+			else
+			{
+				current = parent;
+			}
+		}
+		catch(...) { stop(); }
+	}
+
+	virtual void on_characters(const Glib::ustring &characters)
+	{
+		if (exception || !current) return;
+		try { current->add_child_text(characters); }
+		catch(...) { stop(); }
+	}
+
+	virtual void on_cdata_block(const Glib::ustring &text)
+		{ on_characters(text); }
+
+	virtual void on_fatal_error(const Glib::ustring &text)
+	{
+		if (exception) return;
+		try { throw xmlpp::parse_error(text); }
+		catch(...) { stop(); }
+	}
+
+private:
+	//! Keeps the exception to rethrow it from parse() and stops libxml
+	void stop()
+	{
+		exception = std::current_exception();
+		xmlStopParser(context_);
+	}
+};
+
+}; // END of namespace synfig
+
 Canvas::Handle
 CanvasParser::parse_from_file_as(const FileSystem::Identifier &identifier,const String &as,String &errors)
 {
@@ -3500,31 +3667,40 @@ CanvasParser::parse_from_file_as(const FileSystem::Identifier &identifier,const
 			if (filename_extension(identifier.filename) == ".sifz")
 				stream = FileSystem::ReadStream::Handle(new ZReadStream(stream, zstreambuf::compression::gzip));
 
-			xmlpp::DomParser parser;
-			parser.parse_stream(*stream);
-			stream.reset();
-			if(parser)
+			Canvas::Handle canvas;
+			if (streaming_)
+			{
+				CanvasStreamParser parser(*this, identifier, as);
+				canvas = parser.parse(*stream);
+				stream.reset();
+			}
+			else
 			{
-				Canvas::Handle canvas(parse_canvas(parser.get_document()->get_root_node(),0,false,identifier,as));
-				if (!canvas) return canvas;
-				register_canvas_in_map(canvas, as);
+				xmlpp::DomParser parser;
+				parser.parse_stream(*stream);
+				stream.reset();
+				if(parser)
+					canvas = parse_canvas(parser.get_document()->get_root_node(),0,false,identifier,as);
+			}
 
-				const ValueNodeList& value_node_list(canvas->value_node_list());
+			if (!canvas) return canvas;
+			register_canvas_in_map(canvas, as);
+
+			const ValueNodeList& value_node_list(canvas->value_node_list());
 
-				again:
-				ValueNodeList::const_iterator iter;
-				for(iter=value_node_list.begin();iter!=value_node_list.end();++iter)
+			again:
+			ValueNodeList::const_iterator iter;
+			for(iter=value_node_list.begin();iter!=value_node_list.end();++iter)
+			{
+				ValueNode::Handle value_node(*iter);
+				if(value_node->is_exported() && value_node->get_id().find("Unnamed")==0)
 				{
-					ValueNode::Handle value_node(*iter);
-					if(value_node->is_exported() && value_node->get_id().find("Unnamed")==0)
-					{
-						canvas->remove_value_node(value_node, true);
-						goto again;
-					}
+					canvas->remove_value_node(value_node, true);
+					goto again;
 				}
-
-				return canvas;
 			}
+
+			return canvas;
 		} else {
 			throw std::runtime_error(String("  * ") + _("Can't find linked file") + " \"" + identifier.filename + "\"");
 		}
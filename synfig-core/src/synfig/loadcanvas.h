@@ -32,6 +32,10 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <cstdlib>
+#include <list>
+#include <map>
+
 #include "string.h"
 #include "canvas.h"
 #include "valuenode.h"
@@ -58,6 +62,8 @@ namespace xmlpp { class Node; class Element; };
 
 namespace synfig {
 
+class CanvasStreamParser;
+
 /*!	\class CanvasParser
 **	\brief Class that handles xmlpp elements from a sif file and converts
 * them into Synfig objects
@@ -89,6 +95,11 @@ private:
 	GUID guid_;
 	//
 	bool in_bones_section;
+	//! True if files are parsed element by element instead of building the whole DOM
+	bool streaming_;
+	//! Bones of the canvases which are parsed now, they are referenced only
+	//! by their id until layers link them, so keep them till parse_canvas_footer()
+	std::map<const Canvas*, std::list<ValueNode::Handle> > canvas_bones_;
 
 	/*
  --	** -- C O N S T R U C T O R S ---------------------------------------------
@@ -101,7 +112,8 @@ public:
 		total_warnings_	(0),
 		total_errors_	(0),
 		allow_errors_	(false),
-		in_bones_section(false)
+		in_bones_section(false),
+		streaming_		(!getenv("SYNFIG_DISABLE_STREAMING_LOADER"))
 	{ }
 
 	/*
@@ -113,6 +125,12 @@ public:
 	//! Sets allow errors variable
 	CanvasParser &set_allow_errors(bool x) { allow_errors_=x; return *this; }
 
+	//! Sets if parse_from_file_as() uses the streaming parser
+	CanvasParser &set_streaming(bool x) { streaming_=x; return *this; }
+
+	//! Returns true if parse_from_file_as() uses the streaming parser
+	bool get_streaming()const { return streaming_; }
+
 	//! Sets the maximum number of warnings before a fatal error is thrown
 	CanvasParser &set_max_warnings(int i) { max_warnings_=i; return *this; }
 
@@ -155,6 +173,7 @@ public:
 	static std::set<FileSystem::Identifier> loading_;
 
 private:
+	friend class CanvasStreamParser;
 
 	//! Error handling function
 	void error(xmlpp::Node *node,const String &text);
@@ -169,8 +188,16 @@ private:
 
 	//! Canvas Parsing Function
 	Canvas::Handle parse_canvas(xmlpp::Element *node,Canvas::Handle parent=0,bool inline_=false,const FileSystem::Identifier &identifier = FileSystemNative::instance()->get_identifier(std::string()),String path=".");
+	//! Creates the Canvas from the attributes of the \a node, \a existing is set if the Canvas was already loaded
+	Canvas::Handle parse_canvas_header(xmlpp::Element *node,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,String path,bool &existing);
+	//! Canvas child element Parsing Function (layers, definitions, keyframes, metadata, etc)
+	void parse_canvas_child(xmlpp::Element *node,Canvas::Handle canvas);
+	//! Checks the Canvas when all of its children are parsed
+	void parse_canvas_footer(xmlpp::Element *node,Canvas::Handle canvas);
 	//! Canvas definitions Parsing Function (exported value nodes and exported canvases)
 	void parse_canvas_defs(xmlpp::Element *node,Canvas::Handle canvas);
+	//! Single exported value node or canvas Parsing Function
+	void parse_canvas_def(xmlpp::Element *node,Canvas::Handle canvas);
 
 	std::list<ValueNode::Handle> parse_canvas_bones(xmlpp::Element *node,Canvas::Handle canvas);
 
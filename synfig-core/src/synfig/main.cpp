@@ -58,6 +58,7 @@
 #include "token.h"
 #include "target.h"
 #include "listimporter.h"
+#include "importerframecache.h"
 #include "color.h"
 #include "vector.h"
 #include <fstream>
@@ -385,6 +386,8 @@ synfig::Main::~Main()
 		}
 	}
 
+	// frames are decoded in background by ThreadPool
+	ImporterFrameCache::instance().wait_prefetch();
 	// synfig::info("ThreadPool::subsys_stop()");
 	ThreadPool::subsys_stop();
 	// synfig::info("Importer::subsys_stop()");
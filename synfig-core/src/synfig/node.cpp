@@ -113,6 +113,16 @@ static GlobalNodeMap& global_node_map()
 	return map;
 }
 
+//! Guards parent sets of all nodes. Layers may be cloned (and clones destroyed)
+//! from different threads while building and running rendering tasks,
+//! and clones register themselves as parents of the shared value nodes.
+//! Readers iterate a copy, see Node::get_parent_set().
+static std::mutex& parent_set_mutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
 /* === P R O C E D U R E S ================================================= */
 
 Node* synfig::find_node(const GUID &guid) {
@@ -248,17 +258,21 @@ Node::add_child(Node*x)
 		printf("%s:%d adding %p (%s) as parent of %p (%s) (%zd -> ", __FILE__, __LINE__,
 			   this, get_string().c_str(),
 			   x, x->get_string().c_str(),
-			   x->parent_set.size());
+			   (size_t)x->parent_count());
 
-	x->parent_set.insert(this);
+	{
+		std::lock_guard<std::mutex> lock(parent_set_mutex());
+		x->parent_set.insert(this);
+	}
 
 	if (getenv("SYNFIG_DEBUG_NODE_PARENT_SET"))
-		printf("%zd)\n", x->parent_set.size());
+		printf("%zd)\n", (size_t)x->parent_count());
 }
 
 void
 Node::remove_child(Node*x)
 {
+	std::lock_guard<std::mutex> lock(parent_set_mutex());
 	if(x->parent_set.count(this) == 0)
 	{
 		if (getenv("SYNFIG_DEBUG_NODE_PARENT_SET"))
@@ -284,9 +298,17 @@ Node::remove_child(Node*x)
 int
 Node::parent_count()const
 {
+	std::lock_guard<std::mutex> lock(parent_set_mutex());
 	return parent_set.size();
 }
 
+std::set<Node*>
+Node::get_parent_set()const
+{
+	std::lock_guard<std::mutex> lock(parent_set_mutex());
+	return parent_set;
+}
+
 const Node::time_set &
 Node::get_times() const
 {
@@ -313,18 +335,21 @@ Node::begin_delete()
 void
 Node::on_changed()
 {
+	// parents are signalled without the lock, they may add or remove children
+	const std::set<Node*> parents = get_parent_set();
+
 	if (getenv("SYNFIG_DEBUG_ON_CHANGED"))
 	{
-		printf("%s:%d Node::on_changed() for %p (%s); signalling these %zd parents:\n", __FILE__, __LINE__, this, get_string().c_str(), parent_set.size());
-		for (std::set<Node*>::iterator iter = parent_set.begin(); iter != parent_set.end(); ++iter) printf(" %p (%s)\n", *iter, (*iter)->get_string().c_str());
+		printf("%s:%d Node::on_changed() for %p (%s); signalling these %zd parents:\n", __FILE__, __LINE__, this, get_string().c_str(), parents.size());
+		for (std::set<Node*>::const_iterator iter = parents.begin(); iter != parents.end(); ++iter) printf(" %p (%s)\n", *iter, (*iter)->get_string().c_str());
 		printf("\n");
 	}
 
 	bchanged = true;
 	signal_changed()();
 
-	std::set<Node*>::iterator iter;
-	for(iter=parent_set.begin();iter!=parent_set.end();++iter)
+	std::set<Node*>::const_iterator iter;
+	for(iter=parents.begin();iter!=parents.end();++iter)
 	{
 		(*iter)->child_changed(this);
 	}
@@ -248,6 +248,9 @@ public:
 	//!Returns how many parenst has the current Node
 	int parent_count()const;
 
+	//! Returns a copy of parent_set, safe to iterate while parents are added or removed
+	std::set<Node*> get_parent_set()const;
+
 	//! Returns the cached times values for all the children
 	const time_set &get_times() const;
 
@@ -0,0 +1,120 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/optimizer/optimizercache.cpp
+**	\brief OptimizerCache
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <synfig/general.h>
+
+#include "optimizercache.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+//! smaller results are rendered faster than copied from cache
+static const int min_cached_area = 64*64;
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+OptimizerCache::OptimizerCache(RenderCache *cache, const Surface::Token::Handle &format):
+	cache(cache),
+	format(format)
+{
+	category_id = CATEGORY_ID_COORDS;
+	for_task = true;
+}
+
+void
+OptimizerCache::run(const RunParams& params) const
+{
+	const Task::Handle &task = params.ref_task;
+
+	// root task draws into the surface provided by caller
+	if (!cache || !params.parent || !task)
+		return;
+	if (task.type_is<TaskSurface>() || task.type_is<TaskCacheStore>())
+		return;
+	if (!task->is_valid() || task->target_surface == params.parent->ref_task->target_surface)
+		return;
+
+	const VectorInt size = task->target_rect.get_size();
+	if (size[0]*size[1] < min_cached_area)
+		return;
+
+	// result of whole branch will be stored already
+	for(const RunParams *p = params.parent; p; p = p->parent)
+		if (p->ref_task.type_is<TaskCacheStore>())
+			return;
+
+	if (!cache->is_enabled())
+		return;
+
+	TaskHash hash;
+	if (!task->calc_hash(hash))
+		return;
+	if (format)
+		hash.add(format->name);
+
+	Surface::Handle surface;
+	bool store = false;
+	if (cache->find(hash.get(), size, surface, store)) {
+		// keep source rect to keep the same pixels-per-unit
+		TaskSurface::Handle surface_task = new TaskSurface();
+		surface_task->source_rect = task->source_rect;
+		surface_task->target_rect = RectInt(0, 0, size[0], size[1]);
+		if (surface) {
+			surface_task->target_surface = new SurfaceResource(surface);
+		} else {
+			surface_task->target_surface = new SurfaceResource();
+			surface_task->target_surface->create(size);
+		}
+		apply(params, surface_task);
+	} else
+	if (store) {
+		TaskCacheStore::Handle store_task = new TaskCacheStore();
+		store_task->cache = cache;
+		store_task->key = hash.get();
+		store_task->format = format;
+		store_task->assign_target(*task);
+		store_task->sub_task() = task;
+		apply(params, store_task);
+	}
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,65 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/optimizer/optimizercache.h
+**	\brief OptimizerCache Header
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_OPTIMIZERCACHE_H
+#define __SYNFIG_RENDERING_OPTIMIZERCACHE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include "../../optimizer.h"
+#include "../../rendercache.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+//! Replaces sub-trees rendered before by surfaces from RenderCache,
+//! and marks other hashable sub-trees to store their results.
+//! Results may be stored in compact \a format (see SurfaceSWRGBA16F),
+//! such entries are not shared with renderers which use other format.
+class OptimizerCache: public Optimizer
+{
+public:
+	RenderCache * const cache;
+	const Surface::Token::Handle format;
+	explicit OptimizerCache(RenderCache *cache, const Surface::Token::Handle &format = Surface::Token::Handle());
+	virtual void run(const RunParams &params) const;
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
@@ -32,10 +32,13 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+
 #include "optimizerdraft.h"
 
 #include "../task/taskcontour.h"
 #include "../task/taskblur.h"
+#include "../task/taskescapetime.h"
 #include "../task/tasklayer.h"
 #include "../task/tasktransformation.h"
 
@@ -159,6 +162,32 @@ OptimizerDraftBlur::run(const RunParams &params) const
 }
 
 
+// OptimizerDraftEscapeTime
+
+OptimizerDraftEscapeTime::OptimizerDraftEscapeTime(int divider, int min_iterations):
+	divider(divider), min_iterations(min_iterations) { }
+
+void
+OptimizerDraftEscapeTime::run(const RunParams &params) const
+{
+	if (TaskEscapeTime::Handle escape_time = TaskEscapeTime::Handle::cast_dynamic(params.ref_task))
+	{
+		if (!escape_time->escape_time)
+			return;
+		const int iterations = escape_time->escape_time->iterations;
+		const int max_iterations = std::max(min_iterations, iterations/std::max(1, divider));
+		if ( iterations > max_iterations
+		  && ( escape_time->max_iterations <= 0
+		    || escape_time->max_iterations > max_iterations ))
+		{
+			escape_time = TaskEscapeTime::Handle::cast_dynamic(escape_time->clone());
+			escape_time->max_iterations = max_iterations;
+			apply(params, escape_time);
+		}
+	}
+}
+
+
 // OptimizerDraftLayerRemove
 
 OptimizerDraftLayerRemove::OptimizerDraftLayerRemove(const String &layername):
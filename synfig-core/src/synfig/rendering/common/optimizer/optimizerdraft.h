@@ -85,6 +85,18 @@ public:
 };
 
 
+//! Caps count of iterations of fractals to iterations/divider, but not less than min_iterations,
+//! see TaskEscapeTime::max_iterations
+class OptimizerDraftEscapeTime: public OptimizerDraft
+{
+public:
+	const int divider;
+	const int min_iterations;
+	OptimizerDraftEscapeTime(int divider, int min_iterations);
+	virtual void run(const RunParams &params) const;
+};
+
+
 class OptimizerDraftLayerRemove: public OptimizerDraft
 {
 public:
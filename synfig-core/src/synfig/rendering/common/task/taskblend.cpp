@@ -71,6 +71,14 @@ TaskBlend::get_pass_subtask_index() const
 	return PASSTO_THIS_TASK;
 }
 
+bool
+TaskBlend::hash_params(TaskHash &hash) const
+{
+	hash.add(blend_method);
+	hash.add(amount);
+	return true;
+}
+
 Rect
 TaskBlend::calc_bounds() const
 {
@@ -54,6 +54,14 @@ using namespace rendering;
 SYNFIG_EXPORT Task::Token TaskBlur::token(
 	DescAbstract<TaskBlur>("Blur") );
 
+bool
+TaskBlur::hash_params(TaskHash &hash) const
+{
+	hash.add(blur.size);
+	hash.add(blur.type);
+	return true;
+}
+
 Rect
 TaskBlur::calc_bounds() const
 {
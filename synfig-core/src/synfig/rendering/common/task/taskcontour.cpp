@@ -52,6 +52,32 @@ SYNFIG_EXPORT Task::Token TaskContour::token(
 	DescAbstract<TaskContour>("Contour") );
 
 
+bool
+TaskContour::hash_params(TaskHash &hash) const
+{
+	hash.add(detail);
+	hash.add(allow_antialias);
+	hash.add(transformation->matrix.m);
+	if (!contour)
+		{ hash.add(false); return true; }
+
+	hash.add(contour->invert);
+	hash.add(contour->antialias);
+	hash.add(contour->winding_style);
+	hash.add(contour->color);
+	hash.add(contour->beginning_of_unclosed());
+	const Contour::ChunkList &chunks = contour->get_chunks();
+	hash.add(chunks.size());
+	for(Contour::ChunkList::const_iterator i = chunks.begin(); i != chunks.end(); ++i) {
+		// Chunk has padding bytes, so add fields separately
+		hash.add(i->type);
+		hash.add(i->p1);
+		hash.add(i->pp0);
+		hash.add(i->pp1);
+	}
+	return true;
+}
+
 Rect
 TaskContour::calc_bounds() const
 {
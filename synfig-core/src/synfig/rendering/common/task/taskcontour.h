@@ -60,6 +60,7 @@ public:
 
 	TaskContour(): detail(1.0), allow_antialias(true) { }
 
+	virtual bool hash_params(TaskHash &hash) const;
 	virtual Rect calc_bounds() const;
 
 	virtual Transformation::Handle get_transformation() const
@@ -0,0 +1,153 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/task/taskdistort.cpp
+**	\brief TaskDistort
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+
+#include "taskdistort.h"
+
+#include "../../primitive/transformation.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+//! Infinite source (InsideOut gathers whole plane around its origin)
+//! is limited by this count of sizes of result in each direction
+static const Real max_source_expansion = 4.0;
+
+//! Larger source is rendered in lower resolution, see Transformation::make_discrete_bounds()
+static const Real max_source_area = 4096.0*4096.0;
+
+//! Extra pixels around the source for interpolation
+static const int source_border = 2;
+
+/* === P R O C E D U R E S ================================================= */
+
+static bool
+is_finite(const Rect &rect)
+{
+	return std::isfinite(rect.minx) && std::isfinite(rect.miny)
+	    && std::isfinite(rect.maxx) && std::isfinite(rect.maxy);
+}
+
+/* === M E T H O D S ======================================================= */
+
+
+SYNFIG_EXPORT Task::Token TaskDistort::token(
+	DescAbstract<TaskDistort>("Distort") );
+
+int
+TaskDistort::get_pass_subtask_index() const
+{
+	if (!sub_task())
+		return PASSTO_NO_TASK;
+	return distortion ? PASSTO_THIS_TASK : 0;
+}
+
+bool
+TaskDistort::hash_params(TaskHash &hash) const
+{
+	if (!distortion || !distortion->hash_params(hash))
+		return false;
+	hash.add(interpolation);
+	return true;
+}
+
+Rect
+TaskDistort::calc_bounds() const
+{
+	if (!sub_task())
+		return Rect::zero();
+	const Rect bounds = sub_task()->get_bounds();
+	if (!distortion || !bounds.is_valid())
+		return bounds;
+	return distortion->calc_bounds(bounds);
+}
+
+void
+TaskDistort::set_coords_sub_tasks()
+{
+	if (!sub_task())
+		{ trunc_to_zero(); return; }
+
+	if (distortion && is_valid_coords()) {
+		Rect rect = distortion->map_bounds(source_rect) & sub_task()->get_bounds();
+		if (rect.is_valid() && !is_finite(rect)) {
+			Rect limit = source_rect;
+			limit.expand(std::max(source_rect.get_width(), source_rect.get_height())*max_source_expansion);
+			rect &= limit;
+		}
+
+		const Vector upp = get_units_per_pixel();
+		if ( rect.is_valid()
+		  && rect.get_width()/upp[0] * rect.get_height()/upp[1] <= max_source_area )
+		{
+			// align source to pixels of result, with margin for interpolation,
+			// so the parts of picture which are not moved are not blurred
+			const RectInt pixels(
+				(int)std::floor((rect.minx - source_rect.minx)/upp[0]) - source_border,
+				(int)std::floor((rect.miny - source_rect.miny)/upp[1]) - source_border,
+				(int)std::ceil ((rect.maxx - source_rect.minx)/upp[0]) + source_border,
+				(int)std::ceil ((rect.maxy - source_rect.miny)/upp[1]) + source_border );
+			sub_task()->set_coords(
+				Rect(
+					source_rect.minx + upp[0]*pixels.minx,
+					source_rect.miny + upp[1]*pixels.miny,
+					source_rect.minx + upp[0]*pixels.maxx,
+					source_rect.miny + upp[1]*pixels.maxy ),
+				pixels.get_size() );
+			return;
+		}
+
+		// resolution of source is reduced by make_discrete_bounds()
+		// when distortion gathers a large area into the result
+		Transformation::DiscreteBounds discrete_bounds =
+			Transformation::make_discrete_bounds(
+				Transformation::Bounds(rect, get_pixels_per_unit()) );
+		if (discrete_bounds.is_valid()) {
+			sub_task()->set_coords(discrete_bounds.rect, discrete_bounds.size);
+			return;
+		}
+	}
+
+	sub_task()->set_coords_zero();
+	trunc_to_zero();
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,106 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/task/taskescapetime.cpp
+**	\brief TaskEscapeTime
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+
+#include "taskescapetime.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+
+SYNFIG_EXPORT Task::Token TaskEscapeTime::token(
+	DescAbstract<TaskEscapeTime>("EscapeTime") );
+
+int
+TaskEscapeTime::get_iterations() const
+{
+	if (!escape_time)
+		return 0;
+	return max_iterations > 0
+	     ? std::min(escape_time->iterations, max_iterations)
+	     : escape_time->iterations;
+}
+
+int
+TaskEscapeTime::get_pass_subtask_index() const
+{
+	if (!escape_time)
+		return PASSTO_NO_TASK;
+	return sub_task() && escape_time->uses_source()
+	     ? PASSTO_THIS_TASK
+	     : PASSTO_THIS_TASK_WITHOUT_SUBTASKS;
+}
+
+bool
+TaskEscapeTime::hash_params(TaskHash &hash) const
+{
+	if (!escape_time || !escape_time->hash_params(hash))
+		return false;
+	hash.add(get_iterations());
+	hash.add(context_rect);
+	hash.add(context_size);
+	return true;
+}
+
+Rect
+TaskEscapeTime::calc_bounds() const
+	{ return escape_time ? Rect::infinite() : Rect::zero(); }
+
+void
+TaskEscapeTime::set_coords_sub_tasks()
+{
+	if (!sub_task())
+		return;
+	if ( is_valid_coords()
+	  && escape_time
+	  && escape_time->uses_source()
+	  && context_rect.is_valid()
+	  && context_size[0] > 0 && context_size[1] > 0 )
+		sub_task()->set_coords(context_rect, context_size);
+	else
+		sub_task()->set_coords_zero();
+}
+
+/* === E N T R Y P O I N T ================================================= */
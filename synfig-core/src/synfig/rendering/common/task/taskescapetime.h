@@ -0,0 +1,88 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/task/taskescapetime.h
+**	\brief TaskEscapeTime Header
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_TASKESCAPETIME_H
+#define __SYNFIG_RENDERING_TASKESCAPETIME_H
+
+/* === H E A D E R S ======================================================= */
+
+#include "../../task.h"
+#include "../../primitive/escapetime.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+//! Renders escape-time fractal, see EscapeTime.
+//! Sub-task is the context of layer, it is rendered into the fixed rect
+//! and sampled by the coloring of fractal.
+class TaskEscapeTime: public Task
+{
+public:
+	typedef etl::handle<TaskEscapeTime> Handle;
+	SYNFIG_EXPORT static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	EscapeTime::Handle escape_time;
+
+	//! Fixed cap of iterations set by draft renderer, zero means no cap.
+	//! Coloring is normalized by the actual count of iterations,
+	//! so the capped result looks like the full one with less detail.
+	//! The capped result is never replaced by the full one,
+	//! the full count is used only by renderers without the cap.
+	int max_iterations;
+
+	Rect context_rect;
+	VectorInt context_size;
+
+	TaskEscapeTime(): max_iterations() { }
+
+	int get_iterations() const;
+
+	virtual int get_pass_subtask_index() const;
+
+	const Task::Handle& sub_task() const { return Task::sub_task(0); }
+	Task::Handle& sub_task() { return Task::sub_task(0); }
+
+	virtual bool hash_params(TaskHash &hash) const;
+	virtual Rect calc_bounds() const;
+	virtual void set_coords_sub_tasks();
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
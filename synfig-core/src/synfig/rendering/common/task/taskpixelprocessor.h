@@ -100,6 +100,8 @@ public:
 	Gamma gamma;
 	TaskPixelGamma() { }
 
+	virtual bool hash_params(TaskHash &hash) const;
+
 	virtual bool is_transparent() const
 	{
 		return approximate_equal_lp(gamma.get_r(), ColorReal(1.0))
@@ -118,6 +120,8 @@ public:
 
 	ColorMatrix matrix;
 
+	virtual bool hash_params(TaskHash &hash) const;
+
 	virtual bool is_zero() const
 		{ return matrix.is_transparent(); }
 	virtual bool is_transparent() const
@@ -0,0 +1,112 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/primitive/distortion.cpp
+**	\brief Distortion
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <vector>
+
+#include "distortion.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+//! count of cells of grid per side of rect, see Distortion::map_bounds_vfunc()
+static const int bounds_grid = 32;
+
+/* === P R O C E D U R E S ================================================= */
+
+static bool
+is_finite(const Point &p)
+	{ return std::isfinite(p[0]) && std::isfinite(p[1]); }
+
+/* === M E T H O D S ======================================================= */
+
+void
+Distortion::map_row_vfunc(const Point &point, const Vector &step, Point *source_points, bool *mapped, int count) const
+{
+	for(int i = 0; i < count; ++i)
+		mapped[i] = map(point + step*i, source_points[i]);
+}
+
+Rect
+Distortion::map_bounds_vfunc(const Rect &rect) const
+{
+	if (!rect.is_valid())
+		return Rect::zero();
+	if (!is_finite(rect.get_min()) || !is_finite(rect.get_max()))
+		return Rect::infinite();
+
+	// the largest distance between neighbouring samples is added
+	// to the bounds, it covers parts of source between the samples
+	const Vector step(rect.get_width()/bounds_grid, rect.get_height()/bounds_grid);
+	std::vector<Point> row(bounds_grid + 1);
+	std::vector<char> row_valid(bounds_grid + 1, false);
+
+	Rect bounds;
+	bool found = false;
+	Real margin = 0.0;
+	for(int j = 0; j <= bounds_grid; ++j) {
+		for(int i = 0; i <= bounds_grid; ++i) {
+			Point p(rect.minx + step[0]*i, rect.miny + step[1]*j), s;
+			const bool valid = map(p, s) && is_finite(s);
+			if (valid) {
+				if (found) bounds.expand(s); else bounds = Rect(s);
+				found = true;
+				if (i && row_valid[i-1])
+					margin = std::max(margin, (s - row[i-1]).mag());
+				if (row_valid[i])
+					margin = std::max(margin, (s - row[i]).mag());
+				row[i] = s;
+			}
+			row_valid[i] = valid;
+		}
+	}
+
+	return found ? bounds.expand(margin) : Rect::zero();
+}
+
+Rect
+Distortion::calc_bounds_vfunc(const Rect& /* source_bounds */) const
+	{ return Rect::infinite(); }
+
+bool
+Distortion::hash_params_vfunc(TaskHash& /* hash */) const
+	{ return false; }
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,95 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/primitive/distortion.h
+**	\brief Distortion Header
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_DISTORTION_H
+#define __SYNFIG_RENDERING_DISTORTION_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <ETL/handle>
+
+#include <synfig/rect.h>
+#include <synfig/vector.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+class TaskHash;
+
+//! Non-linear mapping of coordinates, defined backwards:
+//! for each point of the result it gives the point of the source.
+//! Implementations are called from several threads at once,
+//! so they should keep copies of all parameters of layer.
+class Distortion: public etl::shared_object
+{
+public:
+	typedef etl::handle<Distortion> Handle;
+
+protected:
+	virtual bool map_vfunc(const Point &point, Point &source_point) const = 0;
+	virtual void map_row_vfunc(const Point &point, const Vector &step, Point *source_points, bool *mapped, int count) const;
+	virtual Rect map_bounds_vfunc(const Rect &rect) const;
+	virtual Rect calc_bounds_vfunc(const Rect &source_bounds) const;
+	virtual bool hash_params_vfunc(TaskHash &hash) const;
+
+public:
+	virtual ~Distortion() { }
+
+	//! Finds the point of source for the \a point of result,
+	//! returns false when result is transparent at this point
+	bool map(const Point &point, Point &source_point) const
+		{ return map_vfunc(point, source_point); }
+	//! Maps \a count points: point, point + step, point + step*2 and so on,
+	//! so implementations may share calculations between the neighbour points
+	void map_row(const Point &point, const Vector &step, Point *source_points, bool *mapped, int count) const
+		{ map_row_vfunc(point, step, source_points, mapped, count); }
+	//! Rect of source required to build the \a rect of result.
+	//! Default implementation samples the mapping by grid.
+	Rect map_bounds(const Rect &rect) const
+		{ return map_bounds_vfunc(rect); }
+	//! Bounds of result for the \a source_bounds, infinite by default
+	Rect calc_bounds(const Rect &source_bounds) const
+		{ return calc_bounds_vfunc(source_bounds); }
+	//! Adds parameters of mapping to hash, see Task::hash_params()
+	bool hash_params(TaskHash &hash) const
+		{ return hash_params_vfunc(hash); }
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* === E N D =============================================================== */
+
+#endif
@@ -0,0 +1,227 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/primitive/escapetime.cpp
+**	\brief EscapeTime
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include "escapetime.h"
+
+#include "../task.h"
+
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+ #define ESCAPE_TIME_SSE2
+ #include <emmintrin.h>
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+//! Reference iterations for a single point.
+//! Magnitude is rounded to ColorReal before the comparison with bailout,
+//! as layers did it, so the border of set is the same for all implementations.
+template<EscapeTime::Formula formula, bool broken>
+void
+iterate_point(Real x, Real y, const Point &seed, Real bailout, int iterations, EscapeTime::Orbit &orbit)
+{
+	Real zr, zi, cr, ci, zr_hold;
+	if (formula == EscapeTime::JULIA)
+		{ zr = x; zi = y; cr = seed[0]; ci = seed[1]; }
+	else
+		{ zr = zi = 0.0; cr = x; ci = y; }
+
+	ColorReal mag = 0;
+	orbit.escape = -1;
+	for(int i = 0; i < iterations; ++i) {
+		zr_hold = zr;
+		zr = zr*zr - zi*zi + cr;
+		if (broken && formula == EscapeTime::MANDELBROT) zr += zi;
+		zi = zr_hold*zi*2 + ci;
+		if (broken && formula == EscapeTime::JULIA) zr += zi;
+
+		mag = zr*zr + zi*zi;
+		if (mag > bailout)
+			{ orbit.escape = i; break; }
+	}
+
+	orbit.zr = zr;
+	orbit.zi = zi;
+	orbit.mag = mag;
+}
+
+#ifdef ESCAPE_TIME_SSE2
+
+inline __m128d
+select(__m128d mask, __m128d a, __m128d b)
+	{ return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+
+//! Two points per __m128d, and two __m128d are iterated together,
+//! so the long chain of dependent operations of one point doesn't stall the pipeline.
+//! Lanes which are escaped are masked and keep their values,
+//! loop stops when all lanes are escaped.
+template<EscapeTime::Formula formula, bool broken>
+void
+iterate_lanes(const Real *x, Real y, const Point &seed, Real bailout, int iterations, EscapeTime::Orbit *orbits)
+{
+	const int vectors = 2;
+	const __m128d two = _mm_set1_pd(2.0);
+	const __m128d bail = _mm_set1_pd(bailout);
+
+	__m128d zr[vectors], zi[vectors], cr[vectors], ci[vectors], mag[vectors], active[vectors];
+	for(int j = 0; j < vectors; ++j) {
+		const __m128d xx = _mm_loadu_pd(x + 2*j);
+		if (formula == EscapeTime::JULIA)
+			{ zr[j] = xx; zi[j] = _mm_set1_pd(y); cr[j] = _mm_set1_pd(seed[0]); ci[j] = _mm_set1_pd(seed[1]); }
+		else
+			{ zr[j] = zi[j] = _mm_setzero_pd(); cr[j] = xx; ci[j] = _mm_set1_pd(y); }
+		mag[j] = _mm_setzero_pd();
+		active[j] = _mm_castsi128_pd(_mm_set1_epi32(-1));
+	}
+
+	int escape[2*vectors];
+	for(int j = 0; j < 2*vectors; ++j)
+		escape[j] = -1;
+
+	for(int i = 0; i < iterations; ++i) {
+		int active_bits = 0;
+		for(int j = 0; j < vectors; ++j) {
+			__m128d nzr = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(zr[j], zr[j]), _mm_mul_pd(zi[j], zi[j])), cr[j]);
+			if (broken && formula == EscapeTime::MANDELBROT) nzr = _mm_add_pd(nzr, zi[j]);
+			__m128d nzi = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(zr[j], zi[j]), two), ci[j]);
+			if (broken && formula == EscapeTime::JULIA) nzr = _mm_add_pd(nzr, nzi);
+
+			// round to float, as ColorReal of the reference
+			__m128d nmag = _mm_add_pd(_mm_mul_pd(nzr, nzr), _mm_mul_pd(nzi, nzi));
+			nmag = _mm_cvtps_pd(_mm_cvtpd_ps(nmag));
+
+			zr[j] = select(active[j], nzr, zr[j]);
+			zi[j] = select(active[j], nzi, zi[j]);
+			mag[j] = select(active[j], nmag, mag[j]);
+
+			const __m128d escaped = _mm_and_pd(active[j], _mm_cmpgt_pd(nmag, bail));
+			const int escaped_bits = _mm_movemask_pd(escaped);
+			if (escaped_bits) {
+				if (escaped_bits & 1) escape[2*j] = i;
+				if (escaped_bits & 2) escape[2*j + 1] = i;
+				active[j] = _mm_andnot_pd(escaped, active[j]);
+			}
+			active_bits |= _mm_movemask_pd(active[j]);
+		}
+		if (!active_bits)
+			break;
+	}
+
+	for(int j = 0; j < vectors; ++j) {
+		double zrs[2], zis[2], mags[2];
+		_mm_storeu_pd(zrs, zr[j]);
+		_mm_storeu_pd(zis, zi[j]);
+		_mm_storeu_pd(mags, mag[j]);
+		for(int k = 0; k < 2; ++k) {
+			EscapeTime::Orbit &orbit = orbits[2*j + k];
+			orbit.zr = zrs[k];
+			orbit.zi = zis[k];
+			orbit.mag = (ColorReal)mags[k];
+			orbit.escape = escape[2*j + k];
+		}
+	}
+}
+
+#endif // ESCAPE_TIME_SSE2
+
+template<EscapeTime::Formula formula, bool broken>
+void
+iterate_row(const Point &point, const Vector &step, const Point &seed, Real bailout, int iterations, EscapeTime::Orbit *orbits, int count)
+{
+	int i = 0;
+#ifdef ESCAPE_TIME_SSE2
+	// rows are horizontal in practice, other directions are not vectorized
+	if (step[1] == 0.0) {
+		Real x[4];
+		for(; i + 3 < count; i += 4) {
+			for(int j = 0; j < 4; ++j)
+				x[j] = point[0] + step[0]*(i + j);
+			iterate_lanes<formula, broken>(x, point[1], seed, bailout, iterations, orbits + i);
+		}
+	}
+#endif
+	for(; i < count; ++i)
+		iterate_point<formula, broken>(
+			point[0] + step[0]*i, point[1] + step[1]*i,
+			seed, bailout, iterations, orbits[i] );
+}
+
+} // end of anonimous namespace
+
+/* === M E T H O D S ======================================================= */
+
+void
+EscapeTime::iterate_row(const Point &point, const Vector &step, Orbit *orbits, int count, int iterations) const
+{
+	if (formula == JULIA) {
+		if (broken) ::iterate_row<JULIA, true>(point, step, seed, bailout, iterations, orbits, count);
+		       else ::iterate_row<JULIA, false>(point, step, seed, bailout, iterations, orbits, count);
+	} else {
+		if (broken) ::iterate_row<MANDELBROT, true>(point, step, seed, bailout, iterations, orbits, count);
+		       else ::iterate_row<MANDELBROT, false>(point, step, seed, bailout, iterations, orbits, count);
+	}
+}
+
+bool
+EscapeTime::uses_source_vfunc() const
+	{ return true; }
+
+bool
+EscapeTime::hash_params_vfunc(TaskHash& /* hash */) const
+	{ return false; }
+
+bool
+EscapeTime::hash_params(TaskHash &hash) const
+{
+	if (!hash_params_vfunc(hash))
+		return false;
+	hash.add((int)formula);
+	hash.add(seed);
+	hash.add(bailout);
+	hash.add(broken);
+	hash.add(iterations);
+	return true;
+}
+
+/* === E N T R Y P O I N T ================================================= */
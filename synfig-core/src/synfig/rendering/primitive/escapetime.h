@@ -0,0 +1,127 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/primitive/escapetime.h
+**	\brief EscapeTime Header
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_ESCAPETIME_H
+#define __SYNFIG_RENDERING_ESCAPETIME_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <ETL/handle>
+
+#include <synfig/color.h>
+#include <synfig/vector.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+class TaskHash;
+
+//! Escape-time fractal: iterates z = z*z + c for each point
+//! until |z|^2 exceeds the bailout, and colors the point by the orbit.
+//! Iterations are shared by all implementations, coloring is defined by layers.
+//! Implementations are called from several threads at once,
+//! so they should keep copies of all parameters of layer.
+class EscapeTime: public etl::shared_object
+{
+public:
+	typedef etl::handle<EscapeTime> Handle;
+
+	enum Formula
+	{
+		MANDELBROT, //!< z starts from zero, c is the point
+		JULIA       //!< z starts from the point, c is the seed
+	};
+
+	//! Last state of iterations for a point
+	struct Orbit
+	{
+		Real zr, zi;
+		ColorReal mag;  //!< zr*zr + zi*zi
+		int escape;     //!< index of iteration which exceeds the bailout, -1 for points of the set
+
+		Orbit(): zr(), zi(), mag(), escape(-1) { }
+		bool escaped() const { return escape >= 0; }
+	};
+
+	//! Colors of layers under the fractal
+	class Source
+	{
+	public:
+		virtual ~Source() { }
+		virtual Color get_color(const Point &point) const = 0;
+	};
+
+	Formula formula;
+	Point seed;
+	Real bailout;   //!< squared radius
+	bool broken;    //!< adds zi to zr at each iteration
+	int iterations;
+
+	EscapeTime(): formula(MANDELBROT), bailout(4.0), broken(false), iterations(32) { }
+
+protected:
+	virtual Color shade_vfunc(const Point &point, const Orbit &orbit, int iterations, const Source &source) const = 0;
+	virtual bool uses_source_vfunc() const;
+	//! Adds parameters of coloring to hash.
+	//! Returns false by default, so results of fractals which don't override it
+	//! are never cached: unknown coloring parameters could give stale results.
+	virtual bool hash_params_vfunc(TaskHash &hash) const;
+
+public:
+	virtual ~EscapeTime() { }
+
+	//! Iterates \a count points: point, point + step, point + step*2 and so on.
+	//! Several points are processed at once by SIMD, each of them stops at its own escape,
+	//! so results are equal to the iterations of points one by one.
+	void iterate_row(const Point &point, const Vector &step, Orbit *orbits, int count, int iterations) const;
+	void iterate_row(const Point &point, const Vector &step, Orbit *orbits, int count) const
+		{ iterate_row(point, step, orbits, count, iterations); }
+
+	//! Color of \a point, \a iterations is the count which was used to calculate the \a orbit
+	Color shade(const Point &point, const Orbit &orbit, int iterations, const Source &source) const
+		{ return shade_vfunc(point, orbit, iterations, source); }
+	//! Returns false when colors of layers under the fractal are never used
+	bool uses_source() const
+		{ return uses_source_vfunc(); }
+	//! Adds parameters to hash, see Task::hash_params() and hash_params_vfunc()
+	bool hash_params(TaskHash &hash) const;
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* === E N D =============================================================== */
+
+#endif
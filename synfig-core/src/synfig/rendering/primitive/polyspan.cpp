@@ -52,6 +52,8 @@ using namespace rendering;
 
 /* === G L O B A L S ======================================================= */
 
+Polyspan::Accumulator Polyspan::default_accumulator = Polyspan::ACCUMULATOR_BUCKETS;
+
 /* === P R O C E D U R E S ================================================= */
 
 /* === M E T H O D S ======================================================= */
@@ -65,7 +67,8 @@ Polyspan::Polyspan():
 	cur_line_y(0.0),
 	close_x(0.0),
 	close_y(0.0),
-	flags(NotSorted)
+	flags(NotSorted),
+	accumulator(default_accumulator)
 { }
 
 //0 out all the variables involved in processing
@@ -73,6 +76,7 @@ void
 Polyspan::clear()
 {
 	covers.clear();
+	rows.clear();
 	cur_x = cur_y = close_x = close_y = 0;
 	open_index = 0;
 	current.set(0, 0, 0, 0);
@@ -85,6 +89,19 @@ Polyspan::addcurrent()
 {
 	if(current.cover || current.area)
 	{
+		if ( accumulator == ACCUMULATOR_BUCKETS
+		  && current.y >= window.miny && current.y <= window.maxy )
+		{
+			if (rows.empty())
+				rows.resize(window.maxy - window.miny + 1);
+			cover_array &row = rows[current.y - window.miny];
+			if (!row.empty() && row.back().x == current.x)
+				row.back().addcover(current.cover, current.area);
+			else
+				row.push_back(current);
+			return;
+		}
+
 		if (covers.size() == covers.capacity())
 			covers.reserve(covers.size() + 1024*1024);
 		covers.push_back(current);
@@ -141,6 +158,7 @@ void
 Polyspan::merge_all()
 {
 	finish_line();
+	flush_rows();
 	std::sort(covers.begin(),covers.end());
 	open_index = 0;
 }
@@ -156,11 +174,66 @@ Polyspan::sort_marks()
 		addcurrent();
 		current.setcover(0,0);
 
-		std::sort(covers.begin() + open_index,covers.end());
+		if (accumulator == ACCUMULATOR_BUCKETS)
+		{
+			// marks out of rows are possible only for degenerate window
+			bool out_of_rows = (int)covers.size() != open_index;
+			flush_rows();
+			if (out_of_rows)
+				std::sort(covers.begin() + open_index,covers.end());
+		}
+		else
+		{
+			std::sort(covers.begin() + open_index,covers.end());
+		}
 		flags &= ~NotSorted;
 	}
 }
 
+void
+Polyspan::flush_rows()
+{
+	int y = window.miny;
+	for(std::vector<cover_array>::iterator r = rows.begin(); r != rows.end(); ++r, ++y)
+	{
+		cover_array &row = *r;
+		if (row.empty())
+			continue;
+
+		int minx = row.front().x, maxx = minx;
+		for(cover_array::const_iterator i = row.begin() + 1; i != row.end(); ++i)
+			{ minx = std::min(minx, i->x); maxx = std::max(maxx, i->x); }
+
+		if (maxx - minx < 4*(int)row.size())
+		{
+			// dense row - accumulate signed area per cell, no sort required
+			row_cells.assign(maxx - minx + 1, PenMark());
+			for(cover_array::const_iterator i = row.begin(); i != row.end(); ++i)
+				row_cells[i->x - minx].addcover(i->cover, i->area);
+			for(int x = minx; x <= maxx; ++x)
+			{
+				const PenMark &cell = row_cells[x - minx];
+				if (cell.cover || cell.area)
+					covers.push_back(PenMark(x, y, cell.cover, cell.area));
+			}
+		}
+		else
+		{
+			// sparse row - sort by x and merge marks of the same cell
+			std::sort(row.begin(), row.end());
+			covers.push_back(row.front());
+			for(cover_array::const_iterator i = row.begin() + 1; i != row.end(); ++i)
+			{
+				if (i->x == covers.back().x)
+					covers.back().addcover(i->cover, i->area);
+				else
+					covers.push_back(*i);
+			}
+		}
+		row.clear();
+	}
+}
+
 //encapsulate the current sublist of marks (used for drawing)
 void
 Polyspan::encapsulate_current()
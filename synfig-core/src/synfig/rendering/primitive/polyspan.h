@@ -87,6 +87,13 @@ public:
 		MAX_SUBDIVISION_SIZE = 64
 	};
 
+	//! how marks are collected for the sweep
+	enum Accumulator
+	{
+		ACCUMULATOR_SORT,    //!< all marks in one array, sorted at once
+		ACCUMULATOR_BUCKETS  //!< marks are binned per scanline and merged per cell
+	};
+
 private:
 	Point			arc[3*MAX_SUBDIVISION_SIZE + 1];
 
@@ -114,6 +121,14 @@ private:
 	//the window that will be drawn (used for clipping)
 	RectInt		    window;
 
+	Accumulator		accumulator;
+
+	//marks of the open list binned by scanline, used by ACCUMULATOR_BUCKETS
+	std::vector<cover_array> rows;
+	cover_array		row_cells;
+
+	static Accumulator default_accumulator;
+
 	//add the current cell, but only if there is information to add
 	void addcurrent();
 
@@ -133,12 +148,24 @@ private:
 
 	void finish_line();
 
+	//move binned marks to the end of covers, sorted and merged per cell
+	void flush_rows();
+
 public:
 	Polyspan();
 
 	const RectInt& get_window() const { return window; }
+	//with ACCUMULATOR_BUCKETS marks are moved here by sort_marks() only
 	const cover_array& get_covers() const { return covers; }
 
+	Accumulator get_accumulator() const { return accumulator; }
+	void set_accumulator(Accumulator x) { flush_rows(); accumulator = x; }
+
+	//! accumulator of new polyspans, may be changed by
+	//! SYNFIG_RENDERING_POLYSPAN_ACCUMULATOR environment variable ("sort" or "buckets")
+	static Accumulator get_default_accumulator() { return default_accumulator; }
+	static void set_default_accumulator(Accumulator x) { default_accumulator = x; }
+
 	bool notclosed() const
 		{ return (flags & NotClosed) || (cur_x != close_x) || (cur_y != close_y); }
 
@@ -0,0 +1,265 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/rendercache.cpp
+**	\brief RenderCache
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstring>
+#include <vector>
+
+#include <synfig/general.h>
+
+#include "rendercache.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+//! how many keys requested once are remembered
+static const size_t default_max_candidates = 4096;
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+
+// RenderCache
+
+RenderCache::RenderCache(size_t max_bytes):
+	max_bytes(max_bytes),
+	max_candidates(default_max_candidates)
+{ }
+
+size_t
+RenderCache::get_max_bytes() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return max_bytes;
+}
+
+void
+RenderCache::set_max_bytes(size_t max_bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	this->max_bytes = max_bytes;
+	evict(0);
+}
+
+void
+RenderCache::erase_entry(EntryList::iterator i)
+{
+	stats.bytes -= i->bytes;
+	--stats.entries;
+	entries_map.erase(i->key);
+	entries.erase(i);
+}
+
+void
+RenderCache::evict(size_t required)
+{
+	while(!entries.empty() && stats.bytes + required > max_bytes) {
+		erase_entry(--entries.end());
+		++stats.evictions;
+	}
+}
+
+bool
+RenderCache::touch_candidate(Key key)
+{
+	KeyMap::iterator i = candidates_map.find(key);
+	if (i != candidates_map.end()) {
+		candidates.erase(i->second);
+		candidates_map.erase(i);
+		return true;
+	}
+
+	candidates.push_front(key);
+	candidates_map[key] = candidates.begin();
+	if (candidates.size() > max_candidates) {
+		candidates_map.erase(candidates.back());
+		candidates.pop_back();
+	}
+	return false;
+}
+
+bool
+RenderCache::find(Key key, const VectorInt &size, Surface::Handle &surface, bool &store)
+{
+	surface.reset();
+	store = false;
+
+	Surface::Handle cached;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!max_bytes)
+			return false;
+
+		EntryMap::iterator i = entries_map.find(key);
+		if (i == entries_map.end() || i->second->size != size) {
+			++stats.misses;
+			store = touch_candidate(key);
+			return false;
+		}
+
+		++stats.hits;
+		entries.splice(entries.begin(), entries, i->second);
+		cached = i->second->surface;
+	}
+
+	// cached surfaces are never modified, so copy them without lock
+	if (cached) {
+		surface = cached->get_token()->fabric();
+		if (!surface || !surface->assign(*cached))
+			{ surface.reset(); return false; }
+	}
+	return true;
+}
+
+void
+RenderCache::put(Key key, const VectorInt &size, const Surface::Handle &surface)
+{
+	size_t bytes = sizeof(Entry) + (surface ? surface->get_memory_size() : 0);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// don't flush whole cache for a single result
+	if (bytes > max_bytes/4)
+		return;
+
+	EntryMap::iterator i = entries_map.find(key);
+	if (i != entries_map.end())
+		erase_entry(i->second);
+	evict(bytes);
+
+	Entry entry;
+	entry.key = key;
+	entry.size = size;
+	entry.surface = surface;
+	entry.bytes = bytes;
+	entries.push_front(entry);
+	entries_map[key] = entries.begin();
+
+	stats.bytes += bytes;
+	++stats.entries;
+	++stats.stores;
+}
+
+void
+RenderCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+	entries_map.clear();
+	candidates.clear();
+	candidates_map.clear();
+	stats.bytes = 0;
+	stats.entries = 0;
+}
+
+RenderCache::Stats
+RenderCache::get_stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Stats s = stats;
+	s.max_bytes = max_bytes;
+	return s;
+}
+
+void
+RenderCache::reset_stats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.hits = 0;
+	stats.misses = 0;
+	stats.stores = 0;
+	stats.evictions = 0;
+}
+
+
+// TaskCacheStore
+
+Task::Token TaskCacheStore::token(
+	DescSpecial<TaskCacheStore>("CacheStore") );
+
+bool
+TaskCacheStore::run(RunParams & /* params */) const
+{
+	// result of sub-task is already in the target,
+	// so failure here should not break the rendering
+	if (!cache || !is_valid())
+		return true;
+
+	const VectorInt size = target_rect.get_size();
+	Surface::Handle surface;
+
+	if (!target_surface->is_blank()) {
+		SurfaceResource::LockReadBase lock(target_surface);
+		if (!lock.convert(Surface::Token::Handle(), false, true))
+			return true;
+		const Surface &src = *lock.get_surface();
+
+		surface = (format ? format : src.get_token())->fabric();
+		if (!surface)
+			return true;
+
+		if (target_rect == RectInt(0, 0, src.get_width(), src.get_height())) {
+			if (!surface->assign(src))
+				return true;
+		} else {
+			std::vector<Color> buffer;
+			const Color *pixels = src.get_pixels_pointer();
+			if (!pixels) {
+				buffer.resize(src.get_pixels_count());
+				if (!src.get_pixels(&buffer.front()))
+					return true;
+				pixels = &buffer.front();
+			}
+
+			std::vector<Color> region(size[0]*size[1]);
+			for(int y = 0; y < size[1]; ++y)
+				memcpy( &region[y*size[0]],
+						pixels + (target_rect.miny + y)*src.get_width() + target_rect.minx,
+						size[0]*sizeof(Color) );
+			if (!surface->assign(&region.front(), size[0], size[1]))
+				return true;
+		}
+	}
+
+	cache->put(key, size, surface);
+	return true;
+}
+
+/* === E N T R Y P O I N T ================================================= */
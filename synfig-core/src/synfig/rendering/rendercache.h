@@ -0,0 +1,155 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/rendercache.h
+**	\brief RenderCache Header
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_RENDERCACHE_H
+#define __SYNFIG_RENDERING_RENDERCACHE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "task.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+//! Bounded LRU cache of rendered surfaces keyed by hash of task tree
+//! (see Task::calc_hash()). Shared by all renderers, so identical sub-trees
+//! of consecutive frames (static backgrounds, unanimated groups, bitmaps)
+//! are rendered once.
+//! Result is stored only when the same key was requested before,
+//! so animated sub-trees don't evict useful entries.
+class RenderCache
+{
+public:
+	typedef uint64_t Key;
+
+	struct Stats
+	{
+		long long hits;      //!< count of found results
+		long long misses;    //!< count of not found results
+		long long stores;    //!< count of stored results
+		long long evictions; //!< count of results removed to free the memory
+		long long entries;   //!< count of results in cache
+		size_t bytes;        //!< memory used by results
+		size_t max_bytes;    //!< memory limit
+
+		Stats(): hits(), misses(), stores(), evictions(), entries(), bytes(), max_bytes() { }
+	};
+
+private:
+	struct Entry
+	{
+		Key key;
+		VectorInt size;
+		Surface::Handle surface; //!< null for blank result
+		size_t bytes;
+		Entry(): key(), bytes() { }
+	};
+
+	typedef std::list<Entry> EntryList;
+	typedef std::unordered_map<Key, EntryList::iterator> EntryMap;
+	typedef std::list<Key> KeyList;
+	typedef std::unordered_map<Key, KeyList::iterator> KeyMap;
+
+	mutable std::mutex mutex;
+
+	size_t max_bytes;
+	size_t max_candidates;
+	Stats stats;
+
+	//! recently used entries are in front
+	EntryList entries;
+	EntryMap entries_map;
+
+	//! keys which was requested once, but was not stored yet
+	KeyList candidates;
+	KeyMap candidates_map;
+
+	void erase_entry(EntryList::iterator i);
+	void evict(size_t required);
+	bool touch_candidate(Key key);
+
+public:
+	explicit RenderCache(size_t max_bytes = 0);
+
+	size_t get_max_bytes() const;
+	void set_max_bytes(size_t max_bytes);
+	bool is_enabled() const
+		{ return get_max_bytes() > 0; }
+
+	//! Searches the result, on success returns private copy of cached surface
+	//! (or null surface for blank result), so caller may modify it.
+	//! On fail tells through \a store should be the result stored or not.
+	bool find(Key key, const VectorInt &size, Surface::Handle &surface, bool &store);
+	//! Stores the surface, it should not be modified by caller anymore.
+	//! Null surface means blank result
+	void put(Key key, const VectorInt &size, const Surface::Handle &surface);
+
+	void clear();
+	Stats get_stats() const;
+	void reset_stats();
+};
+
+
+//! Stores result of sub-task into RenderCache, see OptimizerCache
+class TaskCacheStore: public Task
+{
+public:
+	typedef etl::handle<TaskCacheStore> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	RenderCache *cache;
+	RenderCache::Key key;
+	Surface::Token::Handle format; //!< format of stored surface, the same as source if not set
+
+	TaskCacheStore(): cache(), key() { }
+
+	const Task::Handle& sub_task() const { return Task::sub_task(0); }
+	Task::Handle& sub_task() { return Task::sub_task(0); }
+
+	virtual bool run(RunParams &params) const;
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
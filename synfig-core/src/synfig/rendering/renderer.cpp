@@ -46,15 +46,23 @@
 #include <synfig/debug/debugsurface.h>
 #include <synfig/debug/log.h>
 #include <synfig/debug/measure.h>
+#include <synfig/debug/trace.h>
 
 #include "renderer.h"
 #include "renderqueue.h"
+#include "rendercache.h"
+
+#include "primitive/polyspan.h"
 
 #include "software/renderersw.h"
 #include "software/rendererdraftsw.h"
 #include "software/rendererpreviewsw.h"
 #include "software/rendererlowressw.h"
 #include "software/renderersafe.h"
+#include "software/surfaceswpool.h"
+#include "software/function/blur.h"
+#include "software/function/fft.h"
+#include "software/function/packedsurface.h"
 #ifdef WITH_OPENGL
 #include "opengl/renderergl.h"
 #include "opengl/task/taskgl.h"
@@ -88,6 +96,7 @@ using namespace rendering;
 Renderer::Handle Renderer::blank;
 std::map<String, Renderer::Handle> *Renderer::renderers;
 RenderQueue *Renderer::queue;
+RenderCache *Renderer::cache;
 Renderer::DebugOptions Renderer::debug_options;
 long long Renderer::last_registered_optimizer_index = 0;
 long long Renderer::last_batch_index = 0;
@@ -210,6 +219,7 @@ Renderer::calc_coords(const Task::List &list) const
 	#ifdef DEBUG_OPTIMIZATION_MEASURE
 	debug::Measure t("calc coords");
 	#endif
+	debug::Trace::Scope trace("optimizer", "calc coords");
 	for(Task::List::const_iterator i = list.begin(); i != list.end(); ++i)
 		if (*i) (*i)->touch_coords();
 }
@@ -237,6 +247,7 @@ Renderer::specialize(Task::List &list) const
 	#ifdef DEBUG_OPTIMIZATION_MEASURE
 	debug::Measure t("specialize");
 	#endif
+	debug::Trace::Scope trace("optimizer", "specialize");
 	specialize_recursive(list);
 }
 
@@ -257,6 +268,7 @@ Renderer::linearize(Task::List &list) const
 	#ifdef DEBUG_OPTIMIZATION_MEASURE
 	debug::Measure t("linearize");
 	#endif
+	debug::Trace::Scope trace("optimizer", "linearize");
 
 	// convert task-tree to linear list
 	for(Task::List::iterator i = list.begin(); i != list.end();)
@@ -493,6 +505,7 @@ Renderer::optimize(Task::List &list) const
 	#ifdef DEBUG_TASK_MEASURE
 	debug::Measure t("Renderer::optimize");
 	#endif
+	debug::Trace::Scope trace("renderer", "optimize", "tasks", (long long)list.size());
 
 	#ifdef DEBUG_OPTIMIZATION_COUNTERS
 	debug::Log::info("", "optimize %d tasks", count_tasks(list));
@@ -583,6 +596,7 @@ Renderer::optimize(Task::List &list) const
 		#ifdef DEBUG_OPTIMIZATION_MEASURE
 		debug::Measure t(etl::strprintf("optimize category %d index %d", current_category_id, current_optimizer_index));
 		#endif
+		debug::Trace::Scope trace_category("optimizer", "optimize category", "category", current_category_id);
 
 		#ifdef DEBUG_OPTIMIZATION_COUNTERS
 		std::atomic<int> calls_count(0), *calls_count_ptr = &calls_count;
@@ -680,6 +694,7 @@ Renderer::find_deps(const Task::List &list, long long batch_index) const
 	#ifdef DEBUG_TASK_MEASURE
 	debug::Measure t("Renderer::find_deps");
 	#endif
+	debug::Trace::Scope trace("renderer", "find deps", "tasks", (long long)list.size());
 
 	typedef std::map<SurfaceResource::Handle, Task::Handle> DepTargetPrevMap;
 	DepTargetPrevMap target_prev_map;
@@ -816,6 +831,13 @@ Renderer::run(const Task::List &list, bool quiet) const
 			get_debug_options().result_image,
 			true );
 
+	if (!quiet && get_debug_options().surface_pool_stats) {
+		SurfaceSWPool::Stats stats = SurfaceSWPool::instance().get_stats();
+		info( "surface pool: allocated %lld, reused %lld, released %lld, dropped %lld, pooled %lu KiB, peak %lu KiB",
+			stats.allocations, stats.reuses, stats.releases, stats.drops,
+			(unsigned long)(stats.bytes/1024), (unsigned long)(stats.peak_bytes/1024) );
+	}
+
 	return task_event->is_done();
 }
 
@@ -991,9 +1013,52 @@ Renderer::initialize()
 		debug_options.task_list_optimized_log = s;
 	if (const char *s = getenv("SYNFIG_RENDERING_DEBUG_RESULT_IMAGE"))
 		debug_options.result_image = s;
+	if (const char *s = getenv("SYNFIG_RENDERING_DEBUG_SURFACE_POOL_STATS"))
+		debug_options.surface_pool_stats = atoi(s) != 0;
+	if (const char *s = getenv("SYNFIG_RENDERING_TRACE"))
+		debug_options.trace_file = s;
+
+	// trace is saved in deinitialize()
+	if (!debug_options.trace_file.empty())
+		debug::Trace::set_enabled(true);
+
+	size_t cache_size = 128;
+	if (const char *s = getenv("SYNFIG_RENDERING_CACHE_SIZE"))
+		cache_size = std::max(0, atoi(s));
+
+	// unused buffers of intermediate surfaces, in megabytes
+	if (const char *s = getenv("SYNFIG_RENDERING_SURFACE_POOL_SIZE"))
+		SurfaceSWPool::instance().set_max_bytes((size_t)std::max(0, atoi(s))*1024*1024);
+
+	// for A/B comparison of rasterizers
+	if (const char *s = getenv("SYNFIG_RENDERING_POLYSPAN_ACCUMULATOR"))
+		Polyspan::set_default_accumulator( String(s) == "sort"
+			? Polyspan::ACCUMULATOR_SORT : Polyspan::ACCUMULATOR_BUCKETS );
+
+	// threads of a single blur, 0 means all threads of ThreadPool
+	if (const char *s = getenv("SYNFIG_RENDERING_BLUR_THREADS"))
+		software::Blur::set_max_threads(atoi(s));
+
+	// measured FFT plans are worth their planning time in long batch renders,
+	// wisdom file keeps them between runs
+	if (const char *s = getenv("SYNFIG_RENDERING_FFT_PLANNING"))
+		software::FFT::set_planning( String(s) == "measure"
+			? software::FFT::PLANNING_MEASURE : software::FFT::PLANNING_ESTIMATE );
+	if (const char *s = getenv("SYNFIG_RENDERING_FFT_WISDOM"))
+		software::FFT::set_wisdom_filename(s);
+
+	// imported bitmaps: codec of chunks and memory of unpacked chunks, in megabytes
+	if (const char *s = getenv("SYNFIG_PACK_IMAGES_CODEC"))
+		software::PackedSurface::set_default_codec(
+			  String(s) == "lz"   ? software::PackedSurface::CodecLZ
+			: String(s) == "zlib" ? software::PackedSurface::CodecZlib
+			:                       software::PackedSurface::CodecNone );
+	if (const char *s = getenv("SYNFIG_RENDERING_PACKED_CACHE_SIZE"))
+		software::PackedSurface::ChunkCache::instance().set_max_bytes((size_t)std::max(0, atoi(s))*1024*1024);
 
 	renderers = new std::map<String, Handle>();
 	queue = new RenderQueue();
+	cache = new RenderCache(cache_size*1024*1024);
 
 	initialize_renderers();
 }
@@ -1011,6 +1076,13 @@ Renderer::deinitialize()
 
 	delete renderers;
 	delete queue;
+	delete cache;
+
+	// threads of queue are stopped, so all their buffers are shared now
+	SurfaceSWPool::instance().clear();
+
+	if (!debug_options.trace_file.empty())
+		debug::Trace::save(debug_options.trace_file);
 }
 
 void
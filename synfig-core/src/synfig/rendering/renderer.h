@@ -49,6 +49,7 @@ namespace rendering
 {
 
 class RenderQueue;
+class RenderCache;
 
 class Renderer: public etl::shared_object
 {
@@ -60,12 +61,16 @@ public:
 		String task_list_log;
 		String task_list_optimized_log;
 		String result_image;
+		bool surface_pool_stats; //!< print statistics of SurfaceSWPool after each rendering
+		String trace_file;       //!< record debug::Trace from start and save it at exit
+		DebugOptions(): surface_pool_stats() { }
 	};
 
 private:
 	static Handle blank;
 	static std::map<String, Handle> *renderers;
 	static RenderQueue *queue;
+	static RenderCache *cache;
 	static DebugOptions debug_options;
 	static long long last_registered_optimizer_index;
 	static long long last_batch_index; // TODO: atomic
@@ -186,6 +191,15 @@ public:
 	static const DebugOptions& get_debug_options()
 		{ return debug_options; }
 
+	//! queue shared by all renderers, may be used to collect statistics
+	static RenderQueue* get_queue()
+		{ return queue; }
+
+	//! cache of rendered sub-trees shared by all renderers,
+	//! size is limited by SYNFIG_RENDERING_CACHE_SIZE environment variable (in megabytes)
+	static RenderCache* get_cache()
+		{ return cache; }
+
 	static bool subsys_init()
 		{ initialize(); return true; }
 	static bool subsys_stop()
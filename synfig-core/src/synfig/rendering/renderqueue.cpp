@@ -34,12 +34,16 @@
 
 #include <cstdlib>
 
+#include <glib.h>
+
+#include <ETL/stringf>
 
 #include <synfig/general.h>
 #include <synfig/localization.h>
 #include <synfig/debug/debugsurface.h>
 #include <synfig/debug/log.h>
 #include <synfig/debug/measure.h>
+#include <synfig/debug/trace.h>
 
 #include "renderqueue.h"
 #include "renderer.h"
@@ -86,8 +90,22 @@ Task::Token TaskSubQueue::token(
 } // end of anonimous namespace
 
 
-RenderQueue::RenderQueue(): started(false) { start(); }
-RenderQueue::~RenderQueue() { stop(); }
+RenderQueue::RenderQueue():
+	started(false),
+	ready_count(0),
+	single_ready_count(0),
+	sleeping_count(0),
+	single_sleeping_count(0),
+	next_worker(0)
+	{ start(); }
+
+RenderQueue::~RenderQueue()
+{
+	stop();
+	for(WorkerList::iterator i = workers.begin(); i != workers.end(); ++i)
+		delete *i;
+	workers.clear();
+}
 
 void
 RenderQueue::start()
@@ -110,19 +128,23 @@ RenderQueue::start()
 	if (count > SYNFIG_RENDERING_MAX_THREADS) count = SYNFIG_RENDERING_MAX_THREADS;
 	if (count < 2) count = 2;
 
+	// workers should be ready before threads are started
+	for(unsigned int i = 0; i < count; ++i)
+		workers.push_back(new Worker());
+	started = true;
+
 	for(unsigned int i = 0; i < count; ++i)
 		threads.push_back(
 			std::thread(
 				sigc::bind(sigc::mem_fun(*this, &RenderQueue::process), i) ));
 	info("rendering threads %d", count);
-	started = true;
 }
 
 void
 RenderQueue::stop()
 {
 	{
-		std::lock_guard<std::mutex> lock(mutex);
+		std::lock_guard<std::mutex> lock(sleep_mutex);
 		started = false;
 		cond.notify_all();
 		single_cond.notify_all();
@@ -134,8 +156,14 @@ RenderQueue::stop()
 void
 RenderQueue::process(int thread_index)
 {
+	Worker &worker = *workers[thread_index];
+	debug::Trace::set_thread_name(etl::strprintf("rendering thread %d", thread_index));
 	while(Task::Handle task = get(thread_index))
 	{
+		// nobody waits for this task, so just release it's dependencies
+		if (task->renderer_data.orphan)
+			{ done(thread_index, task); continue; }
+
 		#ifdef DEBUG_THREAD_TASK
 		info( "thread %d: begin task #%05d-%04d '%s'",
 			  thread_index,
@@ -151,12 +179,28 @@ RenderQueue::process(int thread_index)
 			continue;
 		}
 
+		long long time = g_get_monotonic_time();
 		bool success = false;
 		try {
 			success = task->run(task->renderer_data.params);
 		} catch(...) { }
 		if (!success)
 			task->renderer_data.success = false;
+		const long long end_time = g_get_monotonic_time();
+		worker.busy_us += end_time - time;
+		++worker.tasks_count;
+
+		if (debug::Trace::is_enabled()) {
+			debug::Trace::Event event;
+			event.category = "task";
+			event.name = task->get_token()->name.c_str();
+			event.begin = time;
+			event.end = end_time;
+			event.rect = task->target_rect;
+			event.arg_name = "batch";
+			event.arg = task->renderer_data.batch_index;
+			debug::Trace::add(event);
+		}
 
 		#ifdef DEBUG_TASK_SURFACE
 		debug::DebugSurface::save_to_file(
@@ -196,70 +240,137 @@ void
 RenderQueue::done(int thread_index, const Task::Handle &task)
 {
 	assert(task);
-	int single_signals = 0;
-	int signals = 0;
-	std::lock_guard<std::mutex> lock(mutex);
-	for(Task::Set::iterator i = task->renderer_data.back_deps.begin(); i != task->renderer_data.back_deps.end(); ++i)
+
+	// take dependent tasks under the lock,
+	// cancel() may change dependencies concurrently
+	Task::Set back_deps;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		back_deps.swap(task->renderer_data.back_deps);
+		task->renderer_data.deps.clear();
+		if (TaskEvent::Handle task_event = TaskEvent::Handle::cast_dynamic(task))
+			events.erase(task_event);
+	}
+
+	Task::List ready;
+	for(Task::Set::const_iterator i = back_deps.begin(); i != back_deps.end(); ++i)
 	{
 		assert(*i);
-		(*i)->renderer_data.deps.erase(task);
-		if ((*i)->renderer_data.deps.empty())
+		if (--(*i)->renderer_data.deps_count == 0)
+			ready.push_back(*i);
+	}
+	push(thread_index, ready);
+}
+
+Task::Handle
+RenderQueue::pop(int thread_index)
+{
+	// owner takes the most recent task, it's data is probably still in cache
+	Worker &worker = *workers[thread_index];
+	std::lock_guard<std::mutex> lock(worker.mutex);
+	if (worker.tasks.empty())
+		return Task::Handle();
+	Task::Handle task = worker.tasks.back();
+	worker.tasks.pop_back();
+	return task;
+}
+
+Task::Handle
+RenderQueue::steal(int thread_index)
+{
+	// thread 0 has own lane, so steal only between multithreading workers
+	int count = (int)workers.size() - 1;
+	for(int i = 1; i < count; ++i)
+	{
+		Worker &victim = *workers[1 + (thread_index - 1 + i) % count];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
 		{
-			bool mt = (*i)->get_allow_multithreading();
-			TaskQueue &queue = mt ? ready_tasks     : single_ready_tasks;
-			TaskSet   &wait  = mt ? not_ready_tasks : single_not_ready_tasks;
-			wait.erase(*i);
-			queue.push_back(*i);
-			++(mt ? signals : single_signals);
+			Task::Handle task = victim.tasks.front();
+			victim.tasks.pop_front();
+			++workers[thread_index]->steals_count;
+			return task;
 		}
 	}
-	task->renderer_data.back_deps.clear();
-	assert( tasks_in_process.count(thread_index) == 1 );
-	tasks_in_process.erase(thread_index);
-	//info("rendering threads used %d", tasks_in_process.size());
+	return Task::Handle();
+}
+
+void
+RenderQueue::push(int thread_index, const Task::Handle &task)
+	{ if (task) push(thread_index, Task::List(1, task)); }
 
-	// limit signals count
-	int threads = get_threads_count() - 1;
-	if (signals > threads) signals = threads;
-	if (single_signals > 1) single_signals = 1;
+void
+RenderQueue::push(int thread_index, const Task::List &tasks)
+{
+	if (tasks.empty()) return;
+
+	int count = (int)workers.size() - 1;
+	int signals = 0;
+	int single_signals = 0;
+	for(Task::List::const_iterator i = tasks.begin(); i != tasks.end(); ++i)
+	{
+		if (!*i) continue;
+
+		// keep multithreading tasks at current worker,
+		// tasks from other threads are distributed evenly
+		bool mt = (*i)->get_allow_multithreading();
+		int index = !mt ? 0
+		          : thread_index > 0 ? thread_index
+		          : 1 + (int)(next_worker++ % count);
+
+		Worker &worker = *workers[index];
+		{
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			worker.tasks.push_back(*i);
+		}
+		++(mt ? signals : single_signals);
+	}
 
-	// we don't need to wakeup the current thread
-	--(thread_index ? signals : single_signals);
+	// counters should be changed before check of sleeping threads, see get()
+	if (signals) ready_count += signals;
+	if (single_signals) single_ready_count += single_signals;
 
 	// wake up
-	while(signals-- > 0) cond.notify_one();
-	while(single_signals-- > 0) single_cond.notify_one();
+	if (signals > 0 && sleeping_count > 0)
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		if (signals >= count) cond.notify_all();
+		else while(signals-- > 0) cond.notify_one();
+	}
+	if (single_signals > 0 && single_sleeping_count > 0)
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		single_cond.notify_one();
+	}
 }
 
 Task::Handle
 RenderQueue::get(int thread_index)
 {
-	std::unique_lock<std::mutex> lock(mutex);
+	std::atomic<int> &ready    = thread_index ? ready_count    : single_ready_count;
+	std::atomic<int> &sleeping = thread_index ? sleeping_count : single_sleeping_count;
+	std::condition_variable &c = thread_index ? cond           : single_cond;
 
-	TaskQueue &queue  = thread_index == 0 ? single_ready_tasks     : ready_tasks;
-	TaskQueue &queue2 = thread_index != 0 ? single_ready_tasks     : ready_tasks;
-	TaskSet   &wait   = thread_index == 0 ? single_not_ready_tasks : not_ready_tasks;
 	while(started)
 	{
-		if (!queue.empty())
-		{
-			Task::Handle task = queue.front();
-			queue.pop_front();
-			if (!task) continue;
-			assert( tasks_in_process.count(thread_index) == 0 );
-			tasks_in_process[thread_index] = task;
-			//info("rendering threads used %d", tasks_in_process.size());
-			return task;
-		}
+		Task::Handle task = pop(thread_index);
+		if (!task && thread_index)
+			task = steal(thread_index);
+		if (task)
+			{ --ready; return task; }
+
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		if (!started) break;
 
 		#ifdef DEBUG_THREAD_WAIT
-		if (!wait.empty())
-			info("thread %d: rendering wait for task", thread_index);
+		info("thread %d: rendering wait for task", thread_index);
 		#endif
 
-		assert( wait.empty() || !tasks_in_process.empty() || !queue2.empty() );
-
-		(thread_index ? cond : single_cond).wait(lock);
+		// if ready counter is not zero then some task is still in queue,
+		// or just taken by other thread and we will not wait long
+		++sleeping;
+		if (ready <= 0) c.wait(lock);
+		--sleeping;
 	}
 	return Task::Handle();
 }
@@ -267,11 +378,11 @@ RenderQueue::get(int thread_index)
 void
 RenderQueue::fix_task(const Task &task, const Task::RunParams &params)
 {
-	//for(Task::List::iterator i = task.back_deps.begin(); i != task.back_deps.end();)
-	//	if (*i) ++i; else i = (*i)->back_deps.erase(i);
 	task.renderer_data.params = params;
 	task.renderer_data.params.sub_queue.clear();
 	task.renderer_data.success = true;
+	task.renderer_data.orphan = false;
+	task.renderer_data.deps_count = (int)task.renderer_data.deps.size();
 }
 
 int
@@ -280,41 +391,40 @@ RenderQueue::get_threads_count() const
 	return threads.size();
 }
 
+void
+RenderQueue::detach(const Task::Handle &task)
+{
+	// mutex must be already locked
+
+	Task::RendererData &rd = task->renderer_data;
+	rd.orphan = true;
+
+	Task::Set deps;
+	deps.swap(rd.deps);
+	for(Task::Set::const_iterator i = deps.begin(); i != deps.end(); ++i)
+		if (*i) {
+			(*i)->renderer_data.back_deps.erase(task);
+			if ((*i)->renderer_data.back_deps.empty())
+				remove_if_orphan(*i);
+		}
+}
+
 bool
-RenderQueue::remove_if_orphan(const Task::Handle &task, bool in_queue)
+RenderQueue::remove_if_orphan(const Task::Handle &task)
 {
 	// mutex must be already locked
 
-	if (!task)
+	if (!task || task->renderer_data.orphan)
 		return true;
 
-	TaskSet *tasks = NULL;
-	TaskSet::iterator ii;
-	if (!in_queue) {
-		bool mt = task->get_allow_multithreading();
-		tasks = mt ? &not_ready_tasks : &single_not_ready_tasks;
-		ii = tasks->find(task);
-		if (ii == tasks->end())
-			return true;
-	}
-
 	if (TaskEvent::Handle task_event = TaskEvent::Handle::cast_dynamic(task))
 		if (!task_event->is_finished())
 			return false;
 
 	if (!task->renderer_data.back_deps.empty())
 		return false;
-		
-	for(TaskSet::iterator i = task->renderer_data.deps.begin(); i != task->renderer_data.deps.end(); ++i)
-		if (*i) {
-			(*i)->renderer_data.back_deps.erase(task);
-			if ((*i)->renderer_data.back_deps.empty())
-				remove_if_orphan(*i, false);
-		}
-	task->renderer_data.deps.clear();
 
-	// don't remove task if 'in_queue' is set (it will removed by caller)
-	if (tasks) tasks->erase(ii);
+	detach(task);
 	return true;
 }
 
@@ -323,38 +433,15 @@ RenderQueue::remove_orphans()
 {
 	// mutex must be already locked
 
-	for(TaskQueue::iterator i = ready_tasks.begin(); i != ready_tasks.end();)
-		if (remove_if_orphan(*i, true)) ready_tasks.erase(i++); else ++i;
-	for(TaskQueue::iterator i = single_ready_tasks.begin(); i != single_ready_tasks.end();)
-		if (remove_if_orphan(*i, true)) single_ready_tasks.erase(i++); else ++i;
-
-	for(TaskSet::iterator i = not_ready_tasks.begin(); i != not_ready_tasks.end();)
-		if (remove_if_orphan(*i, true)) not_ready_tasks.erase(i++); else ++i;
-	for(TaskSet::iterator i = single_not_ready_tasks.begin(); i != single_not_ready_tasks.end();)
-		if (remove_if_orphan(*i, true)) single_not_ready_tasks.erase(i++); else ++i;
+	for(EventSet::iterator i = events.begin(); i != events.end();)
+		if (remove_if_orphan(*i)) events.erase(i++); else ++i;
 }
 
 
 void
 RenderQueue::enqueue(const Task::Handle &task, const Task::RunParams &params)
 {
-	if (!task) return;
-	fix_task(*task, params);
-	std::lock_guard<std::mutex> lock(mutex);
-
-	bool mt = task->get_allow_multithreading();
-	TaskQueue &queue = mt ? ready_tasks     : single_ready_tasks;
-	TaskSet   &wait  = mt ? not_ready_tasks : single_not_ready_tasks;
-	if (task->renderer_data.deps.empty()) {
-		queue.push_back(task);
-		(mt ? cond : single_cond).notify_one();
-	}
-	else
-	{
-		wait.insert(task);
-	}
-
-	remove_orphans();
+	if (task) enqueue(Task::List(1, task), params);
 }
 
 void
@@ -367,57 +454,22 @@ RenderQueue::enqueue(const Task::List &tasks, const Task::RunParams &params)
 		if (*i) { fix_task(**i, p); ++count; }
 	if (!count) return;
 
-	std::lock_guard<std::mutex> lock(mutex);
-	int single_signals = 0;
-	int signals = 0;
-	for(Task::List::const_iterator i = tasks.begin(); i != tasks.end(); ++i)
+	Task::List ready;
 	{
-		if (*i)
+		std::lock_guard<std::mutex> lock(mutex);
+		for(Task::List::const_iterator i = tasks.begin(); i != tasks.end(); ++i)
 		{
-			bool mt = (*i)->get_allow_multithreading();
-			TaskQueue &queue = mt ? ready_tasks     : single_ready_tasks;
-			TaskSet   &wait  = mt ? not_ready_tasks : single_not_ready_tasks;
-			if ((*i)->renderer_data.deps.empty()) {
-				queue.push_back(*i);
-				++(mt ? signals : single_signals);
-			} else {
-				wait.insert(*i);
-			}
+			if (!*i) continue;
+			if ((*i)->renderer_data.deps.empty())
+				ready.push_back(*i);
+			else
+			if (TaskEvent::Handle task_event = TaskEvent::Handle::cast_dynamic(*i))
+				events.insert(task_event);
 		}
+		remove_orphans();
 	}
 
-	// limit signals count
-	int threads = get_threads_count() - 1;
-	if (signals > threads) signals = threads;
-	if (single_signals > 1) single_signals = 1;
-
-	// wake up
-	while(signals-- > 0) cond.notify_one();
-	while(single_signals-- > 0) single_cond.notify_one();
-
-	remove_orphans();
-}
-
-bool
-RenderQueue::remove_task(const Task::Handle &task)
-{
-	bool found = false;
-	if (task) {
-		bool mt = task->get_allow_multithreading();
-		TaskQueue &queue = mt ? ready_tasks     : single_ready_tasks;
-		TaskSet   &wait  = mt ? not_ready_tasks : single_not_ready_tasks;
-
-		for(TaskQueue::iterator i = queue.begin(); i != queue.end(); ) {
-			if (*i == task) {
-				found = true;
-				i = queue.erase(i);
-			} else {
-				++i;
-			}
-		}
-		if (wait.erase(task)) found = true;
-	}
-	return found;
+	push(-1, ready);
 }
 
 void
@@ -425,13 +477,15 @@ RenderQueue::cancel(const Task::Handle &task)
 {
 	if (!task) return;
 
+	TaskEvent::Handle task_event = TaskEvent::Handle::cast_dynamic(task);
 	{
 		std::lock_guard<std::mutex> lock(mutex);
-		if (remove_task(task))
-			remove_orphans();
+		if (task_event) events.erase(task_event);
+		task->renderer_data.success = false;
+		detach(task);
 	}
 
-	if (TaskEvent::Handle task_event = TaskEvent::Handle::cast_dynamic(task))
+	if (task_event)
 		task_event->finish(false);
 }
 
@@ -440,32 +494,64 @@ RenderQueue::cancel(const Task::List &list)
 {
 	if (list.empty()) return;
 
-	TaskEvent::List events;
+	TaskEvent::List events_to_finish;
 
 	{
 		std::lock_guard<std::mutex> lock(mutex);
-		bool found = false;
 		for(Task::List::const_iterator i = list.begin(); i != list.end(); ++i) {
-			if (remove_task(*i))
-				found = true;
-			if (TaskEvent::Handle task_event = TaskEvent::Handle::cast_dynamic(*i))
-				events.push_back(task_event);
+			if (!*i) continue;
+			if (TaskEvent::Handle task_event = TaskEvent::Handle::cast_dynamic(*i)) {
+				events.erase(task_event);
+				events_to_finish.push_back(task_event);
+			}
+			(*i)->renderer_data.success = false;
+			detach(*i);
 		}
-		if (found) remove_orphans();
 	}
 
-	for(TaskEvent::List::const_iterator i = events.begin(); i != events.end(); ++i)
+	for(TaskEvent::List::const_iterator i = events_to_finish.begin(); i != events_to_finish.end(); ++i)
 		(*i)->finish(false);
 }
 
 void
 RenderQueue::clear()
 {
-	std::lock_guard<std::mutex> lock(mutex);
-	ready_tasks.clear();
-	single_ready_tasks.clear();
-	not_ready_tasks.clear();
-	single_not_ready_tasks.clear();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		events.clear();
+	}
+
+	for(int i = 0; i < (int)workers.size(); ++i)
+	{
+		Worker &worker = *workers[i];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		(i ? ready_count : single_ready_count) -= (int)worker.tasks.size();
+		worker.tasks.clear();
+	}
+}
+
+void
+RenderQueue::get_stats(ThreadStatsList &out_stats) const
+{
+	out_stats.clear();
+	out_stats.resize(workers.size());
+	for(int i = 0; i < (int)workers.size(); ++i)
+	{
+		out_stats[i].tasks   = workers[i]->tasks_count;
+		out_stats[i].steals  = workers[i]->steals_count;
+		out_stats[i].busy_us = workers[i]->busy_us;
+	}
+}
+
+void
+RenderQueue::reset_stats()
+{
+	for(WorkerList::const_iterator i = workers.begin(); i != workers.end(); ++i)
+	{
+		(*i)->tasks_count  = 0;
+		(*i)->steals_count = 0;
+		(*i)->busy_us      = 0;
+	}
 }
 
 /* === E N T R Y P O I N T ================================================= */
@@ -30,8 +30,12 @@
 
 /* === H E A D E R S ======================================================= */
 
-#include <map>
+#include <deque>
+#include <list>
+#include <set>
+#include <vector>
 
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
@@ -49,31 +53,65 @@ namespace synfig
 namespace rendering
 {
 
+//! Work-stealing task scheduler.
+//! Every thread owns a deque of ready tasks: the owner takes tasks
+//! from the back, idle threads steal them from the front of other deques.
+//! Thread 0 is reserved for non-multithreading tasks (OpenGL), it has its own
+//! deque and never exchanges tasks with other threads.
+//! Dependencies are tracked by Task::RendererData::deps_count counters,
+//! so finished tasks don't need to lock the whole queue to wake up others.
 class RenderQueue
 {
 public:
 	typedef std::list<std::thread> ThreadList;
-	typedef std::map<int, Task::Handle> ThreadTaskMap;
-	typedef std::set<Task::Handle> TaskSet;
-	typedef std::list<Task::Handle> TaskQueue;
+	typedef std::set<TaskEvent::Handle> EventSet;
+	typedef std::deque<Task::Handle> TaskQueue;
+
+	struct ThreadStats
+	{
+		long long tasks;   //!< count of executed tasks
+		long long steals;  //!< count of tasks taken from deques of other threads
+		long long busy_us; //!< time spent in Task::run, in microseconds
+
+		ThreadStats(): tasks(), steals(), busy_us() { }
+	};
+
+	typedef std::vector<ThreadStats> ThreadStatsList;
 
 private:
-	static int last_batch_index;
+	struct Worker
+	{
+		std::mutex mutex;
+		TaskQueue tasks;
+
+		std::atomic<long long> tasks_count;
+		std::atomic<long long> steals_count;
+		std::atomic<long long> busy_us;
+
+		Worker(): tasks_count(), steals_count(), busy_us() { }
+	};
 
+	typedef std::vector<Worker*> WorkerList;
+
+	//! guards dependency graph (Task::RendererData::deps and back_deps) and 'events'
 	std::mutex mutex;
-	std::mutex threads_mutex;
+	//! guards sleeping of threads
+	std::mutex sleep_mutex;
 	std::condition_variable cond;
 	std::condition_variable single_cond;
 
-	TaskQueue ready_tasks;
-	TaskQueue single_ready_tasks;
-	TaskSet not_ready_tasks;
-	TaskSet single_not_ready_tasks;
-
-	bool started;
+	std::atomic<bool> started;
+	std::atomic<int> ready_count;
+	std::atomic<int> single_ready_count;
+	std::atomic<int> sleeping_count;
+	std::atomic<int> single_sleeping_count;
+	std::atomic<unsigned int> next_worker;
 
 	ThreadList threads;
-	ThreadTaskMap tasks_in_process;
+	WorkerList workers;
+
+	//! pending events holds the whole graph of enqueued tasks
+	EventSet events;
 
 	void start();
 	void stop();
@@ -82,10 +120,15 @@ private:
 	void done(int thread_index, const Task::Handle &task);
 	Task::Handle get(int thread_index);
 
+	Task::Handle pop(int thread_index);
+	Task::Handle steal(int thread_index);
+	void push(int thread_index, const Task::Handle &task);
+	void push(int thread_index, const Task::List &tasks);
+
 	static void fix_task(const Task &task, const Task::RunParams &params);
-	bool remove_if_orphan(const Task::Handle &task, bool in_queue);
+	void detach(const Task::Handle &task);
+	bool remove_if_orphan(const Task::Handle &task);
 	void remove_orphans();
-	bool remove_task(const Task::Handle &task);
 
 public:
 	RenderQueue();
@@ -97,6 +140,9 @@ public:
 	void cancel(const Task::Handle &task);
 	void cancel(const Task::List &list);
 	void clear();
+
+	void get_stats(ThreadStatsList &out_stats) const;
+	void reset_stats();
 };
 
 } /* end namespace rendering */
@@ -35,8 +35,11 @@
 #include <cassert>
 
 #include <algorithm>
+#include <deque>
 #include <functional>
 
+#include <synfig/threadpool.h>
+
 #include "blur.h"
 
 #include "blurtemplates.h"
@@ -51,8 +54,279 @@ using namespace rendering;
 
 /* === G L O B A L S ======================================================= */
 
+//! side of square block of transposition in pixels,
+//! 32x32 pixels of source and destination fit into L1 cache
+static const int transpose_block = 32;
+
+//! minimal work for separate thread, in channel-pixel operations
+static const Real min_band_cost = 262144.0;
+
+// Cost model, seconds per operation, channel-pixel is one channel of one pixel.
+// Box, pattern and transposition are measured by blur benchmark at single thread,
+// FFT is fitted to the former fixed thresholds of blur() for 1920x1080
+// (separable gaussian pattern up to radius 32, disc pattern up to 64 items)
+static const Real cost_buffer      = 10.0e-9; //!< allocation of zeroed buffer, per pixel
+static const Real cost_read_write  = 10.0e-9; //!< surface_read() + surface_write(), per pixel
+static const Real cost_transpose   = 10.0e-9; //!< per pixel
+static const Real cost_box         = 4.0e-9;  //!< per channel-pixel per pass
+static const Real cost_tap         = 1.45e-9; //!< per channel-pixel per item of separable pattern
+static const Real cost_pattern_2d  = 15.0e-9; //!< per channel-pixel, iteration of 2D pattern
+static const Real cost_tap_2d      = 1.55e-9; //!< per channel-pixel per item of half of 2D pattern
+static const Real cost_fft         = 2.05e-9; //!< per channel-pixel per log2 of length of transform
+static const Real cost_fft_item    = 5.0e-9;  //!< per channel-pixel, multiplication and abs
+
+int software::Blur::max_threads = 0;
+
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+using software::Array;
+using software::BlurTemplates;
+using software::FFT;
+
+//! Part of blur which may be split into independent bands of items (rows, columns or channels)
+class BandJob
+{
+public:
+	virtual ~BandJob() { }
+	virtual void process(int begin, int end) const = 0;
+};
+
+void
+process_band(const BandJob *job, int begin, int end)
+	{ job->process(begin, end); }
+
+//! Splits \a count items between threads of ThreadPool,
+//! \a cost is whole work in channel-pixel operations
+void
+process_bands(const BandJob &job, int count, Real cost)
+{
+	int bands = std::min(count, software::Blur::get_threads_count());
+	if (cost < bands*min_band_cost)
+		bands = std::max(1, (int)(cost/min_band_cost));
+	if (bands <= 1)
+		{ job.process(0, count); return; }
+
+	ThreadPool::Group group;
+	for(int i = 0; i < bands; ++i)
+		group.enqueue( sigc::bind( sigc::ptr_fun(&process_band),
+			&job, (int)((long long)count*i/bands), (int)((long long)count*(i + 1)/bands) ));
+	group.run();
+}
+
+int
+log2_ceil(int x)
+	{ int l = 0; while((1 << l) < x) ++l; return l; }
+
+//! Reads band of rows of source surface with premultiplied alpha
+template<typename T>
+class ReadJob: public BandJob
+{
+public:
+	const Array<T, 3> &dst;
+	const synfig::Surface &src;
+	const RectInt &src_rect;
+	T amount;
+
+	ReadJob(const Array<T, 3> &dst, const synfig::Surface &src, const RectInt &src_rect, T amount = T(1.0)):
+		dst(dst), src(src), src_rect(src_rect), amount(amount) { }
+
+	virtual void process(int begin, int end) const {
+		RectInt r(src_rect.minx, src_rect.miny + begin, src_rect.maxx, src_rect.miny + end);
+		BlurTemplates::surface_read(dst, src, VectorInt(0, begin), r);
+		if (amount != T(1.0))
+			dst.get_range(0, begin, end).template process< std::multiplies<T> >(amount);
+	}
+};
+
+//! Writes band of rows of destination surface and restores alpha
+template<typename T>
+class WriteJob: public BandJob
+{
+public:
+	const software::Blur::Params &params;
+	const Array<T, 3> &src;
+
+	WriteJob(const software::Blur::Params &params, const Array<T, 3> &src):
+		params(params), src(src) { }
+
+	virtual void process(int begin, int end) const {
+		const RectInt &dr = params.dest_rect;
+		BlurTemplates::surface_write(
+			*params.dest,
+			src,
+			RectInt(dr.minx, dr.miny + begin, dr.maxx, dr.miny + end),
+			params.src_offset - params.src_rect.get_min() + VectorInt(0, begin),
+			params.blend,
+			params.blend_method,
+			params.amount );
+	}
+};
+
+//! Transposes \a rows x \a cols pixels by square blocks,
+//! so the vertical pass of blur reads memory sequentially
+class TransposeJob: public BandJob
+{
+public:
+	ColorReal *dst;
+	const ColorReal *src;
+	int rows, cols;
+	bool add;
+
+	TransposeJob(ColorReal *dst, const ColorReal *src, int rows, int cols, bool add = false):
+		dst(dst), src(src), rows(rows), cols(cols), add(add) { }
+
+	static int get_count(int rows)
+		{ return (rows + transpose_block - 1)/transpose_block; }
+
+	virtual void process(int begin, int end) const {
+		const int channels = 4;
+		const int r_end = std::min(rows, end*transpose_block);
+		for(int r0 = begin*transpose_block; r0 < r_end; r0 += transpose_block) {
+			const int r1 = std::min(r_end, r0 + transpose_block);
+			for(int c0 = 0; c0 < cols; c0 += transpose_block) {
+				const int c1 = std::min(cols, c0 + transpose_block);
+				for(int r = r0; r < r1; ++r) {
+					const ColorReal *s = src + (r*cols + c0)*channels;
+					ColorReal *d = dst + (c0*rows + r)*channels;
+					if (add) {
+						for(int c = c0; c < c1; ++c, s += channels, d += rows*channels)
+							{ d[0] += s[0]; d[1] += s[1]; d[2] += s[2]; d[3] += s[3]; }
+					} else {
+						for(int c = c0; c < c1; ++c, s += channels, d += rows*channels)
+							{ d[0] = s[0]; d[1] = s[1]; d[2] = s[2]; d[3] = s[3]; }
+					}
+				}
+			}
+		}
+	}
+
+	void run() const
+		{ process_bands(*this, get_count(rows), (Real)rows*cols); }
+};
+
+//! Box blur of each row of interleaved channels
+class BoxRowsJob: public BandJob
+{
+public:
+	ColorReal *data;
+	int cols;
+	int size;
+	int count;
+
+	BoxRowsJob(ColorReal *data, int cols, int size, int count):
+		data(data), cols(cols), size(size), count(count) { }
+
+	virtual void process(int begin, int end) const {
+		const int channels = 4;
+		std::deque<ColorReal> q;
+		for(int r = begin; r < end; ++r)
+			for(int channel = 0; channel < channels; ++channel)
+				for(int i = 0; i < count; ++i)
+					BlurTemplates::blur_box_discrete(
+						Array<ColorReal, 1>(data + r*cols*channels + channel, cols, channels), q, size );
+	}
+};
+
+//! Convolution of each row of interleaved channels with symmetric pattern
+class PatternRowsJob: public BandJob
+{
+public:
+	ColorReal *dst;
+	ColorReal *src;
+	int cols;
+	const Array<ColorReal, 1> &pattern;
+
+	PatternRowsJob(ColorReal *dst, ColorReal *src, int cols, const Array<ColorReal, 1> &pattern):
+		dst(dst), src(src), cols(cols), pattern(pattern) { }
+
+	virtual void process(int begin, int end) const {
+		const int channels = 4;
+		for(int r = begin; r < end; ++r)
+			for(int channel = 0; channel < channels; ++channel)
+				BlurTemplates::blur_pattern(
+					Array<ColorReal, 1>(dst + r*cols*channels + channel, cols, channels),
+					Array<ColorReal, 1>(src + r*cols*channels + channel, cols, channels),
+					pattern );
+	}
+};
+
+//! Convolution with 2D pattern, band of rows reads rows around it
+class Pattern2DJob: public BandJob
+{
+public:
+	const Array<ColorReal, 3> &dst;
+	const Array<ColorReal, 3> &src;
+	const Array<ColorReal, 2> &pattern;
+
+	Pattern2DJob(const Array<ColorReal, 3> &dst, const Array<ColorReal, 3> &src, const Array<ColorReal, 2> &pattern):
+		dst(dst), src(src), pattern(pattern) { }
+
+	virtual void process(int begin, int end) const {
+		// pattern leaves borders of its size untouched, so extend the band by them
+		const int pattern_size = pattern.get_count(0) - 1;
+		const int b0 = std::max(0, begin - pattern_size);
+		const int b1 = std::min(dst.get_count(0), end + pattern_size);
+		for(Array<ColorReal, 3>::Iterator d(dst.get_range(0, b0, b1).reorder(2, 0, 1)), s(src.get_range(0, b0, b1).reorder(2, 0, 1)); d; ++d, ++s)
+			BlurTemplates::blur_2d_pattern(*d, *s, pattern);
+	}
+};
+
+//! Convolution of each channel by Fourier transform
+class FFTChannelsJob: public BandJob
+{
+public:
+	const Array<Complex, 3> &surface_rows;
+	const Array<Complex, 3> &surface_cols;
+	const Array<Complex, 2> *full_pattern;
+	const Array<Complex, 1> *row_pattern;
+	const Array<Complex, 1> *col_pattern;
+	bool cross;
+
+	FFTChannelsJob(const Array<Complex, 3> &surface_rows, const Array<Complex, 3> &surface_cols):
+		surface_rows(surface_rows), surface_cols(surface_cols),
+		full_pattern(), row_pattern(), col_pattern(), cross() { }
+
+	virtual void process(int begin, int end) const {
+		if (full_pattern) {
+			for(Array<Complex, 3>::Iterator channel(surface_rows.get_range(0, begin, end)); channel; ++channel) {
+				FFT::fft2d(*channel, false);
+				channel->process< std::multiplies<Complex> >(*full_pattern);
+				FFT::fft2d(*channel, true);
+			}
+			return;
+		}
+
+		Array<Complex, 3> rows = surface_rows.get_range(0, begin, end);
+		Array<Complex, 3> cols = surface_cols.get_range(0, begin, end);
+
+		for(Array<Complex, 3>::Iterator channel(rows); channel; ++channel) {
+			FFT::fft2d(*channel, false, true, false);
+			for(Array<Complex, 2>::Iterator r(*channel); r; ++r)
+				r->process< std::multiplies<Complex> >(*row_pattern);
+			FFT::fft2d(*channel, true, true, false);
+		}
+
+		for(Array<Complex, 3>::Iterator channel(cols); channel; ++channel) {
+			FFT::fft2d(*channel, false, true, false);
+			for(Array<Complex, 2>::Iterator c(*channel); c; ++c)
+				c->process< std::multiplies<Complex> >(*col_pattern);
+			FFT::fft2d(*channel, true, true, false);
+		}
+
+		rows.process< BlurTemplates::Abs<Complex> >();
+		if (cross) {
+			cols.process< BlurTemplates::Abs<Complex> >();
+			rows.split_items<Real>().reorder(0, 1, 2)
+				.process< std::plus<Real> >(
+					cols.split_items<Real>().reorder(0, 2, 1) );
+		}
+	}
+};
+
+} // end of anonimous namespace
+
 /* === M E T H O D S ======================================================= */
 
 bool
@@ -199,7 +473,7 @@ software::Blur::blur_pattern(const Params &params)
 		.set_dim(pattern_rows, 1);
 
 	// prepare surface (apply alpha)
-	BlurTemplates::surface_read(arr_src_surface, *params.src, VectorInt(0, 0), params.src_rect);
+	process_bands(ReadJob<ColorReal>(arr_src_surface, *params.src, params.src_rect), rows, (Real)rows*cols);
 
 	// alloc memory
 	switch(params.type)
@@ -252,54 +526,52 @@ software::Blur::blur_pattern(const Params &params)
 	}
 
 	// process
+	const Real pixels = (Real)rows*cols*channels;
 	if (full)
 	{
 		BlurTemplates::normalize_half_pattern_2d( arr_full_pattern );
-		for(Array<ColorReal, 3>::Iterator dst(arr_dst_surface.reorder(2, 0, 1)), src(arr_src_surface.reorder(2, 0, 1)); dst; ++dst, ++src)
-			BlurTemplates::blur_2d_pattern(*dst, *src, arr_full_pattern);
+		process_bands(
+			Pattern2DJob(arr_dst_surface, arr_src_surface, arr_full_pattern),
+			rows, pixels*pattern_rows*pattern_cols );
 	}
 	else
 	{
 		BlurTemplates::normalize_half_pattern( arr_row_pattern );
 		BlurTemplates::normalize_half_pattern( arr_col_pattern );
 
-		Array<ColorReal, 3> arr_src_surface_rows(arr_src_surface.reorder(2, 0, 1));
-		Array<ColorReal, 3> arr_src_surface_cols(arr_src_surface_rows.reorder(0, 2, 1));
-
-		Array<ColorReal, 3> arr_dst_surface_rows(arr_dst_surface.reorder(2, 0, 1));
-		Array<ColorReal, 3> arr_dst_surface_cols(arr_dst_surface_rows.reorder(0, 2, 1));
-
 		if (cross)
 		{
 			arr_row_pattern.process< std::multiplies<ColorReal> >(0.5);
 			arr_col_pattern.process< std::multiplies<ColorReal> >(0.5);
 		}
 
-		for(Array<ColorReal, 3>::Iterator src_channel(arr_src_surface_rows), dst_channel(arr_dst_surface_rows); dst_channel; ++src_channel, ++dst_channel)
-			for(Array<ColorReal, 2>::Iterator sr(*src_channel), dr(*dst_channel); dr; ++sr, ++dr)
-				BlurTemplates::blur_pattern(*dr, *sr, arr_row_pattern);
-
-		if (!cross)
+		// columns are processed as rows of transposed surface
+		ColorReal *src = &src_surface.front();
+		ColorReal *dst = &dst_surface.front();
+		const size_t bytes = sizeof(src_surface.front())*src_surface.size();
+		if (cross)
 		{
-			std::swap(arr_src_surface_cols.pointer, arr_dst_surface_cols.pointer);
-			std::swap(arr_src_surface.pointer, arr_dst_surface.pointer);
-			memset(&src_surface.front(), 0, sizeof(src_surface.front())*src_surface.size());
+			std::vector<ColorReal> transposed_surface(src_surface.size());
+			ColorReal *transposed = &transposed_surface.front();
+			TransposeJob(transposed, src, rows, cols).run();
+			process_bands(PatternRowsJob(dst, src, cols, arr_row_pattern), rows, pixels*pattern_cols);
+			memset(src, 0, bytes);
+			process_bands(PatternRowsJob(src, transposed, rows, arr_col_pattern), cols, pixels*pattern_rows);
+			TransposeJob(dst, src, cols, rows, true).run();
+		}
+		else
+		{
+			process_bands(PatternRowsJob(dst, src, cols, arr_row_pattern), rows, pixels*pattern_cols);
+			TransposeJob(src, dst, rows, cols).run();
+			memset(dst, 0, bytes);
+			process_bands(PatternRowsJob(dst, src, rows, arr_col_pattern), cols, pixels*pattern_rows);
+			TransposeJob(src, dst, cols, rows).run();
+			arr_dst_surface.pointer = src;
 		}
-
-		for(Array<ColorReal, 3>::Iterator src_channel(arr_src_surface_cols), dst_channel(arr_dst_surface_cols); dst_channel; ++src_channel, ++dst_channel)
-			for(Array<ColorReal, 2>::Iterator sr(*src_channel), dr(*dst_channel); dr; ++sr, ++dr)
-				BlurTemplates::blur_pattern(*dr, *sr, arr_row_pattern);
 	}
 
 	// copy result surface and restore alpha
-	BlurTemplates::surface_write(
-		*params.dest,
-		arr_dst_surface,
-		params.dest_rect,
-		params.src_offset - params.src_rect.get_min(),
-		params.blend,
-		params.blend_method,
-		params.amount );
+	process_bands(WriteJob<ColorReal>(params, arr_dst_surface), params.dest_rect.get_height(), (Real)rows*cols);
 }
 
 void
@@ -338,7 +610,10 @@ software::Blur::blur_fft(const Params &params)
 		.set_dim(2, 1);
 
 	// convert surface to complex
-	BlurTemplates::surface_read(arr_surface.reorder(0, 1, 2), *params.src, VectorInt(0, 0), params.src_rect);
+	const Array<Real, 3> arr_surface_real(arr_surface.reorder(0, 1, 2));
+	process_bands(
+		ReadJob<Real>(arr_surface_real, *params.src, params.src_rect),
+		params.src_rect.get_height(), (Real)params.src_rect.get_width()*params.src_rect.get_height() );
 
 	// alloc memory
 	switch(params.type)
@@ -391,18 +666,20 @@ software::Blur::blur_fft(const Params &params)
 	}
 
 	// process
+	Array<Complex, 3> arr_surface_rows(arr_surface.group_items<Complex>().reorder(2, 0, 1));
+	Array<Complex, 3> arr_surface_cols(arr_surface_rows.reorder(0, 2, 1));
+	FFTChannelsJob job(arr_surface_rows, arr_surface_cols);
+	const Real cost = (Real)rows*cols*channels*(log2_ceil(rows) + log2_ceil(cols));
+
 	if (full)
 	{
 		BlurTemplates::mirror_pattern_2d( arr_full_pattern.reorder(0, 1) );
 		BlurTemplates::normalize_full_pattern_2d( arr_full_pattern.reorder(0, 1) );
 
-		FFT::fft2d(arr_full_pattern.group_items<Complex>(), false);
-		for(Array<Complex, 3>::Iterator channel(arr_surface.group_items<Complex>().reorder(2, 0, 1)); channel; ++channel)
-		{
-			FFT::fft2d(*channel, false);
-			channel->process< std::multiplies<Complex> >(arr_full_pattern.group_items<Complex>());
-			FFT::fft2d(*channel, true);
-		}
+		const Array<Complex, 2> arr_full_pattern_complex(arr_full_pattern.group_items<Complex>());
+		FFT::fft2d(arr_full_pattern_complex, false);
+		job.full_pattern = &arr_full_pattern_complex;
+		process_bands(job, channels, cost);
 	}
 	else
 	{
@@ -412,9 +689,6 @@ software::Blur::blur_fft(const Params &params)
 		BlurTemplates::normalize_full_pattern( arr_col_pattern.reorder(0) );
 
 		std::vector<Complex> surface_copy;
-		Array<Complex, 3> arr_surface_rows(arr_surface.group_items<Complex>().reorder(2, 0, 1));
-		Array<Complex, 3> arr_surface_cols(arr_surface_rows.reorder(0, 2, 1));
-
 		if (cross)
 		{
 			arr_row_pattern.reorder(0).process< std::multiplies<Real> >(0.5);
@@ -423,61 +697,29 @@ software::Blur::blur_fft(const Params &params)
 			arr_surface_cols.pointer = &surface_copy.front();
 		}
 
-		FFT::fft(arr_row_pattern.group_items<Complex>(), false);
-		for(Array<Complex, 3>::Iterator channel(arr_surface_rows); channel; ++channel)
-		{
-			FFT::fft2d(*channel, false, true, false);
-			for(Array<Complex, 2>::Iterator r(*channel); r; ++r)
-				r->process< std::multiplies<Complex> >(arr_row_pattern.group_items<Complex>());
-			FFT::fft2d(*channel, true, true, false);
-		}
-
-		FFT::fft(arr_col_pattern.group_items<Complex>(), false);
-		for(Array<Complex, 3>::Iterator channel(arr_surface_cols); channel; ++channel)
-		{
-			FFT::fft2d(*channel, false, true, false);
-			for(Array<Complex, 2>::Iterator c(*channel); c; ++c)
-				c->process< std::multiplies<Complex> >(arr_col_pattern.group_items<Complex>());
-			FFT::fft2d(*channel, true, true, false);
-		}
-
-		arr_surface_rows.process< BlurTemplates::Abs<Complex> >();
-		if (cross)
-		{
-			arr_surface_cols.process< BlurTemplates::Abs<Complex> >();
-			arr_surface_rows.split_items<Real>().reorder(0, 1, 2)
-				.process< std::plus<Real> >(
-					arr_surface_cols.split_items<Real>().reorder(0, 2, 1) );
-		}
+		const Array<Complex, 1> arr_row_pattern_complex(arr_row_pattern.group_items<Complex>());
+		const Array<Complex, 1> arr_col_pattern_complex(arr_col_pattern.group_items<Complex>());
+		FFT::fft(arr_row_pattern_complex, false);
+		FFT::fft(arr_col_pattern_complex, false);
+		job.row_pattern = &arr_row_pattern_complex;
+		job.col_pattern = &arr_col_pattern_complex;
+		job.cross = cross;
+		process_bands(job, channels, cost);
 	}
 
 	// convert surface from complex to color
-	BlurTemplates::surface_write(
-		*params.dest,
-		arr_surface.reorder(0, 1, 2),
-		params.dest_rect,
-		params.src_offset - params.src_rect.get_min(),
-		params.blend,
-		params.blend_method,
-		params.amount );
+	process_bands(
+		WriteJob<Real>(params, arr_surface_real),
+		params.dest_rect.get_height(), (Real)params.src_rect.get_width()*params.src_rect.get_height() );
 }
 
 void
 software::Blur::blur_box(const Params &params)
 {
-	const Real precision(1e-5);
 	const int channels = 4;
 	int rows = params.src_rect.get_size()[1];
 	int cols = params.src_rect.get_size()[0];
 
-	std::vector<ColorReal> surface(rows*cols*channels);
-	Array<ColorReal, 3> arr_surface(&surface.front());
-	arr_surface
-		.set_dim(rows, cols*channels)
-		.set_dim(cols, channels)
-		.set_dim(channels, 1);
-	BlurTemplates::surface_read(arr_surface, *params.src, VectorInt(0, 0), params.src_rect);
-
 	Vector size = params.amplified_size;
 	bool cross = false;
 	bool count = 1;
@@ -498,53 +740,31 @@ software::Blur::blur_box(const Params &params)
 		return;
 	}
 
-	std::deque<ColorReal> q;
-	std::vector<ColorReal> surface_copy;
-	Array<ColorReal, 3> arr_surface_rows(arr_surface.reorder(2, 0, 1));
-	Array<ColorReal, 3> arr_surface_cols(arr_surface_rows.reorder(0, 2, 1));
-
-	if (cross)
-	{
-		arr_surface.process< std::multiplies<ColorReal> >(0.5);
-		surface_copy = surface;
-		arr_surface_cols.pointer = &surface_copy.front();
-	}
-
-	if (true || fabs(size[0] - round(size[0])) < precision)
-		for(Array<ColorReal, 3>::Iterator channel(arr_surface_rows); channel; ++channel)
-			for(Array<ColorReal, 2>::Iterator r(*channel); r; ++r)
-				for(int i = 0; i < count; ++i)
-					BlurTemplates::blur_box_discrete(*r, q, (int)round(size[0]));
-	else
-		for(Array<ColorReal, 3>::Iterator channel(arr_surface_rows); channel; ++channel)
-			for(Array<ColorReal, 2>::Iterator r(*channel); r; ++r)
-				for(int i = 0; i < count; ++i)
-					BlurTemplates::blur_box_aa(*r, q, (ColorReal)size[0]);
-
-	if (true || fabs(size[1] - round(size[1])) < precision)
-		for(Array<ColorReal, 3>::Iterator channel(arr_surface_cols); channel; ++channel)
-			for(Array<ColorReal, 2>::Iterator c(*channel); c; ++c)
-				for(int i = 0; i < count; ++i)
-					BlurTemplates::blur_box_discrete(*c, q, (int)round(size[1]));
-	else
-		for(Array<ColorReal, 3>::Iterator channel(arr_surface_cols); channel; ++channel)
-			for(Array<ColorReal, 2>::Iterator c(*channel); c; ++c)
-				for(int i = 0; i < count; ++i)
-					BlurTemplates::blur_box_aa(*c, q, (ColorReal)size[1]);
-
+	std::vector<ColorReal> surface(rows*cols*channels);
+	Array<ColorReal, 3> arr_surface(&surface.front());
+	arr_surface
+		.set_dim(rows, cols*channels)
+		.set_dim(cols, channels)
+		.set_dim(channels, 1);
+	process_bands(
+		ReadJob<ColorReal>(arr_surface, *params.src, params.src_rect, cross ? 0.5 : 1.0),
+		rows, (Real)rows*cols );
+
+	// columns are processed as rows of transposed surface,
+	// cross blur makes both passes from the source and sums them
+	const Real cost = (Real)rows*cols*channels*count;
+	std::vector<ColorReal> transposed_surface(surface.size());
+	ColorReal *data = &surface.front();
+	ColorReal *transposed = &transposed_surface.front();
 	if (cross)
-		arr_surface_rows
-			.process< std::plus<ColorReal> >(
-				arr_surface_cols.reorder(0, 2, 1) );
-
-	BlurTemplates::surface_write(
-		*params.dest,
-		arr_surface,
-		params.dest_rect,
-		params.src_offset - params.src_rect.get_min(),
-		params.blend,
-		params.blend_method,
-		params.amount );
+		TransposeJob(transposed, data, rows, cols).run();
+	process_bands(BoxRowsJob(data, cols, (int)round(size[0]), count), rows, cost);
+	if (!cross)
+		TransposeJob(transposed, data, rows, cols).run();
+	process_bands(BoxRowsJob(transposed, rows, (int)round(size[1]), count), cols, cost);
+	TransposeJob(data, transposed, cols, rows, cross).run();
+
+	process_bands(WriteJob<ColorReal>(params, arr_surface), params.dest_rect.get_height(), (Real)rows*cols);
 }
 /*
 software::Blur::IIRCoefficients
@@ -711,33 +931,96 @@ software::Blur::blur_iir(const Params &params)
 		params.amount );
 }*/
 
-void
-software::Blur::blur(Params params)
+int
+software::Blur::get_threads_count()
 {
-	if (!params.validate()) return;
+	if (max_threads == 1)
+		return 1;
+	int threads = std::max(1, ThreadPool::instance().get_max_threads());
+	return max_threads > 0 ? std::min(max_threads, threads) : threads;
+}
 
-	if ( params.type == rendering::Blur::BOX
-	  || params.type == rendering::Blur::CROSS )
-		{ blur_box(params); return; }
+Real
+software::Blur::estimate_cost(Algorithm algorithm, const Params &params)
+{
+	// buffers are zeroed in the calling thread, the rest is split between threads
+	const int channels = 4;
+	const Real pixels = (Real)params.src_rect.get_width()*params.src_rect.get_height();
+	const Real threads = get_threads_count();
+	const bool full = params.type == rendering::Blur::DISC;
+	const bool cross = params.type == rendering::Blur::CROSS;
+	const Real read_write = pixels*cost_read_write/threads;
 
-	if ( params.type == rendering::Blur::DISC
-      && fabs(params.extra_size[0]) < 8
-      && fabs(params.extra_size[1]) < 8 )
-		{ blur_pattern(params); return; }
+	switch(algorithm)
+	{
+	case ALGORITHM_BOX:
+		if ( params.type != rendering::Blur::BOX
+		  && params.type != rendering::Blur::CROSS
+		  && params.type != rendering::Blur::FASTGAUSSIAN )
+			return -1.0;
+		return read_write
+			 + pixels*2*cost_buffer
+			 + pixels*(2*channels*cost_box + 2*cost_transpose)/threads;
+	case ALGORITHM_PATTERN:
+	{
+		const Real pattern_rows = params.extra_size[1] + 1;
+		const Real pattern_cols = params.extra_size[0] + 1;
+		if (full)
+			return read_write
+				 + pixels*2*cost_buffer
+				 + pixels*channels*(cost_pattern_2d + pattern_rows*pattern_cols*cost_tap_2d)/threads;
+		return read_write
+			 + pixels*(cross ? 3 : 2)*cost_buffer
+			 + pixels*(channels*(pattern_rows + pattern_cols)*cost_tap + 2*cost_transpose)/threads;
+	}
+	case ALGORITHM_FFT:
+	{
+		// complex buffers are twice larger, channels are split between threads
+		const int fft_rows = FFT::get_valid_count(params.src_rect.get_height());
+		const int fft_cols = FFT::get_valid_count(params.src_rect.get_width());
+		const Real fft_pixels = (Real)fft_rows*fft_cols;
+		const Real fft_threads = std::min(threads, (Real)channels);
+		return read_write
+			 + fft_pixels*(cross ? 4 : 2)*cost_buffer
+			 + fft_pixels*channels*( 2*(log2_ceil(fft_rows) + log2_ceil(fft_cols))*cost_fft
+			                       + cost_fft_item )/fft_threads;
+	}
+	default:
+		break;
+	}
+	return -1.0;
+}
 
-	if ( params.type == rendering::Blur::DISC
-      && (params.extra_size[0] + 1)*(params.extra_size[1] + 1) < 64.0 )
-		{ blur_pattern(params); return; }
+software::Blur::Algorithm
+software::Blur::choose_algorithm(const Params &params)
+{
+	// box blur is exact for its own types only, so it's always the choice for them
+	if (estimate_cost(ALGORITHM_BOX, params) >= 0.0)
+		return ALGORITHM_BOX;
+	return estimate_cost(ALGORITHM_PATTERN, params) <= estimate_cost(ALGORITHM_FFT, params)
+		 ? ALGORITHM_PATTERN : ALGORITHM_FFT;
+}
 
-	if ( params.type == rendering::Blur::GAUSSIAN
-	  && params.extra_size[0] < 32
-	  && params.extra_size[1] < 32 )
-		{ blur_pattern(params); return; }
+void
+software::Blur::blur(Params params, Algorithm algorithm)
+{
+	if (!params.validate()) return;
 
-	if ( params.type == rendering::Blur::FASTGAUSSIAN )
-		{ blur_box(params); return; }
+	if (algorithm == ALGORITHM_AUTO || estimate_cost(algorithm, params) < 0.0)
+		algorithm = choose_algorithm(params);
 
-	blur_fft(params);
+	switch(algorithm)
+	{
+	case ALGORITHM_BOX:
+		blur_box(params);
+		break;
+	case ALGORITHM_PATTERN:
+		blur_pattern(params);
+		break;
+	default:
+		blur_fft(params);
+		break;
+	}
 }
 
 /* === E N T R Y P O I N T ================================================= */
@@ -30,6 +30,7 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <algorithm>
 #include <vector>
 
 #include "../../primitive/blur.h"
@@ -54,6 +55,15 @@ namespace software
 class Blur
 {
 public:
+	//! Implementations of blur, see choose_algorithm()
+	enum Algorithm
+	{
+		ALGORITHM_AUTO,    //!< choose by estimate_cost()
+		ALGORITHM_BOX,     //!< running sums, for box, cross and fast gaussian blur
+		ALGORITHM_PATTERN, //!< convolution with pattern, separable or 2D (disc)
+		ALGORITHM_FFT      //!< convolution by Fourier transform
+	};
+
 	class Params {
 	public:
 		synfig::Surface *dest;
@@ -114,6 +124,9 @@ private:
 	static constexpr Real iir_max_radius = 2048.0;
 	static constexpr Real iir_radius_step = 0.1;
 
+	//! count of threads used by blur, 0 means all threads of ThreadPool
+	static int max_threads;
+
 	static IIRCoefficients get_iir_coefficients(Real radius);
 
 	//! Simple blur by pattern
@@ -129,8 +142,19 @@ private:
 	static void blur_iir(const Params &params);
 
 public:
+	static int get_max_threads() { return max_threads; }
+	static void set_max_threads(int x) { max_threads = std::max(0, x); }
+	//! count of threads which will be really used by blur
+	static int get_threads_count();
+
+	//! Estimated time of blur in seconds for validated \a params,
+	//! negative when \a algorithm can not make this type of blur
+	static Real estimate_cost(Algorithm algorithm, const Params &params);
+	//! The fastest algorithm for validated \a params
+	static Algorithm choose_algorithm(const Params &params);
+
 	//! Generic blur function
-	static void blur(Params params);
+	static void blur(Params params, Algorithm algorithm = ALGORITHM_AUTO);
 };
 
 } /* end namespace software */
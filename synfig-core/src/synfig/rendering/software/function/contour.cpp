@@ -32,6 +32,9 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+#include <vector>
+
 #include "contour.h"
 
 #include <synfig/debug/debugsurface.h>
@@ -49,235 +52,155 @@ using namespace rendering;
 
 /* === M E T H O D S ======================================================= */
 
+namespace {
+
+//! Writes runs to the surface: solid runs are filled or blended as a whole row,
+//! partially covered runs are blended with per-pixel coverage
+class SurfaceSpanWriter: public software::Contour::SpanConsumer
+{
+public:
+	synfig::Surface &surface;
+	const Color color;
+	const Color::value_type opacity;
+	const Color::BlendMethod blend_method;
+	const bool simple_fill;
+	std::vector<Color> colors;
+
+	SurfaceSpanWriter(
+		synfig::Surface &surface,
+		const Color &color,
+		Color::value_type opacity,
+		Color::BlendMethod blend_method
+	):
+		surface(surface),
+		color(color),
+		opacity(opacity),
+		blend_method(blend_method),
+		simple_fill( (Color::BLEND_METHODS_OVERWRITE_ON_ALPHA_ONE & (1 << blend_method))
+				  && fabsf(1.f - opacity*color.get_a()) <= 1e-6 )
+	{ }
+
+	virtual void fill(int y, int x, int length)
+	{
+		Color *dest = &surface[y][x];
+		if (simple_fill) {
+			std::fill(dest, dest + length, color);
+		} else {
+			if ((int)colors.size() < length)
+				colors.resize(length, color);
+			Color::blend_span(dest, &colors.front(), length, opacity, blend_method);
+		}
+	}
+
+	virtual void blend(int y, int x, int length, const Color::value_type *coverage)
+		{ Color::blend_coverage_span(&surface[y][x], color, coverage, length, opacity, blend_method); }
+};
+
+} // end of anonimous namespace
+
 void
-software::Contour::render_polyspan(
-	synfig::Surface &target_surface,
+software::Contour::render_spans(
+	SpanConsumer &consumer,
 	const Polyspan &polyspan,
 	bool invert,
 	bool antialias,
-	rendering::Contour::WindingStyle winding_style,
-	const Color &color,
-	Color::value_type opacity,
-	Color::BlendMethod blend_method )
+	rendering::Contour::WindingStyle winding_style )
 {
-	bool simple_fill = (Color::BLEND_METHODS_OVERWRITE_ON_ALPHA_ONE & (1 << blend_method))
-			        && fabsf(1.f - opacity*color.get_a()) <= 1e-6;
-
-	synfig::Surface::alpha_pen p(target_surface.begin(), opacity, blend_method);
-	synfig::Surface::pen sp(target_surface.begin());
 	const RectInt &window = polyspan.get_window();
 	const Polyspan::cover_array &covers = polyspan.get_covers();
-
-	Polyspan::cover_array::const_iterator cur_mark = covers.begin();
-	Polyspan::cover_array::const_iterator end_mark = covers.end();
-
-	Real cover = 0, area = 0, alpha = 0;
-	int	y = 0, x = 0;
-
-	p.set_value(color);
-	sp.set_value(color);
-	cover = 0;
-
-	if (cur_mark == end_mark)
-	{
-		// no marks at all
-		if (invert)
-		{
-			if (simple_fill)
-			{
-				sp.move_to(window.minx, window.miny);
-				sp.put_block(window.maxy - window.miny, window.maxx - window.minx);
-			}
-			else
-			{
-				p.move_to(window.minx, window.miny);
-				p.put_block(window.maxy - window.miny, window.maxx - window.minx);
-			}
-		}
+	if (window.maxx <= window.minx || window.maxy <= window.miny)
 		return;
-	}
-
-	// fill initial rect / line
-	if (invert)
-	{
-		if (simple_fill)
-		{
-			// fill all the area above the first vertex
-			sp.move_to(window.minx, window.miny);
-			y = window.miny;
-			int l = window.maxx - window.minx;
-
-			sp.put_block(cur_mark->y - window.miny, l);
-
-			// fill the area to the left of the first vertex on that line
-			l = cur_mark->x - window.minx;
-			sp.move_to(window.minx, cur_mark->y);
-			if (l) sp.put_hline(l);
-		}
-		else
-		{
-			// fill all the area above the first vertex
-			p.move_to(window.minx, window.miny);
-			y = window.miny;
-			int l = window.maxx - window.minx;
 
-			p.put_block(cur_mark->y - window.miny, l);
-
-			// fill the area to the left of the first vertex on that line
-			l = cur_mark->x - window.minx;
-			p.move_to(window.minx, cur_mark->y);
-			if (l) p.put_hline(l);
-		}
-	}
+	// partially covered pixels of current run
+	std::vector<Color::value_type> coverage;
+	int coverage_x = 0;
 
+	Polyspan::cover_array::const_iterator mark = covers.begin();
+	int y = window.miny;
 	while(true)
 	{
-		y = cur_mark->y;
-		x = cur_mark->x;
-
-		p.move_to(x,y);
-
-		area = cur_mark->area;
-		cover += cur_mark->cover;
-
-		// accumulate for the current pixel
-		while(++cur_mark != covers.end())
-		{
-			if (y != cur_mark->y || x != cur_mark->x)
-				break;
+		const int row = mark == covers.end() ? window.maxy : std::min(mark->y, window.maxy);
 
-			area += cur_mark->area;
-			cover += cur_mark->cover;
-		}
+		// rows without marks
+		if (invert)
+			for(; y < row; ++y)
+				consumer.fill(y, window.minx, window.maxx - window.minx);
+		if (mark == covers.end())
+			break;
 
-		// draw pixel - based on covered area
-		if (area) // if we're ok, draw the current pixel
+		// marks out of window could not be drawn
+		if (row < window.miny || mark->y >= window.maxy)
 		{
-			alpha = polyspan.extract_alpha(cover - area, winding_style);
-			if (invert) alpha = 1 - alpha;
-
-			if (antialias)
-			{
-				if (alpha) p.put_value_alpha(alpha);
-			}
-			else
-			{
-				if (alpha >= .5) p.put_value();
-			}
-
-			p.inc_x();
-			++x;
+			for(const int my = mark->y; mark != covers.end() && mark->y == my; ++mark) { }
+			continue;
 		}
 
-		// if we're done, don't use iterator and exit
-		if (cur_mark == end_mark) break;
-
-		// if there is no more live pixels on this line, goto next
-		if (y != cur_mark->y)
+		Real cover = 0;
+		int x = window.minx;
+		coverage.clear();
+		while(mark != covers.end() && mark->y == row)
 		{
-			if (invert)
+			// span to the next pixel, based on total amount of cover
+			const int next_x = std::min(std::max(mark->x, window.minx), window.maxx);
+			if (x < next_x)
 			{
-				// fill the area at the end of the line
-				if (simple_fill)
+				if (!coverage.empty())
 				{
-					sp.move_to(p);
-					sp.put_hline(window.maxx - x);
-				}
-				else
-				{
-					p.put_hline(window.maxx - x);
-				}
-
-				// fill any empty line until next mark
-				if (++y != cur_mark->y)
-				{
-					if (simple_fill)
-					{
-						sp.move_to(window.minx, y);
-						sp.put_block(cur_mark->y - y, window.maxx - window.minx);
-					}
-					else
-					{
-						p.move_to(window.minx, y);
-						p.put_block(cur_mark->y - y, window.maxx - window.minx);
-					}
+					consumer.blend(row, coverage_x, (int)coverage.size(), &coverage.front());
+					coverage.clear();
 				}
 
-				// fill area at the beginning of the next line
-				if (simple_fill)
-				{
-					sp.move_to(window.minx, cur_mark->y);
-					sp.put_hline(cur_mark->x - window.minx);
-				}
-				else
-				{
-					p.move_to(window.minx, cur_mark->y);
-					p.put_hline(cur_mark->x - window.minx);
-				}
+				Real alpha = polyspan.extract_alpha(cover, winding_style);
+				if (invert) alpha = 1 - alpha;
+				if (alpha >= .5)
+					consumer.fill(row, x, next_x - x);
+				x = next_x;
 			}
 
-			cover = 0;
-			continue;
-		}
+			// accumulate for the current pixel
+			const int cell_x = mark->x;
+			Real area = 0;
+			for(; mark != covers.end() && mark->y == row && mark->x == cell_x; ++mark)
+				{ area += mark->area; cover += mark->cover; }
 
-		// draw span to next pixel - based on total amount of pixel cover
-		if (x < cur_mark->x)
-		{
-			alpha = polyspan.extract_alpha(cover, winding_style);
-			if (invert) alpha = 1 - alpha;
-			if (alpha >= .5)
+			// the current pixel, based on covered area
+			if (area && cell_x >= window.minx && cell_x < window.maxx)
 			{
-				if (simple_fill)
-				{
-					sp.move_to(p);
-					sp.put_hline(cur_mark->x - x);
-					p.move_to(sp);
-				}
-				else
-				{
-					p.put_hline(cur_mark->x - x);
-				}
-			}
+				Real alpha = polyspan.extract_alpha(cover - area, winding_style);
+				if (invert) alpha = 1 - alpha;
+				if (!antialias) alpha = alpha >= .5 ? 1 : 0;
 
-			/*
-			if (antialias)
-			{
-				if (alpha) p.put_hline(cur_mark->x - x, alpha);
+				if (coverage.empty()) coverage_x = cell_x;
+				coverage.push_back((Color::value_type)alpha);
+				x = cell_x + 1;
 			}
-			else
-			{
-				if (alpha >= .5) p.put_hline(cur_mark->x - x);
-			}
-			*/
 		}
-	}
-
-	// fill the after stuff
-	if (invert)
-	{
-		if (simple_fill)
-		{
-			sp.move_to(p);
 
-			//fill the area at the end of the line
-			sp.put_hline(window.maxx - x);
+		if (!coverage.empty())
+			consumer.blend(row, coverage_x, (int)coverage.size(), &coverage.front());
 
-			//fill area at the beginning of the next line
-			sp.move_to(window.minx, y+1);
-			sp.put_block(window.maxy - y - 1, window.maxx - window.minx);
-		}
-		else
-		{
-			//fill the area at the end of the line
-			p.put_hline(window.maxx - x);
-
-			//fill area at the beginning of the next line
-			p.move_to(window.minx, y+1);
-			p.put_block(window.maxy - y - 1, window.maxx - window.minx);
-		}
+		// the area at the end of the line
+		if (invert && x < window.maxx)
+			consumer.fill(row, x, window.maxx - x);
+		y = row + 1;
 	}
 }
 
+void
+software::Contour::render_polyspan(
+	synfig::Surface &target_surface,
+	const Polyspan &polyspan,
+	bool invert,
+	bool antialias,
+	rendering::Contour::WindingStyle winding_style,
+	const Color &color,
+	Color::value_type opacity,
+	Color::BlendMethod blend_method )
+{
+	SurfaceSpanWriter writer(target_surface, color, opacity, blend_method);
+	render_spans(writer, polyspan, invert, antialias, winding_style);
+}
+
 void
 software::Contour::build_polyspan(
 	const rendering::Contour::ChunkList &chunks,
@@ -51,6 +51,26 @@ namespace software
 class Contour
 {
 public:
+	//! Receives rasterized rows of polyspan, see render_spans()
+	class SpanConsumer
+	{
+	public:
+		virtual ~SpanConsumer() { }
+		//! pixels [x, x + length) of row y are fully covered
+		virtual void fill(int y, int x, int length) = 0;
+		//! pixels [x, x + length) of row y are partially covered, coverage is in range [0, 1]
+		virtual void blend(int y, int x, int length, const Color::value_type *coverage) = 0;
+	};
+
+	//! Sweeps sorted polyspan and passes runs of pixels to \a consumer,
+	//! runs are clipped by the window of polyspan
+	static void render_spans(
+		SpanConsumer &consumer,
+		const Polyspan &polyspan,
+		bool invert,
+		bool antialias,
+		rendering::Contour::WindingStyle winding_style );
+
 	static void render_polyspan(
 		synfig::Surface &target_surface,
 		const Polyspan &polyspan,
@@ -38,11 +38,15 @@
 
 #include <mutex>
 
+#include <algorithm>
+#include <map>
 #include <vector>
 #include <set>
 
 #include <fftw3.h>
 
+#include <synfig/general.h>
+
 #include "fft.h"
 
 #endif
@@ -61,12 +65,133 @@ using namespace rendering;
 class software::FFT::Internal
 {
 public:
+	//! Layout of complex transform: plans are reusable for arrays with the same dimensions,
+	//! strides and alignment, see fftw_execute_dft()
+	class Key
+	{
+	public:
+		enum { max_dims = 2, size = 5 + 3*max_dims };
+		int values[size];
+
+		Key(const fftw_iodim *dims, int rank, const fftw_iodim *howmany, int howmany_rank, int sign, int alignment, Planning planning)
+		{
+			assert(rank + howmany_rank <= max_dims);
+			std::fill(values, values + size, 0);
+			int *v = values;
+			*v++ = rank;
+			*v++ = howmany_rank;
+			*v++ = sign;
+			*v++ = alignment;
+			*v++ = (int)planning;
+			for(int i = 0; i < rank; ++i)
+				{ *v++ = dims[i].n; *v++ = dims[i].is; *v++ = dims[i].os; }
+			for(int i = 0; i < howmany_rank; ++i)
+				{ *v++ = howmany[i].n; *v++ = howmany[i].is; *v++ = howmany[i].os; }
+		}
+
+		bool operator<(const Key &other) const
+			{ return std::lexicographical_compare(values, values + size, other.values, other.values + size); }
+	};
+
+	typedef std::map<Key, fftw_plan> PlanMap;
+
+	//! plans are never evicted, because other threads may use them without lock
+	static const size_t max_plans = 256;
+	//! limit of planning time of single plan in PLANNING_MEASURE mode, in seconds
+	static constexpr double measure_time_limit = 10.0;
+
 	static std::set<int> counts;
+
+	//! guards FFTW planner (it's not thread-safe) and the fields below
 	static std::mutex mutex;
+	static PlanMap plans;
+	static Planning planning;
+	static String wisdom_filename;
+	static bool wisdom_changed;
+	static Stats stats;
+
+	static fftw_plan create_plan(
+		const fftw_iodim *dims, int rank,
+		const fftw_iodim *howmany, int howmany_rank,
+		Complex *data, int sign, int alignment )
+	{
+		if (planning != PLANNING_MEASURE) {
+			// FFTW_ESTIMATE doesn't touch the arrays
+			fftw_set_timelimit(0.0);
+			return fftw_plan_guru_dft(
+				rank, dims, howmany_rank, howmany,
+				(fftw_complex*)data, (fftw_complex*)data,
+				sign, FFTW_ESTIMATE );
+		}
+
+		// measuring overwrites the arrays, so plan on scratch buffer with the same alignment
+		size_t span = 1;
+		for(int i = 0; i < rank; ++i)
+			span += (size_t)(dims[i].n - 1)*std::abs(dims[i].is);
+		for(int i = 0; i < howmany_rank; ++i)
+			span += (size_t)(howmany[i].n - 1)*std::abs(howmany[i].is);
+		char *buffer = (char*)fftw_malloc(span*sizeof(fftw_complex) + alignment);
+		if (!buffer)
+			return NULL;
+		fftw_complex *scratch = (fftw_complex*)(buffer + alignment);
+
+		fftw_set_timelimit(measure_time_limit);
+		fftw_plan plan = fftw_plan_guru_dft(
+			rank, dims, howmany_rank, howmany,
+			scratch, scratch, sign, FFTW_MEASURE );
+		fftw_free(buffer);
+		wisdom_changed = true;
+		return plan;
+	}
+
+	static void execute(
+		const fftw_iodim *dims, int rank,
+		const fftw_iodim *howmany, int howmany_rank,
+		Complex *data, bool invert )
+	{
+		const int sign = invert ? FFTW_BACKWARD : FFTW_FORWARD;
+		const int alignment = fftw_alignment_of((double*)data);
+
+		fftw_plan plan = NULL;
+		bool cached = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			const Key key(dims, rank, howmany, howmany_rank, sign, alignment, planning);
+			PlanMap::const_iterator i = plans.find(key);
+			if (i != plans.end()) {
+				plan = i->second;
+				cached = true;
+				++stats.reuses;
+			} else {
+				plan = create_plan(dims, rank, howmany, howmany_rank, data, sign, alignment);
+				if (!plan) return;
+				++stats.plans;
+				if (plans.size() < max_plans) {
+					plans[key] = plan;
+					cached = true;
+				} else {
+					++stats.uncached;
+				}
+			}
+		}
+
+		// execution of plan is thread-safe
+		fftw_execute_dft(plan, (fftw_complex*)data, (fftw_complex*)data);
+
+		if (!cached) {
+			std::lock_guard<std::mutex> lock(mutex);
+			fftw_destroy_plan(plan);
+		}
+	}
 };
 
 std::set<int> software::FFT::Internal::counts;
 std::mutex software::FFT::Internal::mutex;
+software::FFT::Internal::PlanMap software::FFT::Internal::plans;
+software::FFT::Planning software::FFT::Internal::planning = software::FFT::PLANNING_ESTIMATE;
+String software::FFT::Internal::wisdom_filename;
+bool software::FFT::Internal::wisdom_changed = false;
+software::FFT::Stats software::FFT::Internal::stats;
 
 void
 software::FFT::initialize()
@@ -80,15 +205,65 @@ software::FFT::initialize()
 			for(int c5 = c3; c5 < max5; c5 *= 5)
 				for(int c7 = c5; c7 < max7; c7 *= 7)
 					Internal::counts.insert(c7);
+
+	std::lock_guard<std::mutex> lock(Internal::mutex);
 	fftw_set_timelimit(0.0);
+	if (!Internal::wisdom_filename.empty())
+		if (!fftw_import_wisdom_from_filename(Internal::wisdom_filename.c_str()))
+			info("FFT: no wisdom loaded from %s", Internal::wisdom_filename.c_str());
+	Internal::wisdom_changed = false;
 }
 
 void
 software::FFT::deinitialize()
 {
+	std::lock_guard<std::mutex> lock(Internal::mutex);
+	if (!Internal::wisdom_filename.empty() && Internal::wisdom_changed)
+		if (!fftw_export_wisdom_to_filename(Internal::wisdom_filename.c_str()))
+			warning("FFT: cannot save wisdom to %s", Internal::wisdom_filename.c_str());
+	Internal::wisdom_changed = false;
+
+	for(Internal::PlanMap::const_iterator i = Internal::plans.begin(); i != Internal::plans.end(); ++i)
+		fftw_destroy_plan(i->second);
+	Internal::plans.clear();
 	Internal::counts.clear();
 }
 
+software::FFT::Planning
+software::FFT::get_planning()
+{
+	std::lock_guard<std::mutex> lock(Internal::mutex);
+	return Internal::planning;
+}
+
+void
+software::FFT::set_planning(Planning x)
+{
+	std::lock_guard<std::mutex> lock(Internal::mutex);
+	Internal::planning = x;
+}
+
+String
+software::FFT::get_wisdom_filename()
+{
+	std::lock_guard<std::mutex> lock(Internal::mutex);
+	return Internal::wisdom_filename;
+}
+
+void
+software::FFT::set_wisdom_filename(const String &x)
+{
+	std::lock_guard<std::mutex> lock(Internal::mutex);
+	Internal::wisdom_filename = x;
+}
+
+software::FFT::Stats
+software::FFT::get_stats()
+{
+	std::lock_guard<std::mutex> lock(Internal::mutex);
+	return Internal::stats;
+}
+
 int
 software::FFT::get_valid_count(int x)
 {
@@ -120,15 +295,7 @@ software::FFT::fft(const Array<Complex, 1> &x, bool invert)
 	iodim.is = x.stride;
 	iodim.os = x.stride;
 
-	{
-		std::lock_guard<std::mutex> lock(Internal::mutex);
-		fftw_plan plan = fftw_plan_guru_dft(
-			1, &iodim, 0, NULL,
-			(fftw_complex*)x.pointer, (fftw_complex*)x.pointer,
-			invert ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE );
-		fftw_execute(plan);
-		fftw_destroy_plan(plan);
-	}
+	Internal::execute(&iodim, 1, NULL, 0, x.pointer, invert);
 
 	// divide by count to complete back-FFT
 	if (invert)
@@ -155,27 +322,10 @@ software::FFT::fft2d(const Array<Complex, 2> &x, bool invert, bool do_rows, bool
 	iodim[1].is = x.stride;
 	iodim[1].os = x.stride;
 
-	{
-		std::lock_guard<std::mutex> lock(Internal::mutex);
-
-		fftw_plan plan;
-		if (do_rows && do_cols)
-		{
-			plan = fftw_plan_guru_dft(
-				2, iodim, 0, NULL,
-				(fftw_complex*)x.pointer, (fftw_complex*)x.pointer,
-				invert ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE );
-		}
-		else
-		{
-			plan = fftw_plan_guru_dft(
-				1, &iodim[do_rows ? 0 : 1], 1, &iodim[do_rows ? 1 : 0],
-				(fftw_complex*)x.pointer, (fftw_complex*)x.pointer,
-				invert ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE );
-		}
-		fftw_execute(plan);
-		fftw_destroy_plan(plan);
-	}
+	if (do_rows && do_cols)
+		Internal::execute(iodim, 2, NULL, 0, x.pointer, invert);
+	else
+		Internal::execute(&iodim[do_rows ? 0 : 1], 1, &iodim[do_rows ? 1 : 0], 1, x.pointer, invert);
 
 	// divide by count to complete back-FFT
 	if (invert)
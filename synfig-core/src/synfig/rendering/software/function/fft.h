@@ -32,6 +32,7 @@
 
 #include "array.h"
 #include <synfig/complex.h>
+#include <synfig/string.h>
 
 /* === M A C R O S ========================================================= */
 
@@ -48,6 +49,23 @@ namespace software
 
 class FFT
 {
+public:
+	//! How FFTW searches the best plan of transform
+	enum Planning
+	{
+		PLANNING_ESTIMATE, //!< by heuristics, fast
+		PLANNING_MEASURE   //!< by measuring of real transforms, slow at start, for long batch renders
+	};
+
+	struct Stats
+	{
+		long long plans;    //!< count of created plans
+		long long reuses;   //!< count of transforms made by cached plans
+		long long uncached; //!< count of plans destroyed after single transform, when cache is full
+
+		Stats(): plans(), reuses(), uncached() { }
+	};
+
 private:
 	class Internal;
 
@@ -58,6 +76,17 @@ public:
 	static void fft(const Array<Complex, 1> &x, bool invert);
 	static void fft2d(const Array<Complex, 2> &x, bool invert, bool do_rows = true, bool do_cols = true);
 
+	//! plans are cached separately for each mode
+	static Planning get_planning();
+	static void set_planning(Planning x);
+
+	//! FFTW wisdom is loaded from this file by initialize() and saved by deinitialize(),
+	//! empty name disables it
+	static String get_wisdom_filename();
+	static void set_wisdom_filename(const String &x);
+
+	static Stats get_stats();
+
 	static void initialize();
 	static void deinitialize();
 };
@@ -35,12 +35,15 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <atomic>
 #include <vector>
 #include <map>
 
 #include "packedsurface.h"
 
+#include <synfig/general.h>
 #include <synfig/real.h>
+#include <synfig/threadpool.h>
 #include <synfig/zstreambuf.h>
 
 #endif
@@ -53,23 +56,301 @@ using namespace software;
 
 /* === G L O B A L S ======================================================= */
 
+//! default limit of memory of unpacked chunks, see Renderer::initialize()
+static const size_t default_chunk_cache_bytes = 64*1024*1024;
+
+static std::atomic<long long> last_surface_id(0);
+
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+// Byte-oriented LZ77 in the manner of LZ4: sequence of
+// token (count of literals in high nibble, length of match minus min_match in low nibble),
+// extra bytes of count of literals, literals, offset of match (2 bytes),
+// extra bytes of length of match. Last sequence has literals only.
+// Chunks are not larger than 64 KiB, so offsets always fit.
+
+const int lz_min_match = 4;
+const int lz_hash_bits = 12;
+const int lz_max_offset = 65535;
+
+inline unsigned int
+lz_read32(const unsigned char *p)
+	{ unsigned int x; memcpy(&x, p, sizeof(x)); return x; }
+
+inline int
+lz_hash(unsigned int x)
+	{ return (int)((x*2654435761u) >> (32 - lz_hash_bits)); }
+
+inline unsigned char*
+lz_write_length(unsigned char *dst, const unsigned char *dst_end, int length)
+{
+	for(; length >= 255; length -= 255) {
+		if (dst >= dst_end) return NULL;
+		*dst++ = 255;
+	}
+	if (dst >= dst_end) return NULL;
+	*dst++ = (unsigned char)length;
+	return dst;
+}
+
+inline const unsigned char*
+lz_read_length(const unsigned char *src, const unsigned char *src_end, int &length)
+{
+	unsigned char b;
+	do {
+		if (src >= src_end) return NULL;
+		b = *src++;
+		length += b;
+	} while(b == 255);
+	return src;
+}
+
+//! returns size of packed data, or zero when it does not fit into \a dest_size
+size_t
+lz_pack(void *dest, size_t dest_size, const void *src, size_t src_size)
+{
+	const unsigned char *s = (const unsigned char*)src;
+	const unsigned char *ip = s;
+	const unsigned char *anchor = s;
+	const unsigned char *s_end = s + src_size;
+	const unsigned char *match_limit = src_size >= (size_t)lz_min_match ? s_end - lz_min_match : s;
+	unsigned char *d = (unsigned char*)dest;
+	unsigned char *d_end = d + dest_size;
+
+	int table[1 << lz_hash_bits];
+	for(int i = 0; i < (1 << lz_hash_bits); ++i)
+		table[i] = -1;
+
+	while(ip <= match_limit) {
+		const unsigned int seq = lz_read32(ip);
+		const int h = lz_hash(seq);
+		const int ref = table[h];
+		table[h] = (int)(ip - s);
+		if (ref < 0 || (ip - s) - ref > lz_max_offset || lz_read32(s + ref) != seq) {
+			// skip faster through the data which is not compressible
+			ip += 1 + ((ip - anchor) >> 6);
+			continue;
+		}
+
+		const unsigned char *match = s + ref;
+		const unsigned char *ip_end = ip + lz_min_match;
+		const unsigned char *m = match + lz_min_match;
+		while(ip_end < s_end && *ip_end == *m) ++ip_end, ++m;
+
+		const int literals = (int)(ip - anchor);
+		const int length = (int)(ip_end - ip) - lz_min_match;
+		if (d >= d_end) return 0;
+		unsigned char *token = d++;
+		*token = (unsigned char)((std::min(literals, 15) << 4) | std::min(length, 15));
+		if (literals >= 15 && !(d = lz_write_length(d, d_end, literals - 15))) return 0;
+		if (d_end - d < literals + 2) return 0;
+		memcpy(d, anchor, literals);
+		d += literals;
+		const int offset = (int)(ip - match);
+		*d++ = (unsigned char)(offset & 0xff);
+		*d++ = (unsigned char)(offset >> 8);
+		if (length >= 15 && !(d = lz_write_length(d, d_end, length - 15))) return 0;
+
+		ip = anchor = ip_end;
+	}
+
+	// last literals
+	const int literals = (int)(s_end - anchor);
+	if (d >= d_end) return 0;
+	*d++ = (unsigned char)(std::min(literals, 15) << 4);
+	if (literals >= 15 && !(d = lz_write_length(d, d_end, literals - 15))) return 0;
+	if (d_end - d < literals) return 0;
+	memcpy(d, anchor, literals);
+	d += literals;
+
+	return d - (unsigned char*)dest;
+}
+
+//! returns size of unpacked data, or zero for broken data
+size_t
+lz_unpack(void *dest, size_t dest_size, const void *src, size_t src_size)
+{
+	const unsigned char *s = (const unsigned char*)src;
+	const unsigned char *s_end = s + src_size;
+	unsigned char *d = (unsigned char*)dest;
+	unsigned char *d_end = d + dest_size;
+
+	while(s < s_end) {
+		const int token = *s++;
+
+		int literals = token >> 4;
+		if (literals == 15 && !(s = lz_read_length(s, s_end, literals))) return 0;
+		if (s_end - s < literals || d_end - d < literals) return 0;
+		memcpy(d, s, literals);
+		d += literals;
+		s += literals;
+		if (s == s_end) break;
+
+		if (s_end - s < 2) return 0;
+		const int offset = s[0] | (s[1] << 8);
+		s += 2;
+		int length = token & 15;
+		if (length == 15 && !(s = lz_read_length(s, s_end, length))) return 0;
+		length += lz_min_match;
+		if (offset == 0 || offset > d - (unsigned char*)dest || d_end - d < length) return 0;
+
+		const unsigned char *m = d - offset;
+		if (offset >= length) {
+			memcpy(d, m, length);
+			d += length;
+		} else {
+			// overlapped match repeats the last bytes
+			for(unsigned char *e = d + length; d < e; ++d, ++m)
+				*d = *m;
+		}
+	}
+
+	return d - (unsigned char*)dest;
+}
+
+} // end of anonymous namespace
+
 /* === M E T H O D S ======================================================= */
 
 
+PackedSurface::Codec PackedSurface::default_codec = PackedSurface::CodecNone;
+
+
+PackedSurface::ChunkCache::ChunkCache(size_t max_bytes):
+	max_bytes(max_bytes)
+{ }
+
+PackedSurface::ChunkCache&
+PackedSurface::ChunkCache::instance()
+{
+	// never deleted: surfaces may be destroyed by static destructors
+	static ChunkCache *cache = new ChunkCache(default_chunk_cache_bytes);
+	return *cache;
+}
+
+void
+PackedSurface::ChunkCache::erase_entry(EntryMap::iterator i)
+{
+	stats.bytes -= i->second->chunk->data.size();
+	--stats.entries;
+	entries.erase(i->second);
+	entries_map.erase(i);
+}
+
+void
+PackedSurface::ChunkCache::evict(size_t required)
+{
+	while(!entries.empty() && stats.bytes + required > max_bytes) {
+		erase_entry(entries_map.find(entries.back().key));
+		++stats.evictions;
+	}
+}
+
+PackedSurface::ChunkCache::Chunk::Handle
+PackedSurface::ChunkCache::get(const PackedSurface &surface, int index)
+{
+	const Key key(surface.id, index);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		EntryMap::iterator i = entries_map.find(key);
+		if (i != entries_map.end()) {
+			++stats.hits;
+			entries.splice(entries.begin(), entries, i->second);
+			return i->second->chunk;
+		}
+		++stats.misses;
+	}
+
+	// unpack without lock, other threads may unpack the same chunk meanwhile
+	Chunk::Handle chunk(new Chunk());
+	chunk->data.resize(surface.chunk_size);
+	surface.unpack_chunk(index, &chunk->data.front());
+
+	std::lock_guard<std::mutex> lock(mutex);
+	const size_t bytes = chunk->data.size();
+	if (bytes > max_bytes/4)
+		return chunk;
+
+	EntryMap::iterator i = entries_map.find(key);
+	if (i != entries_map.end())
+		return i->second->chunk;
+	evict(bytes);
+
+	Entry entry;
+	entry.key = key;
+	entry.chunk = chunk;
+	entries.push_front(entry);
+	entries_map[key] = entries.begin();
+	stats.bytes += bytes;
+	++stats.entries;
+	return chunk;
+}
+
+void
+PackedSurface::ChunkCache::erase(const PackedSurface &surface)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	EntryMap::iterator i = entries_map.lower_bound(Key(surface.id, 0));
+	while(i != entries_map.end() && i->first.first == surface.id)
+		erase_entry(i++);
+}
+
+size_t
+PackedSurface::ChunkCache::get_max_bytes() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return max_bytes;
+}
+
+void
+PackedSurface::ChunkCache::set_max_bytes(size_t max_bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	this->max_bytes = max_bytes;
+	evict(0);
+}
+
+void
+PackedSurface::ChunkCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+	entries_map.clear();
+	stats.bytes = 0;
+	stats.entries = 0;
+}
+
+PackedSurface::ChunkCache::Stats
+PackedSurface::ChunkCache::get_stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Stats s = stats;
+	s.max_bytes = max_bytes;
+	return s;
+}
+
+void
+PackedSurface::ChunkCache::reset_stats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.hits = 0;
+	stats.misses = 0;
+	stats.evictions = 0;
+}
+
+
 PackedSurface::Reader::Reader():
 	surface(NULL),
 	first(NULL),
-	last(NULL),
-	cache(NULL)
+	last(NULL)
 { }
 
 PackedSurface::Reader::Reader(const PackedSurface &surface):
 	surface(NULL),
 	first(NULL),
-	last(NULL),
-	cache(NULL)
+	last(NULL)
 {
 	open(surface);
 }
@@ -102,13 +383,11 @@ PackedSurface::Reader::open(const PackedSurface &surface)
 
 		int cacheCount = std::max(surface.chunks_width, surface.chunks_height)*CacheRows;
 		assert(cacheCount > 1);
-		int cacheEntrySize = sizeof(CacheEntry) + surface.chunk_size;
-		cache = new char[cacheCount*cacheEntrySize];
-		first = (CacheEntry*)cache;
+		cache.resize(cacheCount);
+		first = &cache.front();
 		for(int i = 0; i < cacheCount; ++i)
 		{
-			CacheEntry *entry = (CacheEntry*)(void*)(cache + i*cacheEntrySize);
-			entry->chunk_index = -1;
+			CacheEntry *entry = &cache[i];
 			entry->next = NULL;
 			entry->prev = last;
 			if (last) last->next = entry;
@@ -126,10 +405,10 @@ PackedSurface::Reader::close()
 			std::lock_guard<std::mutex> lock(surface->mutex);
 			surface->readers.erase(this);
 		}
-		if (cache) delete[] cache;
 		first = NULL;
 		last = NULL;
-		cache = NULL;
+		chunks.clear();
+		cache.clear();
 		surface = NULL;
 	}
 }
@@ -149,7 +428,7 @@ PackedSurface::Reader::get_pixel(int x, int y) const
 	if (y >= surface->height)
 		y = surface->height-1;
 
-	if (cache)
+	if (!cache.empty())
 	{
 		int chunk_index = x/ChunkSize + y/ChunkSize*surface->chunks_width;
 		x %= ChunkSize;
@@ -168,8 +447,8 @@ PackedSurface::Reader::get_pixel(int x, int y) const
 			if (entry->chunk_index >= 0)
 				chunks[entry->chunk_index] = NULL;
 			entry->chunk_index = chunk_index;
+			entry->chunk = ChunkCache::instance().get(*surface, chunk_index);
 			chunks[chunk_index] = entry;
-			zstreambuf::unpack(entry->data(), surface->chunk_size, data, size);
 		}
 		if (first != entry)
 		{
@@ -181,7 +460,7 @@ PackedSurface::Reader::get_pixel(int x, int y) const
 			entry->next = first;
 			first = entry;
 		}
-		return surface->get_pixel(entry->data(x*surface->pixel_size + y*surface->chunk_row_size));
+		return surface->get_pixel(&entry->chunk->data[x*surface->pixel_size + y*surface->chunk_row_size]);
 	}
 	else
 	if (surface->pixel_size)
@@ -193,9 +472,11 @@ PackedSurface::Reader::get_pixel(int x, int y) const
 
 
 PackedSurface::PackedSurface():
+	id(0),
 	width(0),
 	height(0),
 	channel_type(),
+	codec(),
 	pixel_size(0),
 	row_size(0),
 	chunk_size(0),
@@ -217,9 +498,13 @@ void
 PackedSurface::clear() {
 	while(!readers.empty())
 		(*readers.begin())->close();
+	if (chunk_size)
+		ChunkCache::instance().erase(*this);
+	id = 0;
 	width = 0;
 	height = 0;
 	channel_type = ChannelUInt8;
+	codec = CodecNone;
 	memset(channels, 0, sizeof(channels));
 	memset(discrete_to_float, 0, sizeof(discrete_to_float));
 	constant = Color();
@@ -282,6 +567,35 @@ PackedSurface::set_pixel(void *pixel, const Color &color)
 	set_channel(pixel, channels[3], channel_type, color.get_a(), discrete_to_float);
 }
 
+void
+PackedSurface::get_row(const void *pixels, Color *target, int count) const
+{
+	// channels are checked once per row instead of once per pixel
+	Color color = constant;
+	Color::value_type *color_channels = (Color::value_type*)(void*)&color;
+	int offsets[4];
+	int used[4];
+	int used_count = 0;
+	for(int i = 0; i < 4; ++i)
+		if (channels[i] >= 0)
+			{ offsets[used_count] = channels[i]; used[used_count] = i; ++used_count; }
+
+	const char *pixel = (const char*)pixels;
+	if (channel_type == ChannelUInt8) {
+		for(Color *end = target + count; target < end; ++target, pixel += pixel_size) {
+			for(int i = 0; i < used_count; ++i)
+				color_channels[used[i]] = discrete_to_float[((const unsigned char*)pixel)[offsets[i]]];
+			*target = color;
+		}
+	} else {
+		for(Color *end = target + count; target < end; ++target, pixel += pixel_size) {
+			for(int i = 0; i < used_count; ++i)
+				memcpy(&color_channels[used[i]], pixel + offsets[i], sizeof(Color::value_type));
+			*target = color;
+		}
+	}
+}
+
 void
 PackedSurface::get_compressed_chunk(int index, const void *&data, int &size, bool &compressed) const
 {
@@ -294,6 +608,73 @@ PackedSurface::get_compressed_chunk(int index, const void *&data, int &size, boo
 	compressed = size != chunk_size;
 }
 
+void
+PackedSurface::unpack_chunk(int index, void *target) const
+{
+	const void *data;
+	int size;
+	bool compressed;
+	get_compressed_chunk(index, data, size, compressed);
+
+	size_t unpacked = 0;
+	if (!compressed)
+		{ memcpy(target, data, size); unpacked = size; }
+	else
+	if (codec == CodecLZ)
+		unpacked = lz_unpack(target, chunk_size, data, size);
+	else
+		unpacked = zstreambuf::unpack(target, chunk_size, data, size);
+
+	if (unpacked != (size_t)chunk_size) {
+		synfig::error("PackedSurface: cannot unpack chunk %d", index);
+		memset(target, 0, chunk_size);
+	}
+}
+
+void
+PackedSurface::pack_chunks(const Color *pixels, int pitch, std::vector<char> *packed, int begin, int end)
+{
+	std::vector<char> chunk(chunk_size);
+	std::vector<char> compressed_chunk(2*chunk.size());
+	for(int i = begin; i < end; ++i) {
+		char *pixel = &chunk.front();
+		int x0 = i%chunks_width*ChunkSize;
+		int y0 = i/chunks_width*ChunkSize;
+		for(int r = 0; r < ChunkSize; ++r) {
+			const Color *color = (const Color*)((const char*)pixels + (y0 + r)*pitch) + x0;
+			for(int c = 0; c < ChunkSize; ++c, pixel += pixel_size, ++color)
+				if (x0+c < width && y0+r < height)
+					set_pixel(pixel, *color);
+				else
+					set_pixel(pixel, Color());
+		}
+
+		const char *current_data = &chunk.front();
+		int size = (int)chunk.size();
+
+		if (codec == CodecZlib) {
+			int gzip_size = (int)zstreambuf::pack(&compressed_chunk.front(), compressed_chunk.size(), &chunk.front(), chunk.size(), true);
+			if (gzip_size <= (int)chunk.size()/4)
+			{
+				current_data = &compressed_chunk.front();
+				size = gzip_size;
+			}
+		}
+		else
+		if (codec == CodecLZ) {
+			// unpacking is cheap, so smaller gain is enough
+			int lz_size = (int)lz_pack(&compressed_chunk.front(), chunk.size()*3/4, &chunk.front(), chunk.size());
+			if (lz_size > 0)
+			{
+				current_data = &compressed_chunk.front();
+				size = lz_size;
+			}
+		}
+
+		packed[i].assign(current_data, current_data + size);
+	}
+}
+
 void
 PackedSurface::set_pixels(const Color *pixels, int width, int height, int pitch) {
 	clear();
@@ -405,14 +786,16 @@ PackedSurface::set_pixels(const Color *pixels, int width, int height, int pitch)
 	const char *s;
 	bool gzip = (s = getenv("SYNFIG_PACK_IMAGES_GZIP")) && atoi(s) != 0;
 	bool split = (s = getenv("SYNFIG_PACK_IMAGES_SPLIT")) && atoi(s) != 0;
+	codec = default_codec == CodecNone && gzip ? CodecZlib : default_codec;
 
 	if (pixel_size == 0) {
 		// do nothing
 	}
 	else
-	if ((!gzip && !split) || std::max((width-1)/ChunkSize + 1, (height-1)/ChunkSize + 1)*CacheRows*ChunkSize*ChunkSize*16 > width*height)
+	if ((codec == CodecNone && !split) || std::max((width-1)/ChunkSize + 1, (height-1)/ChunkSize + 1)*CacheRows*ChunkSize*ChunkSize*16 > width*height)
 	{
 		// no compression
+		codec = CodecNone;
 		data.resize(row_size*height);
 		char *pixel = &data.front();
 		for(int row = 0; row < height; ++row)
@@ -422,47 +805,40 @@ PackedSurface::set_pixels(const Color *pixels, int width, int height, int pitch)
 	else
 	{
 		// make chunks
+		id = ++last_surface_id;
 		chunk_row_size = pixel_size*ChunkSize;
 		chunk_size = chunk_row_size*ChunkSize;
 		chunks_width = (width-1)/ChunkSize + 1;
 		chunks_height = (height-1)/ChunkSize + 1;
 
+		// compress rows of chunks in parallel
 		int count = chunks_width*chunks_height;
-		std::vector<char> data((count + 1)*sizeof(int), 0);
-		std::vector<char> chunk(chunk_size);
-		std::vector<char> compressed_chunk(2*chunk.size());
-		for(int i = 0; i < count; ++i) {
-			char *pixel = &chunk.front();
-			for(int r = 0; r < ChunkSize; ++r) {
-				int x0 = i%chunks_width*ChunkSize;
-				int y0 = i/chunks_width*ChunkSize;
-				const Color *color = (const Color*)((const char*)pixels + (y0 + r)*pitch) + x0;
-				for(int c = 0; c < ChunkSize; ++c, pixel += pixel_size, ++color)
-					if (x0+c < width && y0+r < height)
-						set_pixel(pixel, *color);
-					else
-						set_pixel(pixel, Color());
-			}
-
-			const void* current_data = &chunk.front();
-			int size = (int)chunk.size();
-
-			if (gzip) {
-				int gzip_size = (int)zstreambuf::pack(&compressed_chunk.front(), compressed_chunk.size(), &chunk.front(), chunk.size(), true);
-				if (gzip_size <= (int)chunk.size()/4)
-				{
-					current_data = &compressed_chunk.front();
-					size = gzip_size;
-				}
-			}
-
-			((int*)(void*)&data.front())[i] = data.size();
-			data.resize(data.size() + size);
-			memcpy(&data[data.size() - size], current_data, size);
+		std::vector< std::vector<char> > packed(count);
+		int bands = codec == CodecNone ? 1 : std::min(chunks_height, ThreadPool::instance().get_max_threads());
+		if (bands <= 1) {
+			pack_chunks(pixels, pitch, &packed.front(), 0, count);
+		} else {
+			ThreadPool::Group group;
+			for(int i = 0; i < bands; ++i)
+				group.enqueue( sigc::bind( sigc::mem_fun(*this, &PackedSurface::pack_chunks),
+					pixels, pitch, &packed.front(),
+					chunks_height*i/bands*chunks_width, chunks_height*(i + 1)/bands*chunks_width ));
+			group.run();
 		}
-		((int*)(void*)&data.front())[count] = data.size();
 
-		this->data = data;
+		size_t size = (count + 1)*sizeof(int);
+		for(int i = 0; i < count; ++i)
+			size += packed[i].size();
+		data.resize(size);
+		int *offsets = (int*)(void*)&data.front();
+		int offset = (count + 1)*sizeof(int);
+		for(int i = 0; i < count; ++i) {
+			offsets[i] = offset;
+			if (!packed[i].empty())
+				memcpy(&data[offset], &packed[i].front(), packed[i].size());
+			offset += (int)packed[i].size();
+		}
+		offsets[count] = offset;
 	}
 }
 
@@ -470,11 +846,33 @@ void
 PackedSurface::get_pixels(Color *target) const {
 	if (target == NULL || width <= 0 || height <= 0)
 		return;
-	Reader reader(*this);
-	Color *color = target;
-	for(int y = 0; y < height; ++y)
-		for(int x = 0; x < width; ++x, ++color)
-			*color = reader.get_pixel(x, y);
+
+	if (!chunk_size) {
+		for(int y = 0; y < height; ++y)
+			if (pixel_size)
+				get_row(&data[y*row_size], target + y*width, width);
+			else
+				std::fill(target + y*width, target + (y + 1)*width, constant);
+		return;
+	}
+
+	// whole surface is read once, so chunks are unpacked without shared cache
+	std::vector<char> chunk(chunk_size);
+	for(int i = 0; i < chunks_width*chunks_height; ++i) {
+		const void *data;
+		int size;
+		bool compressed;
+		get_compressed_chunk(i, data, size, compressed);
+		if (compressed)
+			{ unpack_chunk(i, &chunk.front()); data = &chunk.front(); }
+
+		int x0 = i%chunks_width*ChunkSize;
+		int y0 = i/chunks_width*ChunkSize;
+		int w = std::min((int)ChunkSize, width - x0);
+		int h = std::min((int)ChunkSize, height - y0);
+		for(int r = 0; r < h; ++r)
+			get_row((const char*)data + r*chunk_row_size, target + (y0 + r)*width + x0, w);
+	}
 }
 
 
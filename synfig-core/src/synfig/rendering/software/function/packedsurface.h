@@ -30,7 +30,13 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <list>
+#include <map>
+#include <mutex>
 #include <set>
+#include <vector>
+
+#include <ETL/handle>
 
 #include <synfig/real.h>
 #include <synfig/color.h>
@@ -60,11 +66,85 @@ public:
 		ChannelFloat32
 	};
 
+	//! Compression of chunks, chunks which are not compressed well are stored as is
+	enum Codec {
+		CodecNone, //!< chunks are used only when SYNFIG_PACK_IMAGES_SPLIT is set
+		CodecZlib, //!< smallest, but slow to unpack
+		CodecLZ    //!< byte-oriented LZ77, unpacks at memory speed
+	};
+
 	enum {
 		ChunkSize = 32,
 		CacheRows = 2
 	};
 
+	//! Unpacked chunks shared by all readers of all surfaces,
+	//! so threads which sample the same bitmap unpack each chunk once.
+	//! Least recently used chunks are dropped when memory limit is reached.
+	class ChunkCache
+	{
+	public:
+		class Chunk: public etl::shared_object
+		{
+		public:
+			typedef etl::handle<Chunk> Handle;
+			std::vector<char> data;
+		};
+
+		struct Stats
+		{
+			long long hits;      //!< count of chunks found in cache
+			long long misses;    //!< count of unpacked chunks
+			long long evictions; //!< count of chunks removed to free the memory
+			long long entries;   //!< count of chunks in cache
+			size_t bytes;        //!< memory used by chunks
+			size_t max_bytes;    //!< memory limit
+
+			Stats(): hits(), misses(), evictions(), entries(), bytes(), max_bytes() { }
+		};
+
+	private:
+		typedef std::pair<long long, int> Key; //!< id of surface and index of chunk
+
+		struct Entry
+		{
+			Key key;
+			Chunk::Handle chunk;
+		};
+
+		typedef std::list<Entry> EntryList;
+		typedef std::map<Key, EntryList::iterator> EntryMap;
+
+		mutable std::mutex mutex;
+		size_t max_bytes;
+		Stats stats;
+
+		//! recently used chunks are in front
+		EntryList entries;
+		EntryMap entries_map;
+
+		explicit ChunkCache(size_t max_bytes);
+
+		void erase_entry(EntryMap::iterator i);
+		void evict(size_t required);
+
+	public:
+		//! cache lives until exit of process, so surfaces may be freed at any time
+		static ChunkCache& instance();
+
+		//! Returns unpacked chunk, unpacks it if it is not found
+		Chunk::Handle get(const PackedSurface &surface, int index);
+		//! Removes all chunks of the surface
+		void erase(const PackedSurface &surface);
+
+		size_t get_max_bytes() const;
+		void set_max_bytes(size_t max_bytes);
+
+		void clear();
+		Stats get_stats() const;
+		void reset_stats();
+	};
+
 	class Reader
 	{
 	private:
@@ -72,14 +152,16 @@ public:
 			int chunk_index;
 			CacheEntry *prev;
 			CacheEntry *next;
-			void *data(int offset = 0) { return (char*)this + sizeof(*this) + offset; }
+			ChunkCache::Chunk::Handle chunk;
+			CacheEntry(): chunk_index(-1), prev(), next() { }
 		};
 
 		const PackedSurface *surface;
 		mutable CacheEntry* first;
 		mutable CacheEntry* last;
 		mutable std::vector<CacheEntry*> chunks;
-		char* cache;
+		//! recently used chunks, holds them while shared cache may drop them
+		mutable std::vector<CacheEntry> cache;
 
 	public:
 
@@ -134,10 +216,14 @@ private:
 	mutable std::mutex mutex;
 	mutable std::set<Reader*> readers;
 
+	//! unique for each set_pixels() call, identifies chunks in ChunkCache
+	long long id;
+
 	int width;
 	int height;
 
 	ChannelType channel_type;
+	Codec codec;
 	int channels[4];
 	Color::value_type discrete_to_float[256];
 	Color constant;
@@ -152,13 +238,19 @@ private:
 
 	std::vector<char> data;
 
+	static Codec default_codec;
+
 	static Color::value_type get_channel(const void *pixel, int offset, ChannelType type, Color::value_type constant, const Color::value_type *discrete_to_float);
 	static void set_channel(void *pixel, int offset, ChannelType type, Color::value_type color, const Color::value_type *discrete_to_float);
 
 	Color get_pixel(const void *pixel) const;
 	void set_pixel(void *pixel, const Color &color);
 
+	void get_row(const void *pixels, Color *target, int count) const;
+
 	void get_compressed_chunk(int index, const void *&data, int &size, bool &compressed) const;
+	void unpack_chunk(int index, void *target) const;
+	void pack_chunks(const Color *pixels, int pitch, std::vector<char> *packed, int begin, int end);
 
 public:
 	PackedSurface();
@@ -169,6 +261,12 @@ public:
 	int get_width() const { return width; }
 	int get_height() const { return height; }
 	void get_pixels(Color *target) const;
+	//! memory used by packed pixels
+	size_t get_data_size() const { return data.size(); }
+
+	//! Codec of new surfaces, SYNFIG_PACK_IMAGES_GZIP selects zlib when it is not set
+	static Codec get_default_codec() { return default_codec; }
+	static void set_default_codec(Codec codec) { default_codec = codec; }
 };
 
 } /* end namespace software */
@@ -36,11 +36,13 @@
 
 #include "rendererdraftsw.h"
 
+#include "surfaceswrgba8.h"
 #include "task/tasksw.h"
 
 #include "../common/optimizer/optimizerblendassociative.h"
 #include "../common/optimizer/optimizerblendmerge.h"
 #include "../common/optimizer/optimizerblendtotarget.h"
+#include "../common/optimizer/optimizercache.h"
 #include "../common/optimizer/optimizerdraft.h"
 #include "../common/optimizer/optimizerlist.h"
 #include "../common/optimizer/optimizersplit.h"
@@ -67,6 +69,7 @@ RendererDraftSW::RendererDraftSW()
 	// register optimizers
 	register_optimizer(new OptimizerDraftContour(2.0, true));
 	register_optimizer(new OptimizerDraftBlur());
+	register_optimizer(new OptimizerDraftEscapeTime(4, 32));
 	register_optimizer(new OptimizerDraftLayerSkip("MotionBlur"));
 	register_optimizer(new OptimizerDraftLayerSkip("radial_blur"));
 	register_optimizer(new OptimizerDraftLayerSkip("curve_warp"));
@@ -81,8 +84,6 @@ RendererDraftSW::RendererDraftSW()
 	register_optimizer(new OptimizerDraftLayerSkip("halftone2"));
 	register_optimizer(new OptimizerDraftLayerSkip("halftone3"));
 	register_optimizer(new OptimizerDraftLayerSkip("lumakey"));
-	register_optimizer(new OptimizerDraftLayerSkip("julia"));
-	register_optimizer(new OptimizerDraftLayerSkip("mandelbrot"));
 	register_optimizer(new OptimizerDraftLayerSkip("conical_gradient"));
 	register_optimizer(new OptimizerDraftLayerSkip("curve_gradient"));
 	register_optimizer(new OptimizerDraftLayerSkip("noise"));
@@ -94,6 +95,8 @@ RendererDraftSW::RendererDraftSW()
 
 	register_optimizer(new OptimizerTransformation());
 	register_optimizer(new OptimizerDraftTransformation());
+	// only cached results are stored in 8 bits, tasks still render in float
+	register_optimizer(new OptimizerCache(get_cache(), SurfaceSWRGBA8::token.handle()));
 
 	register_optimizer(new OptimizerPass(false));
 	register_optimizer(new OptimizerPass(true));
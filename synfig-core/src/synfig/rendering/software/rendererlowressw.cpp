@@ -36,11 +36,13 @@
 
 #include "rendererlowressw.h"
 
+#include "surfaceswrgba16f.h"
 #include "task/tasksw.h"
 
 #include "../common/optimizer/optimizerblendassociative.h"
 #include "../common/optimizer/optimizerblendmerge.h"
 #include "../common/optimizer/optimizerblendtotarget.h"
+#include "../common/optimizer/optimizercache.h"
 #include "../common/optimizer/optimizerdraft.h"
 #include "../common/optimizer/optimizerlist.h"
 #include "../common/optimizer/optimizersplit.h"
@@ -69,6 +71,8 @@ RendererLowResSW::RendererLowResSW(int level):
 	register_optimizer(new OptimizerDraftLowRes(level));
 	register_optimizer(new OptimizerTransformation());
 	register_optimizer(new OptimizerDraftTransformation());
+	// only cached results are stored in half-float, tasks still render in float
+	register_optimizer(new OptimizerCache(get_cache(), SurfaceSWRGBA16F::token.handle()));
 
 	register_optimizer(new OptimizerPass(false));
 	register_optimizer(new OptimizerPass(true));
@@ -36,11 +36,13 @@
 
 #include "rendererpreviewsw.h"
 
+#include "surfaceswrgba16f.h"
 #include  "task/tasksw.h"
 
 #include "../common/optimizer/optimizerblendassociative.h"
 #include "../common/optimizer/optimizerblendmerge.h"
 #include "../common/optimizer/optimizerblendtotarget.h"
+#include "../common/optimizer/optimizercache.h"
 #include "../common/optimizer/optimizerlist.h"
 #include "../common/optimizer/optimizersplit.h"
 #include "../common/optimizer/optimizertransformation.h"
@@ -69,6 +71,8 @@ RendererPreviewSW::RendererPreviewSW()
 	// register optimizers
 	register_optimizer(new OptimizerTransformation());
 	register_optimizer(new OptimizerDraftTransformation());
+	// only cached results are stored in half-float, tasks still render in float
+	register_optimizer(new OptimizerCache(get_cache(), SurfaceSWRGBA16F::token.handle()));
 	register_optimizer(new OptimizerPass(false));
 	register_optimizer(new OptimizerPass(true));
 	register_optimizer(new OptimizerBlendMerge());
@@ -32,7 +32,11 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+#include <utility>
+
 #include "surfacesw.h"
+#include "surfaceswpool.h"
 
 #endif
 
@@ -54,12 +58,16 @@ rendering::Surface::Token SurfaceSW::token(
 
 SurfaceSW::SurfaceSW():
 	own_surface(true),
-	surface(new synfig::Surface())
+	surface(new synfig::Surface()),
+	pool_pixels(),
+	pool_capacity()
 { }
 
 SurfaceSW::SurfaceSW(synfig::Surface &surface, bool own_surface):
 	own_surface(own_surface),
-	surface(&surface)
+	surface(&surface),
+	pool_pixels(),
+	pool_capacity()
 {
 	assert(this->surface);
 	set_desc(this->surface->get_w(), this->surface->get_h(), false);
@@ -71,15 +79,92 @@ SurfaceSW::~SurfaceSW()
 	if (own_surface)
 		{ assert(surface); delete surface; }
 	surface = NULL;
+	release_pixels();
 	set_desc(0, 0, true);
 }
 
 bool
-SurfaceSW::create_vfunc(int width, int height)
+SurfaceSW::alloc_pixels(int width, int height, bool &zeroed)
 {
 	assert(surface);
-	surface->set_wh(width, height);
-	surface->clear();
+	zeroed = false;
+
+	// surface of the other owner may outlive this object
+	if (!own_surface || width <= 0 || height <= 0) {
+		surface->set_wh(width, height);
+		release_pixels();
+		return true;
+	}
+
+	const size_t count = (size_t)width*height;
+	size_t capacity = 0;
+	SurfaceSWPool::get_class(count, capacity);
+	if (!pool_pixels || pool_capacity != capacity) {
+		Color *pixels = SurfaceSWPool::instance().alloc(count, capacity, zeroed);
+		if (!pixels)
+			return false;
+		surface->set_wh(width, height, (unsigned char*)pixels, sizeof(Color)*width);
+		release_pixels();
+		pool_pixels = pixels;
+		pool_capacity = capacity;
+	} else {
+		surface->set_wh(width, height, (unsigned char*)pool_pixels, sizeof(Color)*width);
+	}
+	return true;
+}
+
+void
+SurfaceSW::release_pixels()
+{
+	if (pool_pixels)
+		SurfaceSWPool::instance().release(pool_pixels, pool_capacity);
+	pool_pixels = NULL;
+	pool_capacity = 0;
+}
+
+bool
+SurfaceSW::create_vfunc(int width, int height)
+{
+	bool zeroed;
+	if (!alloc_pixels(width, height, zeroed))
+		return false;
+	if (!zeroed)
+		surface->clear();
+	return true;
+}
+
+bool
+SurfaceSW::create_uninitialized_vfunc(int width, int height, const std::vector<RectInt> &rects)
+{
+	bool zeroed;
+	if (!alloc_pixels(width, height, zeroed))
+		return false;
+	if (zeroed)
+		return true;
+
+	// clear only the gaps between rects in each row
+	const RectInt bounds(0, 0, width, height);
+	std::vector<std::pair<int, int> > spans;
+	for(int y = 0; y < height; ++y) {
+		spans.clear();
+		for(std::vector<RectInt>::const_iterator i = rects.begin(); i != rects.end(); ++i) {
+			RectInt r;
+			rect_set_intersect(r, *i, bounds);
+			if (r.is_valid() && r.miny <= y && y < r.maxy)
+				spans.push_back(std::make_pair(r.minx, r.maxx));
+		}
+		std::sort(spans.begin(), spans.end());
+
+		Color *row = (*surface)[y];
+		int x = 0;
+		for(std::vector<std::pair<int, int> >::const_iterator i = spans.begin(); i != spans.end(); ++i) {
+			if (i->first > x)
+				std::fill(row + x, row + i->first, Color());
+			x = std::max(x, i->second);
+		}
+		if (x < width)
+			std::fill(row + x, row + width, Color());
+	}
 	return true;
 }
 
@@ -87,10 +172,12 @@ bool
 SurfaceSW::assign_vfunc(const rendering::Surface &surface)
 {
 	assert(this->surface);
-	this->surface->set_wh(surface.get_width(), surface.get_height());
-	if (surface.get_pixels(&(*this->surface)[0][0]))
+	bool zeroed;
+	if ( alloc_pixels(surface.get_width(), surface.get_height(), zeroed)
+	  && surface.get_pixels(&(*this->surface)[0][0]) )
 		return true;
 	this->surface->set_wh(0, 0);
+	release_pixels();
 	set_desc(0, 0, true);
 	return false;
 }
@@ -108,6 +195,7 @@ SurfaceSW::reset_vfunc()
 {
 	assert(surface);
 	surface->set_wh(0, 0);
+	release_pixels();
 	return true;
 }
 
@@ -123,6 +211,12 @@ void
 SurfaceSW::set_surface(synfig::Surface &surface, bool own_surface)
 {
 	if (&surface == this->surface) {
+		if (!own_surface && pool_pixels) {
+			// the other owner needs memory not bound to the pool
+			synfig::Surface copy(surface);
+			surface = copy;
+			release_pixels();
+		}
 		this->own_surface = own_surface;
 		return;
 	}
@@ -131,6 +225,7 @@ SurfaceSW::set_surface(synfig::Surface &surface, bool own_surface)
 		assert(this->surface);
 		delete(this->surface);
 	}
+	release_pixels();
 
 	this->surface = &surface;
 	assert(this->surface);
@@ -145,6 +240,7 @@ SurfaceSW::reset_surface()
 		assert(surface);
 		delete(surface);
 	}
+	release_pixels();
 	own_surface = true;
 	surface = new synfig::Surface();
 	set_desc(0, 0, true);
@@ -57,9 +57,15 @@ public:
 private:
 	bool own_surface;
 	synfig::Surface *surface;
+	Color *pool_pixels;   //!< buffer from SurfaceSWPool used by own surface
+	size_t pool_capacity;
+
+	bool alloc_pixels(int width, int height, bool &zeroed);
+	void release_pixels();
 
 protected:
 	virtual bool create_vfunc(int width, int height);
+	virtual bool create_uninitialized_vfunc(int width, int height, const std::vector<RectInt> &rects);
 	virtual bool assign_vfunc(const Surface &surface);
 	virtual bool clear_vfunc();
 	virtual bool reset_vfunc();
@@ -68,6 +68,9 @@ public:
 		{ assign(other); }
 	const software::PackedSurface& get_surface() const
 		{ return surface; }
+
+	virtual size_t get_memory_size() const
+		{ return surface.get_data_size(); }
 };
 
 } /* end namespace rendering */
@@ -0,0 +1,257 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/surfaceswpool.cpp
+**	\brief SurfaceSWPool
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstdlib>
+
+#include "surfaceswpool.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+//! default limit of memory of unused buffers, see Renderer::initialize()
+static const size_t default_max_bytes = 128*1024*1024;
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+//! The last buffer released by the thread,
+//! returned to the shared buckets when thread exits
+struct SurfaceSWPool::LocalSlot
+{
+	Color *pixels;
+	size_t capacity;
+	int index;
+
+	LocalSlot(): pixels(), capacity(), index() { }
+	~LocalSlot()
+		{ if (pixels) SurfaceSWPool::instance().push(index, pixels); }
+};
+
+thread_local SurfaceSWPool::LocalSlot SurfaceSWPool::local_slot;
+
+
+SurfaceSWPool::SurfaceSWPool(size_t max_bytes):
+	max_bytes(max_bytes),
+	bytes(),
+	peak_bytes(),
+	allocations(),
+	reuses(),
+	releases(),
+	drops()
+{ }
+
+SurfaceSWPool&
+SurfaceSWPool::instance()
+{
+	// never deleted: surfaces may be destroyed by static destructors
+	static SurfaceSWPool *pool = new SurfaceSWPool(default_max_bytes);
+	return *pool;
+}
+
+int
+SurfaceSWPool::get_class(size_t count, size_t &capacity)
+{
+	const size_t min_capacity = (size_t)1 << min_exponent;
+	if (count <= min_capacity)
+		{ capacity = min_capacity; return 0; }
+
+	// 2^e < count <= 2^(e+1), four classes between
+	int e = min_exponent;
+	while(((size_t)1 << (e + 1)) < count) ++e;
+	const size_t base = (size_t)1 << e;
+	const size_t step = base/4;
+	const size_t k = (count - base + step - 1)/step;
+	capacity = base + k*step;
+	return (e - min_exponent)*4 + (int)k;
+}
+
+size_t
+SurfaceSWPool::get_class_capacity(int index)
+{
+	if (index <= 0)
+		return (size_t)1 << min_exponent;
+	const size_t base = (size_t)1 << (min_exponent + (index - 1)/4);
+	return base + base/4*((index - 1)%4 + 1);
+}
+
+bool
+SurfaceSWPool::reserve_bytes(size_t size)
+{
+	size_t b = bytes;
+	do {
+		if (b + size > max_bytes)
+			return false;
+	} while(!bytes.compare_exchange_weak(b, b + size));
+
+	size_t peak = peak_bytes;
+	while(b + size > peak && !peak_bytes.compare_exchange_weak(peak, b + size)) { }
+	return true;
+}
+
+void
+SurfaceSWPool::push(int index, Color *pixels)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	buckets[index].push_back(pixels);
+}
+
+void
+SurfaceSWPool::trim()
+{
+	// free the largest buffers first
+	std::lock_guard<std::mutex> lock(mutex);
+	for(int i = classes_count - 1; i >= 0 && bytes > max_bytes; --i) {
+		const size_t size = get_class_capacity(i)*sizeof(Color);
+		while(!buckets[i].empty() && bytes > max_bytes) {
+			free(buckets[i].back());
+			buckets[i].pop_back();
+			bytes -= size;
+		}
+	}
+}
+
+Color*
+SurfaceSWPool::alloc(size_t count, size_t &capacity, bool &zeroed)
+{
+	const int index = get_class(count, capacity);
+	const size_t size = capacity*sizeof(Color);
+
+	LocalSlot &slot = local_slot;
+	if (slot.pixels && slot.index == index) {
+		Color *pixels = slot.pixels;
+		slot.pixels = NULL;
+		bytes -= size;
+		++reuses;
+		zeroed = false;
+		return pixels;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!buckets[index].empty()) {
+			Color *pixels = buckets[index].back();
+			buckets[index].pop_back();
+			bytes -= size;
+			++reuses;
+			zeroed = false;
+			return pixels;
+		}
+	}
+
+	// calloc leaves zeroing of large blocks to the system
+	Color *pixels = (Color*)calloc(capacity, sizeof(Color));
+	if (!pixels) {
+		capacity = 0;
+		zeroed = false;
+		return NULL;
+	}
+	++allocations;
+	zeroed = true;
+	return pixels;
+}
+
+void
+SurfaceSWPool::release(Color *pixels, size_t capacity)
+{
+	if (!pixels) return;
+
+	const int index = get_class(capacity, capacity);
+	if (!reserve_bytes(capacity*sizeof(Color))) {
+		free(pixels);
+		++drops;
+		return;
+	}
+	++releases;
+
+	// keep the most recent buffer in thread, it still may be in CPU cache
+	LocalSlot &slot = local_slot;
+	if (slot.pixels)
+		push(slot.index, slot.pixels);
+	slot.pixels = pixels;
+	slot.capacity = capacity;
+	slot.index = index;
+}
+
+void
+SurfaceSWPool::set_max_bytes(size_t max_bytes)
+{
+	this->max_bytes = max_bytes;
+	trim();
+}
+
+void
+SurfaceSWPool::clear()
+{
+	// buffers kept by threads are not touched
+	std::lock_guard<std::mutex> lock(mutex);
+	for(int i = 0; i < classes_count; ++i) {
+		for(std::vector<Color*>::const_iterator j = buckets[i].begin(); j != buckets[i].end(); ++j)
+			free(*j);
+		bytes -= buckets[i].size()*get_class_capacity(i)*sizeof(Color);
+		buckets[i].clear();
+	}
+}
+
+SurfaceSWPool::Stats
+SurfaceSWPool::get_stats() const
+{
+	Stats s;
+	s.allocations = allocations;
+	s.reuses = reuses;
+	s.releases = releases;
+	s.drops = drops;
+	s.bytes = bytes;
+	s.peak_bytes = peak_bytes;
+	s.max_bytes = max_bytes;
+	return s;
+}
+
+void
+SurfaceSWPool::reset_stats()
+{
+	allocations = 0;
+	reuses = 0;
+	releases = 0;
+	drops = 0;
+	peak_bytes = (size_t)bytes;
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,125 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/surfaceswpool.h
+**	\brief SurfaceSWPool Header
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_SURFACESWPOOL_H
+#define __SYNFIG_RENDERING_SURFACESWPOOL_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <synfig/color.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+//! Recycles pixel buffers of SurfaceSW between tasks and frames.
+//! Buffers are grouped by size classes (four classes per power of two).
+//! Each thread keeps the last released buffer for itself,
+//! so the next task of the same thread gets memory which is still in CPU cache,
+//! other buffers are shared by all threads.
+class SurfaceSWPool
+{
+public:
+	struct Stats
+	{
+		long long allocations; //!< count of buffers allocated from system
+		long long reuses;      //!< count of allocations avoided by reusing of released buffers
+		long long releases;    //!< count of buffers returned into pool
+		long long drops;       //!< count of released buffers freed because of memory limit
+		size_t bytes;          //!< memory held by unused buffers
+		size_t peak_bytes;     //!< maximum of \a bytes since last reset_stats()
+		size_t max_bytes;      //!< memory limit
+
+		Stats(): allocations(), reuses(), releases(), drops(), bytes(), peak_bytes(), max_bytes() { }
+	};
+
+private:
+	struct LocalSlot;
+
+	static const int min_exponent = 10; //!< smallest size class is 2^min_exponent pixels
+	static const int classes_count = (8*sizeof(size_t) - min_exponent)*4 + 1;
+
+	std::mutex mutex;
+	std::vector<Color*> buckets[classes_count];
+
+	std::atomic<size_t> max_bytes;
+	std::atomic<size_t> bytes;
+	std::atomic<size_t> peak_bytes;
+	std::atomic<long long> allocations;
+	std::atomic<long long> reuses;
+	std::atomic<long long> releases;
+	std::atomic<long long> drops;
+
+	static thread_local LocalSlot local_slot;
+
+	explicit SurfaceSWPool(size_t max_bytes);
+
+	bool reserve_bytes(size_t size);
+	void push(int index, Color *pixels);
+	void trim();
+
+public:
+	//! pool lives until exit of process, so surfaces may be freed at any time
+	static SurfaceSWPool& instance();
+
+	//! Rounds \a count up to the size class, returns index of the class
+	static int get_class(size_t count, size_t &capacity);
+	static size_t get_class_capacity(int index);
+
+	//! Returns buffer for at least \a count pixels, its real size is returned in \a capacity.
+	//! Content of reused buffers is undefined, new buffers are filled by zeros (see \a zeroed).
+	Color* alloc(size_t count, size_t &capacity, bool &zeroed);
+	//! Returns buffer into pool, \a capacity should be the same as returned by alloc()
+	void release(Color *pixels, size_t capacity);
+
+	size_t get_max_bytes() const
+		{ return max_bytes; }
+	void set_max_bytes(size_t max_bytes);
+
+	//! frees all unused buffers shared between threads
+	void clear();
+	Stats get_stats() const;
+	void reset_stats();
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,261 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/surfaceswrgba16f.cpp
+**	\brief SurfaceSWRGBA16F
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+#include "surfaceswrgba16f.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+// F16C code is compiled with function attributes and selected at runtime,
+// intrinsics are allowed in functions with target attribute since GCC 4.9
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+ && (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+ #define SURFACE_RGBA16F_F16C
+ #define SURFACE_RGBA16F_TARGET_F16C __attribute__((target("f16c")))
+ #include <cpuid.h>
+ #include <immintrin.h>
+#endif
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+// conversions with rounding to nearest even, see
+// https://gist.github.com/rygorous/2156668
+
+inline uint32_t float_bits(float x)
+	{ uint32_t u; memcpy(&u, &x, sizeof(u)); return u; }
+inline float bits_float(uint32_t u)
+	{ float x; memcpy(&x, &u, sizeof(x)); return x; }
+
+uint16_t
+float_to_half(float x)
+{
+	const uint32_t f32_infinity = 255u << 23;
+	const uint32_t f16_max      = (127u + 16u) << 23;
+	const uint32_t denorm_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+	uint32_t u = float_bits(x);
+	const uint32_t sign = u & 0x80000000u;
+	u ^= sign;
+
+	uint32_t h;
+	if (u >= f16_max) {
+		// overflow to infinity, NaN stays NaN
+		h = u > f32_infinity ? 0x7e00u : 0x7c00u;
+	} else
+	if (u < (113u << 23)) {
+		// subnormal or zero, let the FPU do the rounding
+		h = float_bits(bits_float(u) + bits_float(denorm_magic)) - denorm_magic;
+	} else {
+		const uint32_t mantissa_odd = (u >> 13) & 1u;
+		u += ((15u - 127u) << 23) + 0xfffu + mantissa_odd;
+		h = u >> 13;
+	}
+	return (uint16_t)(h | (sign >> 16));
+}
+
+float
+half_to_float(uint16_t h)
+{
+	const uint32_t shifted_exp = 0x7c00u << 13;
+	uint32_t u = ((uint32_t)h & 0x7fffu) << 13;
+	const uint32_t exp = u & shifted_exp;
+	u += (127u - 15u) << 23;
+	if (exp == shifted_exp) {
+		// infinity or NaN
+		u += (128u - 16u) << 23;
+	} else
+	if (!exp) {
+		// subnormal or zero
+		u += 1u << 23;
+		u = float_bits(bits_float(u) - bits_float(113u << 23));
+	}
+	return bits_float(u | (((uint32_t)h & 0x8000u) << 16));
+}
+
+void
+encode_generic(const Color *src, SurfaceSWRGBA16F::Channel *dest, int count)
+{
+	for(const Color *end = src + count; src < end; ++src, dest += 4) {
+		dest[0] = float_to_half(src->get_r());
+		dest[1] = float_to_half(src->get_g());
+		dest[2] = float_to_half(src->get_b());
+		dest[3] = float_to_half(src->get_a());
+	}
+}
+
+void
+decode_generic(const SurfaceSWRGBA16F::Channel *src, Color *dest, int count)
+{
+	for(Color *end = dest + count; dest < end; ++dest, src += 4)
+		*dest = Color(half_to_float(src[0]), half_to_float(src[1]), half_to_float(src[2]), half_to_float(src[3]));
+}
+
+#ifdef SURFACE_RGBA16F_F16C
+
+// Color is stored as four floats r, g, b, a, so one pixel is converted by one instruction
+
+//! __builtin_cpu_supports() doesn't know "f16c" in older compilers, so ask CPUID,
+//! F16C instructions are VEX encoded, so OS should also save AVX registers
+bool
+cpu_supports_f16c()
+{
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+	if (!(ecx & bit_F16C) || !(ecx & bit_AVX) || !(ecx & bit_OSXSAVE))
+		return false;
+	unsigned int xcr0, xcr0_high;
+	__asm__ __volatile__ ("xgetbv" : "=a"(xcr0), "=d"(xcr0_high) : "c"(0));
+	return (xcr0 & 6) == 6; // XMM and YMM state
+}
+
+SURFACE_RGBA16F_TARGET_F16C void
+encode_f16c(const Color *src, SurfaceSWRGBA16F::Channel *dest, int count)
+{
+	for(const Color *end = src + count; src < end; ++src, dest += 4)
+		_mm_storel_epi64((__m128i*)dest, _mm_cvtps_ph(_mm_loadu_ps((const float*)src), 0));
+}
+
+SURFACE_RGBA16F_TARGET_F16C void
+decode_f16c(const SurfaceSWRGBA16F::Channel *src, Color *dest, int count)
+{
+	for(Color *end = dest + count; dest < end; ++dest, src += 4)
+		_mm_storeu_ps((float*)dest, _mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)src)));
+}
+
+#endif // SURFACE_RGBA16F_F16C
+
+//! Conversion functions, selected once for current CPU
+class ConvertFuncs
+{
+public:
+	void (*encode)(const Color*, SurfaceSWRGBA16F::Channel*, int);
+	void (*decode)(const SurfaceSWRGBA16F::Channel*, Color*, int);
+
+	ConvertFuncs(): encode(encode_generic), decode(decode_generic)
+	{
+		#ifdef SURFACE_RGBA16F_F16C
+		if (cpu_supports_f16c())
+			{ encode = encode_f16c; decode = decode_f16c; }
+		#endif
+	}
+
+	static const ConvertFuncs& instance()
+		{ static const ConvertFuncs funcs; return funcs; }
+};
+
+} // end of anonimous namespace
+
+/* === M E T H O D S ======================================================= */
+
+
+rendering::Surface::Token SurfaceSWRGBA16F::token(
+	Desc<SurfaceSWRGBA16F>("SurfaceSWRGBA16F") );
+
+
+void
+SurfaceSWRGBA16F::encode(const Color *src, Channel *dest, int count)
+	{ ConvertFuncs::instance().encode(src, dest, count); }
+
+void
+SurfaceSWRGBA16F::decode(const Channel *src, Color *dest, int count)
+	{ ConvertFuncs::instance().decode(src, dest, count); }
+
+bool
+SurfaceSWRGBA16F::create_vfunc(int width, int height)
+{
+	pixels.assign(4*width*height, 0);
+	return true;
+}
+
+bool
+SurfaceSWRGBA16F::assign_vfunc(const rendering::Surface &surface)
+{
+	if (const SurfaceSWRGBA16F *s = dynamic_cast<const SurfaceSWRGBA16F*>(&surface))
+		{ pixels = s->pixels; return true; }
+
+	const int count = surface.get_pixels_count();
+	std::vector<Color> buffer;
+	const Color *src = surface.get_pixels_pointer();
+	if (!src) {
+		buffer.resize(count);
+		if (!surface.get_pixels(&buffer.front()))
+			return false;
+		src = &buffer.front();
+	}
+	pixels.resize(4*count);
+	encode(src, &pixels.front(), count);
+	return true;
+}
+
+bool
+SurfaceSWRGBA16F::clear_vfunc()
+{
+	std::fill(pixels.begin(), pixels.end(), 0);
+	return true;
+}
+
+bool
+SurfaceSWRGBA16F::reset_vfunc()
+{
+	std::vector<Channel>().swap(pixels);
+	return true;
+}
+
+bool
+SurfaceSWRGBA16F::get_pixels_vfunc(Color *dest) const
+{
+	decode(&pixels.front(), dest, get_pixels_count());
+	return true;
+}
+
+bool
+SurfaceSWRGBA16F::get_pixels_row_vfunc(int x, int y, int count, Color *dest) const
+{
+	decode(get_row(y) + 4*x, dest, count);
+	return true;
+}
+
+/* === E N T R Y P O I N T ================================================= */
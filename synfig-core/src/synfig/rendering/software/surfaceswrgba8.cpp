@@ -0,0 +1,168 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/surfaceswrgba8.cpp
+**	\brief SurfaceSWRGBA8
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+
+#include "surfaceswrgba8.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+inline SurfaceSWRGBA8::Channel
+to_channel(float x)
+	{ return (SurfaceSWRGBA8::Channel)(x*255.f + 0.5f); }
+
+inline float
+clamp_channel(float x)
+	{ return x > 0.f ? (x < 1.f ? x : 1.f) : 0.f; } // NaN goes to zero
+
+//! 1/a for all alpha values, to demultiply channels without division
+class ReciprocalTable
+{
+public:
+	float values[256];
+
+	ReciprocalTable()
+	{
+		values[0] = 0.f;
+		for(int i = 1; i < 256; ++i)
+			values[i] = 1.f/(float)i;
+	}
+
+	static const ReciprocalTable& instance()
+		{ static const ReciprocalTable table; return table; }
+};
+
+} // end of anonimous namespace
+
+/* === M E T H O D S ======================================================= */
+
+
+rendering::Surface::Token SurfaceSWRGBA8::token(
+	Desc<SurfaceSWRGBA8>("SurfaceSWRGBA8") );
+
+
+void
+SurfaceSWRGBA8::encode(const Color *src, Channel *dest, int count)
+{
+	for(const Color *end = src + count; src < end; ++src, dest += 4) {
+		const float a = clamp_channel(src->get_a());
+		dest[0] = to_channel(clamp_channel(src->get_r())*a);
+		dest[1] = to_channel(clamp_channel(src->get_g())*a);
+		dest[2] = to_channel(clamp_channel(src->get_b())*a);
+		dest[3] = to_channel(a);
+	}
+}
+
+void
+SurfaceSWRGBA8::decode(const Channel *src, Color *dest, int count)
+{
+	const float *reciprocal = ReciprocalTable::instance().values;
+	for(Color *end = dest + count; dest < end; ++dest, src += 4) {
+		// color of transparent pixel is lost, it becomes transparent black
+		const float k = reciprocal[src[3]];
+		*dest = Color(
+			std::min(1.f, src[0]*k),
+			std::min(1.f, src[1]*k),
+			std::min(1.f, src[2]*k),
+			src[3]*(1.f/255.f) );
+	}
+}
+
+bool
+SurfaceSWRGBA8::create_vfunc(int width, int height)
+{
+	pixels.assign(4*width*height, 0);
+	return true;
+}
+
+bool
+SurfaceSWRGBA8::assign_vfunc(const rendering::Surface &surface)
+{
+	if (const SurfaceSWRGBA8 *s = dynamic_cast<const SurfaceSWRGBA8*>(&surface))
+		{ pixels = s->pixels; return true; }
+
+	const int count = surface.get_pixels_count();
+	std::vector<Color> buffer;
+	const Color *src = surface.get_pixels_pointer();
+	if (!src) {
+		buffer.resize(count);
+		if (!surface.get_pixels(&buffer.front()))
+			return false;
+		src = &buffer.front();
+	}
+	pixels.resize(4*count);
+	encode(src, &pixels.front(), count);
+	return true;
+}
+
+bool
+SurfaceSWRGBA8::clear_vfunc()
+{
+	std::fill(pixels.begin(), pixels.end(), 0);
+	return true;
+}
+
+bool
+SurfaceSWRGBA8::reset_vfunc()
+{
+	std::vector<Channel>().swap(pixels);
+	return true;
+}
+
+bool
+SurfaceSWRGBA8::get_pixels_vfunc(Color *dest) const
+{
+	decode(&pixels.front(), dest, get_pixels_count());
+	return true;
+}
+
+bool
+SurfaceSWRGBA8::get_pixels_row_vfunc(int x, int y, int count, Color *dest) const
+{
+	decode(get_row(y) + 4*x, dest, count);
+	return true;
+}
+
+/* === E N T R Y P O I N T ================================================= */
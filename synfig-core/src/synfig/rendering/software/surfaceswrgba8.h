@@ -0,0 +1,90 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/surfaceswrgba8.h
+**	\brief SurfaceSWRGBA8 Header
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_SURFACESWRGBA8_H
+#define __SYNFIG_RENDERING_SURFACESWRGBA8_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <cstdint>
+#include <vector>
+
+#include "../surface.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+//! Surface with 8-bit premultiplied channels r, g, b, a,
+//! a quarter of memory of SurfaceSW, channels are clamped to [0, 1].
+//! Only results stored in RenderCache by draft renderer use it, see OptimizerCache.
+class SurfaceSWRGBA8: public Surface
+{
+public:
+	typedef etl::handle<SurfaceSWRGBA8> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const
+		{ return token.handle(); }
+
+	typedef uint8_t Channel;
+
+	static void encode(const Color *src, Channel *dest, int count);
+	static void decode(const Channel *src, Color *dest, int count);
+
+protected:
+	virtual bool create_vfunc(int width, int height);
+	virtual bool assign_vfunc(const Surface &surface);
+	virtual bool clear_vfunc();
+	virtual bool reset_vfunc();
+	virtual bool get_pixels_vfunc(Color *dest) const;
+	virtual bool get_pixels_row_vfunc(int x, int y, int count, Color *dest) const;
+
+private:
+	std::vector<Channel> pixels;
+
+public:
+	//! four channels per pixel
+	const Channel* get_row(int y) const
+		{ return &pixels[4*y*get_width()]; }
+
+	virtual size_t get_memory_size() const
+		{ return pixels.size()*sizeof(Channel); }
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
@@ -32,9 +32,13 @@
 #	include <config.h>
 #endif
 
+#include <vector>
+
 #include <synfig/debug/debugsurface.h>
 
 #include "../../common/task/taskblend.h"
+#include "../surfaceswrgba16f.h"
+#include "../surfaceswrgba8.h"
 #include "tasksw.h"
 
 #endif
@@ -52,6 +56,17 @@ using namespace rendering;
 
 namespace {
 
+//! Locks source surface without conversion when it stored in compact format,
+//! such surfaces will be decoded row by row
+bool
+lock_source(Task::LockReadBase &lock)
+{
+	return lock.convert(SurfaceSW::token.handle(), false)
+		|| lock.convert(SurfaceSWRGBA16F::token.handle(), false)
+		|| lock.convert(SurfaceSWRGBA8::token.handle(), false)
+		|| lock.convert(SurfaceSW::token.handle());
+}
+
 class TaskBlendSW: public TaskBlend,
                    public TaskSW,
                    public TaskInterfaceTargetAsSource
@@ -75,6 +90,12 @@ public:
 	virtual bool run(RunParams&) const {
 		if (!is_valid()) return true;
 
+		// surface a will be copied over the whole target rect
+		if ( sub_task_a() && sub_task_a()->is_valid()
+		  && sub_task_a()->target_surface != target_surface
+		  && rect_contains(sub_task_a()->target_rect - get_offset_a(), target_rect) )
+			target_surface->will_overwrite(target_rect);
+
 		LockWrite lc(this);
 		if (!lc) return false;
 		synfig::Surface &c = lc->get_surface();
@@ -91,22 +112,18 @@ public:
 				rect_set_intersect(ra, ra, r);
 				if (ra.is_valid() && sub_task_a()->target_surface != target_surface)
 				{
-					LockRead la(sub_task_a());
-					if (!la) return false;
-					synfig::Surface &a = la.cast_handle()->get_surface(); // TODO: make blit_to constant
+					LockReadBase la(sub_task_a());
+					if (!lock_source(la)) return false;
+					const rendering::Surface &a = *la.get_surface();
 
 					assert( 0 <= ra.minx && ra.minx < ra.maxx && ra.maxx <= c.get_w()
 						 && 0 <= ra.miny && ra.miny < ra.maxy && ra.miny <= c.get_h() );
-					assert( 0 <= ra.minx + oa[0] && ra.maxx + oa[0] <= a.get_w()
-						 && 0 <= ra.miny + oa[1] && ra.maxy + oa[1] <= a.get_h() );
-
-					synfig::Surface::pen p = c.get_pen(ra.minx, ra.miny);
-					a.blit_to(
-						p,
-						ra.minx + oa[0],
-						ra.miny + oa[1],
-						ra.maxx - ra.minx,
-						ra.maxy - ra.miny );
+					assert( 0 <= ra.minx + oa[0] && ra.maxx + oa[0] <= a.get_width()
+						 && 0 <= ra.miny + oa[1] && ra.maxy + oa[1] <= a.get_height() );
+
+					for(int y = ra.miny; y < ra.maxy; ++y)
+						if (!a.get_pixels_row(ra.minx + oa[0], y + oa[1], ra.maxx - ra.minx, c[y] + ra.minx))
+							return false;
 				}
 			}
 		}
@@ -122,24 +139,29 @@ public:
 				rect_set_intersect(rb, rb, r);
 				if (rb.is_valid())
 				{
-					LockRead lb(sub_task_b());
-					if (!lb) return false;
-					synfig::Surface &b = lb.cast_handle()->get_surface(); // TODO: make blit_to constant
+					LockReadBase lb(sub_task_b());
+					if (!lock_source(lb)) return false;
+					const rendering::Surface &b = *lb.get_surface();
 
 					assert( 0 <= rb.minx && rb.minx < rb.maxx && rb.maxx <= c.get_w()
 						 && 0 <= rb.miny && rb.miny < rb.maxy && rb.miny <= c.get_h() );
-					assert( 0 <= rb.minx + ob[0] && rb.maxx + ob[0] <= b.get_w()
-						 && 0 <= rb.miny + ob[1] && rb.maxy + ob[1] <= b.get_h() );
-
-					synfig::Surface::alpha_pen ap(c.get_pen(rb.minx, rb.miny));
-					ap.set_blend_method(blend_method);
-					ap.set_alpha(amount);
-					b.blit_to(
-						ap,
-						rb.minx + ob[0],
-						rb.miny + ob[1],
-						rb.maxx - rb.minx,
-						rb.maxy - rb.miny );
+					assert( 0 <= rb.minx + ob[0] && rb.maxx + ob[0] <= b.get_width()
+						 && 0 <= rb.miny + ob[1] && rb.maxy + ob[1] <= b.get_height() );
+
+					const int w = rb.maxx - rb.minx;
+					const Color *pixels = b.get_pixels_pointer();
+					std::vector<Color> row(pixels ? 0 : w);
+					for(int y = rb.miny; y < rb.maxy; ++y) {
+						const Color *src;
+						if (pixels) {
+							src = pixels + (y + ob[1])*b.get_width() + rb.minx + ob[0];
+						} else {
+							if (!b.get_pixels_row(rb.minx + ob[0], y + ob[1], w, &row.front()))
+								return false;
+							src = &row.front();
+						}
+						Color::blend_span(c[y] + rb.minx, src, w, amount, blend_method);
+					}
 
 					if (ra.is_valid())
 					{
@@ -0,0 +1,189 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/task/taskdistortsw.cpp
+**	\brief TaskDistortSW
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <synfig/general.h>
+#include <synfig/threadpool.h>
+
+#include "../../common/task/taskdistort.h"
+#include "tasksw.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+//! minimal count of pixels for separate thread
+static const int min_band_pixels = 16384;
+
+//! count of pixels of row mapped by single call of Distortion::map_row()
+static const int block_pixels = 256;
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+namespace {
+
+class TaskDistortSW: public TaskDistort, public TaskSW
+{
+public:
+	typedef etl::handle<TaskDistortSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+private:
+	struct Params
+	{
+		const Distortion *distortion;
+		synfig::Surface *dst;
+		const synfig::Surface *src;
+		RectInt rect;        //!< pixels of dst to process
+		Point origin;        //!< units of pixel (0, 0) of dst
+		Vector upp;          //!< units per pixel of dst
+		Point src_origin;    //!< pixel of src at zero units
+		Vector src_ppu;      //!< pixels of src per unit
+		Rect src_rect;       //!< valid pixels of src
+
+		Params(): distortion(), dst(), src() { }
+	};
+
+	template<synfig::Surface::sampler_cook::func func>
+	static void process_rows(const Params *params, int begin, int end)
+	{
+		const Params &p = *params;
+		const Vector step(p.upp[0], 0.0);
+		Point source[block_pixels];
+		bool mapped[block_pixels];
+		for(int r = begin; r < end; ++r) {
+			for(int x = p.rect.minx; x < p.rect.maxx; x += block_pixels) {
+				const int count = std::min(block_pixels, p.rect.maxx - x);
+				const Point point(p.origin[0] + p.upp[0]*x, p.origin[1] + p.upp[1]*r);
+				p.distortion->map_row(point, step, source, mapped, count);
+
+				Color *c = &(*p.dst)[r][x];
+				for(int i = 0; i < count; ++i) {
+					if (!mapped[i])
+						continue;
+					const Point s(
+						p.src_origin[0] + p.src_ppu[0]*source[i][0],
+						p.src_origin[1] + p.src_ppu[1]*source[i][1] );
+					if (p.src_rect.is_inside(s))
+						c[i] = ColorPrep::uncook_static(func(p.src, s[0], s[1]));
+				}
+			}
+		}
+	}
+
+	template<synfig::Surface::sampler_cook::func func>
+	static void process(const Params &params)
+	{
+		const int rows = params.rect.get_height();
+		const int pixels = rows*params.rect.get_width();
+		int bands = std::min(rows, std::max(1, ThreadPool::instance().get_max_threads()));
+		bands = std::max(1, std::min(bands, pixels/min_band_pixels));
+		if (bands <= 1)
+			{ process_rows<func>(&params, params.rect.miny, params.rect.maxy); return; }
+
+		ThreadPool::Group group;
+		for(int i = 0; i < bands; ++i)
+			group.enqueue( sigc::bind( sigc::ptr_fun(&process_rows<func>), &params,
+				params.rect.miny + (int)((long long)rows*i/bands),
+				params.rect.miny + (int)((long long)rows*(i + 1)/bands) ));
+		group.run();
+	}
+
+public:
+	virtual bool run(RunParams&) const
+	{
+		if (!is_valid() || !distortion || !sub_task() || !sub_task()->is_valid())
+			return true;
+
+		LockWrite ldst(this);
+		if (!ldst)
+			return false;
+		LockRead lsrc(sub_task());
+		if (!lsrc)
+			return false;
+
+		synfig::Surface &dst_surface = ldst->get_surface();
+		const synfig::Surface &src_surface = lsrc->get_surface();
+
+		Params params;
+		params.distortion = distortion.get();
+		params.dst = &dst_surface;
+		params.src = &src_surface;
+		params.rect = RectInt(0, 0, dst_surface.get_w(), dst_surface.get_h()) & target_rect;
+		if (!params.rect.is_valid())
+			return true;
+
+		params.upp = get_units_per_pixel();
+		params.origin = Point(
+			source_rect.minx - params.upp[0]*target_rect.minx,
+			source_rect.miny - params.upp[1]*target_rect.miny );
+
+		const Task &sub = *sub_task();
+		params.src_ppu = sub.get_pixels_per_unit();
+		params.src_origin = Point(
+			sub.target_rect.minx - params.src_ppu[0]*sub.source_rect.minx,
+			sub.target_rect.miny - params.src_ppu[1]*sub.source_rect.miny );
+		params.src_rect = Rect(
+			sub.target_rect.minx, sub.target_rect.miny,
+			sub.target_rect.maxx, sub.target_rect.maxy ) & Rect(0, 0, src_surface.get_w(), src_surface.get_h());
+
+		switch(interpolation) {
+			case Color::INTERPOLATION_NEAREST:
+				process<synfig::Surface::sampler_cook::nearest_sample>(params); break;
+			case Color::INTERPOLATION_COSINE:
+				process<synfig::Surface::sampler_cook::cosine_sample>(params); break;
+			case Color::INTERPOLATION_CUBIC:
+				process<synfig::Surface::sampler_cook::cubic_sample>(params); break;
+			default: // linear
+				process<synfig::Surface::sampler_cook::linear_sample>(params); break;
+		}
+
+		return true;
+	}
+};
+
+
+Task::Token TaskDistortSW::token(
+	DescReal<TaskDistortSW, TaskDistort>("DistortSW") );
+
+} // end of anonimous namespace
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,199 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/task/taskescapetimesw.cpp
+**	\brief TaskEscapeTimeSW
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <synfig/general.h>
+#include <synfig/threadpool.h>
+
+#include "../../common/task/taskescapetime.h"
+#include "tasksw.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+//! minimal count of iterations for separate thread
+static const long long min_band_iterations = 1 << 20;
+
+//! count of bands per thread, see TaskEscapeTimeSW::run()
+static const int bands_per_thread = 4;
+
+//! count of pixels of row iterated by single call of EscapeTime::iterate_row()
+static const int block_pixels = 256;
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+namespace {
+
+//! Samples rendered context of layer, like Layer_RenderingTask::get_color()
+class SourceSW: public EscapeTime::Source
+{
+public:
+	const synfig::Surface *surface;
+	Point origin;  //!< pixel of surface at zero units
+	Vector ppu;    //!< pixels of surface per unit
+	Rect rect;     //!< valid pixels of surface
+
+	SourceSW(): surface() { }
+
+	virtual Color get_color(const Point &point) const
+	{
+		if (!surface)
+			return Color(0.0, 0.0, 0.0, 0.0);
+		const Point p(origin[0] + ppu[0]*point[0], origin[1] + ppu[1]*point[1]);
+		return rect.is_inside(p)
+		     ? surface->linear_sample(p[0], p[1])
+		     : Color(0.0, 0.0, 0.0, 0.0);
+	}
+};
+
+class TaskEscapeTimeSW: public TaskEscapeTime, public TaskSW
+{
+public:
+	typedef etl::handle<TaskEscapeTimeSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+private:
+	struct Params
+	{
+		const EscapeTime *escape_time;
+		int iterations;
+		synfig::Surface *dst;
+		SourceSW source;
+		RectInt rect;        //!< pixels of dst to process
+		Point origin;        //!< units of pixel (0, 0) of dst
+		Vector upp;          //!< units per pixel of dst
+
+		Params(): escape_time(), iterations(), dst() { }
+	};
+
+	static void process_rows(const Params *params, int begin, int end)
+	{
+		const Params &p = *params;
+		const Vector step(p.upp[0], 0.0);
+		EscapeTime::Orbit orbits[block_pixels];
+		for(int r = begin; r < end; ++r) {
+			for(int x = p.rect.minx; x < p.rect.maxx; x += block_pixels) {
+				const int count = std::min(block_pixels, p.rect.maxx - x);
+				// center of pixel
+				const Point point(p.origin[0] + p.upp[0]*(x + 0.5), p.origin[1] + p.upp[1]*(r + 0.5));
+				p.escape_time->iterate_row(point, step, orbits, count, p.iterations);
+
+				Color *c = &(*p.dst)[r][x];
+				for(int i = 0; i < count; ++i) {
+					const Color color = p.escape_time->shade(point + step*i, orbits[i], p.iterations, p.source);
+					c[i] = color.get_a() ? color : Color::alpha();
+				}
+			}
+		}
+	}
+
+public:
+	virtual bool run(RunParams&) const
+	{
+		if (!is_valid() || !escape_time)
+			return true;
+
+		LockWrite ldst(this);
+		if (!ldst)
+			return false;
+
+		synfig::Surface &dst_surface = ldst->get_surface();
+
+		Params params;
+		params.escape_time = escape_time.get();
+		params.iterations = get_iterations();
+		params.dst = &dst_surface;
+		params.rect = RectInt(0, 0, dst_surface.get_w(), dst_surface.get_h()) & target_rect;
+		if (!params.rect.is_valid())
+			return true;
+
+		params.upp = get_units_per_pixel();
+		params.origin = Point(
+			source_rect.minx - params.upp[0]*target_rect.minx,
+			source_rect.miny - params.upp[1]*target_rect.miny );
+
+		LockRead lsrc(sub_task());
+		if ( escape_time->uses_source()
+		  && sub_task()
+		  && sub_task()->is_valid()
+		  && lsrc )
+		{
+			const Task &sub = *sub_task();
+			const synfig::Surface &src_surface = lsrc->get_surface();
+			params.source.surface = &src_surface;
+			params.source.ppu = sub.get_pixels_per_unit();
+			params.source.origin = Point(
+				sub.target_rect.minx - params.source.ppu[0]*sub.source_rect.minx,
+				sub.target_rect.miny - params.source.ppu[1]*sub.source_rect.miny );
+			params.source.rect = Rect(
+				sub.target_rect.minx, sub.target_rect.miny,
+				sub.target_rect.maxx, sub.target_rect.maxy ) & Rect(0, 0, src_surface.get_w(), src_surface.get_h());
+		}
+
+		// cost of rows differs a lot (the set is usually in the middle of picture),
+		// so there are several bands per thread, they are balanced by ThreadPool
+		const int rows = params.rect.get_height();
+		const long long work = (long long)rows*params.rect.get_width()*std::max(1, params.iterations);
+		int bands = std::min(rows, std::max(1, ThreadPool::instance().get_max_threads())*bands_per_thread);
+		bands = (int)std::max(1ll, std::min((long long)bands, work/min_band_iterations));
+		if (bands <= 1)
+			{ process_rows(&params, params.rect.miny, params.rect.maxy); return true; }
+
+		ThreadPool::Group group;
+		for(int i = 0; i < bands; ++i)
+			group.enqueue( sigc::bind( sigc::ptr_fun(&process_rows), &params,
+				params.rect.miny + (int)((long long)rows*i/bands),
+				params.rect.miny + (int)((long long)rows*(i + 1)/bands) ));
+		group.run();
+
+		return true;
+	}
+};
+
+
+Task::Token TaskEscapeTimeSW::token(
+	DescReal<TaskEscapeTimeSW, TaskEscapeTime>("EscapeTimeSW") );
+
+} // end of anonimous namespace
+
+/* === E N T R Y P O I N T ================================================= */
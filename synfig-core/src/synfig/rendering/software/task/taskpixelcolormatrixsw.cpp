@@ -67,6 +67,9 @@ public:
 		ColorMatrix::BatchProcessor processor(matrix);
 		std::vector<RectInt> constant_rects(1, rd);
 
+		// every pixel of target rect is written below
+		if (!sub_task() || sub_task()->target_surface != target_surface)
+			target_surface->will_overwrite(rd);
 		LockWrite ldst(this);
 		if (!ldst) return false;
 		synfig::Surface &dst = ldst->get_surface();
@@ -199,6 +199,8 @@ public:
 		rect_set_intersect(rs, rs, rd);
 		if (rs.is_valid())
 		{
+			if (rs == rd && sub_task()->target_surface != target_surface)
+				target_surface->will_overwrite(rd);
 			LockWrite ldst(this);
 			if (!ldst) return false;
 			LockRead lsrc(sub_task());
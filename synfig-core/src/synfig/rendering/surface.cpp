@@ -34,6 +34,8 @@
 
 #include <cstring>
 
+#include <synfig/debug/trace.h>
+
 #include "surface.h"
 
 #include "common/surfacememoryreadwrapper.h"
@@ -52,7 +54,7 @@ using namespace rendering;
 /* === M E T H O D S ======================================================= */
 
 synfig::Token Surface::token;
-int SurfaceResource::last_id = 0;
+std::atomic<int> SurfaceResource::last_id(0);
 
 Surface::Surface():
 	blank(true),
@@ -86,8 +88,21 @@ Surface::get_pixels_vfunc(Color *dest) const
 	return true;
 }
 
+bool
+Surface::get_pixels_row_vfunc(int x, int y, int count, Color *dest) const
+{
+	const Color *src = get_pixels_pointer();
+	if (!src) return false;
+	memcpy(dest, src + y*get_width() + x, count*sizeof(Color));
+	return true;
+}
+
 bool
 Surface::create(int width, int height)
+	{ return create(width, height, std::vector<RectInt>()); }
+
+bool
+Surface::create(int width, int height, const std::vector<RectInt> &uninitialized_rects)
 {
 	if (is_exists() && width == this->width && height == this->height && this->blank)
 		return true;
@@ -95,7 +110,9 @@ Surface::create(int width, int height)
 		return false;
 	if (is_exists())
 		reset();
-	if (!create_vfunc(width, height))
+	if (!( uninitialized_rects.empty()
+		 ? create_vfunc(width, height)
+		 : create_uninitialized_vfunc(width, height, uninitialized_rects) ))
 	{
 		if (!reset()) assert(false);
 		return false;
@@ -187,6 +204,16 @@ Surface::get_pixels(Color *dest) const
 	return get_pixels_vfunc(dest);
 }
 
+bool
+Surface::get_pixels_row(int x, int y, int count, Color *dest) const
+{
+	if (!is_exists() || !dest || count < 0)
+		return false;
+	if (x < 0 || y < 0 || x + count > get_width() || y >= get_height())
+		return false;
+	return !count || get_pixels_row_vfunc(x, y, count, dest);
+}
+
 bool
 Surface::compare_with(synfig::rendering::Surface::Handle s) const
 {
@@ -214,12 +241,15 @@ Surface::touch()
 
 SurfaceResource::SurfaceResource():
 	id(++last_id),
+	version(),
 	width(),
 	height(),
 	blank(true)
 { }
 
 SurfaceResource::SurfaceResource(Surface::Handle surface):
+	id(++last_id),
+	version(),
 	width(),
 	height(),
 	blank(true)
@@ -267,9 +297,11 @@ SurfaceResource::get_surface(
 			return Surface::Handle();
 
 		if (blank) {
-			if (!surface->create(width, height))
+			if (!surface->create(width, height, exclusive ? overwrite_rects : std::vector<RectInt>()))
 				return Surface::Handle();
 		} else {
+			// named by the type of new surface
+			debug::Trace::Scope trace("surface conversion", token->name.c_str(), RectInt(0, 0, width, height));
 			bool found = false;
 			for(Map::const_iterator i = surfaces.begin(); i != surfaces.end() && !found; ++i)
 				if (i->second->get_pixels_pointer() && surface->assign(*i->second))
@@ -290,6 +322,8 @@ SurfaceResource::get_surface(
 			{ surfaces.clear(); surfaces[token] = surface; }
 		surface->touch();
 		blank = false;
+		overwrite_rects.clear();
+		++version;
 	}
 	return surface;
 }
@@ -308,6 +342,16 @@ SurfaceResource::create(int width, int height)
 	}
 	blank = true;
 	surfaces.clear();
+	overwrite_rects.clear();
+	++version;
+}
+
+void
+SurfaceResource::will_overwrite(const RectInt &rect)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (blank && rect.is_valid())
+		overwrite_rects.push_back(rect);
 }
 
 void
@@ -324,6 +368,8 @@ SurfaceResource::assign(Surface::Handle surface)
 	height = 0;
 	blank = true;
 	surfaces.clear();
+	overwrite_rects.clear();
+	++version;
 	if (!surface->is_exists())
 		return;
 
@@ -340,6 +386,8 @@ SurfaceResource::clear()
 	std::lock_guard<std::mutex> short_lock(mutex);
 	blank = true;
 	surfaces.clear();
+	overwrite_rects.clear();
+	++version;
 }
 
 void
@@ -351,6 +399,8 @@ SurfaceResource::reset()
 	height = 0;
 	blank = true;
 	surfaces.clear();
+	overwrite_rects.clear();
+	++version;
 }
 
 /* === E N T R Y P O I N T ================================================= */
@@ -30,6 +30,7 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <atomic>
 #include <map>
 #include <vector>
 
@@ -118,6 +119,10 @@ protected:
 
 	virtual bool create_vfunc(int /* width */, int /* height */)
 		{ return false; }
+	//! Creates surface where pixels in \a rects may be left uninitialized,
+	//! because caller will overwrite them anyway
+	virtual bool create_uninitialized_vfunc(int width, int height, const std::vector<RectInt> & /* rects */)
+		{ return create_vfunc(width, height); }
 	virtual bool assign_vfunc(const Surface & /* other */)
 		{ return false; }
 	virtual bool clear_vfunc()
@@ -128,6 +133,7 @@ protected:
 	virtual const Color* get_pixels_pointer_vfunc() const
 		{ return NULL; }
 	virtual bool get_pixels_vfunc(Color *dest) const;
+	virtual bool get_pixels_row_vfunc(int x, int y, int count, Color *dest) const;
 
 public:
 	Surface();
@@ -137,6 +143,7 @@ public:
 		{ return false; }
 
 	bool create(int width, int height);
+	bool create(int width, int height, const std::vector<RectInt> &uninitialized_rects);
 	bool assign(const Surface &other);
 	bool clear();
 	bool reset();
@@ -149,6 +156,9 @@ public:
 
 	const Color* get_pixels_pointer() const;
 	bool get_pixels(Color *dest) const;
+	//! Reads \a count pixels of row \a y starting from \a x,
+	//! allows to process surfaces of any pixel format row by row without full copy
+	bool get_pixels_row(int x, int y, int count, Color *dest) const;
 
 	bool compare_with(synfig::rendering::Surface::Handle s) const;
 
@@ -160,6 +170,9 @@ public:
 		{ return get_width()*get_height(); }
 	size_t get_buffer_size() const
 		{ return get_pixels_count()*sizeof(Color); }
+	//! memory used by pixels in own format of surface
+	virtual size_t get_memory_size() const
+		{ return get_buffer_size(); }
 	bool is_exists() const
 		{ return get_width() > 0 && get_height() > 0; }
 	bool is_blank() const
@@ -328,13 +341,15 @@ public:
 	};
 
 private:
-	static int last_id;
+	static std::atomic<int> last_id;
 
 	int id = 0;
+	int version;
 	int width;
 	int height;
 	bool blank;
 	Map surfaces;
+	std::vector<RectInt> overwrite_rects;
 
 	mutable std::mutex mutex;
 	mutable Glib::Threads::RWLock rwlock;
@@ -360,8 +375,15 @@ public:
 	void create(const VectorInt &x)
 		{ create(x[0], x[1]); }
 
+	//! Tells that writer will overwrite every pixel in \a rect,
+	//! so if surface is not created yet this rect will be left uninitialized.
+	//! Call it right before the write lock.
+	void will_overwrite(const RectInt &rect);
+
 	int get_id() const //!< helps to debug of renderer optimizers
 		{ return id; }
+	int get_version() const //!< changes every time when content may be changed
+		{ std::lock_guard<std::mutex> lock(mutex); return version; }
 	int get_width() const
 		{ std::lock_guard<std::mutex> lock(mutex); return width; }
 	int get_height() const
@@ -32,6 +32,8 @@
 #	include <config.h>
 #endif
 
+#include <cstring>
+
 #include <synfig/general.h>
 
 #include "task.h"
@@ -48,6 +50,20 @@ using namespace rendering;
 
 /* === P R O C E D U R E S ================================================= */
 
+static inline uint64_t
+rotl64(uint64_t x, int r)
+	{ return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t
+mix_word(uint64_t hash, uint64_t word)
+{
+	word *= 0x87c37b91114253d5ull;
+	word  = rotl64(word, 31);
+	word *= 0x4cf5ad432745937full;
+	hash ^= word;
+	return rotl64(hash, 27)*5 + 0x52dce729;
+}
+
 /* === M E T H O D S ======================================================= */
 
 
@@ -66,6 +82,39 @@ SYNFIG_EXPORT Task::Token TaskEvent::token(
 	DescSpecial<TaskEvent>("Event") );
 
 
+// TaskHash
+
+void
+TaskHash::add(const void *data, size_t size)
+{
+	const unsigned char *bytes = (const unsigned char*)data;
+	length += size;
+	for(; size >= sizeof(uint64_t); size -= sizeof(uint64_t), bytes += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, bytes, sizeof(word));
+		value = mix_word(value, word);
+	}
+	if (size) {
+		uint64_t word = 0;
+		memcpy(&word, bytes, size);
+		value = mix_word(value, word);
+	}
+}
+
+uint64_t
+TaskHash::get() const
+{
+	// finalization mix of MurmurHash3
+	uint64_t h = value ^ length;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+
 // Task
 
 void Task::Token::unprepare_vfunc()
@@ -322,6 +371,39 @@ bool
 Task::run(RunParams & /* params */) const
 	{ return false; }
 
+bool
+Task::calc_hash(TaskHash &hash) const
+{
+	hash.add(get_token()->name);
+	if (!hash_params(hash))
+		return false;
+
+	hash.add(source_rect);
+	hash.add(target_rect);
+	hash.add(target_surface ? target_surface->get_size() : VectorInt::zero());
+
+	hash.add(sub_tasks.size());
+	for(List::const_iterator i = sub_tasks.begin(); i != sub_tasks.end(); ++i)
+		if (!*i) hash.add(false); else
+		if (!(*i)->calc_hash(hash)) return false;
+	return true;
+}
+
+
+// TaskSurface
+
+bool
+TaskSurface::hash_params(TaskHash &hash) const
+{
+	// surface may be changed between frames,
+	// so identify it by both id and version of content
+	if (target_surface) {
+		hash.add(target_surface->get_id());
+		hash.add(target_surface->get_version());
+	}
+	return true;
+}
+
 
 // TaskList
 
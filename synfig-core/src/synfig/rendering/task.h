@@ -30,6 +30,7 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <cstdint>
 #include <vector>
 #include <set>
 #include <map>
@@ -127,6 +128,31 @@ public:
 typedef std::vector<ModeToken::Handle> ModeList;
 
 
+// Task hash
+
+
+//! Accumulates content hash of task tree, see Task::calc_hash()
+class TaskHash
+{
+private:
+	uint64_t value;
+	uint64_t length;
+
+public:
+	TaskHash(): value(), length() { }
+
+	void add(const void *data, size_t size);
+	void add(const String &x)
+		{ add(x.c_str(), x.size()); }
+	//! use only for types without padding bytes
+	template<typename T>
+	void add(const T &x)
+		{ add(&x, sizeof(x)); }
+
+	uint64_t get() const;
+};
+
+
 // Task
 
 
@@ -292,10 +318,33 @@ public:
 		Set tmp_deps;
 		Set tmp_back_deps;
 
+		//! count of unfinished tasks from 'deps', RenderQueue decrements it
+		//! when dependency is done, so 'deps' stays untouched while rendering
+		std::atomic<int> deps_count;
+		//! nobody waits for result of this task anymore, so RenderQueue will skip it
+		std::atomic<bool> orphan;
+
 		RunParams params;
 		bool success;
 
-		RendererData(): batch_index(), index(), success() { }
+		RendererData(): batch_index(), index(), deps_count(), orphan(), success() { }
+		RendererData(const RendererData &other):
+			batch_index(), index(), deps_count(), orphan(), success()
+			{ *this = other; }
+
+		RendererData& operator=(const RendererData &other) {
+			batch_index = other.batch_index;
+			index = other.index;
+			deps = other.deps;
+			back_deps = other.back_deps;
+			tmp_deps = other.tmp_deps;
+			tmp_back_deps = other.tmp_back_deps;
+			deps_count = other.deps_count.load();
+			orphan = other.orphan.load();
+			params = other.params;
+			success = other.success;
+			return *this;
+		}
 	};
 
 	class LockReadBase: public SurfaceResource::LockReadBase
@@ -467,6 +516,15 @@ public:
 	virtual int get_pass_subtask_index() const
 		{ return PASSTO_THIS_TASK; }
 
+	/// Adds own parameters of task (without coordinates and sub-tasks) to hash
+	/// \return false if result of task cannot be identified by its parameters
+	virtual bool hash_params(TaskHash & /* hash */) const
+		{ return false; }
+	/// Calculates hash of whole task tree: tokens, parameters, coordinates and sub-tasks.
+	/// Equal hashes means equal results, so rendered surfaces may be reused
+	/// \return false if any task in tree cannot be hashed
+	bool calc_hash(TaskHash &hash) const;
+
 	void touch_coords();
 	void set_coords(const Rect &source_rect, const VectorInt &target_size);
 	void set_coords_zero();
@@ -529,6 +587,7 @@ public:
 	typedef etl::handle<TaskSurface> Handle;
 	SYNFIG_EXPORT static Token token;
 	virtual Token::Handle get_token() const { return token.handle(); }
+	virtual bool hash_params(TaskHash &hash) const;
 };
 
 
@@ -238,7 +238,37 @@ synfig::Surface::blit_to(alpha_pen& pen, int x, int y, int w, int h)
 		return;
 	}
 #endif
-	etl::surface<Color, ColorAccumulator, ColorPrep>::blit_to(pen,x,y,w,h);
+
+	if(x>=get_w() || y>=get_h())
+		return;
+
+	//clip source origin
+	if(x<0)
+	{
+		w+=x;	//decrease
+		x=0;
+	}
+
+	if(y<0)
+	{
+		h+=y;	//decrease
+		y=0;
+	}
+
+	//clip width against dest width
+	w = std::min((long)w,(long)(pen.end_x()-pen.x()));
+	h = std::min((long)h,(long)(pen.end_y()-pen.y()));
+
+	//clip width against src width
+	w = std::min(w,get_w()-x);
+	h = std::min(h,get_h()-y);
+
+	if(w<=0 || h<=0)
+		return;
+
+	// blend whole rows, the pen moves like in etl::surface::blit_to()
+	for(int i = 0; i < h; ++i, pen.inc_y())
+		Color::blend_span(pen.x(), operator[](y+i)+x, w, alpha, pen.get_blend_method());
 }
 
 
@@ -0,0 +1,95 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file target_framesinflight.cpp
+**	\brief FramesInFlight
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include "target_framesinflight.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+FramesInFlight::FramesInFlight(const Renderer::Handle &renderer, int max_count, const WriteSlot &write_slot):
+	renderer(renderer),
+	max_count(max_count < 1 ? 1 : max_count),
+	write_slot(write_slot)
+{ }
+
+FramesInFlight::~FramesInFlight()
+{
+	// drop frames which will not be written
+	if (frames.empty())
+		return;
+	Task::List events;
+	for(std::deque<FrameInFlight>::iterator i = frames.begin(); i != frames.end(); ++i)
+		events.push_back(i->event);
+	Renderer::cancel(events);
+}
+
+void
+FramesInFlight::submit(int frame, const SurfaceResource::Handle &surface, const Task::Handle &task)
+{
+	FrameInFlight f;
+	f.frame = frame;
+	f.surface = surface;
+	f.event = new TaskEvent();
+	if (task)
+		renderer->enqueue(task, f.event);
+	else
+		f.event->finish(true);
+	frames.push_back(f);
+}
+
+bool
+FramesInFlight::write(bool all)
+{
+	while(!frames.empty() && (all || (int)frames.size() >= max_count))
+	{
+		if (!write_slot(frames.front()))
+			return false;
+		frames.pop_front();
+	}
+	return true;
+}
+
+/* === E N T R Y P O I N T ================================================= */
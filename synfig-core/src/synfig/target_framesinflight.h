@@ -0,0 +1,97 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file target_framesinflight.h
+**	\brief FramesInFlight Header
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_TARGET_FRAMESINFLIGHT_H
+#define __SYNFIG_TARGET_FRAMESINFLIGHT_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <deque>
+
+#include <sigc++/sigc++.h>
+
+#include "rendering/renderer.h"
+#include "rendering/surface.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig {
+
+//! Frame sent to the renderer, see FramesInFlight
+struct FrameInFlight
+{
+	//! value of Target::curr_frame_ after next_frame() call for this frame
+	int frame;
+	rendering::SurfaceResource::Handle surface;
+	rendering::TaskEvent::Handle event;
+
+	FrameInFlight(): frame() { }
+};
+
+//! Queue of frames sent to the renderer and not written to the target yet.
+//! Targets build tasks of the next frames while the renderer still rasterizes
+//! the previous ones, finished frames are written strictly in order
+//! by the write slot of the target. Frames which are not written
+//! (when writing fails or rendering stops) are cancelled by destructor.
+class FramesInFlight
+{
+public:
+	//! Puts the finished frame onto the target, returns false on failure
+	typedef sigc::slot<bool, FrameInFlight&> WriteSlot;
+
+private:
+	rendering::Renderer::Handle renderer;
+	int max_count;
+	WriteSlot write_slot;
+	std::deque<FrameInFlight> frames;
+
+public:
+	FramesInFlight(const rendering::Renderer::Handle &renderer, int max_count, const WriteSlot &write_slot);
+	~FramesInFlight();
+
+	FramesInFlight(const FramesInFlight&) = delete;
+	FramesInFlight& operator=(const FramesInFlight&) = delete;
+
+	//! Sends the \a task which renders \a frame into \a surface to the renderer,
+	//! null task means an empty frame
+	void submit(int frame, const rendering::SurfaceResource::Handle &surface, const rendering::Task::Handle &task);
+
+	//! Writes the oldest frames while the queue is full,
+	//! or all of them when \a all is set (there is nothing more to submit).
+	//! Returns false when the write slot fails.
+	bool write(bool all);
+};
+
+}; // END of namespace synfig
+
+/* === E N D =============================================================== */
+
+#endif
@@ -34,6 +34,9 @@
 #	include <config.h>
 #endif
 
+#include <condition_variable>
+#include <mutex>
+
 #include "target_scanline.h"
 
 #include "general.h"
@@ -44,6 +47,8 @@
 #include "render.h"
 #include "string.h"
 #include "surface.h"
+#include "target_framesinflight.h"
+#include "threadpool.h"
 #include "rendering/renderer.h"
 #include "rendering/surface.h"
 #include "rendering/software/surfacesw.h"
@@ -68,12 +73,108 @@ using namespace rendering;
 
 /* === M E T H O D S ======================================================= */
 
+struct Target_Scanline::EncodeQueue: public etl::shared_object
+{
+	typedef etl::handle<EncodeQueue> Handle;
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	//! count of jobs passed to ThreadPool and not finished yet
+	int pending;
+	//! set when any job fails, cleared by wait_encode_jobs()
+	bool failed;
+
+	EncodeQueue(): pending(), failed() { }
+
+	static void run(Handle queue, EncodeJob *job)
+	{
+		bool success = false;
+		try { success = job->run(); } catch(...) { }
+		// free the frame buffer before the next frame is allowed into queue
+		job->unref();
+
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		--queue->pending;
+		if (!success) queue->failed = true;
+		queue->cond.notify_all();
+	}
+};
+
+namespace {
+	//! waits for encoded frames on any exit from render()
+	class EncodeJobsWaiter
+	{
+		Target_Scanline &target;
+	public:
+		explicit EncodeJobsWaiter(Target_Scanline &target): target(target) { }
+		~EncodeJobsWaiter() { target.wait_encode_jobs(); }
+	};
+}
+
 Target_Scanline::Target_Scanline():
-	threads_(2)
+	threads_(2),
+	frames_in_flight_(1),
+	encoding_queue_(0),
+	encode_queue_(new EncodeQueue())
 {
 	curr_frame_=0;
 	if (const char *s = getenv("SYNFIG_TARGET_DEFAULT_ENGINE"))
 		set_engine(s);
+	if (const char *s = getenv("SYNFIG_TARGET_ENCODING_QUEUE"))
+		set_encoding_queue(atoi(s));
+}
+
+Target_Scanline::~Target_Scanline()
+	{ wait_encode_jobs(); }
+
+bool
+Target_Scanline::is_encoding_async()const
+	{ return encoding_queue_ > 0 && desc.get_frame_end() - desc.get_frame_start() > 0; }
+
+bool
+Target_Scanline::enqueue_encode_job(const EncodeJob::Handle &job)
+{
+	if (!job)
+		return false;
+
+	if (!is_encoding_async()) {
+		bool success = job->run();
+		std::lock_guard<std::mutex> lock(encode_queue_->mutex);
+		if (!success) encode_queue_->failed = true;
+		return !encode_queue_->failed;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(encode_queue_->mutex);
+		while(encode_queue_->pending >= encoding_queue_)
+			ThreadPool::instance().wait(encode_queue_->cond, lock);
+		if (encode_queue_->failed)
+			return false;
+		++encode_queue_->pending;
+	}
+
+	// released by EncodeQueue::run()
+	job->ref();
+	ThreadPool::instance().enqueue( sigc::bind( sigc::ptr_fun(&EncodeQueue::run), encode_queue_, job.get() ));
+	return true;
+}
+
+void
+Target_Scanline::set_encoding_failed()
+{
+	std::lock_guard<std::mutex> lock(encode_queue_->mutex);
+	encode_queue_->failed = true;
+}
+
+bool
+Target_Scanline::wait_encode_jobs()
+{
+	std::unique_lock<std::mutex> lock(encode_queue_->mutex);
+	while(encode_queue_->pending > 0)
+		ThreadPool::instance().wait(encode_queue_->cond, lock);
+	bool success = !encode_queue_->failed;
+	encode_queue_->failed = false;
+	return success;
 }
 
 int
@@ -82,8 +183,8 @@ Target_Scanline::next_frame(Time& time)
 	return Target::next_frame(time);
 }
 
-bool
-synfig::Target_Scanline::call_renderer(
+rendering::Task::Handle
+synfig::Target_Scanline::build_frame_task(
 	const etl::handle<rendering::SurfaceResource> &surface,
 	Canvas &canvas,
 	const ContextParams &context_params,
@@ -94,10 +195,6 @@ synfig::Target_Scanline::call_renderer(
 
 	if (task)
 	{
-		rendering::Renderer::Handle renderer = rendering::Renderer::get_renderer(get_engine());
-		if (!renderer)
-			throw "Renderer '" + get_engine() + "' not found";
-
 		Vector p0 = renddesc.get_tl();
 		Vector p1 = renddesc.get_br();
 		if (p0[0] > p1[0] || p0[1] > p1[1]) {
@@ -113,6 +210,24 @@ synfig::Target_Scanline::call_renderer(
 		task->target_surface = surface;
 		task->target_rect = RectInt( VectorInt(), surface->get_size() );
 		task->source_rect = Rect(p0, p1);
+	}
+	return task;
+}
+
+bool
+synfig::Target_Scanline::call_renderer(
+	const etl::handle<rendering::SurfaceResource> &surface,
+	Canvas &canvas,
+	const ContextParams &context_params,
+	const RendDesc &renddesc )
+{
+	rendering::Task::Handle task = build_frame_task(surface, canvas, context_params, renddesc);
+
+	if (task)
+	{
+		rendering::Renderer::Handle renderer = rendering::Renderer::get_renderer(get_engine());
+		if (!renderer)
+			throw "Renderer '" + get_engine() + "' not found";
 
 		rendering::Task::List list;
 		list.push_back(task);
@@ -121,6 +236,82 @@ synfig::Target_Scanline::call_renderer(
 	return true;
 }
 
+bool
+synfig::Target_Scanline::write_frame_in_flight(FrameInFlight &frame, ProgressCallback *cb)
+{
+	frame.event->wait();
+	if (!frame.event->is_done())
+	{
+		if(cb)cb->error(_("Accelerated Renderer Failure"));
+		return false;
+	}
+
+	SurfaceResource::LockRead<SurfaceSW> lock(frame.surface);
+	if(!lock)
+	{
+		if(cb)cb->error(_("Bad surface"));
+		return false;
+	}
+
+	// targets may look at the current frame number while writing,
+	// so let them see the number of the frame being written,
+	// not the number of the last frame sent to the renderer
+	int last_frame = curr_frame_;
+	curr_frame_ = frame.frame;
+	bool success = add_frame(&lock->get_surface(), cb);
+	curr_frame_ = last_frame;
+
+	if (!success)
+	{
+		if(cb)cb->error(_("Unable to put surface on target"));
+		return false;
+	}
+	return true;
+}
+
+bool
+synfig::Target_Scanline::render_frames_in_flight(ProgressCallback *cb, const ContextParams &context_params, int total_frames)
+{
+	rendering::Renderer::Handle renderer = rendering::Renderer::get_renderer(get_engine());
+	if (!renderer)
+		throw "Renderer '" + get_engine() + "' not found";
+
+	FramesInFlight frames_in_flight(
+		renderer,
+		frames_in_flight_,
+		sigc::bind(sigc::mem_fun(*this, &Target_Scanline::write_frame_in_flight), cb) );
+	bool success = true;
+	int frames = 0;
+	Time t = 0;
+
+	do
+	{
+		// Grab the time
+		frames = next_frame(t);
+
+		if(cb && !cb->amount_complete(total_frames-frames,total_frames))
+			{ success = false; break; }
+
+		// Set the time that we wish to render,
+		// rendering tasks of the previous frames are built already
+		// and don't depend on the canvas time anymore
+		if(!get_avoid_time_sync() || canvas->get_time()!=t) {
+			canvas->set_time(t);
+			canvas->load_resources(t);
+		}
+		canvas->set_outline_grow(desc.get_outline_grow());
+
+		SurfaceResource::Handle surface = new SurfaceResource();
+		frames_in_flight.submit(curr_frame_, surface, build_frame_task(surface, *canvas, context_params, desc));
+
+		// write the oldest frames when the queue is full or there is nothing more to build
+		success = frames_in_flight.write(!frames);
+	} while(success && frames);
+
+	// frames which will not be written are cancelled by destructor of frames_in_flight
+	return success;
+}
+
 bool
 synfig::Target_Scanline::render(ProgressCallback *cb)
 {
@@ -145,6 +336,7 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 	frame_end=desc.get_frame_end();
 
 	ContextParams context_params(desc.get_render_excluded_contexts());
+	EncodeJobsWaiter encode_jobs_waiter(*this);
 
 	// Calculate the number of frames
 	total_frames=frame_end-frame_start+1;
@@ -154,6 +346,16 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 
 	//synfig::info("1time_set_to %s",t.get_string().c_str());
 
+	#if USE_PIXELRENDERING_LIMIT
+	if(total_frames>1 && frames_in_flight_>1 && desc.get_w()*desc.get_h() <= PIXEL_RENDERING_LIMIT)
+	#else
+	if(total_frames>1 && frames_in_flight_>1)
+	#endif
+	{
+		if (!render_frames_in_flight(cb, context_params, total_frames))
+			return false;
+	}
+	else
 	if(total_frames>=1)
 	{
 		do{
@@ -489,6 +691,12 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 		if(cb)cb->error(_("Caught unknown error, rethrowing..."));
 		throw;
 	}
+
+	if (!wait_encode_jobs())
+	{
+		if(cb)cb->error(_("Unable to encode frames"));
+		return false;
+	}
 	return true;
 }
 
@@ -554,5 +762,16 @@ Target_Scanline::add_frame(const synfig::Surface *surface, ProgressCallback *cb)
 
 	end_frame();
 
+	// stop rendering when encoding of any previous frame has failed
+	{
+		std::lock_guard<std::mutex> lock(encode_queue_->mutex);
+		if (encode_queue_->failed)
+		{
+			if (cb)
+				cb->error(_("add_frame(): unable to encode frame"));
+			return false;
+		}
+	}
+
 	return true;
 }
@@ -41,7 +41,9 @@
 
 namespace synfig {
 
-namespace rendering { class SurfaceResource; }
+namespace rendering { class SurfaceResource; class Task; }
+
+struct FrameInFlight;
 
 /*!	\class Target_Scanline
 **	\brief This is a Target class that implements the render function
@@ -51,9 +53,22 @@ class Target_Scanline : public Target
 {
 	//! Number of threads to use
 	int threads_;
+	//! Number of frames which may be rendered at the same time
+	int frames_in_flight_;
+	//! Number of finished frames which may wait for encoding
+	int encoding_queue_;
 
 	String engine_;
 
+	struct EncodeQueue;
+	etl::handle<EncodeQueue> encode_queue_;
+
+	etl::handle<rendering::Task> build_frame_task(
+		const etl::handle<rendering::SurfaceResource> &surface,
+		Canvas &canvas,
+		const ContextParams &context_params,
+		const RendDesc &renddesc );
+
 	bool call_renderer(
 		const etl::handle<rendering::SurfaceResource> &surface,
 		Canvas &canvas,
@@ -64,8 +79,21 @@ public:
 	typedef etl::handle<Target_Scanline> Handle;
 	typedef etl::loose_handle<Target_Scanline> LooseHandle;
 	typedef etl::handle<const Target_Scanline> ConstHandle;
+	//! Encoding of a single finished frame, prepared by the target in end_frame()
+	//! and run by a thread of ThreadPool, see enqueue_encode_job()
+	class EncodeJob: public etl::shared_object
+	{
+	public:
+		typedef etl::handle<EncodeJob> Handle;
+		virtual ~EncodeJob() { }
+		//! Writes the frame, should not touch the target
+		virtual bool run()=0;
+	};
+
 	//! Default constructor (threads = 2 current frame = 0)
 	Target_Scanline();
+	//! Waits for the frames which are still encoded
+	virtual ~Target_Scanline();
 
 	//! Renders the canvas to the target
 	virtual bool render(ProgressCallback *cb=NULL);
@@ -105,6 +133,23 @@ public:
 	void set_threads(int x) { threads_=x; }
 	//! Gets the number of threads
 	int get_threads()const { return threads_; }
+	//! Sets the number of frames which may be rendered at the same time
+	/*! When greater than one, building of the rendering task for the next
+	**	frames overlaps with rendering of the current one.
+	**	Frames are still passed to the target in order.
+	*/
+	void set_frames_in_flight(int x) { frames_in_flight_ = x < 1 ? 1 : x; }
+	//! Gets the number of frames which may be rendered at the same time
+	int get_frames_in_flight()const { return frames_in_flight_; }
+	//! Sets the number of finished frames which may wait for encoding
+	/*! When greater than zero, targets which write every frame into
+	**	a separate file encode them by threads of ThreadPool,
+	**	so rendering of the next frame doesn't wait for the compression.
+	**	Memory is bounded by this number of frame buffers.
+	*/
+	void set_encoding_queue(int x) { encoding_queue_ = x < 0 ? 0 : x; }
+	//! Gets the number of finished frames which may wait for encoding
+	int get_encoding_queue()const { return encoding_queue_; }
 	//! Gets engine
 	const String& get_engine()const { return engine_; }
 	//! Sets engine
@@ -112,7 +157,27 @@ public:
 
 	//! Puts the rendered surface onto the target.
 	bool add_frame(const synfig::Surface *surface, ProgressCallback* cb);
+
+	//! Waits for all queued frames
+	/*! \return \c false if encoding of any of them has failed */
+	bool wait_encode_jobs();
+
+protected:
+	//! Returns \c true if frames of the current render may be encoded in background
+	bool is_encoding_async()const;
+	//! Passes the job to ThreadPool, blocks while the queue is full.
+	//! Runs the job in the current thread when the queue is disabled.
+	/*! \return \c false if encoding of this or any previous frame has failed */
+	bool enqueue_encode_job(const EncodeJob::Handle &job);
+	//! Marks encoding of the current render as failed, like a failed job,
+	//! for a frame which can't be passed to enqueue_encode_job()
+	void set_encoding_failed();
+
 private:
+	//! Renders all frames keeping up to frames_in_flight_ of them in the render queue
+	bool render_frames_in_flight(ProgressCallback *cb, const ContextParams &context_params, int total_frames);
+	//! Waits for the oldest frame in flight and puts it onto the target
+	bool write_frame_in_flight(FrameInFlight &frame, ProgressCallback *cb);
 }; // END of class Target_Scanline
 
 }; // END of namespace synfig
@@ -34,6 +34,7 @@
 #	include <config.h>
 #endif
 
+#include <cstring>
 #include <vector>
 #include <algorithm>
 
@@ -49,6 +50,7 @@
 #include "render.h"
 #include "string.h"
 #include "surface.h"
+#include "target_framesinflight.h"
 
 #include "debug/measure.h"
 
@@ -77,6 +79,33 @@ const unsigned int	DEF_TILE_HEIGHT = TILE_SIZE / 2;
 
 /* === P R O C E D U R E S ================================================= */
 
+static void
+apply_alpha_mode(synfig::Surface &s, TargetAlphaMode alpha_mode, const Color &bg_color)
+{
+	int cnt = s.get_w() * s.get_h();
+
+	switch(alpha_mode)
+	{
+		case TARGET_ALPHA_MODE_FILL:
+			for(int i = 0; i < cnt; ++i)
+				s[0][i] = Color::blend(s[0][i], bg_color, 1.0f);
+			break;
+		case TARGET_ALPHA_MODE_EXTRACT:
+			for(int i = 0; i< cnt; ++i)
+			{
+				float a = s[0][i].get_a();
+				s[0][i] = Color(a,a,a,a);
+			}
+			break;
+		case TARGET_ALPHA_MODE_REDUCE:
+			for(int i = 0; i < cnt; ++i)
+				s[0][i].set_a(1.0f);
+			break;
+		default:
+			break;
+	}
+}
+
 /* === M E T H O D S ======================================================= */
 
 Target_Tile::Target_Tile():
@@ -84,7 +113,8 @@ Target_Tile::Target_Tile():
 	tile_w_(DEF_TILE_WIDTH),
 	tile_h_(DEF_TILE_HEIGHT),
 	curr_tile_(0),
-	clipping_(true)
+	clipping_(true),
+	frames_in_flight_(1)
 {
 	curr_frame_=0;
 	if (const char *s = getenv("SYNFIG_TARGET_DEFAULT_ENGINE"))
@@ -117,17 +147,13 @@ Target_Tile::next_tile(RectInt& rect)
 	return (tw*th)-curr_tile_+1;
 }
 
-bool
-synfig::Target_Tile::call_renderer(
+rendering::Task::Handle
+synfig::Target_Tile::build_frame_task(
 	const etl::handle<rendering::SurfaceResource> &surface,
 	Canvas &canvas,
 	const ContextParams &context_params,
 	const RendDesc &renddesc )
 {
-	#ifdef DEBUG_MEASURE
-	debug::Measure t("Target_Tile::call_renderer");
-	#endif
-
 	surface->create(renddesc.get_w(), renddesc.get_h());
 	rendering::Task::Handle task;
 	{
@@ -139,10 +165,6 @@ synfig::Target_Tile::call_renderer(
 
 	if (task)
 	{
-		rendering::Renderer::Handle renderer = rendering::Renderer::get_renderer(get_engine());
-		if (!renderer)
-			throw "Renderer '" + get_engine() + "' not found";
-
 		Vector p0 = renddesc.get_tl();
 		Vector p1 = renddesc.get_br();
 		if (p0[0] > p1[0] || p0[1] > p1[1]) {
@@ -158,6 +180,28 @@ synfig::Target_Tile::call_renderer(
 		task->target_surface = surface;
 		task->target_rect = RectInt( VectorInt(), surface->get_size() );
 		task->source_rect = Rect(p0, p1);
+	}
+	return task;
+}
+
+bool
+synfig::Target_Tile::call_renderer(
+	const etl::handle<rendering::SurfaceResource> &surface,
+	Canvas &canvas,
+	const ContextParams &context_params,
+	const RendDesc &renddesc )
+{
+	#ifdef DEBUG_MEASURE
+	debug::Measure t("Target_Tile::call_renderer");
+	#endif
+
+	rendering::Task::Handle task = build_frame_task(surface, canvas, context_params, renddesc);
+
+	if (task)
+	{
+		rendering::Renderer::Handle renderer = rendering::Renderer::get_renderer(get_engine());
+		if (!renderer)
+			throw "Renderer '" + get_engine() + "' not found";
 
 		rendering::Task::List list;
 		list.push_back(task);
@@ -251,28 +295,7 @@ synfig::Target_Tile::async_render_tile(
 	}
 
 	synfig::Surface &s = lock->get_surface();
-	int cnt = s.get_w() * s.get_h();
-
-	switch(get_alpha_mode())
-	{
-		case TARGET_ALPHA_MODE_FILL:
-			for(int i = 0; i < cnt; ++i)
-				s[0][i] = Color::blend(s[0][i], desc.get_bg_color(), 1.0f);
-			break;
-		case TARGET_ALPHA_MODE_EXTRACT:
-			for(int i = 0; i< cnt; ++i)
-			{
-				float a = s[0][i].get_a();
-				s[0][i] = Color(a,a,a,a);
-			}
-			break;
-		case TARGET_ALPHA_MODE_REDUCE:
-			for(int i = 0; i < cnt; ++i)
-				s[0][i].set_a(1.0f);
-			break;
-		default:
-			break;
-	}
+	apply_alpha_mode(s, get_alpha_mode(), desc.get_bg_color());
 
 	// Add the tile to the target
 	if (!add_tile(s, rect.minx, rect.miny))
@@ -292,6 +315,119 @@ synfig::Target_Tile::wait_render_tiles(ProgressCallback* /* cb */)
 }
 
 
+bool
+synfig::Target_Tile::write_frame_in_flight(FrameInFlight &frame, ProgressCallback *cb)
+{
+	frame.event->wait();
+	if (!frame.event->is_done())
+	{
+		if(cb)cb->error(_("Accelerated Renderer Failure"));
+		return false;
+	}
+
+	SurfaceResource::LockWrite<SurfaceSW> lock(frame.surface);
+	if(!lock)
+	{
+		if(cb)cb->error(_("Bad surface"));
+		return false;
+	}
+
+	synfig::Surface &s = lock->get_surface();
+	apply_alpha_mode(s, get_alpha_mode(), desc.get_bg_color());
+
+	// targets may look at the current frame number while writing,
+	// so let them see the number of the frame being written,
+	// not the number of the last frame sent to the renderer
+	int last_frame = curr_frame_;
+	curr_frame_ = frame.frame;
+
+	bool success = start_frame(cb);
+	if (success)
+	{
+		const RectInt bounds(0, 0, s.get_w(), s.get_h());
+		RectInt rect;
+		curr_tile_ = 0;
+		while(success && next_tile(rect))
+		{
+			if (clipping_)
+			{
+				if (rect.minx >= bounds.maxx || rect.miny >= bounds.maxy)
+					continue;
+				rect_set_intersect(rect, rect, bounds);
+			}
+			if (!rect.valid())
+				continue;
+
+			// cut the tile from the frame, parts outside of the frame stay transparent
+			synfig::Surface tile(rect.maxx - rect.minx, rect.maxy - rect.miny);
+			RectInt src = rect;
+			rect_set_intersect(src, src, bounds);
+			if (src != rect)
+				tile.clear();
+			if (src.valid())
+				for(int y = src.miny; y < src.maxy; ++y)
+					memcpy(
+						&tile[y - rect.miny][src.minx - rect.minx],
+						&s[y][src.minx],
+						sizeof(Color)*(src.maxx - src.minx) );
+
+			if (!add_tile(tile, rect.minx, rect.miny))
+			{
+				if(cb)cb->error(_("add_tile(): Unable to put surface on target"));
+				success = false;
+				break;
+			}
+			signal_progress()();
+		}
+		if (success)
+			end_frame();
+	}
+
+	curr_frame_ = last_frame;
+	return success;
+}
+
+bool
+synfig::Target_Tile::render_frames_in_flight(ProgressCallback *cb, const ContextParams &context_params, int total_frames)
+{
+	rendering::Renderer::Handle renderer = rendering::Renderer::get_renderer(get_engine());
+	if (!renderer)
+		throw "Renderer '" + get_engine() + "' not found";
+
+	FramesInFlight frames_in_flight(
+		renderer,
+		frames_in_flight_,
+		sigc::bind(sigc::mem_fun(*this, &Target_Tile::write_frame_in_flight), cb) );
+	bool success = true;
+	int frames = 0;
+	Time t = 0;
+
+	do
+	{
+		// Grab the time
+		frames = next_frame(t);
+
+		if(cb && !cb->amount_complete(total_frames-frames,total_frames))
+			{ success = false; break; }
+
+		// Set the time that we wish to render,
+		// rendering tasks of the previous frames are built already
+		// and don't depend on the canvas time anymore
+		canvas->set_time(t);
+		canvas->load_resources(t);
+		canvas->set_outline_grow(desc.get_outline_grow());
+
+		SurfaceResource::Handle surface = new SurfaceResource();
+		frames_in_flight.submit(curr_frame_, surface, build_frame_task(surface, *canvas, context_params, desc));
+
+		// write the oldest frames when the queue is full or there is nothing more to build
+		success = frames_in_flight.write(!frames);
+	} while(success && frames);
+
+	// frames which will not be written are cancelled by destructor of frames_in_flight
+	return success;
+}
+
 bool
 synfig::Target_Tile::render(ProgressCallback *cb)
 {
@@ -323,6 +459,12 @@ synfig::Target_Tile::render(ProgressCallback *cb)
 
 	try {
 
+		if(total_frames>1 && frames_in_flight_>1)
+		{
+			if (!render_frames_in_flight(cb, context_params, total_frames))
+				return false;
+		}
+		else
 		if(total_frames>=1)
 		{
 			do
@@ -44,7 +44,9 @@
 
 namespace synfig {
 
-namespace rendering { class SurfaceResource; }
+namespace rendering { class SurfaceResource; class Task; }
+
+struct FrameInFlight;
 
 /*!	\class Target_Tile
 **	\brief Render-target
@@ -63,11 +65,19 @@ class Target_Tile : public Target
 	//! Determines if the tiles should be clipped to the redener description
 	//! or not
 	bool clipping_;
+	//! Number of frames which may be rendered at the same time
+	int frames_in_flight_;
 
 	String engine_;
 
 	struct TileGroup;
 
+	etl::handle<rendering::Task> build_frame_task(
+		const etl::handle<rendering::SurfaceResource> &surface,
+		Canvas &canvas,
+		const ContextParams &context_params,
+		const RendDesc &renddesc );
+
 	bool call_renderer(
 		const etl::handle<rendering::SurfaceResource> &surface,
 		Canvas &canvas,
@@ -121,6 +131,15 @@ public:
 	void set_threads(int x) { threads_=x; }
 	//!Gets the number of threads
 	int get_threads()const { return threads_; }
+	//! Sets the number of frames which may be rendered at the same time
+	/*! When greater than one, whole frames are sent to the renderer
+	**	and building of the rendering task for the next frames overlaps
+	**	with rendering of the current one. Tiles are cut from the finished
+	**	frames and passed to the target in order.
+	*/
+	void set_frames_in_flight(int x) { frames_in_flight_ = x < 1 ? 1 : x; }
+	//! Gets the number of frames which may be rendered at the same time
+	int get_frames_in_flight()const { return frames_in_flight_; }
 	//!Sets the tile width
 	void set_tile_w(int w) { tile_w_=w; }
 	//!Gets the tile width
@@ -141,6 +160,10 @@ public:
 private:
 	//! Renders the context to the surface
 	bool render_frame_(etl::handle<Canvas> canvas, ContextParams context_params, ProgressCallback *cb);
+	//! Renders all frames keeping up to frames_in_flight_ of them in the render queue
+	bool render_frames_in_flight(ProgressCallback *cb, const ContextParams &context_params, int total_frames);
+	//! Waits for the oldest frame in flight and puts its tiles onto the target
+	bool write_frame_in_flight(FrameInFlight &frame, ProgressCallback *cb);
 
 }; // END of class Target_Tile
 
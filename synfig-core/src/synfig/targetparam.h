@@ -48,12 +48,16 @@ struct TargetParam
 	 *  its own valid default settings.
 	 */
 	TargetParam (const std::string& Video_codec = "none", int Bitrate = -1):
-		video_codec(Video_codec), bitrate(Bitrate), sequence_separator("."), offset_x(0), offset_y(0),rows(0),columns(0),append(true),dir(HR)
+		video_codec(Video_codec), bitrate(Bitrate), sequence_separator("."), compression_level(-1), offset_x(0), offset_y(0),rows(0),columns(0),append(true),dir(HR)
 	{ }
 
 	std::string video_codec;
 	int bitrate;
 	std::string sequence_separator;
+	//! Compression level of lossless image formats (0..9), negative for the default one
+	int compression_level;
+	//! Row filter of lossless image formats (none, sub, up, avg, paeth or all), empty for the default one
+	std::string compression_filter;
 	//TODO: It is a spike. Need to separate this class.
 	int offset_x;
 	int offset_y;
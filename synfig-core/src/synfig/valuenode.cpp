@@ -126,7 +126,7 @@ LinkableValueNode::unlink_all()
 	{
 		ValueNode::LooseHandle value_node(get_link(i));
 		if(value_node)
-			value_node->parent_set.erase(this);
+			remove_child(value_node.get());
 	}
 }
 
@@ -160,12 +160,11 @@ ValueNode::replace(etl::handle<ValueNode> x)
 	if(x.get()==this)
 		return 0;
 
-	while(parent_set.size())
+	const std::set<Node*> parents = get_parent_set();
+	for(std::set<Node*>::const_iterator iter = parents.begin(); iter != parents.end(); ++iter)
 	{
-		(*parent_set.begin())->add_child(x.get());
-		(*parent_set.begin())->remove_child(this);
-		//x->parent_set.insert(*parent_set.begin());
-		//parent_set.erase(parent_set.begin());
+		(*iter)->add_child(x.get());
+		(*iter)->remove_child(this);
 	}
 	int r(RHandle(this).replace(x));
 	x->changed();
@@ -208,7 +207,7 @@ ValueNode::is_descendant(ValueNode::Handle value_node_dest)
         return true;
 
     //! loop through the parents of each node in current_nodes
-	std::set<Node*> node_parents(value_node_dest->parent_set);
+	std::set<Node*> node_parents(value_node_dest->get_parent_set());
     ValueNode::Handle value_node_parent;
     for (std::set<Node*>::iterator iter = node_parents.begin(); iter != node_parents.end(); iter++)
     {
@@ -286,7 +285,8 @@ ValueNode::canvas_time_bounds(const Canvas &canvas, bool &found, Time &begin, Ti
 void
 ValueNode::find_time_bounds(const Node &node, bool &found, Time &begin, Time &end, Real &fps)
 {
-	for(std::set<Node*>::const_iterator i = node.parent_set.begin(); i != node.parent_set.end(); ++i)
+	const std::set<Node*> parents = node.get_parent_set();
+	for(std::set<Node*>::const_iterator i = parents.begin(); i != parents.end(); ++i)
 	{
 		if (!*i) continue;
 		if (Layer *layer = dynamic_cast<Layer*>(*i))
@@ -357,65 +357,138 @@ ValueNode::get_values_vfunc(std::map<Time, ValueBase> &x) const
 
 
 ValueNodeList::ValueNodeList():
-	placeholder_count_(0)
+	placeholder_count_(0),
+	index_dirty_(false)
 {
 }
 
-bool
-ValueNodeList::count(const String &id)const
+ValueNodeList::ValueNodeList(const ValueNodeList &other):
+	std::list<ValueNode::RHandle>(other),
+	placeholder_count_(other.placeholder_count_),
+	index_dirty_(true)
 {
-	const_iterator iter;
+	for(iterator iter = begin(); iter != end(); ++iter)
+		track(iter->get());
+}
 
-	if(id.empty())
-		return false;
+ValueNodeList::~ValueNodeList()
+	{ untrack_all(); }
+
+ValueNodeList&
+ValueNodeList::operator=(const ValueNodeList &other)
+{
+	if (this == &other)
+		return *this;
+	untrack_all();
+	std::list<ValueNode::RHandle>::operator=(other);
+	placeholder_count_ = other.placeholder_count_;
+	index_dirty_ = true;
+	for(iterator iter = begin(); iter != end(); ++iter)
+		track(iter->get());
+	return *this;
+}
 
-	for(iter=begin();iter!=end() && id!=(*iter)->get_id();++iter)
-		;
+void
+ValueNodeList::track(ValueNode *value_node)
+{
+	if (!connections_.count(value_node))
+		connections_[value_node] = value_node->signal_id_changed().connect(
+			sigc::mem_fun(*this, &ValueNodeList::on_id_changed) );
+	// callers never add a second node with the same id, so overwriting is safe
+	if (!index_dirty_)
+		index_[value_node->get_id()] = value_node;
+}
 
-	if(iter==end())
-		return false;
+void
+ValueNodeList::untrack(const ValueNode *value_node)
+{
+	auto i = connections_.find(value_node);
+	if (i != connections_.end()) {
+		i->second.disconnect();
+		connections_.erase(i);
+	}
+}
+
+void
+ValueNodeList::forget(const ValueNode *value_node)
+{
+	untrack(value_node);
+	// another node may have the same id, so let the next lookup rebuild the index
+	if (!index_dirty_) {
+		auto j = index_.find(value_node->get_id());
+		if (j != index_.end() && j->second == value_node)
+			index_dirty_ = true;
+	}
+}
 
-	return true;
+void
+ValueNodeList::untrack_all()
+{
+	for(auto i = connections_.begin(); i != connections_.end(); ++i)
+		i->second.disconnect();
+	connections_.clear();
+	index_.clear();
+	index_dirty_ = true;
+}
+
+void
+ValueNodeList::rebuild_index()const
+{
+	index_.clear();
+	index_.reserve(size());
+	// insert() keeps the first node with each id, as the linear search did
+	for(const_iterator iter = begin(); iter != end(); ++iter)
+		index_.insert(std::make_pair((*iter)->get_id(), iter->get()));
+	index_dirty_ = false;
+}
+
+ValueNode*
+ValueNodeList::lookup(const String &id)const
+{
+	if (index_dirty_)
+		rebuild_index();
+	auto i = index_.find(id);
+	return i == index_.end() ? nullptr : i->second;
+}
+
+bool
+ValueNodeList::count(const String &id)const
+{
+	if(id.empty())
+		return false;
+	return lookup(id) != nullptr;
 }
 
 ValueNode::Handle
 ValueNodeList::find(const String &id, bool might_fail)
 {
-	iterator iter;
-
 	if(id.empty())
 		throw Exception::IDNotFound("Empty ID");
 
-	for(iter=begin();iter!=end() && id!=(*iter)->get_id();++iter)
-		;
-
-	if(iter==end())
+	ValueNode *value_node = lookup(id);
+	if(!value_node)
 	{
 		if (!might_fail) ValueNode::breakpoint();
 		throw Exception::IDNotFound("ValueNode in ValueNodeList: "+id);
 	}
 
-	return *iter;
+	return value_node;
 }
 
 ValueNode::ConstHandle
 ValueNodeList::find(const String &id, bool might_fail)const
 {
-	const_iterator iter;
-
 	if(id.empty())
 		throw Exception::IDNotFound("Empty ID");
 
-	for(iter=begin();iter!=end() && id!=(*iter)->get_id();++iter)
-		;
-
-	if(iter==end())
+	const ValueNode *value_node = lookup(id);
+	if(!value_node)
 	{
 		if (!might_fail) ValueNode::breakpoint();
 		throw Exception::IDNotFound("ValueNode in ValueNodeList: "+id);
 	}
 
-	return *iter;
+	return value_node;
 }
 
 ValueNode::Handle
@@ -435,6 +508,7 @@ ValueNodeList::surefind(const String &id)
 		value_node=PlaceholderValueNode::create();
 		value_node->set_id(id);
 		push_back(value_node);
+		track(value_node.get());
 		placeholder_count_++;
 	}
 
@@ -451,6 +525,7 @@ ValueNodeList::erase(ValueNode::Handle value_node)
 	for(iter=begin();iter!=end();++iter)
 		if(value_node.get()==iter->get())
 		{
+			forget(value_node.get());
 			std::list<ValueNode::RHandle>::erase(iter);
 			if(PlaceholderValueNode::Handle::cast_dynamic(value_node))
 				placeholder_count_--;
@@ -472,7 +547,11 @@ ValueNodeList::add(ValueNode::Handle value_node)
 		ValueNode::RHandle other_value_node=find(value_node->get_id(), true);
 		if(PlaceholderValueNode::Handle::cast_dynamic(other_value_node))
 		{
+			// replace() also swaps the handle stored in the list,
+			// track() then overwrites the index entry of the placeholder
+			untrack(other_value_node.get());
 			other_value_node->replace(value_node);
+			track(value_node.get());
 			placeholder_count_--;
 			return true;
 		}
@@ -482,6 +561,7 @@ ValueNodeList::add(ValueNode::Handle value_node)
 	catch(Exception::IDNotFound&)
 	{
 		push_back(value_node);
+		track(value_node.get());
 		return true;
 	}
 
@@ -495,7 +575,10 @@ ValueNodeList::audit()
 
 	for(next=begin(),iter=next++;iter!=end();iter=next++)
 		if(iter->count()==1)
+		{
+			forget(iter->get());
 			std::list<ValueNode::RHandle>::erase(iter);
+		}
 }
 
 
@@ -703,7 +786,7 @@ LinkableValueNode::get_description(int index, bool show_exported_name)const
 	LinkableValueNode::ConstHandle parent_linkable_vn;
 
 	// walk up through the valuenodes trying to find the layer at the top
-	while (!node->parent_set.empty() && !dynamic_cast<const Layer*>(node))
+	while (node->parent_count() && !dynamic_cast<const Layer*>(node))
 	{
 		LinkableValueNode::ConstHandle linkable_value_node(dynamic_cast<const LinkableValueNode*>(node));
 		if (linkable_value_node)
@@ -719,7 +802,7 @@ LinkableValueNode::get_description(int index, bool show_exported_name)const
 
 			description = linkable_value_node->get_local_name() + link + (parent_linkable_vn?">":"") + description;
 		}
-		node = *node->parent_set.begin();
+		node = *node->get_parent_set().begin();
 		parent_linkable_vn = linkable_value_node;
 	}
 
@@ -44,10 +44,12 @@
 #include <ETL/handle>
 
 #include <sigc++/signal.h>
+#include <sigc++/connection.h>
 
 #include <map>
 #include <set>
 #include <memory>
+#include <unordered_map>
 
 /* === M A C R O S ========================================================= */
 
@@ -478,8 +480,27 @@ protected:
 class ValueNodeList : public std::list<ValueNode::RHandle>
 {
 	int placeholder_count_;
+
+	//! Index of the list by id, rebuilt lazily when some value node was renamed
+	mutable std::unordered_map<String, ValueNode*> index_;
+	mutable bool index_dirty_;
+	//! Connections to signal_id_changed() of the listed value nodes
+	std::unordered_map<const ValueNode*, sigc::connection> connections_;
+
+	void on_id_changed() { index_dirty_ = true; }
+	void track(ValueNode *value_node);
+	void untrack(const ValueNode *value_node);
+	void forget(const ValueNode *value_node);
+	void untrack_all();
+	void rebuild_index()const;
+	ValueNode* lookup(const String &id)const;
+
 public:
 	ValueNodeList();
+	ValueNodeList(const ValueNodeList &other);
+	~ValueNodeList();
+
+	ValueNodeList& operator=(const ValueNodeList &other);
 
 	//! Finds the ValueNode in the list with the given \a name
 	/*!	\return If found, returns a handle to the ValueNode.
@@ -36,6 +36,7 @@
 #include <cmath>
 
 #include <algorithm>
+#include <atomic>
 #include <typeinfo>
 #include <vector>
 #include <list>
@@ -80,6 +81,15 @@ struct timecmp
 	}
 };
 
+//! Comparators of sorted waypoints for std::upper_bound() and std::lower_bound()
+static bool
+time_is_before_waypoint(const Time &t, const Waypoint &waypoint)
+	{ return t.is_less_than(waypoint.get_time()); }
+
+static bool
+waypoint_is_before_time(const Waypoint &waypoint, const Time &t)
+	{ return waypoint.get_time().is_less_than(t); }
+
 template<class T>
 struct subtractor: public std::binary_function<T, T, T>
 	{ T operator()(const T &a,const T &b)const { return a-b; } };
@@ -347,8 +357,32 @@ public:
 		// Bounds of this curve
 		Time r,s;
 
+		//! Segment found by the last lookup, playback usually needs the same or the next one
+		mutable std::atomic<size_t> last_segment;
+
+		static bool time_is_before_segment_end(const Time &t, const PathSegment &segment)
+			{ return t < segment.first.get_s(); }
+
+		//! Returns the first segment which ends after \a t
+		typename curve_list_type::const_iterator find_segment(const Time &t)const
+		{
+			size_t hint = last_segment.load(std::memory_order_relaxed);
+			for(size_t i = hint; i < hint + 2 && i < curve_list.size(); ++i)
+				if ( time_is_before_segment_end(t, curve_list[i])
+				  && (i == 0 || !time_is_before_segment_end(t, curve_list[i-1])) )
+				{
+					if (i != hint) last_segment.store(i, std::memory_order_relaxed);
+					return curve_list.begin() + i;
+				}
+
+			typename curve_list_type::const_iterator iter =
+				std::upper_bound(curve_list.begin(), curve_list.end(), t, time_is_before_segment_end);
+			last_segment.store(iter - curve_list.begin(), std::memory_order_relaxed);
+			return iter;
+		}
+
 	public:
-		Hermite(ValueNode_AnimatedInterfaceConst &node): Interpolator(node) { }
+		Hermite(ValueNode_AnimatedInterfaceConst &node): Interpolator(node), last_segment(0) { }
 
 		virtual Interpolator* create(ValueNode_AnimatedInterfaceConst &node) const
 			{ return new Hermite(node); }
@@ -660,12 +694,7 @@ public:
 			if(t>=s)
 				return animated.waypoint_list_.back().get_value(t);
 
-			typename curve_list_type::const_iterator iter;
-
-			// This next line will set iter to the
-			// correct iterator for the given time.
-			for(iter=curve_list.begin();iter<curve_list.end() && t>=iter->first.get_s();++iter)
-				continue;
+			typename curve_list_type::const_iterator iter = find_segment(t);
 			if(iter==curve_list.end())
 				return animated.waypoint_list_.back().get_value(t);
 			return iter->resolve(t);
@@ -751,15 +780,10 @@ public:
 			if(t>=s)
 				return animated.waypoint_list_.back().get_value(t);
 
-			WaypointList::const_iterator iter;
-			WaypointList::const_iterator next;
-
-			// This next line will set iter to the
-			// correct iterator for the given time.
-			for(next=animated.waypoint_list_.begin(),iter=next++;next!=animated.waypoint_list_.end() && t>=next->get_time();iter=next++)
-				continue;
-
-			return iter->get_value(t);
+			// the last waypoint at or before t
+			WaypointList::const_iterator iter = std::upper_bound(
+				animated.waypoint_list_.begin(), animated.waypoint_list_.end(), t, time_is_before_waypoint );
+			return (--iter)->get_value(t);
 		}
 
 		virtual void get_values_vfunc(std::map<Time, ValueBase> &x) const
@@ -842,13 +866,10 @@ public:
 			if(t>=s)
 				return animated.waypoint_list_.back().get_value(t);
 
-			WaypointList::const_iterator iter = animated.waypoint_list_.begin();
-
 			// A waypoint sets the boolean value until next waypoint
-			for (auto next = iter+1; next != animated.waypoint_list_.end(); iter = next++)
-				if (iter->get_time()==t || t < next->get_time())
-					return iter->get_value(t);
-			return iter->get_value(t);
+			WaypointList::const_iterator iter = std::upper_bound(
+				animated.waypoint_list_.begin(), animated.waypoint_list_.end(), t, time_is_before_waypoint );
+			return (--iter)->get_value(t);
 		}
 
 		virtual void get_values_vfunc(std::map<Time, ValueBase> &x) const
@@ -870,33 +891,21 @@ ValueNode_AnimatedInterfaceConst::ValueNode_AnimatedInterfaceConst(ValueNode &no
 int
 ValueNode_AnimatedInterfaceConst::find(const Time& begin, const Time& end, std::vector<Waypoint*>& selected)
 {
-	Time curr_time(begin);
 	int ret(0);
 
-	// try to grab first waypoint
-	try
+	// grab the waypoint at begin, if any, and then all waypoints before end
+	WaypointList::iterator iter = std::lower_bound(waypoint_list_.begin(), waypoint_list_.end(), begin, waypoint_is_before_time);
+	if(iter!=waypoint_list_.end() && iter->get_time().is_equal(begin))
 	{
-		WaypointList::iterator iter;
-		iter=find(curr_time);
 		selected.push_back(&*iter);
 		ret++;
+		++iter;
 	}
-	catch(...) { }
-
-	try
+	for(;iter!=waypoint_list_.end() && iter->get_time()<end;++iter)
 	{
-		WaypointList::iterator iter;
-		while(true)
-		{
-			iter=find_next(curr_time);
-			curr_time=iter->get_time();
-			if(curr_time>=end)
-				break;
-			selected.push_back(&*iter);
-			ret++;
-		}
+		selected.push_back(&*iter);
+		ret++;
 	}
-	catch(...) { }
 
 	return ret;
 }
@@ -904,33 +913,21 @@ ValueNode_AnimatedInterfaceConst::find(const Time& begin, const Time& end, std::
 int
 ValueNode_AnimatedInterfaceConst::find(const Time& begin, const Time& end, std::vector<const Waypoint*>& selected) const
 {
-	Time curr_time(begin);
 	int ret(0);
 
-	// try to grab first waypoint
-	try
+	// grab the waypoint at begin, if any, and then all waypoints before end
+	WaypointList::const_iterator iter = std::lower_bound(waypoint_list_.begin(), waypoint_list_.end(), begin, waypoint_is_before_time);
+	if(iter!=waypoint_list_.end() && iter->get_time().is_equal(begin))
 	{
-		WaypointList::const_iterator iter;
-		iter=find(curr_time);
 		selected.push_back(&*iter);
 		ret++;
+		++iter;
 	}
-	catch(...) { }
-
-	try
+	for(;iter!=waypoint_list_.end() && iter->get_time()<end;++iter)
 	{
-		WaypointList::const_iterator iter;
-		while(true)
-		{
-			iter=find_next(curr_time);
-			curr_time=iter->get_time();
-			if(curr_time>=end)
-				break;
-			selected.push_back(&*iter);
-			ret++;
-		}
+		selected.push_back(&*iter);
+		ret++;
 	}
-	catch(...) { }
 
 	return ret;
 }
@@ -984,18 +981,13 @@ ValueNode_AnimatedInterfaceConst::new_waypoint_at_time(const Time& time)const
 		}
 		else
 		{
-			WaypointList::const_iterator prev;
-			WaypointList::const_iterator next;
-
-			bool has_prev(false), has_next(false);
+			const_findresult prev = find_prev_time(time);
+			const_findresult next = find_next_time(time);
 
-			try { prev=find_prev(time); has_prev=true; } catch(...) { }
-			try { next=find_next(time); has_next=true; } catch(...) { }
-
-			if(has_prev && !prev->is_static())
-				waypoint.set_value_node(prev->get_value_node());
-			if(has_next && !next->is_static())
-				waypoint.set_value_node(next->get_value_node());
+			if(prev.second && !prev.first->is_static())
+				waypoint.set_value_node(prev.first->get_value_node());
+			if(next.second && !next.first->is_static())
+				waypoint.set_value_node(next.first->get_value_node());
 			else
 				waypoint.set_value((*this)(time));
 
@@ -1043,16 +1035,9 @@ ValueNode_AnimatedInterfaceConst::find(const Time &x)const
 ValueNode_AnimatedInterfaceConst::WaypointList::iterator
 ValueNode_AnimatedInterfaceConst::find_next(const Time &x)
 {
-	WaypointList::iterator iter(binary_find(editable_waypoint_list().begin(),editable_waypoint_list().end(),x));
-
-	if(iter!=editable_waypoint_list().end())
-	{
-		if(iter->get_time().is_more_than(x))
-			return iter;
-		++iter;
-		if(iter!=editable_waypoint_list().end() && iter->get_time().is_more_than(x))
-			return iter;
-	}
+	findresult f = find_next_time(x);
+	if(f.second)
+		return f.first;
 
 	throw Exception::NotFound(strprintf("ValueNode_AnimatedInterfaceConst::find_next(): Can't find Waypoint after %s",x.get_string().c_str()));
 }
@@ -1066,15 +1051,9 @@ ValueNode_AnimatedInterfaceConst::find_next(const Time &x)const
 ValueNode_AnimatedInterfaceConst::WaypointList::iterator
 ValueNode_AnimatedInterfaceConst::find_prev(const Time &x)
 {
-	WaypointList::iterator iter(binary_find(editable_waypoint_list().begin(),editable_waypoint_list().end(),x));
-
-	if(iter!=editable_waypoint_list().end())
-	{
-		if(iter->get_time().is_less_than(x))
-			return iter;
-		if(iter!=editable_waypoint_list().begin() && (--iter)->get_time().is_less_than(x))
-			return iter;
-	}
+	findresult f = find_prev_time(x);
+	if(f.second)
+		return f.first;
 
 	throw Exception::NotFound(strprintf("ValueNode_AnimatedInterfaceConst::find_prev(): Can't find Waypoint after %s",x.get_string().c_str()));
 }
@@ -1260,6 +1239,50 @@ ValueNode_AnimatedInterfaceConst::find_time(const Time &x)const
  	return f;
 }
 
+ValueNode_AnimatedInterfaceConst::findresult
+ValueNode_AnimatedInterfaceConst::find_next_time(const Time &x)
+{
+	findresult f;
+	f.first = std::upper_bound(waypoint_list_.begin(), waypoint_list_.end(), x, time_is_before_waypoint);
+	f.second = f.first != waypoint_list_.end();
+	return f;
+}
+
+ValueNode_AnimatedInterfaceConst::const_findresult
+ValueNode_AnimatedInterfaceConst::find_next_time(const Time &x)const
+{
+	const_findresult f;
+	f.first = std::upper_bound(waypoint_list_.begin(), waypoint_list_.end(), x, time_is_before_waypoint);
+	f.second = f.first != waypoint_list_.end();
+	return f;
+}
+
+ValueNode_AnimatedInterfaceConst::findresult
+ValueNode_AnimatedInterfaceConst::find_prev_time(const Time &x)
+{
+	findresult f;
+	f.first = std::lower_bound(waypoint_list_.begin(), waypoint_list_.end(), x, waypoint_is_before_time);
+	f.second = f.first != waypoint_list_.begin();
+	if(f.second)
+		--f.first;
+	else
+		f.first = waypoint_list_.end();
+	return f;
+}
+
+ValueNode_AnimatedInterfaceConst::const_findresult
+ValueNode_AnimatedInterfaceConst::find_prev_time(const Time &x)const
+{
+	const_findresult f;
+	f.first = std::lower_bound(waypoint_list_.begin(), waypoint_list_.end(), x, waypoint_is_before_time);
+	f.second = f.first != waypoint_list_.begin();
+	if(f.second)
+		--f.first;
+	else
+		f.first = waypoint_list_.end();
+	return f;
+}
+
 void
 ValueNode_AnimatedInterfaceConst::insert_time(const Time& location, const Time& delta)
 {
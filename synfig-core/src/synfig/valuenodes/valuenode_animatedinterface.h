@@ -105,6 +105,10 @@ protected:
 	findresult 			   find_uid(const UniqueID &x);
 	//! Finds Waypoint iterator and associated boolean if found. Find by Time
 	findresult			   find_time(const Time &x);
+	//! Finds the first Waypoint after the time \x and associated boolean if found
+	findresult			   find_next_time(const Time &x);
+	//! Finds the last Waypoint before the time \x and associated boolean if found
+	findresult			   find_prev_time(const Time &x);
 	//! Finds a Waypoint by given UniqueID \x
 	WaypointList::iterator find(const UniqueID &x);
 	//! Finds a Waypoint by given Time \x
@@ -142,6 +146,10 @@ public:
 	const_findresult 	         find_uid(const UniqueID &x)const;
 	//! Finds Waypoint iterator and associated boolean if found. Find by Time
 	const_findresult	         find_time(const Time &x)const;
+	//! Finds the first Waypoint after the time \x and associated boolean if found
+	const_findresult	         find_next_time(const Time &x)const;
+	//! Finds the last Waypoint before the time \x and associated boolean if found
+	const_findresult	         find_prev_time(const Time &x)const;
 	//! Finds a Waypoint by given UniqueID \x
 	WaypointList::const_iterator find(const UniqueID &x)const;
 	//! Finds a Waypoint by given Time \x
@@ -170,6 +178,8 @@ public:
 
 	using ValueNode_AnimatedInterfaceConst::find_uid;
 	using ValueNode_AnimatedInterfaceConst::find_time;
+	using ValueNode_AnimatedInterfaceConst::find_next_time;
+	using ValueNode_AnimatedInterfaceConst::find_prev_time;
 	using ValueNode_AnimatedInterfaceConst::find;
 	using ValueNode_AnimatedInterfaceConst::find_next;
 	using ValueNode_AnimatedInterfaceConst::find_prev;
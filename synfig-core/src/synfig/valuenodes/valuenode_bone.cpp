@@ -33,6 +33,9 @@
 #	include <config.h>
 #endif
 
+#include <atomic>
+#include <mutex>
+
 #include "valuenode_bone.h"
 #include "valuenode_const.h"
 #include "valuenode_animated.h"
@@ -79,8 +82,126 @@ static Time last_time = Time::begin();
 
 static ValueNode_Bone_Root::Handle rooot;
 
+//! count of times stored for each skeleton, see PoseCache
+static const size_t max_poses_per_skeleton = 4;
+
+static std::atomic<bool> pose_cache_enabled(true);
+
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+//! Poses of bones of each root canvas for a few recently used times
+class PoseCache
+{
+private:
+	typedef std::map<const ValueNode_Bone*, ValueNode_Bone::Pose> BonePoses;
+
+	struct Entry
+	{
+		Time time;
+		BonePoses bones;
+	};
+
+	typedef std::list<Entry> EntryList; //!< recently used times are in front
+
+	struct Skeleton
+	{
+		//! value of PoseCache::generation when the skeleton was added
+		unsigned long long generation;
+		EntryList entries;
+
+		explicit Skeleton(unsigned long long generation): generation(generation) { }
+	};
+
+	typedef std::map<etl::loose_handle<const Canvas>, Skeleton> SkeletonMap;
+
+	std::mutex mutex;
+	SkeletonMap skeletons;
+	//! incremented by clear(), skeletons are added again with the new value,
+	//! so poses evaluated before the clear() don't match them
+	unsigned long long generation;
+
+	PoseCache(): generation() { }
+
+public:
+	//! never deleted: bones may be destroyed by static destructors
+	static PoseCache& instance()
+	{
+		static PoseCache *cache = new PoseCache();
+		return *cache;
+	}
+
+	//! When the pose is not found, returns false and sets \a generation
+	//! of the skeleton of \a bone, which should be passed to put()
+	bool find(const ValueNode_Bone *bone, Time t, ValueNode_Bone::Pose &pose, unsigned long long &generation)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		SkeletonMap::iterator s = skeletons.find(bone->get_root_canvas());
+		if (s == skeletons.end()) {
+			generation = this->generation;
+			return false;
+		}
+		generation = s->second.generation;
+		EntryList &entries = s->second.entries;
+		for(EntryList::iterator i = entries.begin(); i != entries.end(); ++i) {
+			if (i->time != t)
+				continue;
+			BonePoses::const_iterator j = i->bones.find(bone);
+			if (j == i->bones.end())
+				return false;
+			pose = j->second;
+			entries.splice(entries.begin(), entries, i);
+			return true;
+		}
+		return false;
+	}
+
+	//! stores the pose only if the skeleton was not cleared since find() returned \a generation,
+	//! otherwise bone may be changed while its pose was evaluated
+	void put(const ValueNode_Bone *bone, Time t, const ValueNode_Bone::Pose &pose, unsigned long long generation)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		SkeletonMap::iterator s = skeletons.find(bone->get_root_canvas());
+		if (s == skeletons.end()) {
+			if (generation != this->generation)
+				return;
+			s = skeletons.insert(SkeletonMap::value_type(bone->get_root_canvas(), Skeleton(generation))).first;
+		} else
+		if (generation != s->second.generation)
+			return;
+		EntryList &entries = s->second.entries;
+		EntryList::iterator i = entries.begin();
+		while(i != entries.end() && i->time != t) ++i;
+		if (i == entries.end()) {
+			entries.push_front(Entry());
+			entries.front().time = t;
+			if (entries.size() > max_poses_per_skeleton)
+				entries.pop_back();
+			i = entries.begin();
+		}
+		i->bones[bone] = pose;
+	}
+
+	//! drops poses of bones of \a root_canvas only,
+	//! bones of other documents can't depend on them
+	void clear(const etl::loose_handle<const Canvas> &root_canvas)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		skeletons.erase(root_canvas);
+		++generation;
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		skeletons.clear();
+		++generation;
+	}
+};
+
+} // end of anonimous namespace
+
 struct compare_bones
 {
 	bool operator() (const ValueNode_Bone::LooseHandle b1, const ValueNode_Bone::LooseHandle b2) const
@@ -296,6 +417,9 @@ void ValueNode_Bone::on_changed()
 	if (getenv("SYNFIG_DEBUG_ON_CHANGED"))
 		printf("%s:%d ValueNode_Bone::on_changed()\n", __FILE__, __LINE__);
 
+	// poses of children depend on this bone, parents and children share the root canvas
+	PoseCache::instance().clear(get_root_canvas());
+
 	LinkableValueNode::on_changed();
 }
 
@@ -323,6 +447,7 @@ ValueNode_Bone::~ValueNode_Bone()
 	if (getenv("SYNFIG_DEBUG_BONE_MAP"))
 		printf("%s:%d removing from canvas_map\n", __FILE__, __LINE__);
 	canvas_map[get_root_canvas()].erase(get_guid());
+	PoseCache::instance().clear(get_root_canvas());
 
 	show_bone_map(get_root_canvas(), __FILE__, __LINE__, "in destructor");
 
@@ -356,6 +481,8 @@ ValueNode_Bone::set_root_canvas(etl::loose_handle<Canvas> canvas)
 
 		canvas_map[new_canvas][guid] = canvas_map[old_canvas][guid];
 		canvas_map[old_canvas].erase(guid);
+		PoseCache::instance().clear(old_canvas);
+		PoseCache::instance().clear(new_canvas);
 		show_bone_map(new_canvas, __FILE__, __LINE__, strprintf("after changing canvas from %p to %p", old_canvas.get(), new_canvas.get()));
 	}
 	else
@@ -383,27 +510,6 @@ ValueNode_Bone::get_animated_matrix(Time t, Point child_origin)const
 		 * Matrix().set_translate(child_origin[0]*scalelx, child_origin[1]);
 }
 
-Matrix
-ValueNode_Bone::get_animated_matrix(Time t, Real scalex, Real scaley, Angle angle, Point origin, ValueNode_Bone::ConstHandle parent)const
-{
-	Matrix parent_matrix(parent->get_animated_matrix(t, origin));
-	Matrix ret = parent_matrix
-			   * Matrix().set_rotate(angle)
-			   * Matrix().set_scale(scalex,scaley);
-
-	if (getenv("SYNFIG_DEBUG_ANIMATED_MATRIX_CALCULATION"))
-	{
-		printf("%s  *\n", Matrix().set_scale(scalex, scaley).get_string(18, "animated_matrix = ",
-																		strprintf("scale(%7.2f, %7.2f) (%s)", scalex, scaley,
-																				  get_bone_name(t).c_str())).c_str());
-		printf("%s  *\n", Matrix().set_rotate(angle).get_string(18, "", strprintf("rotate(%.2f)", Angle::deg(angle).get())).c_str());
-		printf("%s  =\n", parent_matrix.get_string(18, "", "parent").c_str());
-		printf("%s\n",	  ret.get_string(18).c_str());
-	}
-
-	return ret;
-}
-
 ValueNode_Bone::ConstHandle
 ValueNode_Bone::get_parent(Time t)const
 {
@@ -428,6 +534,67 @@ ValueNode_Bone::get_parent(Time t)const
 	return new ValueNode_Bone_Root();
 }
 
+ValueNode_Bone::Pose
+ValueNode_Bone::get_pose(Time t)const
+{
+	Pose pose;
+	const bool cache = is_pose_cache_enabled();
+	// taken before the links are read, so changes made meanwhile are not stored
+	unsigned long long generation = 0;
+	if (cache && PoseCache::instance().find(this, t, pose, generation))
+		return pose;
+
+	// the same products in the same order as get_animated_matrix(),
+	// the lock is not held here, because links may evaluate other bones
+	ValueNode_Bone::ConstHandle parent(get_parent(t));
+	pose.parent = parent.get();
+	pose.origin = (*origin_)(t).get(Point());
+	pose.angle = (*angle_)(t).get(Angle());
+	pose.scalelx = (*scalelx_)(t).get(Real());
+	pose.scalex = (*scalex_)(t).get(Real());
+
+	Matrix parent_matrix;
+	if (!cache || parent->is_root()) {
+		parent_matrix = parent->get_animated_matrix(t, pose.origin);
+	} else {
+		Pose parent_pose(parent->get_pose(t));
+		parent_matrix = parent_pose.animated_matrix
+					  * Matrix().set_translate(pose.origin[0]*parent_pose.scalelx, pose.origin[1]);
+	}
+	pose.animated_matrix = parent_matrix
+						 * Matrix().set_rotate(pose.angle)
+						 * Matrix().set_scale(pose.scalex, 1.0);
+
+	if (getenv("SYNFIG_DEBUG_ANIMATED_MATRIX_CALCULATION"))
+	{
+		printf("%s  *\n", Matrix().set_scale(pose.scalex, 1.0).get_string(18, "animated_matrix = ",
+																		strprintf("scale(%7.2f, %7.2f) (%s)", pose.scalex, 1.0,
+																				  get_bone_name(t).c_str())).c_str());
+		printf("%s  *\n", Matrix().set_rotate(pose.angle).get_string(18, "", strprintf("rotate(%.2f)", Angle::deg(pose.angle).get())).c_str());
+		printf("%s  =\n", parent_matrix.get_string(18, "", "parent").c_str());
+		printf("%s\n",	  pose.animated_matrix.get_string(18).c_str());
+	}
+
+	if (cache)
+		PoseCache::instance().put(this, t, pose, generation);
+	return pose;
+}
+
+bool
+ValueNode_Bone::is_pose_cache_enabled()
+	{ return pose_cache_enabled; }
+
+void
+ValueNode_Bone::set_pose_cache_enabled(bool enabled)
+{
+	pose_cache_enabled = enabled;
+	clear_pose_cache();
+}
+
+void
+ValueNode_Bone::clear_pose_cache()
+	{ PoseCache::instance().clear(); }
+
 ValueBase
 ValueNode_Bone::operator()(Time t)const
 {
@@ -437,19 +604,22 @@ ValueNode_Bone::operator()(Time t)const
 //	show_bone_map(get_root_canvas(), __FILE__, __LINE__, strprintf("in op() at %s", t.get_string().c_str()), t);
 
 	String bone_name			((*name_	)(t).get(String()));
-	ValueNode_Bone::ConstHandle   bone_parent			(get_parent(t));
 #ifndef HIDE_BONE_FIELDS
-	Point  bone_origin			((*origin_	)(t).get(Point()));
-	Angle  bone_angle			((*angle_	)(t).get(Angle()));
-	Real   bone_scalelx			((*scalelx_	)(t).get(Real()));
-	Real   bone_scalex			((*scalex_	)(t).get(Real()));
+	if (getenv("SYNFIG_DEBUG_ANIMATED_MATRIX_CALCULATION")) printf("\n***\n*** %s:%d get_animated_matrix() for %s\n***\n\n", __FILE__, __LINE__, get_bone_name(t).c_str());
+	Pose   pose					(get_pose(t));
+	if (getenv("SYNFIG_DEBUG_ANIMATED_MATRIX_CALCULATION")) printf("\n***\n*** %s:%d get_animated_matrix() for %s done\n***\n\n", __FILE__, __LINE__, get_bone_name(t).c_str());
+	ValueNode_Bone::ConstHandle   bone_parent			(pose.parent);
+	Point  bone_origin			(pose.origin);
+	Angle  bone_angle			(pose.angle);
+	Real   bone_scalelx			(pose.scalelx);
+	Real   bone_scalex			(pose.scalex);
 	Real   bone_length			((*length_	)(t).get(Real()));
 	Real   bone_width			((*width_	)(t).get(Real()));
 	Real   bone_tipwidth		((*tipwidth_)(t).get(Real()));
 	Real   bone_depth			((*depth_)(t).get(Real()));
-	if (getenv("SYNFIG_DEBUG_ANIMATED_MATRIX_CALCULATION")) printf("\n***\n*** %s:%d get_animated_matrix() for %s\n***\n\n", __FILE__, __LINE__, get_bone_name(t).c_str());
-	Matrix bone_animated_matrix	(get_animated_matrix(t, bone_scalex, 1.0, bone_angle, bone_origin, bone_parent));
-	if (getenv("SYNFIG_DEBUG_ANIMATED_MATRIX_CALCULATION")) printf("\n***\n*** %s:%d get_animated_matrix() for %s done\n***\n\n", __FILE__, __LINE__, get_bone_name(t).c_str());
+	Matrix bone_animated_matrix	(pose.animated_matrix);
+#else
+	ValueNode_Bone::ConstHandle   bone_parent			(get_parent(t));
 #endif
 
 	Bone ret;
@@ -851,7 +1021,7 @@ ValueNode_Bone::get_bones_affected_by(ValueNode::Handle value_node)
 		for (std::set<const Node*>::iterator iter = current_nodes.begin(); iter != current_nodes.end(); iter++, count++)
 		{
 			// loop through the parents of each node in current_nodes
-			std::set<Node*> node_parents((*iter)->parent_set);
+			std::set<Node*> node_parents((*iter)->get_parent_set());
 			if (debug) printf("%s:%d node %d %p (%s) has %zd parents\n",
 							  __FILE__, __LINE__, count, *iter, (*iter)->get_string().c_str(), node_parents.size());
 			int count2 = 0;
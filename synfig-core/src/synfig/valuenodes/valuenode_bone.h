@@ -66,6 +66,19 @@ public:
 	typedef std::set<LooseHandle> BoneSet;
 	typedef std::list<LooseHandle> BoneList;
 
+	//! Animated state of bone at some time, see get_pose()
+	struct Pose
+	{
+		const ValueNode_Bone *parent;
+		Point origin;
+		Angle angle;
+		Real scalelx;
+		Real scalex;
+		Matrix animated_matrix;
+
+		Pose(): parent(), scalelx(), scalex() { }
+	};
+
 	static ValueNode_Bone* create(const ValueBase& x, etl::loose_handle<Canvas> canvas=nullptr);
 	virtual ~ValueNode_Bone();
 
@@ -121,6 +134,16 @@ public:
 
 	static ValueNode_Bone::Handle get_root_bone();
 
+	//! Pose of bone at time \a t. Each bone of skeleton is evaluated once per time,
+	//! parents before children, and the result is stored in the pose cache,
+	//! so bones don't evaluate the whole chain of their ancestors again and again.
+	//! Poses of skeleton of the root canvas are dropped when any of its bones is changed.
+	Pose get_pose(Time t)const;
+
+	static bool is_pose_cache_enabled();
+	static void set_pose_cache_enabled(bool enabled);
+	static void clear_pose_cache();
+
 #ifdef _DEBUG
 	virtual void ref() const override;
 	virtual bool unref() const override;
@@ -130,7 +153,6 @@ public:
 
 private:
 	virtual Matrix get_animated_matrix(Time t, Point child_origin)const;
-	Matrix get_animated_matrix(Time t, Real scalex, Real scaley, Angle angle, Point origin, ValueNode_Bone::ConstHandle parent)const;
 	ValueNode_Bone::ConstHandle get_parent(Time t)const;
 
 }; // END of class ValueNode_Bone
@@ -38,6 +38,8 @@ SynfigToolGeneralOptions::SynfigToolGeneralOptions()
 	_should_be_quiet = false;
 	_should_print_benchmarks = false;
 	_threads = 1;
+	_frames_in_flight = 1;
+	_encoding_queue = 0;
 }
 
 std::string SynfigToolGeneralOptions::get_binary_path() const
@@ -59,6 +61,26 @@ void SynfigToolGeneralOptions::set_threads(size_t threads)
 	_threads = threads;
 }
 
+size_t SynfigToolGeneralOptions::get_frames_in_flight() const
+{
+	return _frames_in_flight;
+}
+
+void SynfigToolGeneralOptions::set_frames_in_flight(size_t frames_in_flight)
+{
+	_frames_in_flight = frames_in_flight;
+}
+
+size_t SynfigToolGeneralOptions::get_encoding_queue() const
+{
+	return _encoding_queue;
+}
+
+void SynfigToolGeneralOptions::set_encoding_queue(size_t encoding_queue)
+{
+	_encoding_queue = encoding_queue;
+}
+
 int SynfigToolGeneralOptions::get_verbosity() const
 {
 	return _verbosity;
@@ -89,3 +111,13 @@ void SynfigToolGeneralOptions::set_should_print_benchmarks(bool print_benchmarks
 {
 	_should_print_benchmarks = print_benchmarks;
 }
+
+std::string SynfigToolGeneralOptions::get_trace_file() const
+{
+	return _trace_file;
+}
+
+void SynfigToolGeneralOptions::set_trace_file(const std::string& trace_file)
+{
+	_trace_file = trace_file;
+}
@@ -91,6 +91,14 @@ public:
 
 	void set_threads(size_t threads);
 
+	size_t get_frames_in_flight() const;
+
+	void set_frames_in_flight(size_t frames_in_flight);
+
+	size_t get_encoding_queue() const;
+
+	void set_encoding_queue(size_t encoding_queue);
+
 	int get_verbosity() const;
 
 	void set_verbosity(int verbosity);
@@ -103,11 +111,18 @@ public:
 
 	void set_should_print_benchmarks(bool print_benchmarks);
 
+	std::string get_trace_file() const;
+
+	void set_trace_file(const std::string& trace_file);
+
 private:
 	SynfigToolGeneralOptions();
 	std::string _binary_path;
 	int _verbosity;
 	size_t _threads;
+	size_t _frames_in_flight;
+	size_t _encoding_queue;
+	std::string _trace_file;
 	bool _should_be_quiet,
 		 _should_print_benchmarks;
 };
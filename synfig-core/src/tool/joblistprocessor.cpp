@@ -44,8 +44,12 @@
 #include <synfig/localization.h>
 #include <synfig/target.h>
 #include <synfig/target_scanline.h>
+#include <synfig/target_tile.h>
 #include <synfig/savecanvas.h>
 #include <synfig/filesystemnative.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/rendercache.h>
+#include <synfig/debug/trace.h>
 
 #include "definitions.h"
 #include "synfigtoolexception.h"
@@ -69,11 +73,25 @@ void process_job_list(std::list<Job>& job_list, const TargetParam& target_params
 	if (job_list.empty())
 		throw (SynfigToolException(SYNFIGTOOL_BORED, _("Nothing to do!")));
 
+	const std::string trace_file = SynfigToolGeneralOptions::instance()->get_trace_file();
+	if (!trace_file.empty())
+	{
+		debug::Trace::clear();
+		debug::Trace::set_enabled(true);
+	}
+
 	for(; !job_list.empty(); job_list.pop_front())
 	{
 		if (setup_job(job_list.front(), target_params))
 			process_job(job_list.front());
 	}
+
+	if (!trace_file.empty())
+	{
+		debug::Trace::set_enabled(false);
+		if (!debug::Trace::save(trace_file))
+			throw (SynfigToolException(SYNFIGTOOL_INVALIDOUTPUT, _("Unable to save trace file.")));
+	}
 }
 
 std::string get_extension(const std::string &filename)
@@ -217,6 +235,18 @@ bool setup_job(Job& job, const TargetParam& target_parameters)
 	if (job.target && Target_Scanline::Handle::cast_dynamic(job.target))
 		Target_Scanline::Handle::cast_dynamic(job.target)->set_threads(SynfigToolGeneralOptions::instance()->get_threads());
 
+	// Set the number of frames rendered at the same time
+	if (Target_Scanline::Handle target = Target_Scanline::Handle::cast_dynamic(job.target))
+		target->set_frames_in_flight((int)SynfigToolGeneralOptions::instance()->get_frames_in_flight());
+	if (Target_Tile::Handle target = Target_Tile::Handle::cast_dynamic(job.target))
+		target->set_frames_in_flight((int)SynfigToolGeneralOptions::instance()->get_frames_in_flight());
+
+	// Set the number of frames encoded in background,
+	// keep the value of SYNFIG_TARGET_ENCODING_QUEUE if option is not set
+	if (Target_Scanline::Handle target = Target_Scanline::Handle::cast_dynamic(job.target))
+		if (SynfigToolGeneralOptions::instance()->get_encoding_queue() > 0)
+			target->set_encoding_queue((int)SynfigToolGeneralOptions::instance()->get_encoding_queue());
+
 	return true;
 }
 
@@ -280,6 +310,18 @@ void process_job (Job& job)
                       << _(": Rendered in ")
                       << duration.count()
                       << _(" seconds.") << std::endl;
+
+            if (rendering::RenderCache *cache = rendering::Renderer::get_cache())
+            {
+                rendering::RenderCache::Stats stats = cache->get_stats();
+                std::cout << job.filename.c_str()
+                          << _(": Render cache hits ") << stats.hits
+                          << _(", misses ") << stats.misses
+                          << _(", stored ") << stats.stores
+                          << _(", evicted ") << stats.evictions
+                          << _(", used ") << stats.bytes/1024 << _(" KiB of ")
+                          << stats.max_bytes/1024 << _(" KiB.") << std::endl;
+            }
         }
 	}
 
@@ -95,9 +95,13 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	set_antialias(),
 	set_quality(),
 	set_num_threads(),
+	set_frames_in_flight(),
+	set_encoding_queue(),
 	set_input_file(),
 	set_output_file(),
 	set_sequence_separator(),
+	set_compression_level(-1),
+	set_compression_filter(),
 	set_canvas_id(),
 	set_fps(),
 	set_time(),
@@ -113,6 +117,7 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	sw_quiet(),
 	sw_print_benchmarks(),
 	sw_extract_alpha(),
+	sw_trace_filename(),
 
 	// Misc group
 	misc_append_filename(),
@@ -153,9 +158,13 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	add_option(og_set, "antialias",   'a', set_antialias,	_("Set antialias amount for parametric renderer."), "1..30");
 	//og_set.add_option("quality",     'Q', quality_arg_desc, etl::strprintf(_("Specify image quality for accelerated renderer (Default: %d)"), DEFAULT_QUALITY).c_str(), "NUM");
 	add_option(og_set, "threads",     'T', set_num_threads, _("Enable multithreaded renderer using the specified number of threads"), "NUM");
+	add_option(og_set, "frames-in-flight", ' ', set_frames_in_flight, _("Render up to the specified number of frames at the same time (Default: 1)"), "NUM");
+	add_option(og_set, "encoding-queue", ' ', set_encoding_queue, _("Encode up to the specified number of image sequence frames in background (Default: 0)"), "NUM");
 	add_option(og_set, "input-file",  'i', set_input_file, 	_("Specify input filename"), "filename");
 	add_option(og_set, "output-file", 'o', set_output_file, _("Specify output filename"), "filename");
 	add_option(og_set, "sequence-separator", ' ', set_sequence_separator, _("Output file sequence separator string (Use double quotes if you want to use spaces)"), "string");
+	add_option(og_set, "compression-level", ' ', set_compression_level, _("Set the compression level of lossless image formats"), "0..9");
+	add_option(og_set, "compression-filter", ' ', set_compression_filter, _("Set the row filter of lossless image formats (none, sub, up, avg, paeth or all)"), "filter");
 	add_option(og_set, "canvas",      'c', set_canvas_id, 	_("Render the canvas with the given id instead of the root."), "id");
 	add_option(og_set, "fps",         ' ', set_fps, 		_("Set the frame rate"), "NUM");
 	add_option(og_set, "time",        ' ', set_time, 		_("Render a single frame at <seconds>"), "seconds");
@@ -172,6 +181,7 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	add_option(og_switch, "quiet",         'q', sw_quiet, 				_("Quiet mode (No progress/time-remaining display)"), "");
 	add_option(og_switch, "benchmarks",    'b', sw_print_benchmarks,	_("Print benchmarks"), "");
 	add_option(og_switch, "extract-alpha", 'x', sw_extract_alpha, 		_("Extract alpha"), "");
+	add_option_filename(og_switch, "trace", ' ', sw_trace_filename, 	_("Record timings of rendering tasks and save them to <filename> in Chrome trace format"), _("filename"));
 
 	//SynfigOptionGroup og_misc("misc", _("Misc options"), "Show Misc options help");
 	add_option_filename(og_misc, "append", ' ', misc_append_filename, 	_("Append layers in <filename> to composition"), _("filename"));
@@ -345,6 +355,11 @@ void SynfigCommandLineParser::process_settings_options() const
 		SynfigToolGeneralOptions::instance()->set_should_print_benchmarks(true);
 	}
 
+	if (!sw_trace_filename.empty())
+	{
+		SynfigToolGeneralOptions::instance()->set_trace_file(sw_trace_filename);
+	}
+
 	if (sw_quiet)
 	{
 		SynfigToolGeneralOptions::instance()->set_should_be_quiet(true);
@@ -357,6 +372,20 @@ void SynfigCommandLineParser::process_settings_options() const
 
 	VERBOSE_OUT(1) << _("Threads set to ")
 				   << SynfigToolGeneralOptions::instance()->get_threads() << std::endl;
+
+	if (set_frames_in_flight > 0)
+	{
+		SynfigToolGeneralOptions::instance()->set_frames_in_flight(size_t(set_frames_in_flight));
+		VERBOSE_OUT(1) << _("Frames in flight set to ")
+					   << SynfigToolGeneralOptions::instance()->get_frames_in_flight() << std::endl;
+	}
+
+	if (set_encoding_queue > 0)
+	{
+		SynfigToolGeneralOptions::instance()->set_encoding_queue(size_t(set_encoding_queue));
+		VERBOSE_OUT(1) << _("Encoding queue set to ")
+					   << SynfigToolGeneralOptions::instance()->get_encoding_queue() << std::endl;
+	}
 }
 
 void SynfigCommandLineParser::process_trivial_info_options()
@@ -631,6 +660,19 @@ TargetParam SynfigCommandLineParser::extract_targetparam()
                        << "'."
 					   << std::endl;
 	}
+	if (set_compression_level >= 0)
+	{
+		if (set_compression_level > 9)
+			throw SynfigToolException(SYNFIGTOOL_UNKNOWNARGUMENT,
+									  etl::strprintf(_("Compression level %d is out of range 0..9."), set_compression_level));
+		params.compression_level = set_compression_level;
+		VERBOSE_OUT(1) << _("Compression level set to: ") << params.compression_level << std::endl;
+	}
+	if (!set_compression_filter.empty())
+	{
+		params.compression_filter = set_compression_filter;
+		VERBOSE_OUT(1) << _("Compression filter set to: ") << params.compression_filter << std::endl;
+	}
 
 	return params;
 }
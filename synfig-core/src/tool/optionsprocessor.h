@@ -104,9 +104,13 @@ private:
 	int				set_antialias;
 	int				set_quality;
 	int				set_num_threads;
+	int				set_frames_in_flight;
+	int				set_encoding_queue;
 	Glib::ustring	set_input_file;
 	Glib::ustring	set_output_file;
 	Glib::ustring	set_sequence_separator;
+	int				set_compression_level;
+	Glib::ustring	set_compression_filter;
 	Glib::ustring	set_canvas_id;
 	double			set_fps;
 	Glib::ustring	set_time;
@@ -122,6 +126,7 @@ private:
 	bool			sw_quiet;
 	bool			sw_print_benchmarks;
 	bool			sw_extract_alpha;
+	std::string		sw_trace_filename;
 
 	// Misc group
 	std::string		misc_append_filename;
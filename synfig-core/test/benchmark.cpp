@@ -0,0 +1,178 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file benchmark.cpp
+**	\brief Performance measurements of synfig-core
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <glib.h>
+
+#include <synfig/general.h>
+#include <synfig/importer.h>
+#include <synfig/importerframecache.h>
+#include <synfig/layer.h>
+#include <synfig/real.h>
+#include <synfig/threadpool.h>
+#include <synfig/token.h>
+#include <synfig/type.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/common/task/taskcontour.h>
+
+#include "benchmark.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+namespace {
+
+struct Benchmark
+{
+	const char *name;
+	int (*run)();
+};
+
+// the loader goes first, while the peak memory of the process is still low
+const Benchmark benchmarks[] = {
+	{ "document",  benchmark_document },
+	{ "rendering", benchmark_rendering },
+	{ "contour",   benchmark_contour },
+	{ "surface",   benchmark_surface },
+	{ "blur",      benchmark_blur },
+	{ "importer",  benchmark_importer },
+};
+
+const int benchmarks_count = sizeof(benchmarks)/sizeof(*benchmarks);
+
+} // end of anonimous namespace
+
+/* === P R O C E D U R E S ================================================= */
+
+Task::Handle
+benchmark_contour_task(const Vector &center, Real radius, const Color &color)
+{
+	Contour::Handle contour(new Contour());
+	contour->color = color;
+	for(int i = 0; i < 10; ++i) {
+		Real angle = 2.0*PI*i/10.0;
+		Real r = i % 2 ? radius*0.4 : radius;
+		Vector p = center + Vector(r*cos(angle), r*sin(angle));
+		if (i) contour->line_to(p); else contour->move_to(p);
+	}
+	contour->close();
+
+	TaskContour::Handle task(new TaskContour());
+	task->contour = contour;
+	return task;
+}
+
+bool
+benchmark_read_pixels(const SurfaceResource::Handle &resource, std::vector<Color> &pixels)
+{
+	SurfaceResource::LockReadBase lock(resource);
+	if (!lock.convert(rendering::Surface::Token::Handle(), false, true))
+		return false;
+	pixels.resize(lock.get_surface()->get_pixels_count());
+	return lock.get_surface()->get_pixels(&pixels.front());
+}
+
+bool
+benchmark_colors_equal(const Color &straight_a, const Color &straight_b)
+{
+	const Color a = straight_a.premult_alpha(), b = straight_b.premult_alpha();
+	return std::fabs(a.get_r() - b.get_r()) <= 1e-5f
+	    && std::fabs(a.get_g() - b.get_g()) <= 1e-5f
+	    && std::fabs(a.get_b() - b.get_b()) <= 1e-5f
+	    && std::fabs(a.get_a() - b.get_a()) <= 1e-5f;
+}
+
+String
+benchmark_temporary_file_name(const char *name)
+{
+	gchar *file_name = g_build_filename(g_get_tmp_dir(), name, nullptr);
+	String filename(file_name);
+	g_free(file_name);
+	return filename;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+//! runs all benchmarks, or only the ones given by names in arguments
+int main(int argc, char **argv)
+{
+	for(int i = 1; i < argc; ++i) {
+		bool found = false;
+		for(int j = 0; j < benchmarks_count; ++j)
+			if (!strcmp(argv[i], benchmarks[j].name)) found = true;
+		if (!found) {
+			fprintf(stderr, "unknown benchmark: %s\nusage: %s [", argv[i], argv[0]);
+			for(int j = 0; j < benchmarks_count; ++j)
+				fprintf(stderr, "%s%s", j ? "|" : "", benchmarks[j].name);
+			fprintf(stderr, "]...\n");
+			return 1;
+		}
+	}
+
+	Type::subsys_init();
+	ThreadPool::subsys_init();
+	Renderer::subsys_init();
+	Layer::subsys_init();
+	Importer::subsys_init();
+	Token::rebuild();
+
+	int error = 0;
+	for(int j = 0; j < benchmarks_count; ++j) {
+		bool selected = argc < 2;
+		for(int i = 1; i < argc; ++i)
+			if (!strcmp(argv[i], benchmarks[j].name)) selected = true;
+		if (selected)
+			error += benchmarks[j].run();
+	}
+
+	ImporterFrameCache::instance().wait_prefetch();
+	Importer::subsys_stop();
+	Layer::subsys_stop();
+	Renderer::subsys_stop();
+	ThreadPool::subsys_stop();
+	Type::subsys_stop();
+
+	return error;
+}
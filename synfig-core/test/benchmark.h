@@ -0,0 +1,69 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file benchmark.h
+**	\brief Performance measurements of synfig-core
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_TEST_BENCHMARK_H
+#define __SYNFIG_TEST_BENCHMARK_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <vector>
+
+#include <synfig/color.h>
+#include <synfig/string.h>
+#include <synfig/vector.h>
+#include <synfig/rendering/surface.h>
+#include <synfig/rendering/task.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+//! Benchmarks only measure, correctness is checked by the tests of 'make check'.
+//! Each benchmark returns count of failed runs, when the result is obviously broken
+//! and the measured time doesn't mean anything.
+
+//! star of the given color, rendered by TaskContour
+synfig::rendering::Task::Handle benchmark_contour_task(const synfig::Vector &center, synfig::Real radius, const synfig::Color &color);
+//! reads all pixels of the surface as straight colors
+bool benchmark_read_pixels(const synfig::rendering::SurfaceResource::Handle &resource, std::vector<synfig::Color> &pixels);
+//! compares premultiplied colors, so almost transparent pixels may differ in straight color
+bool benchmark_colors_equal(const synfig::Color &straight_a, const synfig::Color &straight_b);
+//! name of the file in temporary directory
+synfig::String benchmark_temporary_file_name(const char *name);
+
+int benchmark_document();
+int benchmark_rendering();
+int benchmark_contour();
+int benchmark_surface();
+int benchmark_blur();
+int benchmark_importer();
+
+/* === E N D =============================================================== */
+
+#endif
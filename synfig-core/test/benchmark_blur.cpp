@@ -0,0 +1,222 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file benchmark_blur.cpp
+**	\brief Benchmarks of blur and of FFT
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include <glib.h>
+
+#include <synfig/general.h>
+#include <synfig/real.h>
+#include <synfig/surface.h>
+#include <synfig/rendering/software/function/blur.h>
+#include <synfig/rendering/software/function/fft.h>
+
+#include "benchmark.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#define BLUR_WIDTH             1920
+#define BLUR_HEIGHT            1080
+
+#define FFT_REPEATS            4
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+static double
+blur_time(synfig::Surface &dest, const synfig::Surface &src, rendering::Blur::Type type, Real size, software::Blur::Algorithm algorithm)
+{
+	long long time = g_get_monotonic_time();
+	software::Blur::blur(
+		software::Blur::Params(
+			dest, RectInt(0, 0, dest.get_w(), dest.get_h()),
+			src, VectorInt(0, 0),
+			type, Vector(size, size),
+			false, Color::BLEND_COMPOSITE, 1.0 ),
+		algorithm );
+	return 1e-6*(g_get_monotonic_time() - time);
+}
+
+//! time of blur algorithms at single and all threads compared with estimate of the cost model,
+//! the result should not depend on count of threads
+static int
+blur_test(rendering::Blur::Type type, Real size, int width, int height)
+{
+	const char *type_names[] = { "box", "fastgaussian", "cross", "gaussian", "disc" };
+	const char *algorithm_names[] = { "auto", "box", "pattern", "fft" };
+
+	synfig::Surface src(width, height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			src[y][x] = ((x/64 + y/64)%3)
+			          ? Color((Real)x/width, (Real)y/height, 0.5, (x*y)%7 ? 1.0 : 0.0)
+			          : Color::alpha();
+
+	software::Blur::Params params(
+		src, RectInt(0, 0, width, height),
+		src, VectorInt(0, 0),
+		type, Vector(size, size),
+		false, Color::BLEND_COMPOSITE, 1.0 );
+	if (!params.validate()) {
+		synfig::error("blur_test: invalid params");
+		return 1;
+	}
+	const software::Blur::Algorithm chosen = software::Blur::choose_algorithm(params);
+	const Real chosen_cost = software::Blur::estimate_cost(chosen, params);
+
+	const int max_threads = software::Blur::get_max_threads();
+	int errors = 0;
+	for(int i = software::Blur::ALGORITHM_BOX; i <= software::Blur::ALGORITHM_FFT; ++i) {
+		const software::Blur::Algorithm algorithm = (software::Blur::Algorithm)i;
+		const Real cost = software::Blur::estimate_cost(algorithm, params);
+		// don't wait for algorithms which are obviously slow
+		if (cost < 0.0 || (algorithm != chosen && cost > 4.0*chosen_cost))
+			continue;
+
+		synfig::Surface serial(width, height), parallel(width, height);
+		software::Blur::set_max_threads(1);
+		const double time_serial = blur_time(serial, src, type, size, algorithm);
+		software::Blur::set_max_threads(0);
+		const int threads = software::Blur::get_threads_count();
+		const double time_parallel = blur_time(parallel, src, type, size, algorithm);
+
+		int mismatches = 0;
+		for(int y = 0; y < height; ++y)
+			for(int x = 0; x < width; ++x)
+				if (!benchmark_colors_equal(serial[y][x], parallel[y][x])) ++mismatches;
+
+		printf("blur<%s, %g, %dx%d>: %s%s, estimated %.1f ms, 1 thread %.1f ms, %d threads %.1f ms, x%.2f, mismatches %d\n",
+			type_names[type], (double)size, width, height,
+			algorithm_names[algorithm], algorithm == chosen ? " (chosen)" : "",
+			1e3*cost, 1e3*time_serial, threads, 1e3*time_parallel,
+			time_parallel > 0.0 ? time_serial/time_parallel : 0.0,
+			mismatches );
+
+		if (mismatches) {
+			synfig::error("blur_test: result of %s blur depends on count of threads", algorithm_names[algorithm]);
+			++errors;
+		}
+	}
+	software::Blur::set_max_threads(max_threads);
+
+	return errors ? 1 : 0;
+}
+
+//! throughput of forward and inverse 2D transforms by cached plans,
+//! the first pair includes the planning
+static int
+fft_test(software::FFT::Planning planning, int width, int height, int repeats)
+{
+	width = software::FFT::get_valid_count(width);
+	height = software::FFT::get_valid_count(height);
+
+	std::vector<Complex> data(width*height), source(width*height);
+	for(int i = 0; i < (int)source.size(); ++i)
+		source[i] = Complex((i*7 + i/width*13)%256/255.0, (i%11)/10.0);
+	data = source;
+
+	software::Array<Complex, 2> arr(&data.front());
+	arr.set_dim(height, width).set_dim(width, 1);
+
+	const software::FFT::Planning prev_planning = software::FFT::get_planning();
+	software::FFT::set_planning(planning);
+	const software::FFT::Stats stats = software::FFT::get_stats();
+
+	long long time = g_get_monotonic_time();
+	software::FFT::fft2d(arr, false);
+	software::FFT::fft2d(arr, true);
+	double time_first = 1e-6*(g_get_monotonic_time() - time);
+
+	time = g_get_monotonic_time();
+	for(int i = 0; i < repeats; ++i) {
+		software::FFT::fft2d(arr, false);
+		software::FFT::fft2d(arr, true);
+	}
+	double time_cached = 1e-6*(g_get_monotonic_time() - time);
+
+	software::FFT::set_planning(prev_planning);
+	const software::FFT::Stats new_stats = software::FFT::get_stats();
+
+	Real error = 0.0;
+	for(int i = 0; i < (int)source.size(); ++i)
+		error = std::max(error, (Real)std::abs(data[i] - source[i]));
+
+	// conventional estimate of flops of complex transform is 5*N*log2(N)
+	const double flops = 5.0*width*height*std::log2((double)width*height)*2*repeats;
+	printf("fft<%s, %dx%d>: first pair %.1f ms, then %.1f ms per pair, %.2f GFlops, plans %lld, reuses %lld, max error %g\n",
+		planning == software::FFT::PLANNING_MEASURE ? "measure" : "estimate",
+		width, height,
+		1e3*time_first,
+		1e3*time_cached/repeats,
+		time_cached > 0.0 ? 1e-9*flops/time_cached : 0.0,
+		new_stats.plans - stats.plans,
+		new_stats.reuses - stats.reuses,
+		(double)error );
+
+	if (error > 1e-9) {
+		synfig::error("fft_test: inverse transform doesn't restore the data, error %g", (double)error);
+		return 1;
+	}
+	return 0;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int benchmark_blur()
+{
+	int error = 0;
+	error += blur_test(rendering::Blur::BOX, 64, BLUR_WIDTH, BLUR_HEIGHT);
+	error += blur_test(rendering::Blur::CROSS, 32, BLUR_WIDTH, BLUR_HEIGHT);
+	error += blur_test(rendering::Blur::FASTGAUSSIAN, 64, BLUR_WIDTH, BLUR_HEIGHT);
+	error += fft_test(software::FFT::PLANNING_ESTIMATE, BLUR_WIDTH, BLUR_HEIGHT, FFT_REPEATS);
+	error += fft_test(software::FFT::PLANNING_MEASURE, BLUR_WIDTH, BLUR_HEIGHT, FFT_REPEATS);
+
+	const Real blur_sizes[] = { 2, 8, 32, 128 };
+	for(int i = 0; i < (int)(sizeof(blur_sizes)/sizeof(*blur_sizes)); ++i) {
+		error += blur_test(rendering::Blur::GAUSSIAN, blur_sizes[i], BLUR_WIDTH, BLUR_HEIGHT);
+		error += blur_test(rendering::Blur::DISC, blur_sizes[i], BLUR_WIDTH, BLUR_HEIGHT);
+	}
+	return error;
+}
@@ -0,0 +1,346 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file benchmark_contour.cpp
+**	\brief Benchmarks of rasterization of contours and of blending
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include <glib.h>
+
+#include <synfig/general.h>
+#include <synfig/matrix.h>
+#include <synfig/real.h>
+#include <synfig/surface.h>
+#include <synfig/color/color.h>
+#include <synfig/rendering/primitive/contour.h>
+#include <synfig/rendering/primitive/polyspan.h>
+#include <synfig/rendering/software/function/contour.h>
+
+#include "benchmark.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#define BLEND_SPAN_WIDTH       1024
+#define BLEND_SPAN_ROWS        1024
+
+#define CONTOUR_STRESS_POINTS  4000
+#define CONTOUR_REPEATS        4
+
+#define GEOMETRY_REPEATS       20
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+//! star with thin spikes over the whole frame, a lot of edge crossings per row
+static Contour::Handle
+create_stress_star(int points)
+{
+	Contour::Handle contour(new Contour());
+	for(int i = 0; i < points; ++i) {
+		Real angle = 2.0*PI*i/points;
+		Real r = i % 2 ? 0.05 : 1.0;
+		Vector p(r*cos(angle), r*sin(angle));
+		if (i) contour->line_to(p); else contour->move_to(p);
+	}
+	contour->close();
+	return contour;
+}
+
+//! self-intersecting pseudo-random polyline, a lot of crossings in every cell
+static Contour::Handle
+create_stress_scribble(int points)
+{
+	Contour::Handle contour(new Contour());
+	contour->winding_style = Contour::WINDING_EVEN_ODD;
+	unsigned int seed = 12345;
+	for(int i = 0; i < points; ++i) {
+		seed = seed*1103515245u + 12345u;
+		Real x = (seed >> 8 & 0xffff)/32768.0 - 1.0;
+		seed = seed*1103515245u + 12345u;
+		Real y = (seed >> 8 & 0xffff)/32768.0 - 1.0;
+		if (i) contour->line_to(Vector(x, y)); else contour->move_to(Vector(x, y));
+	}
+	contour->close();
+	return contour;
+}
+
+//! contours/sec of TaskContourSW core (polyspan build, sort and sweep) for each Polyspan::Accumulator
+static int
+contour_test(const char *name, const Contour::Handle &contour, int width, int height, int repeats)
+{
+	const Polyspan::Accumulator accumulators[] = { Polyspan::ACCUMULATOR_SORT, Polyspan::ACCUMULATOR_BUCKETS };
+	const char *accumulator_names[] = { "sort", "buckets" };
+	const int count = sizeof(accumulators)/sizeof(*accumulators);
+
+	// unit square fits into frame
+	Matrix matrix;
+	matrix.m00 = matrix.m11 = 0.5*std::min(width, height);
+	matrix.m20 = 0.5*width;
+	matrix.m21 = 0.5*height;
+
+	synfig::Surface surfaces[count];
+	double seconds[count];
+	size_t marks[count];
+	for(int a = 0; a < count; ++a) {
+		surfaces[a].set_wh(width, height);
+		long long time = g_get_monotonic_time();
+		for(int i = 0; i < repeats; ++i) {
+			surfaces[a].clear();
+			Polyspan polyspan;
+			polyspan.set_accumulator(accumulators[a]);
+			polyspan.init(0, 0, width, height);
+			software::Contour::build_polyspan(contour->get_chunks(), matrix, polyspan);
+			polyspan.close();
+			polyspan.sort_marks();
+			software::Contour::render_polyspan(
+				surfaces[a], polyspan, false, true, contour->winding_style,
+				Color::white(), 1.0, Color::BLEND_COMPOSITE );
+			marks[a] = polyspan.get_covers().size();
+		}
+		seconds[a] = 1e-6*(g_get_monotonic_time() - time);
+	}
+
+	printf("contour<%s, %dx%d>:", name, width, height);
+	for(int a = 0; a < count; ++a)
+		printf(" %s %7.2f contours/sec (%lu marks)%s",
+			accumulator_names[a],
+			seconds[a] > 0.0 ? repeats/seconds[a] : 0.0,
+			(unsigned long)marks[a],
+			a + 1 < count ? "," : "" );
+	printf(", x%.2f\n", seconds[count - 1] > 0.0 ? seconds[0]/seconds[count - 1] : 0.0);
+
+	// accumulators differ only by order of summation
+	for(int a = 1; a < count; ++a)
+		for(int y = 0; y < height; ++y)
+			for(int x = 0; x < width; ++x)
+				if (std::fabs(surfaces[a][y][x].get_a() - surfaces[0][y][x].get_a()) > 1e-4f) {
+					synfig::error("contour_test: %s, accumulator %s differs at pixel %d, %d",
+						name, accumulator_names[a], x, y);
+					return 1;
+				}
+	return 0;
+}
+
+//! contour like the one built by the layer of mod_geometry with the same name
+static Contour::Handle
+create_geometry_contour(const String &type)
+{
+	Contour::Handle contour(new Contour());
+	if (type == "rectangle") {
+		contour->move_to(Vector(-0.6, -0.4));
+		contour->line_to(Vector( 0.6, -0.4));
+		contour->line_to(Vector( 0.6,  0.4));
+		contour->line_to(Vector(-0.6,  0.4));
+	} else
+	if (type == "circle") {
+		// 8 conic segments, as in Circle::sync_vfunc()
+		const Real radius = 0.8, k = 1.0/cos(PI/8.0);
+		contour->move_to(Vector(radius, 0.0));
+		for(int i = 0; i < 8; ++i) {
+			Real a0 = PI*(2*i + 1)/8.0, a1 = PI*(2*i + 2)/8.0;
+			contour->conic_to(
+				Vector(radius*cos(a1), radius*sin(a1)),
+				Vector(k*radius*cos(a0), k*radius*sin(a0)) );
+		}
+	} else
+	if (type == "star") {
+		for(int i = 0; i < 10; ++i) {
+			Real angle = PI/2.0 + 2.0*PI*i/10.0;
+			Real r = i % 2 ? 0.38 : 1.0;
+			Vector p(r*cos(angle), r*sin(angle));
+			if (i) contour->line_to(p); else contour->move_to(p);
+		}
+	} else
+	if (type == "region") {
+		// closed spline through 6 vertices
+		const int count = 6;
+		std::vector<Vector> points(count);
+		for(int i = 0; i < count; ++i) {
+			Real angle = 2.0*PI*i/count, r = i % 2 ? 0.6 : 0.9;
+			points[i] = Vector(r*cos(angle), r*sin(angle));
+		}
+		contour->move_to(points[0]);
+		for(int i = 0; i < count; ++i) {
+			const Vector &p0 = points[i], &p1 = points[(i + 1) % count];
+			Vector t0 = (p1 - points[(i + count - 1) % count])*0.5;
+			Vector t1 = (points[(i + 2) % count] - p0)*0.5;
+			contour->cubic_to(p1, p0 + t0/3.0, p1 - t1/3.0);
+		}
+	} else
+	if (type == "outline") {
+		// thin stroke along wavy loop, mostly antialiased pixels
+		const int count = 64;
+		const Real width = 0.02;
+		for(int side = 0; side < 2; ++side) {
+			for(int j = 0; j <= count; ++j) {
+				int i = side ? count - j : j;
+				Real angle = 2.0*PI*i/count;
+				Real r = 0.7 + 0.1*sin(6.0*angle) + (side ? -width : width);
+				Vector p(r*cos(angle), r*sin(angle));
+				if (j) contour->line_to(p); else contour->move_to(p);
+			}
+			contour->close();
+		}
+	}
+	contour->close();
+	return contour;
+}
+
+//! Mpixels/sec of TaskContourSW core for shapes of mod_geometry layers,
+//! opaque and semi-transparent color, normal and inverted
+static int
+geometry_test(const String &type, int width, int height, int repeats)
+{
+	Contour::Handle contour = create_geometry_contour(type);
+
+	Matrix matrix;
+	matrix.m00 = matrix.m11 = 0.5*std::min(width, height);
+	matrix.m20 = 0.5*width;
+	matrix.m21 = 0.5*height;
+
+	const double mpixels = 1e-6*width*height*repeats;
+	synfig::Surface surfaces[2];
+	printf("geometry<%-9s, %dx%d>:", type.c_str(), width, height);
+	for(int pass = 0; pass < 4; ++pass) {
+		const bool invert = pass % 2;
+		const Color::value_type opacity = pass < 2 ? 1.f : 0.5f;
+
+		surfaces[invert].set_wh(width, height);
+		long long time = g_get_monotonic_time();
+		for(int i = 0; i < repeats; ++i) {
+			surfaces[invert].clear();
+			Polyspan polyspan;
+			polyspan.init(0, 0, width, height);
+			software::Contour::build_polyspan(contour->get_chunks(), matrix, polyspan);
+			polyspan.close();
+			polyspan.sort_marks();
+			software::Contour::render_polyspan(
+				surfaces[invert], polyspan, invert, true, contour->winding_style,
+				Color::white(), opacity, Color::BLEND_COMPOSITE );
+		}
+		double seconds = 1e-6*(g_get_monotonic_time() - time);
+		printf(" %s%s %7.1f", opacity < 1.f ? "blend" : "fill", invert ? "/invert" : "",
+			seconds > 0.0 ? mpixels/seconds : 0.0 );
+
+		// inverted shape should complement the normal one
+		if (invert)
+			for(int y = 0; y < height; ++y)
+				for(int x = 0; x < width; ++x)
+					if (std::fabs(surfaces[0][y][x].get_a() + surfaces[1][y][x].get_a() - opacity) > 1e-4f) {
+						printf("\n");
+						synfig::error("geometry_test: %s, inverted shape differs at pixel %d, %d", type.c_str(), x, y);
+						return 1;
+					}
+	}
+	printf(" Mpixels/sec\n");
+	return 0;
+}
+
+//! Mpixels/sec of Color::blend_span() compared with per-pixel Color::blend()
+static int
+blend_span_test(Color::BlendMethod method, int width, int rows)
+{
+	std::vector<Color> src(width), dest(width);
+	for(int i = 0; i < width; ++i) {
+		src[i] = Color(i%3/2.f, i%5/4.f, i%7/6.f, i%11/10.f);
+		dest[i] = Color(i%13/12.f, i%2/1.f, i%17/16.f, i%19/18.f);
+	}
+	const float amount = 0.75f;
+	const double mpixels = 1e-6*width*rows;
+
+	// dest is restored for each row, so the values do not degrade to denormals
+	std::vector<Color> row(width);
+	long long time = g_get_monotonic_time();
+	for(int j = 0; j < rows; ++j) {
+		std::copy(dest.begin(), dest.end(), row.begin());
+		for(int i = 0; i < width; ++i)
+			row[i] = Color::blend(src[i], row[i], amount, method);
+	}
+	double time_pixel = 1e-6*(g_get_monotonic_time() - time);
+
+	std::vector<Color> span(width);
+	time = g_get_monotonic_time();
+	for(int j = 0; j < rows; ++j) {
+		std::copy(dest.begin(), dest.end(), span.begin());
+		Color::blend_span(&span.front(), &src.front(), width, amount, method);
+	}
+	double time_span = 1e-6*(g_get_monotonic_time() - time);
+
+	printf("blend<%2d>: per pixel %8.1f Mpixels/sec, span %8.1f Mpixels/sec, x%.2f\n",
+		(int)method,
+		time_pixel > 0.0 ? mpixels/time_pixel : 0.0,
+		time_span > 0.0 ? mpixels/time_span : 0.0,
+		time_span > 0.0 ? time_pixel/time_span : 0.0 );
+
+	// results should be the same up to rounding errors
+	for(int i = 0; i < width; ++i)
+		if ( !approximate_equal_lp(row[i].get_r(), span[i].get_r())
+		  || !approximate_equal_lp(row[i].get_g(), span[i].get_g())
+		  || !approximate_equal_lp(row[i].get_b(), span[i].get_b())
+		  || !approximate_equal_lp(row[i].get_a(), span[i].get_a()) )
+		{
+			synfig::error("blend_span_test: method %d, results differ at pixel %d", (int)method, i);
+			return 1;
+		}
+	return 0;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int benchmark_contour()
+{
+	int error = 0;
+	for(int i = 0; i < 2; ++i) {
+		const int width = i ? 3840 : 1920, height = i ? 2160 : 1080;
+		error += contour_test("star", create_stress_star(CONTOUR_STRESS_POINTS), width, height, CONTOUR_REPEATS);
+		error += contour_test("scribble", create_stress_scribble(CONTOUR_STRESS_POINTS), width, height, CONTOUR_REPEATS);
+	}
+
+	const char *geometry_layers[] = { "region", "outline", "circle", "star", "rectangle" };
+	for(int i = 0; i < (int)(sizeof(geometry_layers)/sizeof(*geometry_layers)); ++i)
+		error += geometry_test(geometry_layers[i], 1920, 1080, GEOMETRY_REPEATS);
+
+	for(int i = 0; i < Color::BLEND_END; ++i)
+		error += blend_span_test((Color::BlendMethod)i, BLEND_SPAN_WIDTH, BLEND_SPAN_ROWS);
+	return error;
+}
@@ -0,0 +1,336 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file benchmark_document.cpp
+**	\brief Benchmarks of loading and evaluation of documents
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include <glib.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <ETL/stringf>
+
+#include <synfig/canvas.h>
+#include <synfig/filesystemnative.h>
+#include <synfig/general.h>
+#include <synfig/loadcanvas.h>
+#include <synfig/real.h>
+#include <synfig/waypoint.h>
+#include <synfig/valuenodes/valuenode_animated.h>
+#include <synfig/valuenodes/valuenode_bone.h>
+
+#include "benchmark.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#define EXPORTED_VALUE_NODES   10000
+#define LOADER_LAYERS          20000
+
+#define ANIMATED_WAYPOINTS     10000
+#define ANIMATED_SUBFRAMES     4
+
+#define BONE_DEPTH             60
+#define BONE_VERTICES          200
+#define BONE_FRAMES            12
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+//! writes a file with many exported value nodes, which refer to each other,
+//! and with group layers linked to them
+static void
+write_exported_file(const String &filename, int count, int layers)
+{
+	std::ofstream file(filename.c_str());
+	file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	     << "<canvas version=\"1.2\" width=\"480\" height=\"270\" view-box=\"-4 2.25 4 -2.25\">\n"
+	     << "<defs>\n";
+	// half of the nodes are constants, others link two earlier nodes
+	for(int i = 0; i < count; ++i) {
+		if (i < 2 || i % 2 == 0)
+			file << etl::strprintf("<real id=\"v%d\" value=\"%d\"/>\n", i, i);
+		else
+			file << etl::strprintf("<add type=\"real\" id=\"v%d\" lhs=\"v%d\" rhs=\"v%d\" scalar=\"v0\"/>\n",
+				i, i/2, i - 1 );
+	}
+	file << "</defs>\n";
+	for(int i = 0; i < layers; ++i)
+		file << etl::strprintf(
+			"<layer type=\"group\" active=\"true\" desc=\"layer %d\">\n"
+			"<param name=\"amount\" use=\"v%d\"/>\n"
+			"<param name=\"origin\"><vector><x>%d</x><y>0</y></vector></param>\n"
+			"<param name=\"canvas\"><canvas></canvas></param>\n"
+			"</layer>\n", i, 2*(i % (count/2)), i );
+	file << "</canvas>\n";
+}
+
+//! load time of a file with many exported value nodes
+static int
+load_exported_test(int count)
+{
+	String filename = benchmark_temporary_file_name("synfig-benchmark-exported.sif");
+	write_exported_file(filename, count, 0);
+
+	String errors, warnings;
+	long long time = g_get_monotonic_time();
+	Canvas::Handle canvas = open_canvas_as(FileSystemNative::instance()->get_identifier(filename), filename, errors, warnings);
+	double time_load = 1e-6*(g_get_monotonic_time() - time);
+
+	FileSystemNative::instance()->file_remove(filename);
+
+	if (!canvas) {
+		synfig::error("load_exported_test: %s", errors.c_str());
+		return 1;
+	}
+
+	int missing = 0;
+	time = g_get_monotonic_time();
+	for(int i = count - 1; i >= 0; --i)
+		if (!canvas->value_node_list().count(etl::strprintf("v%d", i)))
+			++missing;
+	double time_find = 1e-6*(g_get_monotonic_time() - time);
+
+	printf("load_exported<%d>: load %f seconds, find all %f seconds\n", count, time_load, time_find);
+
+	if (missing || (int)canvas->value_node_list().size() != count) {
+		synfig::error("load_exported_test: %d of %d exported value nodes not found", missing, count);
+		return 1;
+	}
+	return 0;
+}
+
+#ifndef _WIN32
+//! loads the file in a child process, to measure the peak memory of the loader alone
+static int
+load_in_child_process(const String &filename, bool streaming)
+{
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid < 0)
+		return 1;
+	if (pid == 0) {
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		long rss = usage.ru_maxrss;
+
+		String errors;
+		CanvasParser parser;
+		parser.set_streaming(streaming);
+		long long time = g_get_monotonic_time();
+		Canvas::Handle canvas = parser.parse_from_file_as(FileSystemNative::instance()->get_identifier(filename), filename, errors);
+		double seconds = 1e-6*(g_get_monotonic_time() - time);
+
+		getrusage(RUSAGE_SELF, &usage);
+		printf("  %-9s: %f seconds, peak RSS +%ld KiB, %d layers, %d value nodes\n",
+			streaming ? "streaming" : "DOM", seconds, usage.ru_maxrss - rss,
+			canvas ? (int)canvas->size() : 0,
+			canvas ? (int)canvas->value_node_list().size() : 0 );
+		if (!canvas)
+			synfig::error("loader_test: %s", errors.c_str());
+		fflush(stdout);
+		_exit(canvas ? 0 : 1);
+	}
+
+	int status = 0;
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+#endif
+
+//! compares wall time and peak memory of streaming and DOM loaders
+static int
+loader_test(int count, int layers)
+{
+#ifdef _WIN32
+	return 0;
+#else
+	String filename = benchmark_temporary_file_name("synfig-benchmark-loader.sif");
+	write_exported_file(filename, count, layers);
+
+	printf("loader<%d value nodes, %d layers>:\n", count, layers);
+	int error = 0;
+	error += load_in_child_process(filename, false);
+	error += load_in_child_process(filename, true);
+
+	FileSystemNative::instance()->file_remove(filename);
+	return error;
+#endif
+}
+
+//! evaluations/sec of an animated value node with a waypoint per frame
+static int
+animated_test(int waypoints, int subframes)
+{
+	const Real fps = 24.0;
+	ValueNode_Animated::Handle node = ValueNode_Animated::create(type_real);
+	for(int i = 0; i < waypoints; ++i) {
+		Waypoint waypoint(ValueBase(Real(std::sin(0.1*i))), Time(i/fps));
+		waypoint.set_parent_value_node(node.get());
+		node->editable_waypoint_list().push_back(waypoint);
+	}
+	node->changed();
+
+	// whole timeline forward, like playback or rendering
+	const int count = (waypoints - 1)*subframes + 1;
+	Real sum = 0.0;
+	long long time = g_get_monotonic_time();
+	for(int i = 0; i < count; ++i)
+		sum += (*node)(Time(i/(fps*subframes))).get(Real());
+	double time_forward = 1e-6*(g_get_monotonic_time() - time);
+
+	// scattered over the timeline, like studio does while scrubbing
+	time = g_get_monotonic_time();
+	for(int i = 0; i < count; ++i)
+		sum += (*node)(Time((i*7919 % count)/(fps*subframes))).get(Real());
+	double time_scattered = 1e-6*(g_get_monotonic_time() - time);
+
+	printf("animated<%d waypoints>: forward %.0f evaluations/sec, scattered %.0f evaluations/sec (%g)\n",
+		waypoints,
+		time_forward > 0.0 ? count/time_forward : 0.0,
+		time_scattered > 0.0 ? count/time_scattered : 0.0,
+		sum );
+
+	// the curve passes through the waypoints
+	for(int i = 0; i < waypoints; ++i)
+		if (!approximate_equal_lp((*node)(Time(i/fps)).get(Real()), std::sin(0.1*i))) {
+			synfig::error("animated_test: wrong value at waypoint %d", i);
+			return 1;
+		}
+	return 0;
+}
+
+//! chain of bones with animated angles, each one is the parent of the next,
+//! evaluated for vertices like ValueNode_BoneInfluence does,
+//! with and without the pose cache of ValueNode_Bone
+static int
+bone_pose_test(int depth, int vertices, int frames)
+{
+	const Real fps = 24.0;
+	std::vector<ValueNode_Bone::Handle> bones;
+	std::vector<ValueNode_Animated::Handle> angles;
+	for(int i = 0; i < depth; ++i) {
+		Bone bone;
+		bone.set_name(etl::strprintf("benchmark bone %d", i));
+		bone.set_origin(Point(i ? 1.0 : 0.0, 0.0));
+		bone.set_parent(i ? bones.back().get() : NULL);
+		ValueNode_Bone::Handle node(ValueNode_Bone::create(bone));
+
+		ValueNode_Animated::Handle angle = ValueNode_Animated::create(type_angle);
+		for(int j = 0; j < 2; ++j) {
+			Waypoint waypoint(ValueBase(Angle::deg(j ? 5.0 + i%7 : -3.0)), Time(j*frames/fps));
+			waypoint.set_parent_value_node(angle.get());
+			angle->editable_waypoint_list().push_back(waypoint);
+		}
+		angle->changed();
+		node->set_link("angle", angle);
+
+		bones.push_back(node);
+		angles.push_back(angle);
+	}
+
+	const bool enabled = ValueNode_Bone::is_pose_cache_enabled();
+	std::vector<Matrix> matrices[2];
+	double times[2] = { };
+	Real sum = 0.0;
+	for(int pass = 0; pass < 4; ++pass) {
+		// the last two passes check invalidation of cache, which is filled before, by changes of bones
+		if (pass == 2) {
+			angles.front()->editable_waypoint_list().front().set_value(ValueBase(Angle::deg(-10.0)));
+			angles.front()->changed();
+		}
+		const int cached = pass == 0 || pass == 2 ? 0 : 1;
+		ValueNode_Bone::set_pose_cache_enabled(cached);
+		matrices[cached].clear();
+
+		long long time = g_get_monotonic_time();
+		for(int f = 0; f < frames; ++f) {
+			const Time t(f/fps);
+			for(int v = 0; v < vertices; ++v) {
+				const Bone a = (*bones[v%depth])(t).get(Bone());
+				const Bone b = (*bones[(v*7 + 3)%depth])(t).get(Bone());
+				sum += a.get_animated_matrix().get_transformed(Vector(0.5, 0.0))[0];
+				sum += b.get_animated_matrix().get_transformed(Vector(0.5, 0.0))[1];
+			}
+			for(int i = 0; i < depth; ++i)
+				matrices[cached].push_back((*bones[i])(t).get(Bone()).get_animated_matrix());
+		}
+		if (pass < 2)
+			times[cached] = 1e-6*(g_get_monotonic_time() - time);
+
+		if (pass == 1 || pass == 3) {
+			for(int i = 0; i < (int)matrices[0].size(); ++i)
+				if (matrices[0][i] != matrices[1][i]) {
+					ValueNode_Bone::set_pose_cache_enabled(enabled);
+					synfig::error("bone_pose_test: cached pose differs from evaluation of chain, pass %d, bone %d", pass, i%depth);
+					return 1;
+				}
+		}
+	}
+	ValueNode_Bone::set_pose_cache_enabled(enabled);
+
+	const double evaluations = 2.0*frames*vertices;
+	printf("bone_pose<%d bones, %d vertices, %d frames>: chain %.0f bones/sec, cached %.0f bones/sec, x%.2f (%g)\n",
+		depth, vertices, frames,
+		times[0] > 0.0 ? evaluations/times[0] : 0.0,
+		times[1] > 0.0 ? evaluations/times[1] : 0.0,
+		times[1] > 0.0 ? times[0]/times[1] : 0.0,
+		sum );
+	return 0;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int benchmark_document()
+{
+	int error = 0;
+	error += loader_test(EXPORTED_VALUE_NODES, LOADER_LAYERS);
+	error += load_exported_test(EXPORTED_VALUE_NODES);
+	error += animated_test(ANIMATED_WAYPOINTS, ANIMATED_SUBFRAMES);
+	error += bone_pose_test(BONE_DEPTH, BONE_VERTICES, BONE_FRAMES);
+	return error;
+}
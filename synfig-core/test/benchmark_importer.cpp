@@ -0,0 +1,341 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file benchmark_importer.cpp
+**	\brief Benchmarks of importers and of targets
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include <glib.h>
+#include <zlib.h>
+
+#include <ETL/stringf>
+
+#include <synfig/filesystemnative.h>
+#include <synfig/general.h>
+#include <synfig/importer.h>
+#include <synfig/importerframecache.h>
+#include <synfig/listimporter.h>
+#include <synfig/renddesc.h>
+#include <synfig/surface.h>
+#include <synfig/target_scanline.h>
+
+#include "benchmark.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#define IMPORTER_CACHE_FRAMES  48
+
+#define ENCODING_FRAMES        24
+#define ENCODING_QUEUE         4
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+//! importer of synthetic images for importer_cache_test,
+//! each file name gives its own image, files don't exist
+class BenchmarkImporter: public Importer
+{
+public:
+	static std::atomic<int> decodes;
+
+	explicit BenchmarkImporter(const FileSystem::Identifier &identifier):
+		Importer(identifier) { }
+
+	static Importer* create(const FileSystem::Identifier &identifier)
+		{ return new BenchmarkImporter(identifier); }
+
+	static Color pixel(int seed, int x, int y)
+	{
+		return Color(
+			(Real)((x + seed)%256)/255,
+			(Real)((y*3 + seed)%256)/255,
+			(Real)((x/16 + y/16 + seed)%2 ? 255 : 0)/255,
+			1.0 );
+	}
+
+	static int seed(const String &filename)
+	{
+		int seed = 0;
+		for(String::const_iterator i = filename.begin(); i != filename.end(); ++i)
+			seed = (seed*31 + *i) & 0xffff;
+		return seed;
+	}
+
+	virtual bool get_frame(synfig::Surface &surface, const RendDesc & /* renddesc */, Time /* time */, ProgressCallback * /* callback */)
+	{
+		++decodes;
+		const int s = seed(identifier.filename);
+		surface.set_wh(640, 360);
+		for(int y = 0; y < surface.get_h(); ++y)
+			for(int x = 0; x < surface.get_w(); ++x)
+				surface[y][x] = pixel(s, x, y);
+		return true;
+	}
+};
+
+std::atomic<int> BenchmarkImporter::decodes(0);
+
+static double
+importer_pass(const Importer::Handle &importer, const RendDesc &renddesc, int frames, bool prefetch, int &mismatches)
+{
+	std::vector<Color> pixels;
+	long long time = g_get_monotonic_time();
+	for(int pass = 0; pass < 3; ++pass)
+		for(int i = 0; i < frames; ++i) {
+			// forward, backward and forward again, like scrubbing
+			const int frame = pass == 1 ? frames - 1 - i : i;
+			const Time t(frame/renddesc.get_frame_rate());
+			rendering::Surface::Handle surface = importer->get_frame(renddesc, t);
+			if (prefetch)
+				ImporterFrameCache::instance().prefetch(importer, renddesc, t);
+
+			const int x = frame*7, y = frame*5;
+			const int seed = BenchmarkImporter::seed(
+				benchmark_temporary_file_name(etl::strprintf("synfig-benchmark-%03d.benchframe", frame).c_str()) );
+			pixels.resize(surface ? surface->get_pixels_count() : 0);
+			if ( pixels.empty() || !surface->get_pixels(&pixels.front())
+			  || pixels[y*surface->get_width() + x] != BenchmarkImporter::pixel(seed, x, y) )
+				++mismatches;
+		}
+	ImporterFrameCache::instance().wait_prefetch();
+	return 1e-6*(g_get_monotonic_time() - time);
+}
+
+//! image sequence scrubbed back and forth: decodes and hits of the frame cache
+//! with enough memory, with prefetch, and with memory for a few frames only
+static int
+importer_cache_test(int frames)
+{
+	Importer::book()["benchframe"] = Importer::BookEntry(&BenchmarkImporter::create, false);
+	Importer::book()["lst"] = Importer::BookEntry(&ListImporter::create, false);
+
+	String filename = benchmark_temporary_file_name("synfig-benchmark-sequence.lst");
+	{
+		std::ofstream file(filename.c_str());
+		file << "FPS 24\n";
+		for(int i = 0; i < frames; ++i)
+			file << etl::strprintf("synfig-benchmark-%03d.benchframe\n", i);
+	}
+
+	RendDesc renddesc;
+	renddesc.set_frame_rate(24);
+
+	ImporterFrameCache &cache = ImporterFrameCache::instance();
+	const size_t max_bytes = cache.get_max_bytes();
+	int error = 0;
+	for(int mode = 0; mode < 3; ++mode) {
+		const char *names[] = { "cache", "cache+prefetch", "small cache" };
+		cache.clear();
+		cache.reset_stats();
+		if (mode == 2) {
+			// memory for a quarter of the frames
+			Importer::Handle probe = Importer::open(FileSystemNative::instance()->get_identifier(filename));
+			rendering::Surface::Handle surface = probe ? probe->get_frame(renddesc, Time(0)) : rendering::Surface::Handle();
+			cache.set_max_bytes((surface ? surface->get_memory_size() : 0)*(frames/4));
+			cache.clear();
+			cache.reset_stats();
+		}
+		BenchmarkImporter::decodes = 0;
+
+		int mismatches = 0;
+		double seconds;
+		{
+			Importer::Handle importer = Importer::open(FileSystemNative::instance()->get_identifier(filename), true);
+			if (!importer) {
+				synfig::error("importer_cache_test: cannot open %s", filename.c_str());
+				return 1;
+			}
+			seconds = importer_pass(importer, renddesc, frames, mode == 1, mismatches);
+		}
+		ImporterFrameCache::Stats stats = cache.get_stats();
+
+		printf("importer<%s, %d frames x 3>: %f seconds, %d decodes, hits %lld, misses %lld (hit rate %.1f%%), "
+			   "prefetched %lld (used %lld), evictions %lld, %lu MiB\n",
+			names[mode], frames, seconds, (int)BenchmarkImporter::decodes,
+			stats.hits, stats.misses,
+			stats.hits + stats.misses ? 100.0*stats.hits/(stats.hits + stats.misses) : 0.0,
+			stats.prefetches, stats.prefetch_hits, stats.evictions,
+			(unsigned long)(stats.bytes/1024/1024) );
+
+		if (mismatches) {
+			synfig::error("importer_cache_test: %d frames of %s have wrong content", mismatches, names[mode]);
+			++error;
+		}
+		// every frame is decoded once, when all frames fit into memory
+		if (mode < 2 && BenchmarkImporter::decodes != frames) {
+			synfig::error("importer_cache_test: %d decodes of %d frames", (int)BenchmarkImporter::decodes, frames);
+			++error;
+		}
+	}
+
+	cache.set_max_bytes(max_bytes);
+	cache.clear();
+	Importer::book().erase("benchframe");
+	FileSystemNative::instance()->file_remove(filename);
+	return error;
+}
+
+//! image sequence target which compresses frames by zlib, like png_trgt,
+//! but keeps only sizes and checksums of the compressed frames
+class BenchmarkTarget: public Target_Scanline
+{
+	class FrameJob: public EncodeJob
+	{
+	public:
+		BenchmarkTarget *target;
+		int frame;
+		std::vector<unsigned char> pixels;
+
+		FrameJob(): target(), frame() { }
+
+		virtual bool run()
+		{
+			uLongf size = compressBound(pixels.size());
+			std::vector<unsigned char> packed(size);
+			if (compress2(&packed.front(), &size, &pixels.front(), pixels.size(), 6) != Z_OK)
+				return false;
+			// frames are finished in any order, but each writes only its own entry
+			target->sizes[frame] = size;
+			target->checksums[frame] = adler32(adler32(0, NULL, 0), &packed.front(), size);
+			return true;
+		}
+	};
+
+	etl::handle<FrameJob> job;
+	std::vector<Color> row;
+	int y;
+
+public:
+	std::vector<uLongf> sizes;
+	std::vector<uLong> checksums;
+
+	BenchmarkTarget(int width, int height, int frames): y()
+	{
+		desc.set_wh(width, height);
+		desc.set_frame_start(0);
+		desc.set_frame_end(frames - 1);
+		row.resize(width);
+		sizes.resize(frames);
+		checksums.resize(frames);
+	}
+
+	virtual bool start_frame(ProgressCallback * /* cb */)
+	{
+		job = new FrameJob();
+		job->target = this;
+		job->frame = curr_frame_++;
+		job->pixels.resize(4*desc.get_w()*desc.get_h());
+		y = 0;
+		return true;
+	}
+
+	virtual Color* start_scanline(int /* scanline */)
+		{ return &row.front(); }
+
+	virtual bool end_scanline()
+	{
+		unsigned char *p = &job->pixels[4*desc.get_w()*y++];
+		for(std::vector<Color>::const_iterator i = row.begin(); i != row.end(); ++i) {
+			*p++ = (unsigned char)(255*i->get_r());
+			*p++ = (unsigned char)(255*i->get_g());
+			*p++ = (unsigned char)(255*i->get_b());
+			*p++ = (unsigned char)(255*i->get_a());
+		}
+		return true;
+	}
+
+	virtual void end_frame()
+		{ enqueue_encode_job(job); job.reset(); }
+};
+
+static int
+encoding_queue_test(int frames, int queue)
+{
+	const int width = 1280, height = 720;
+	synfig::Surface surface(width, height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			surface[y][x] = BenchmarkImporter::pixel(y/8, x, y);
+
+	std::vector<uLong> checksums;
+	int error = 0;
+	for(int mode = 0; mode < 2; ++mode) {
+		etl::handle<BenchmarkTarget> target = new BenchmarkTarget(width, height, frames);
+		target->set_encoding_queue(mode ? queue : 0);
+
+		bool success = true;
+		long long time = g_get_monotonic_time();
+		for(int i = 0; i < frames; ++i)
+			success = target->add_frame(&surface, NULL) && success;
+		success = target->wait_encode_jobs() && success;
+		time = g_get_monotonic_time() - time;
+
+		unsigned long long bytes = 0;
+		for(int i = 0; i < frames; ++i)
+			bytes += target->sizes[i];
+		printf("encoding<queue %d, %d frames %dx%d>: %f seconds, %llu KiB\n",
+			target->get_encoding_queue(), frames, width, height, time*1e-6, bytes/1024);
+
+		if (!success) {
+			synfig::error("encoding_queue_test: encoding failed with queue %d", target->get_encoding_queue());
+			++error;
+		}
+		// background encoding should write exactly the same frames
+		if (mode && target->checksums != checksums) {
+			synfig::error("encoding_queue_test: frames encoded in background differ");
+			++error;
+		}
+		checksums = target->checksums;
+	}
+	return error;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int benchmark_importer()
+{
+	int error = 0;
+	error += importer_cache_test(IMPORTER_CACHE_FRAMES);
+	error += encoding_queue_test(ENCODING_FRAMES, ENCODING_QUEUE);
+	return error;
+}
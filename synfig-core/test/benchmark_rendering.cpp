@@ -0,0 +1,636 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file benchmark_rendering.cpp
+**	\brief Benchmarks of scheduling and caching of rendering tasks
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include <glib.h>
+
+#include <ETL/stringf>
+
+#include <synfig/general.h>
+#include <synfig/real.h>
+#include <synfig/surface.h>
+#include <synfig/debug/trace.h>
+#include <synfig/rendering/rendercache.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/renderqueue.h>
+#include <synfig/rendering/common/task/taskblend.h>
+#include <synfig/rendering/common/task/taskblur.h>
+#include <synfig/rendering/common/task/taskdistort.h>
+#include <synfig/rendering/common/task/taskescapetime.h>
+#include <synfig/rendering/common/task/taskpixelprocessor.h>
+#include <synfig/rendering/software/surfaceswpool.h>
+
+#include "benchmark.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#define RENDER_QUEUE_JOBS      4096
+#define RENDER_QUEUE_JOB_SIZE  16
+
+#define RENDER_CACHE_FRAMES    24
+#define RENDER_CACHE_SIZE      512
+
+#define SURFACE_POOL_FRAMES    48
+#define SURFACE_POOL_SIZE      1024
+#define SURFACE_POOL_LAYERS    16
+
+#define DISTORT_SIZE           1024
+#define DISTORT_REPEATS        4
+
+#define ESCAPE_TIME_SIZE       512
+#define ESCAPE_TIME_ITERATIONS 256
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+static Task::Handle
+create_constant_task(const Color &color)
+{
+	TaskPixelColorMatrix::Handle task(new TaskPixelColorMatrix());
+	task->matrix.set_constant(color);
+	return task;
+}
+
+static void
+print_queue_stats(const String &name, long long time_us)
+{
+	RenderQueue::ThreadStatsList stats;
+	Renderer::get_queue()->get_stats(stats);
+
+	long long tasks = 0;
+	for(RenderQueue::ThreadStatsList::const_iterator i = stats.begin(); i != stats.end(); ++i)
+		tasks += i->tasks;
+
+	double seconds = 1e-6*(double)time_us;
+	printf("%s: %lld tasks, %f seconds, %.0f tasks/sec\n",
+		name.c_str(), tasks, seconds, seconds > 0.0 ? tasks/seconds : 0.0 );
+	for(int i = 0; i < (int)stats.size(); ++i)
+		printf("  thread %3d%s: tasks %7lld, steals %7lld, utilization %5.1f%%\n",
+			i, i ? "" : " (single)",
+			stats[i].tasks,
+			stats[i].steals,
+			time_us > 0 ? 100.0*stats[i].busy_us/time_us : 0.0 );
+}
+
+//! thousands of tiny independent blends, measures scheduling overhead
+static int
+render_queue_test(int jobs, int batches)
+{
+	Renderer::Handle renderer = Renderer::get_renderer("software");
+	if (!renderer || !Renderer::get_queue()) {
+		synfig::error("render_queue_test: software renderer is not initialized");
+		return 1;
+	}
+
+	std::vector<Task::List> lists(batches);
+	for(int i = 0; i < jobs; ++i) {
+		TaskBlend::Handle blend(new TaskBlend());
+		blend->blend_method = Color::BLEND_COMPOSITE;
+		blend->amount = 0.5;
+		blend->sub_task_a() = create_constant_task(Color(1.0, 0.0, 0.0, 1.0));
+		blend->sub_task_b() = create_constant_task(Color(0.0, 0.0, 1.0, 0.5));
+		blend->target_surface = new SurfaceResource();
+		blend->target_surface->create(RENDER_QUEUE_JOB_SIZE, RENDER_QUEUE_JOB_SIZE);
+		blend->target_rect = RectInt(0, 0, RENDER_QUEUE_JOB_SIZE, RENDER_QUEUE_JOB_SIZE);
+		blend->source_rect = Rect(0.0, 0.0, 1.0, 1.0);
+		lists[i % batches].push_back(blend);
+	}
+
+	Renderer::get_queue()->reset_stats();
+	long long time = g_get_monotonic_time();
+
+	// enqueue all batches at once, like studio does for tiles
+	std::vector<TaskEvent::Handle> events;
+	for(int i = 0; i < batches; ++i) {
+		events.push_back(new TaskEvent());
+		renderer->enqueue(lists[i], events.back(), true);
+	}
+	int errors = 0;
+	for(int i = 0; i < batches; ++i) {
+		events[i]->wait();
+		if (!events[i]->is_done()) ++errors;
+	}
+
+	time = g_get_monotonic_time() - time;
+
+	print_queue_stats(etl::strprintf("render_queue<%d jobs, %d batches>", jobs, batches), time);
+
+	if (errors)
+		synfig::error("render_queue_test: %d batches failed", errors);
+	return errors ? 1 : 0;
+}
+
+//! the same tiny blends with tracing, checks that each executed task is in the saved trace
+static int
+render_trace_test(int jobs)
+{
+	const String filename = "benchmark-trace.json";
+
+	debug::Trace::clear();
+	debug::Trace::set_enabled(true);
+	int error = render_queue_test(jobs, 64);
+	debug::Trace::set_enabled(false);
+
+	RenderQueue::ThreadStatsList stats;
+	Renderer::get_queue()->get_stats(stats);
+	long long tasks = 0;
+	for(RenderQueue::ThreadStatsList::const_iterator i = stats.begin(); i != stats.end(); ++i)
+		tasks += i->tasks;
+
+	const long long events = debug::Trace::count();
+	long long time = g_get_monotonic_time();
+	if (!debug::Trace::save(filename)) {
+		synfig::error("render_trace_test: cannot save trace");
+		return 1;
+	}
+	time = g_get_monotonic_time() - time;
+
+	// one event per line
+	long long task_events = 0, threads = 0;
+	std::ifstream stream(filename.c_str());
+	for(String line; std::getline(stream, line); ) {
+		if (line.find("\"cat\":\"task\"") != String::npos) ++task_events;
+		if (line.find("\"thread_name\"") != String::npos) ++threads;
+	}
+	stream.close();
+	std::remove(filename.c_str());
+
+	debug::Trace::clear();
+	printf("render_trace<%d jobs>: %lld events, %lld tasks, %lld named threads, saved in %f seconds\n",
+		jobs, events, task_events, threads, 1e-6*(double)time);
+
+	if (task_events != tasks) {
+		synfig::error("render_trace_test: %lld tasks are executed, but %lld are traced", tasks, task_events);
+		++error;
+	}
+	if (debug::Trace::count()) {
+		synfig::error("render_trace_test: trace is not empty after clear()");
+		++error;
+	}
+	return error;
+}
+
+//! static blurred background and a moving star at foreground
+static Task::Handle
+create_frame_task(int frame, int size)
+{
+	TaskBlur::Handle background(new TaskBlur());
+	background->blur.size = Vector(0.1, 0.1);
+	background->blur.type = Blur::GAUSSIAN;
+	background->sub_task() = benchmark_contour_task(Vector(), 0.9, Color(0.2, 0.6, 0.2, 1.0));
+
+	TaskBlend::Handle blend(new TaskBlend());
+	blend->blend_method = Color::BLEND_COMPOSITE;
+	blend->sub_task_a() = background;
+	blend->sub_task_b() = benchmark_contour_task(Vector(-0.5 + 0.04*frame, 0.0), 0.3, Color(0.8, 0.2, 0.2, 1.0));
+	blend->target_surface = new SurfaceResource();
+	blend->target_surface->create(size, size);
+	blend->target_rect = RectInt(0, 0, size, size);
+	blend->source_rect = Rect(-1.0, -1.0, 1.0, 1.0);
+	return blend;
+}
+
+//! stack of semi-transparent stars, each one is rendered into own intermediate surface
+static Task::Handle
+create_layers_task(int frame, int size, int layers)
+{
+	Task::Handle task;
+	for(int i = 0; i < layers; ++i) {
+		TaskBlend::Handle blend(new TaskBlend());
+		blend->blend_method = Color::BLEND_COMPOSITE;
+		blend->amount = 0.8;
+		blend->sub_task_a() = task;
+		blend->sub_task_b() = benchmark_contour_task(
+			Vector(-0.5 + 1.0*i/layers, -0.5 + 0.01*frame), 0.5,
+			Color((Real)i/layers, 0.5, 1.0 - (Real)i/layers, 1.0) );
+		task = blend;
+	}
+	task->target_surface = new SurfaceResource();
+	task->target_surface->create(size, size);
+	task->target_rect = RectInt(0, 0, size, size);
+	task->source_rect = Rect(-1.0, -1.0, 1.0, 1.0);
+	return task;
+}
+
+//! renders the same animation with and without RenderCache, results should be equal
+static int
+render_cache_test(int frames, int size)
+{
+	Renderer::Handle renderer = Renderer::get_renderer("software");
+	RenderCache *cache = Renderer::get_cache();
+	if (!renderer || !cache) {
+		synfig::error("render_cache_test: software renderer is not initialized");
+		return 1;
+	}
+
+	const size_t max_bytes = cache->get_max_bytes();
+	std::vector< std::vector<Color> > expected(frames);
+	long long times[2] = { 0, 0 };
+	int errors = 0;
+
+	for(int pass = 0; pass < 2; ++pass) {
+		cache->clear();
+		cache->set_max_bytes(pass ? std::max(max_bytes, (size_t)64*1024*1024) : 0);
+		cache->reset_stats();
+
+		long long time = g_get_monotonic_time();
+		for(int i = 0; i < frames; ++i) {
+			Task::Handle task = create_frame_task(i, size);
+			std::vector<Color> pixels;
+			if (!renderer->run(Task::List(1, task), true) || !benchmark_read_pixels(task->target_surface, pixels))
+				{ ++errors; continue; }
+			if (!pass) { expected[i].swap(pixels); continue; }
+
+			bool equal = pixels.size() == expected[i].size();
+			for(int j = 0; equal && j < (int)pixels.size(); ++j)
+				equal = benchmark_colors_equal(pixels[j], expected[i][j]);
+			if (!equal) {
+				synfig::error("render_cache_test: frame %d differs from the frame rendered without cache", i);
+				++errors;
+			}
+		}
+		times[pass] = g_get_monotonic_time() - time;
+	}
+
+	RenderCache::Stats stats = cache->get_stats();
+	printf("render_cache<%d frames, %dx%d>: without cache %f seconds, with cache %f seconds\n",
+		frames, size, size, 1e-6*times[0], 1e-6*times[1]);
+	printf("  hits %lld, misses %lld, stored %lld, evicted %lld, used %lu KiB\n",
+		stats.hits, stats.misses, stats.stores, stats.evictions, (unsigned long)(stats.bytes/1024));
+
+	// background should be rendered twice: requested first time and stored
+	if (stats.hits < frames - 2) {
+		synfig::error("render_cache_test: expected at least %d cache hits, got %lld", frames - 2, stats.hits);
+		++errors;
+	}
+
+	cache->clear();
+	cache->set_max_bytes(max_bytes);
+	cache->reset_stats();
+	return errors ? 1 : 0;
+}
+
+//! renders the same frames with and without SurfaceSWPool,
+//! all intermediate surfaces are recycled in the second pass
+static int
+surface_pool_test(int frames, int size)
+{
+	Renderer::Handle renderer = Renderer::get_renderer("software");
+	RenderCache *cache = Renderer::get_cache();
+	SurfaceSWPool &pool = SurfaceSWPool::instance();
+	if (!renderer || !cache) {
+		synfig::error("surface_pool_test: software renderer is not initialized");
+		return 1;
+	}
+
+	// cached results would hide the intermediate surfaces
+	const size_t cache_bytes = cache->get_max_bytes();
+	const size_t pool_bytes = pool.get_max_bytes();
+	cache->set_max_bytes(0);
+
+	std::vector< std::vector<Color> > expected(frames);
+	long long times[2] = { 0, 0 };
+	int errors = 0;
+
+	for(int pass = 0; pass < 2; ++pass) {
+		pool.set_max_bytes(0);
+		pool.clear();
+		pool.set_max_bytes(pass ? std::max(pool_bytes, (size_t)256*1024*1024) : 0);
+		pool.reset_stats();
+
+		long long time = g_get_monotonic_time();
+		for(int i = 0; i < frames; ++i) {
+			Task::Handle task = create_layers_task(i, size, SURFACE_POOL_LAYERS);
+			std::vector<Color> pixels;
+			if (!renderer->run(Task::List(1, task), true) || !benchmark_read_pixels(task->target_surface, pixels))
+				{ ++errors; continue; }
+			if (!pass) { expected[i].swap(pixels); continue; }
+
+			bool equal = pixels.size() == expected[i].size();
+			for(int j = 0; equal && j < (int)pixels.size(); ++j)
+				equal = benchmark_colors_equal(pixels[j], expected[i][j]);
+			if (!equal) {
+				synfig::error("surface_pool_test: frame %d differs from the frame rendered without pool", i);
+				++errors;
+			}
+		}
+		times[pass] = g_get_monotonic_time() - time;
+	}
+
+	SurfaceSWPool::Stats stats = pool.get_stats();
+	printf("surface_pool<%d frames, %dx%d>: without pool %f seconds, with pool %f seconds\n",
+		frames, size, size, 1e-6*times[0], 1e-6*times[1]);
+	printf("  allocated %lld, reused %lld, released %lld, dropped %lld, peak %lu KiB\n",
+		stats.allocations, stats.reuses, stats.releases, stats.drops, (unsigned long)(stats.peak_bytes/1024));
+
+	if (stats.reuses < stats.allocations) {
+		synfig::error("surface_pool_test: expected more reused buffers than allocated, got %lld and %lld",
+			stats.reuses, stats.allocations);
+		++errors;
+	}
+
+	pool.set_max_bytes(pool_bytes);
+	cache->set_max_bytes(cache_bytes);
+	return errors ? 1 : 0;
+}
+
+//! twirl around the origin, like Twirl layer of lyr_std module
+class BenchmarkTwirl: public Distortion
+{
+public:
+	Real radius;
+	Real rotations;
+
+	BenchmarkTwirl(Real radius, Real rotations): radius(radius), rotations(rotations) { }
+
+protected:
+	virtual bool map_vfunc(const Point &point, Point &source_point) const
+	{
+		const Real mag = point.mag();
+		if (mag >= radius)
+			{ source_point = point; return true; }
+		const Real a = 2.0*PI*rotations*(mag - radius)/radius;
+		const Real s = sin(a), c = cos(a);
+		source_point = Point(c*point[0] - s*point[1], s*point[0] + c*point[1]);
+		return true;
+	}
+};
+
+static Task::Handle
+create_distort_source()
+{
+	TaskBlend::Handle blend(new TaskBlend());
+	blend->blend_method = Color::BLEND_COMPOSITE;
+	blend->sub_task_a() = benchmark_contour_task(Vector(), 0.9, Color(0.2, 0.6, 0.2, 1.0));
+	blend->sub_task_b() = benchmark_contour_task(Vector(0.3, 0.0), 0.4, Color(0.8, 0.2, 0.2, 1.0));
+	return blend;
+}
+
+//! TaskDistort compared with sampling of the pre-rendered source pixel by pixel,
+//! like distortion layers did by Layer::get_color() of TaskLayer
+static int
+distort_test(int size, int repeats)
+{
+	Renderer::Handle renderer = Renderer::get_renderer("software");
+	if (!renderer) {
+		synfig::error("distort_test: software renderer is not initialized");
+		return 1;
+	}
+
+	const Distortion::Handle distortion(new BenchmarkTwirl(0.8, 1.0));
+	const Real upp = 2.0/size;
+	const int src_size = 2*size;
+
+	// per-pixel reference, source covers twice larger area than the result
+	std::vector<Color> expected(size*size);
+	long long time = g_get_monotonic_time();
+	for(int i = 0; i < repeats; ++i) {
+		Task::Handle source = create_distort_source();
+		source->target_surface = new SurfaceResource();
+		source->target_surface->create(src_size, src_size);
+		source->target_rect = RectInt(0, 0, src_size, src_size);
+		source->source_rect = Rect(-2.0, -2.0, 2.0, 2.0);
+		std::vector<Color> pixels;
+		if (!renderer->run(Task::List(1, source), true) || !benchmark_read_pixels(source->target_surface, pixels)) {
+			synfig::error("distort_test: cannot render source");
+			return 1;
+		}
+
+		synfig::Surface surface(src_size, src_size);
+		for(int y = 0; y < src_size; ++y)
+			for(int x = 0; x < src_size; ++x)
+				surface[y][x] = pixels[y*src_size + x];
+
+		for(int y = 0; y < size; ++y) {
+			for(int x = 0; x < size; ++x) {
+				Point s;
+				Color c = Color::alpha();
+				if (distortion->map(Point(-1.0 + upp*x, -1.0 + upp*y), s)) {
+					const Vector p((s[0] + 2.0)/upp, (s[1] + 2.0)/upp);
+					if (p[0] >= 0.0 && p[1] >= 0.0 && p[0] <= src_size - 1 && p[1] <= src_size - 1)
+						c = surface.linear_sample(p[0], p[1]);
+				}
+				expected[y*size + x] = c;
+			}
+		}
+	}
+	const double time_reference = 1e-6*(g_get_monotonic_time() - time);
+
+	std::vector<Color> pixels;
+	time = g_get_monotonic_time();
+	for(int i = 0; i < repeats; ++i) {
+		TaskDistort::Handle task(new TaskDistort());
+		task->distortion = distortion;
+		task->sub_task() = create_distort_source();
+		task->target_surface = new SurfaceResource();
+		task->target_surface->create(size, size);
+		task->target_rect = RectInt(0, 0, size, size);
+		task->source_rect = Rect(-1.0, -1.0, 1.0, 1.0);
+		if (!renderer->run(Task::List(1, task), true) || !benchmark_read_pixels(task->target_surface, pixels)) {
+			synfig::error("distort_test: cannot render distortion");
+			return 1;
+		}
+	}
+	const double time_task = 1e-6*(g_get_monotonic_time() - time);
+
+	Real max_error = 0.0, sum_error = 0.0;
+	for(int i = 0; i < size*size; ++i) {
+		const Color a = pixels[i].premult_alpha(), b = expected[i].premult_alpha();
+		const Real e = std::max(
+			std::max(std::fabs(a.get_r() - b.get_r()), std::fabs(a.get_g() - b.get_g())),
+			std::max(std::fabs(a.get_b() - b.get_b()), std::fabs(a.get_a() - b.get_a())) );
+		max_error = std::max(max_error, e);
+		sum_error += e;
+	}
+	const Real mean_error = sum_error/(size*size);
+
+	printf("distort<twirl, %dx%d>: per pixel %.1f ms, task %.1f ms, x%.2f, max error %g, mean error %g\n",
+		size, size, 1e3*time_reference/repeats, 1e3*time_task/repeats,
+		time_task > 0.0 ? time_reference/time_task : 0.0,
+		(double)max_error, (double)mean_error );
+
+	if (max_error > 1e-3) {
+		synfig::error("distort_test: result differs from per-pixel sampling");
+		return 1;
+	}
+	return 0;
+}
+
+//! colors by count of iterations, like Mandelbrot layer with solid gradients
+class BenchmarkEscapeTime: public EscapeTime
+{
+protected:
+	virtual Color shade_vfunc(const Point&, const Orbit &orbit, int iterations, const Source&) const
+	{
+		if (!orbit.escaped())
+			return Color(0.0, 0.0, 0.0, 1.0);
+		const ColorReal k = (ColorReal)orbit.escape/iterations;
+		return Color(k, 1 - k, orbit.mag > 16 ? 1 : 0, 1.0);
+	}
+	virtual bool uses_source_vfunc() const
+		{ return false; }
+};
+
+class BenchmarkEmptySource: public EscapeTime::Source
+{
+public:
+	virtual Color get_color(const Point&) const
+		{ return Color::alpha(); }
+};
+
+static bool
+same_real(Real a, Real b)
+	{ return a == b || (std::isnan(a) && std::isnan(b)); }
+
+//! EscapeTime::iterate_row() compared with iterations of points one by one,
+//! and TaskEscapeTime compared with per-pixel coloring, like Layer::get_color() of TaskLayer
+static int
+escape_time_test(EscapeTime::Formula formula, bool broken, int size, int iterations)
+{
+	Renderer::Handle renderer = Renderer::get_renderer("software");
+	if (!renderer) {
+		synfig::error("escape_time_test: software renderer is not initialized");
+		return 1;
+	}
+
+	etl::handle<BenchmarkEscapeTime> escape_time(new BenchmarkEscapeTime());
+	escape_time->formula = formula;
+	escape_time->seed = Point(-0.8, 0.156);
+	escape_time->broken = broken;
+	escape_time->iterations = iterations;
+
+	const Rect rect(-2.0, -1.5, 1.0, 1.5);
+	const Vector upp(rect.get_width()/size, rect.get_height()/size);
+	const Vector step(upp[0], 0.0);
+
+	std::vector<EscapeTime::Orbit> expected(size*size), rows(size*size);
+	long long time = g_get_monotonic_time();
+	for(int y = 0; y < size; ++y) {
+		const Point point(rect.minx + upp[0]*0.5, rect.miny + upp[1]*(y + 0.5));
+		for(int x = 0; x < size; ++x)
+			escape_time->iterate_row(point + step*x, Vector(), &expected[y*size + x], 1);
+	}
+	const double time_point = 1e-6*(g_get_monotonic_time() - time);
+
+	time = g_get_monotonic_time();
+	for(int y = 0; y < size; ++y) {
+		const Point point(rect.minx + upp[0]*0.5, rect.miny + upp[1]*(y + 0.5));
+		escape_time->iterate_row(point, step, &rows[y*size], size);
+	}
+	const double time_row = 1e-6*(g_get_monotonic_time() - time);
+
+	int mismatches = 0;
+	for(int i = 0; i < size*size; ++i)
+		if ( rows[i].escape != expected[i].escape
+		  || !same_real(rows[i].mag, expected[i].mag)
+		  || !same_real(rows[i].zr, expected[i].zr)
+		  || !same_real(rows[i].zi, expected[i].zi) )
+			++mismatches;
+
+	std::vector<Color> pixels;
+	time = g_get_monotonic_time();
+	TaskEscapeTime::Handle task(new TaskEscapeTime());
+	task->escape_time = escape_time;
+	task->target_surface = new SurfaceResource();
+	task->target_surface->create(size, size);
+	task->target_rect = RectInt(0, 0, size, size);
+	task->source_rect = rect;
+	if (!renderer->run(Task::List(1, task), true) || !benchmark_read_pixels(task->target_surface, pixels)) {
+		synfig::error("escape_time_test: cannot render task");
+		return 1;
+	}
+	const double time_task = 1e-6*(g_get_monotonic_time() - time);
+
+	// points of task are calculated by blocks, so a few of them may differ by rounding
+	const BenchmarkEmptySource source;
+	int different_pixels = 0;
+	for(int i = 0; i < size*size; ++i) {
+		const Color a = pixels[i];
+		const Color b = escape_time->shade(Point(), expected[i], iterations, source);
+		if ( std::fabs(a.get_r() - b.get_r()) > 1e-5
+		  || std::fabs(a.get_g() - b.get_g()) > 1e-5
+		  || std::fabs(a.get_b() - b.get_b()) > 1e-5 )
+			++different_pixels;
+	}
+
+	printf("escape_time<%s%s, %dx%d, %d iterations>: per point %.1f ms, rows %.1f ms, x%.2f, task %.1f ms, mismatches %d, different pixels %d\n",
+		formula == EscapeTime::JULIA ? "julia" : "mandelbrot",
+		broken ? ", broken" : "",
+		size, size, iterations,
+		1e3*time_point, 1e3*time_row,
+		time_row > 0.0 ? time_point/time_row : 0.0,
+		1e3*time_task,
+		mismatches, different_pixels );
+
+	if (mismatches) {
+		synfig::error("escape_time_test: rows differ from iterations of single points");
+		return 1;
+	}
+	if (different_pixels*1000 > size*size) {
+		synfig::error("escape_time_test: task differs from per-pixel coloring");
+		return 1;
+	}
+	return 0;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int benchmark_rendering()
+{
+	int error = 0;
+	error += render_queue_test(RENDER_QUEUE_JOBS, 1);
+	error += render_queue_test(RENDER_QUEUE_JOBS, 64);
+	error += render_trace_test(RENDER_QUEUE_JOBS);
+	error += render_cache_test(RENDER_CACHE_FRAMES, RENDER_CACHE_SIZE);
+	error += surface_pool_test(SURFACE_POOL_FRAMES, SURFACE_POOL_SIZE);
+	error += distort_test(DISTORT_SIZE, DISTORT_REPEATS);
+	error += escape_time_test(EscapeTime::MANDELBROT, false, ESCAPE_TIME_SIZE, ESCAPE_TIME_ITERATIONS);
+	error += escape_time_test(EscapeTime::MANDELBROT, true, ESCAPE_TIME_SIZE, ESCAPE_TIME_ITERATIONS);
+	error += escape_time_test(EscapeTime::JULIA, false, ESCAPE_TIME_SIZE, ESCAPE_TIME_ITERATIONS);
+	error += escape_time_test(EscapeTime::JULIA, true, ESCAPE_TIME_SIZE, ESCAPE_TIME_ITERATIONS);
+	return error;
+}
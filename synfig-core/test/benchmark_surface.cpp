@@ -0,0 +1,326 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file benchmark_surface.cpp
+**	\brief Benchmarks of pixel formats and of compact surfaces
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <glib.h>
+
+#include <synfig/general.h>
+#include <synfig/real.h>
+#include <synfig/color/color.h>
+#include <synfig/color/pixelformat.h>
+#include <synfig/rendering/software/surfacesw.h>
+#include <synfig/rendering/software/surfaceswrgba16f.h>
+#include <synfig/rendering/software/surfaceswrgba8.h>
+#include <synfig/rendering/software/function/packedsurface.h>
+
+#include "benchmark.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+#define SURFACE_FORMAT_REPEATS 4
+
+#define PIXEL_FORMAT_REPEATS   8
+
+#define PACKED_SURFACE_REPEATS 4
+#define PACKED_SURFACE_SAMPLES 4000000
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+//! speed of conversion of colors into 8-bit pixel formats of exported images and of Cairo surfaces,
+//! results of optimized conversion are compared with the reference one
+static int
+pixel_format_test(PixelFormat pf, const char *name, const Gamma *gamma, int width, int height, int repeats)
+{
+	std::vector<Color> pixels(width*height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			pixels[y*width + x] = Color(
+				(Real)x/width,
+				(Real)((x*7 + y*13)%1024)/1023,
+				(Real)(y%300)/256 - 0.1,
+				(Real)((x + y)%260)/255 );
+	// special values in the first row
+	pixels[0] = Color(-1, 2, 0, 0);
+	pixels[1] = Color(NAN, 0.5, NAN, NAN);
+	pixels[2] = Color(1, 1, 1, 1);
+	pixels[3] = Color(0.5, 0.25, 0.125, 1e-6);
+
+	const int size = pixel_size(pf);
+	std::vector<unsigned char> bytes(size*width*height), reference_bytes(bytes.size());
+
+	long long time = g_get_monotonic_time();
+	for(int i = 0; i < repeats; ++i)
+		color_to_pixelformat_reference(&reference_bytes.front(), &pixels.front(), pf, gamma, width, height);
+	double time_reference = 1e-6*(g_get_monotonic_time() - time);
+
+	time = g_get_monotonic_time();
+	for(int i = 0; i < repeats; ++i)
+		color_to_pixelformat(&bytes.front(), &pixels.front(), pf, gamma, width, height);
+	double time_encode = 1e-6*(g_get_monotonic_time() - time);
+
+	int max_error = 0, mismatches = 0;
+	for(size_t i = 0; i < bytes.size(); ++i)
+		if (bytes[i] != reference_bytes[i]) {
+			max_error = std::max(max_error, std::abs((int)bytes[i] - (int)reference_bytes[i]));
+			++mismatches;
+		}
+
+	std::vector<Color> colors(width*height), reference_colors(width*height);
+	time = g_get_monotonic_time();
+	for(int i = 0; i < repeats; ++i)
+		pixelformat_to_color_reference(&reference_colors.front(), &reference_bytes.front(), pf, width, height);
+	double time_decode_reference = 1e-6*(g_get_monotonic_time() - time);
+
+	time = g_get_monotonic_time();
+	for(int i = 0; i < repeats; ++i)
+		pixelformat_to_color(&colors.front(), &reference_bytes.front(), pf, width, height);
+	double time_decode = 1e-6*(g_get_monotonic_time() - time);
+
+	const bool decode_equal = !memcmp(&colors.front(), &reference_colors.front(), colors.size()*sizeof(Color));
+
+	const double mpixels = 1e-6*width*height*repeats;
+	printf("pixelformat<%s%s, %dx%d>: encode %.1f Mpixels/sec (reference %.1f), decode %.1f Mpixels/sec (reference %.1f), "
+		   "%d mismatched bytes (max error %d)\n",
+		name, gamma ? "+gamma" : "", width, height,
+		time_encode > 0.0 ? mpixels/time_encode : 0.0,
+		time_reference > 0.0 ? mpixels/time_reference : 0.0,
+		time_decode > 0.0 ? mpixels/time_decode : 0.0,
+		time_decode_reference > 0.0 ? mpixels/time_decode_reference : 0.0,
+		mismatches, max_error );
+
+	int error = 0;
+	if (mismatches > 0) {
+		synfig::error("pixel_format_test: %d bytes of %s differ from reference, max error %d", mismatches, name, max_error);
+		++error;
+	}
+	if (!decode_equal) {
+		synfig::error("pixel_format_test: decoded colors of %s differ from reference", name);
+		++error;
+	}
+	return error;
+}
+
+//! memory and conversion speed of compact surface formats of RenderCache entries,
+//! error is measured for premultiplied components
+static int
+surface_format_test(const rendering::Surface::Token::Handle &token, int width, int height, int repeats, Real max_error)
+{
+	std::vector<Color> pixels(width*height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			pixels[y*width + x] = Color(
+				(Real)x/width,
+				(Real)y/height,
+				(Real)((x*7 + y*13)%256)/255,
+				(Real)((x + y)%1024)/1023 );
+
+	SurfaceSW reference;
+	reference.assign(&pixels.front(), width, height);
+	rendering::Surface::Handle surface = token->fabric();
+	if (!surface) {
+		synfig::error("surface_format_test: cannot create surface %s", token->name.c_str());
+		return 1;
+	}
+
+	long long time = g_get_monotonic_time();
+	for(int i = 0; i < repeats; ++i)
+		surface->assign(&pixels.front(), width, height);
+	double time_encode = 1e-6*(g_get_monotonic_time() - time);
+
+	std::vector<Color> row(width);
+	Real error = 0.0;
+	time = g_get_monotonic_time();
+	for(int i = 0; i < repeats; ++i)
+		for(int y = 0; y < height; ++y)
+			if (!surface->get_pixels_row(0, y, width, &row.front())) {
+				synfig::error("surface_format_test: cannot read row %d of surface %s", y, token->name.c_str());
+				return 1;
+			}
+	double time_decode = 1e-6*(g_get_monotonic_time() - time);
+
+	for(int y = 0; y < height; ++y) {
+		surface->get_pixels_row(0, y, width, &row.front());
+		for(int x = 0; x < width; ++x) {
+			const Color a = pixels[y*width + x].premult_alpha(), b = row[x].premult_alpha();
+			error = std::max(error, (Real)std::fabs(a.get_r() - b.get_r()));
+			error = std::max(error, (Real)std::fabs(a.get_g() - b.get_g()));
+			error = std::max(error, (Real)std::fabs(a.get_b() - b.get_b()));
+			error = std::max(error, (Real)std::fabs(a.get_a() - b.get_a()));
+		}
+	}
+
+	const double mpixels = 1e-6*width*height*repeats;
+	printf("surface<%s, %dx%d>: %lu KiB (float %lu KiB), encode %.1f Mpixels/sec, decode %.1f Mpixels/sec, max error %g\n",
+		token->name.c_str(), width, height,
+		(unsigned long)(surface->get_memory_size()/1024),
+		(unsigned long)(reference.get_memory_size()/1024),
+		time_encode > 0.0 ? mpixels/time_encode : 0.0,
+		time_decode > 0.0 ? mpixels/time_decode : 0.0,
+		(double)error );
+
+	if (error > max_error) {
+		synfig::error("surface_format_test: error of surface %s is %g, expected not more than %g",
+			token->name.c_str(), (double)error, (double)max_error);
+		return 1;
+	}
+	return 0;
+}
+
+//! size, packing and unpacking speed of chunk codecs of imported bitmaps,
+//! sampling along rotated rows goes through the shared cache of unpacked chunks
+static int
+packed_surface_test(software::PackedSurface::Codec codec, const char *name, int width, int height, int repeats, int samples)
+{
+	typedef software::PackedSurface PackedSurface;
+
+	// flat areas and gradients of 8-bit image
+	std::vector<Color> pixels(width*height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			pixels[y*width + x] = Color(
+				(Real)(x*255/width)/255,
+				(Real)((y/64)%2 ? 255 : 0)/255,
+				(Real)((x/48 + y/48)%4*64)/255,
+				(Real)(x < width/2 ? 255 : (x*7 + y*13)%256)/255 );
+
+	PackedSurface reference;
+	PackedSurface::set_default_codec(PackedSurface::CodecNone);
+	reference.set_pixels(&pixels.front(), width, height);
+	std::vector<Color> expected(width*height);
+	reference.get_pixels(&expected.front());
+
+	PackedSurface::set_default_codec(codec);
+	PackedSurface surface;
+	long long time = g_get_monotonic_time();
+	for(int i = 0; i < repeats; ++i)
+		surface.set_pixels(&pixels.front(), width, height);
+	double time_pack = 1e-6*(g_get_monotonic_time() - time);
+	PackedSurface::set_default_codec(PackedSurface::CodecNone);
+
+	std::vector<Color> result(width*height);
+	time = g_get_monotonic_time();
+	for(int i = 0; i < repeats; ++i)
+		surface.get_pixels(&result.front());
+	double time_unpack = 1e-6*(g_get_monotonic_time() - time);
+
+	// each band of rotated rows has its own reader, as tasks of tiles do
+	PackedSurface::ChunkCache &cache = PackedSurface::ChunkCache::instance();
+	const size_t cache_bytes = cache.get_max_bytes();
+	const Real angle = 0.3, dx = std::cos(angle), dy = std::sin(angle);
+	const int band = 16*width;
+	int mismatches = 0;
+	double time_sample[2] = { };
+	PackedSurface::ChunkCache::Stats stats;
+	for(int pass = 0; pass < 2; ++pass) {
+		cache.set_max_bytes(pass ? cache_bytes : 0);
+		cache.reset_stats();
+		time = g_get_monotonic_time();
+		for(int i = 0; i < samples; i += band) {
+			PackedSurface::Reader reader(surface);
+			for(int j = i; j < std::min(samples, i + band); ++j) {
+				const int row = j/width, col = j%width;
+				int x = (int)std::floor(col*dx - row*dy + width/2) % width;
+				int y = (int)std::floor(col*dy + row*dx) % height;
+				if (x < 0) x += width;
+				if (y < 0) y += height;
+				if (reader.get_pixel(x, y) != expected[y*width + x])
+					++mismatches;
+			}
+		}
+		time_sample[pass] = 1e-6*(g_get_monotonic_time() - time);
+		stats = cache.get_stats();
+	}
+
+	for(int i = 0; i < width*height; ++i)
+		if (result[i] != expected[i])
+			++mismatches;
+
+	const double mpixels = 1e-6*width*height*repeats;
+	printf("packed<%s, %dx%d>: %lu KiB (raw %lu KiB), pack %.1f Mpixels/sec, unpack %.1f Mpixels/sec, "
+		   "sample %.1f Msamples/sec (%.1f without chunk cache), chunk cache hits %lld, misses %lld\n",
+		name, width, height,
+		(unsigned long)(surface.get_data_size()/1024),
+		(unsigned long)(reference.get_data_size()/1024),
+		time_pack > 0.0 ? mpixels/time_pack : 0.0,
+		time_unpack > 0.0 ? mpixels/time_unpack : 0.0,
+		time_sample[1] > 0.0 ? 1e-6*samples/time_sample[1] : 0.0,
+		time_sample[0] > 0.0 ? 1e-6*samples/time_sample[0] : 0.0,
+		stats.hits, stats.misses );
+
+	if (mismatches) {
+		synfig::error("packed_surface_test: %d pixels of codec %s differ from unpacked surface", mismatches, name);
+		return 1;
+	}
+	return 0;
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int benchmark_surface()
+{
+	int error = 0;
+	error += surface_format_test(SurfaceSWRGBA16F::token.handle(), 3840, 2160, SURFACE_FORMAT_REPEATS, 1e-3);
+	error += surface_format_test(SurfaceSWRGBA8::token.handle(), 3840, 2160, SURFACE_FORMAT_REPEATS, 1.0/255.0);
+
+	const Gamma pixel_format_gamma(1/2.2);
+	error += pixel_format_test(PF_RGB, "rgb", NULL, 1920, 1080, PIXEL_FORMAT_REPEATS);
+	error += pixel_format_test(PF_BGR, "bgr", NULL, 1920, 1080, PIXEL_FORMAT_REPEATS);
+	error += pixel_format_test(PF_RGB|PF_A, "rgba", NULL, 1920, 1080, PIXEL_FORMAT_REPEATS);
+	error += pixel_format_test(PF_BGR|PF_A, "bgra", NULL, 1920, 1080, PIXEL_FORMAT_REPEATS);
+	error += pixel_format_test(PF_A_START|PF_RGB, "argb", NULL, 1920, 1080, PIXEL_FORMAT_REPEATS);
+	error += pixel_format_test(PF_BGR|PF_A|PF_A_PREMULT, "cairo-le", NULL, 1920, 1080, PIXEL_FORMAT_REPEATS);
+	error += pixel_format_test(PF_A_START|PF_RGB|PF_A_PREMULT, "cairo-be", NULL, 1920, 1080, PIXEL_FORMAT_REPEATS);
+	error += pixel_format_test(PF_A_START|PF_BGR|PF_A_PREMULT, "abgr-premult", NULL, 1920, 1080, PIXEL_FORMAT_REPEATS);
+	error += pixel_format_test(PF_GRAY|PF_A, "gray", NULL, 1920, 1080, PIXEL_FORMAT_REPEATS);
+	error += pixel_format_test(PF_RGB, "rgb", &pixel_format_gamma, 1920, 1080, PIXEL_FORMAT_REPEATS);
+	error += pixel_format_test(PF_BGR|PF_A|PF_A_PREMULT, "cairo-le", &pixel_format_gamma, 1920, 1080, PIXEL_FORMAT_REPEATS);
+
+	error += packed_surface_test(software::PackedSurface::CodecZlib, "zlib", 3840, 2160, PACKED_SURFACE_REPEATS, PACKED_SURFACE_SAMPLES);
+	error += packed_surface_test(software::PackedSurface::CodecLZ, "lz", 3840, 2160, PACKED_SURFACE_REPEATS, PACKED_SURFACE_SAMPLES);
+	return error;
+}
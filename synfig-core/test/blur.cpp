@@ -0,0 +1,187 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file blur.cpp
+**	\brief Test software blur and FFT
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <synfig/surface.h>
+#include <synfig/threadpool.h>
+#include <synfig/token.h>
+#include <synfig/type.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/software/function/blur.h>
+#include <synfig/rendering/software/function/fft.h>
+
+#include "test_base.h"
+
+using namespace synfig;
+using namespace rendering;
+
+static const int width = 131;
+static const int height = 97;
+
+static synfig::Surface
+generate_surface()
+{
+	synfig::Surface surface(width, height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			surface[y][x] = ((x/16 + y/16)%3)
+			              ? Color((Real)x/width, (Real)y/height, 0.5, (x*y)%7 ? 1.0 : 0.0)
+			              : Color::alpha();
+	return surface;
+}
+
+static software::Blur::Params
+blur_params(synfig::Surface &dest, const synfig::Surface &src, rendering::Blur::Type type, Real size)
+{
+	return software::Blur::Params(
+		dest, RectInt(0, 0, dest.get_w(), dest.get_h()),
+		src, VectorInt(0, 0),
+		type, Vector(size, size),
+		false, Color::BLEND_COMPOSITE, 1.0 );
+}
+
+static bool
+colors_equal(const Color &straight_a, const Color &straight_b)
+{
+	const Color a = straight_a.premult_alpha(), b = straight_b.premult_alpha();
+	return std::fabs(a.get_r() - b.get_r()) <= 1e-5f
+	    && std::fabs(a.get_g() - b.get_g()) <= 1e-5f
+	    && std::fabs(a.get_b() - b.get_b()) <= 1e-5f
+	    && std::fabs(a.get_a() - b.get_a()) <= 1e-5f;
+}
+
+//! result of each algorithm should not depend on count of threads
+static void
+check_blur(rendering::Blur::Type type, Real size)
+{
+	const synfig::Surface src = generate_surface();
+	synfig::Surface probe(width, height);
+	software::Blur::Params params = blur_params(probe, src, type, size);
+	ASSERT(params.validate());
+
+	const int max_threads = software::Blur::get_max_threads();
+	for(int i = software::Blur::ALGORITHM_BOX; i <= software::Blur::ALGORITHM_FFT; ++i) {
+		const software::Blur::Algorithm algorithm = (software::Blur::Algorithm)i;
+		if (software::Blur::estimate_cost(algorithm, params) < 0.0)
+			continue;
+
+		synfig::Surface serial(width, height), parallel(width, height);
+		software::Blur::set_max_threads(1);
+		software::Blur::blur(blur_params(serial, src, type, size), algorithm);
+		software::Blur::set_max_threads(0);
+		software::Blur::blur(blur_params(parallel, src, type, size), algorithm);
+		software::Blur::set_max_threads(max_threads);
+
+		for(int y = 0; y < height; ++y)
+			for(int x = 0; x < width; ++x)
+				ASSERT(colors_equal(serial[y][x], parallel[y][x]));
+	}
+}
+
+void test_blur_does_not_depend_on_threads() {
+	check_blur(rendering::Blur::BOX, 8);
+	check_blur(rendering::Blur::CROSS, 8);
+	check_blur(rendering::Blur::FASTGAUSSIAN, 8);
+	check_blur(rendering::Blur::GAUSSIAN, 2);
+	check_blur(rendering::Blur::GAUSSIAN, 8);
+	check_blur(rendering::Blur::DISC, 8);
+}
+
+void test_chosen_blur_algorithm_is_the_cheapest() {
+	const synfig::Surface src = generate_surface();
+	synfig::Surface dest(width, height);
+	const rendering::Blur::Type types[] = { rendering::Blur::BOX, rendering::Blur::GAUSSIAN, rendering::Blur::DISC };
+	for(int t = 0; t < (int)(sizeof(types)/sizeof(*types)); ++t) {
+		software::Blur::Params params = blur_params(dest, src, types[t], 8);
+		ASSERT(params.validate());
+		const software::Blur::Algorithm chosen = software::Blur::choose_algorithm(params);
+		const Real cost = software::Blur::estimate_cost(chosen, params);
+		ASSERT(cost >= 0.0);
+		for(int i = software::Blur::ALGORITHM_BOX; i <= software::Blur::ALGORITHM_FFT; ++i) {
+			const Real c = software::Blur::estimate_cost((software::Blur::Algorithm)i, params);
+			ASSERT(c < 0.0 || cost <= c);
+		}
+	}
+}
+
+//! inverse transform should restore the data
+static void
+check_fft(software::FFT::Planning planning)
+{
+	const int w = software::FFT::get_valid_count(width);
+	const int h = software::FFT::get_valid_count(height);
+	std::vector<Complex> data(w*h), source(w*h);
+	for(int i = 0; i < (int)source.size(); ++i)
+		source[i] = Complex((i*7 + i/w*13)%256/255.0, (i%11)/10.0);
+	data = source;
+
+	software::Array<Complex, 2> arr(&data.front());
+	arr.set_dim(h, w).set_dim(w, 1);
+
+	const software::FFT::Planning prev_planning = software::FFT::get_planning();
+	software::FFT::set_planning(planning);
+	const software::FFT::Stats stats = software::FFT::get_stats();
+	for(int i = 0; i < 2; ++i) {
+		software::FFT::fft2d(arr, false);
+		software::FFT::fft2d(arr, true);
+	}
+	const software::FFT::Stats new_stats = software::FFT::get_stats();
+	software::FFT::set_planning(prev_planning);
+
+	Real error = 0.0;
+	for(int i = 0; i < (int)source.size(); ++i)
+		error = std::max(error, (Real)std::abs(data[i] - source[i]));
+	ASSERT(error <= 1e-9);
+
+	// the second pair of transforms uses the plans of the first one
+	ASSERT(new_stats.reuses > stats.reuses);
+}
+
+void test_fft_restores_data() {
+	check_fft(software::FFT::PLANNING_ESTIMATE);
+	check_fft(software::FFT::PLANNING_MEASURE);
+}
+
+int main() {
+	Type::subsys_init();
+	ThreadPool::subsys_init();
+	Renderer::subsys_init();
+	Token::rebuild();
+
+	TEST_SUITE_BEGIN()
+		TEST_FUNCTION(test_blur_does_not_depend_on_threads);
+		TEST_FUNCTION(test_chosen_blur_algorithm_is_the_cheapest);
+		TEST_FUNCTION(test_fft_restores_data);
+	TEST_SUITE_END()
+
+	Renderer::subsys_stop();
+	ThreadPool::subsys_stop();
+	Type::subsys_stop();
+
+	return tst_exit_status;
+}
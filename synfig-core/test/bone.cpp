@@ -33,7 +33,18 @@
 #endif
 
 #include <iostream>
+#include <vector>
+
+#include <ETL/stringf>
+
 #include <synfig/bone.h>
+#include <synfig/canvas.h>
+#include <synfig/general.h>
+#include <synfig/type.h>
+#include <synfig/waypoint.h>
+#include <synfig/valuenodes/valuenode_animated.h>
+#include <synfig/valuenodes/valuenode_bone.h>
+#include <synfig/valuenodes/valuenode_const.h>
 
 #endif
 
@@ -57,14 +68,190 @@ int bone_test2()
 	return 0;
 }
 
+//! chain of bones with animated angles, each one is the parent of the next
+static void
+create_bone_chain(int depth, int frames, std::vector<ValueNode_Bone::Handle> &bones, std::vector<ValueNode_Animated::Handle> &angles)
+{
+	const Real fps = 24.0;
+	for(int i = 0; i < depth; ++i) {
+		Bone bone;
+		bone.set_name(etl::strprintf("bone %d", i));
+		bone.set_origin(Point(i ? 1.0 : 0.0, 0.0));
+		bone.set_parent(i ? bones.back().get() : NULL);
+		ValueNode_Bone::Handle node(ValueNode_Bone::create(bone));
+
+		ValueNode_Animated::Handle angle = ValueNode_Animated::create(type_angle);
+		for(int j = 0; j < 2; ++j) {
+			Waypoint waypoint(ValueBase(Angle::deg(j ? 5.0 + i%7 : -3.0)), Time(j*frames/fps));
+			waypoint.set_parent_value_node(angle.get());
+			angle->editable_waypoint_list().push_back(waypoint);
+		}
+		angle->changed();
+		node->set_link("angle", angle);
+
+		bones.push_back(node);
+		angles.push_back(angle);
+	}
+}
+
+static std::vector<Matrix>
+evaluate_bones(const std::vector<ValueNode_Bone::Handle> &bones, int frames)
+{
+	const Real fps = 24.0;
+	std::vector<Matrix> matrices;
+	for(int f = 0; f < frames; ++f)
+		for(int i = (int)bones.size() - 1; i >= 0; --i)
+			matrices.push_back((*bones[i])(Time(f/fps)).get(Bone()).get_animated_matrix());
+	return matrices;
+}
+
+static std::vector<Matrix>
+evaluate_bone_chain(const std::vector<ValueNode_Bone::Handle> &bones, int frames, bool cached)
+{
+	ValueNode_Bone::set_pose_cache_enabled(cached);
+	return evaluate_bones(bones, frames);
+}
+
+//! poses from the cache of ValueNode_Bone should be the same as evaluated by the chain,
+//! also when a bone is changed after the cache is filled
+int bone_pose_cache_test()
+{
+	const int depth = 8, frames = 6;
+	const bool enabled = ValueNode_Bone::is_pose_cache_enabled();
+	std::vector<ValueNode_Bone::Handle> bones;
+	std::vector<ValueNode_Animated::Handle> angles;
+	create_bone_chain(depth, frames, bones, angles);
+
+	int failures = 0;
+	for(int pass = 0; pass < 2; ++pass) {
+		if (pass) {
+			angles.front()->editable_waypoint_list().front().set_value(ValueBase(Angle::deg(-10.0)));
+			angles.front()->changed();
+		}
+		const std::vector<Matrix> cached = evaluate_bone_chain(bones, frames, true);
+		const std::vector<Matrix> expected = evaluate_bone_chain(bones, frames, false);
+		for(int i = 0; i < (int)expected.size(); ++i)
+			if (cached[i] != expected[i]) {
+				synfig::error("bone_pose_cache_test: cached pose differs from evaluation of chain, pass %d, bone %d", pass, depth - 1 - i%depth);
+				++failures;
+				break;
+			}
+	}
+
+	ValueNode_Bone::set_pose_cache_enabled(enabled);
+	return failures;
+}
+
+//! change of a bone drops cached poses of its own document only,
+//! poses of both documents should stay the same as evaluated by the chain
+int bone_pose_cache_two_canvases_test()
+{
+	const int depth = 4, frames = 3;
+	const bool enabled = ValueNode_Bone::is_pose_cache_enabled();
+	Canvas::Handle canvas_a = Canvas::create(), canvas_b = Canvas::create();
+	std::vector<ValueNode_Bone::Handle> bones_a, bones_b;
+	std::vector<ValueNode_Animated::Handle> angles_a, angles_b;
+	create_bone_chain(depth, frames, bones_a, angles_a);
+	create_bone_chain(depth, frames, bones_b, angles_b);
+	for(int i = 0; i < depth; ++i) {
+		bones_a[i]->set_root_canvas(canvas_a);
+		bones_b[i]->set_root_canvas(canvas_b);
+	}
+
+	ValueNode_Bone::set_pose_cache_enabled(true);
+	evaluate_bones(bones_a, frames);
+	evaluate_bones(bones_b, frames);
+	angles_a.front()->editable_waypoint_list().front().set_value(ValueBase(Angle::deg(-10.0)));
+	angles_a.front()->changed();
+	const std::vector<Matrix> cached_a = evaluate_bones(bones_a, frames);
+	const std::vector<Matrix> cached_b = evaluate_bones(bones_b, frames);
+
+	int failures = 0;
+	if (cached_a != evaluate_bone_chain(bones_a, frames, false)) {
+		synfig::error("bone_pose_cache_two_canvases_test: pose of changed document is outdated");
+		++failures;
+	}
+	if (cached_b != evaluate_bone_chain(bones_b, frames, false)) {
+		synfig::error("bone_pose_cache_two_canvases_test: pose of other document differs from evaluation of chain");
+		++failures;
+	}
+
+	ValueNode_Bone::set_pose_cache_enabled(enabled);
+	return failures;
+}
+
+//! scale of bone, which changes angle of the same bone when it is evaluated the first time,
+//! like an edit made by another thread while the pose is evaluated
+class InterleavedScale: public ValueNode
+{
+public:
+	ValueNode_Const::Handle angle;
+	mutable bool angle_changed;
+
+	InterleavedScale(): ValueNode(type_real), angle_changed() { }
+
+	virtual ValueBase operator()(Time /* t */)const
+	{
+		if (!angle_changed) {
+			angle_changed = true;
+			angle->set_value(ValueBase(Angle::deg(90.0)));
+		}
+		return ValueBase(Real(1.0));
+	}
+
+	virtual String get_name()const { return "interleaved_scale"; }
+	virtual String get_local_name()const { return get_name(); }
+	virtual ValueNode::Handle clone(etl::loose_handle<Canvas> /* canvas */, const GUID& /* deriv_guid */)const
+		{ return ValueNode::Handle(); }
+
+protected:
+	virtual void get_times_vfunc(Node::time_set & /* set */)const { }
+};
+
+//! pose evaluated while the bone is changed should not stay in the cache
+int bone_pose_cache_interleaved_change_test()
+{
+	const bool enabled = ValueNode_Bone::is_pose_cache_enabled();
+	ValueNode_Bone::set_pose_cache_enabled(true);
+
+	Bone bone;
+	bone.set_name("interleaved");
+	ValueNode_Bone::Handle node(ValueNode_Bone::create(bone));
+	ValueNode_Const::Handle angle(ValueNode_Const::Handle::cast_dynamic(ValueNode_Const::create(Angle::deg(0.0))));
+	etl::handle<InterleavedScale> scale(new InterleavedScale());
+	scale->angle = angle;
+	node->set_link("angle", angle);
+	node->set_link("scalex", scale);
+
+	// the first evaluation reads the old angle, and the angle is changed meanwhile
+	(*node)(Time()).get(Bone());
+	const Matrix cached = (*node)(Time()).get(Bone()).get_animated_matrix();
+	ValueNode_Bone::set_pose_cache_enabled(false);
+	const Matrix expected = (*node)(Time()).get(Bone()).get_animated_matrix();
+	ValueNode_Bone::set_pose_cache_enabled(enabled);
+
+	if (!scale->angle_changed || cached != expected) {
+		synfig::error("bone_pose_cache_interleaved_change_test: pose evaluated before the change is still cached");
+		return 1;
+	}
+	return 0;
+}
+
 /* === E N T R Y P O I N T ================================================= */
 
 int main()
 {
 	int failures = 0;
 
+	Type::subsys_init();
+
 	failures += bone_test1();
 	failures += bone_test2();
+	failures += bone_pose_cache_test();
+	failures += bone_pose_cache_interleaved_change_test();
+	failures += bone_pose_cache_two_canvases_test();
+
+	Type::subsys_stop();
 
 	return failures;
 }
@@ -0,0 +1,158 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file color.cpp
+**	\brief Test Color blending
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <synfig/color/color.h>
+
+#include "test_base.h"
+
+using namespace synfig;
+
+std::ostream& operator<<(std::ostream& os, const Color& c)
+{
+	os << '(' << c.get_r() << ',' << c.get_g() << ',' << c.get_b() << ',' << c.get_a() << ')';
+	return os;
+}
+
+// odd count to check the tail of vectorized loops
+static const int span_size = 37;
+
+static bool
+approximate_equal_relative(float x, float y)
+{
+	float scale = std::max(1.f, std::max(std::fabs(x), std::fabs(y)));
+	return std::fabs(x - y) <= 1e-5f*scale;
+}
+
+static bool
+colors_approximate_equal(const Color &a, const Color &b)
+{
+	return approximate_equal_relative(a.get_r(), b.get_r())
+		&& approximate_equal_relative(a.get_g(), b.get_g())
+		&& approximate_equal_relative(a.get_b(), b.get_b())
+		&& approximate_equal_relative(a.get_a(), b.get_a());
+}
+
+static std::vector<Color>
+generate_colors(unsigned int seed)
+{
+	std::vector<Color> colors(span_size);
+	srand(seed);
+	for(int i = 0; i < span_size; ++i) {
+		float r = rand()/(float)RAND_MAX;
+		float g = rand()/(float)RAND_MAX;
+		float b = rand()/(float)RAND_MAX;
+		float a = rand()/(float)RAND_MAX;
+		// edge cases: fully transparent and fully opaque pixels
+		if (i % 5 == 1) a = 0.f;
+		if (i % 5 == 2) a = 1.f;
+		colors[i] = Color(r, g, b, a);
+	}
+	return colors;
+}
+
+static void
+check_blend_span(Color::BlendMethod method, float amount)
+{
+	const std::vector<Color> src = generate_colors(1 + method);
+	const std::vector<Color> dest = generate_colors(100 + method);
+
+	std::vector<Color> result = dest;
+	Color::blend_span(&result.front(), &src.front(), span_size, amount, method);
+
+	for(int i = 0; i < span_size; ++i) {
+		Color expected = Color::blend(src[i], dest[i], amount, method);
+		if (!colors_approximate_equal(expected, result[i])) {
+			std::ostringstream oss;
+			oss.precision(8);
+			oss << "\t - method " << (int)method << ", amount " << amount << ", pixel " << i
+			    << ": expected " << expected << ", but got " << result[i] << std::endl;
+			throw SynfigTestException{__FUNCTION__, __LINE__, oss.str()};
+		}
+	}
+}
+
+void test_blend_span_matches_blend_for_all_methods() {
+	const float amounts[] = { 1.f, 0.5f, 0.25f, -0.5f };
+	for(int method = 0; method < Color::BLEND_END; ++method)
+		for(int i = 0; i < (int)(sizeof(amounts)/sizeof(amounts[0])); ++i)
+			check_blend_span((Color::BlendMethod)method, amounts[i]);
+}
+
+void test_blend_span_with_zero_amount_keeps_dest() {
+	const std::vector<Color> src = generate_colors(1);
+	const std::vector<Color> dest = generate_colors(2);
+
+	std::vector<Color> result = dest;
+	Color::blend_span(&result.front(), &src.front(), span_size, 0.f, Color::BLEND_COMPOSITE);
+	for(int i = 0; i < span_size; ++i)
+		ASSERT(result[i] == dest[i]);
+}
+
+void test_blend_span_with_short_spans() {
+	const std::vector<Color> src = generate_colors(3);
+	const std::vector<Color> dest = generate_colors(4);
+
+	for(int count = 0; count < 4; ++count) {
+		std::vector<Color> result = dest;
+		Color::blend_span(&result.front(), &src.front(), count, 1.f, Color::BLEND_COMPOSITE);
+		for(int i = 0; i < span_size; ++i) {
+			Color expected = i < count ? Color::blend(src[i], dest[i], 1.f, Color::BLEND_COMPOSITE) : dest[i];
+			ASSERT(colors_approximate_equal(expected, result[i]));
+		}
+	}
+}
+
+void test_blend_coverage_span_matches_blend_for_all_methods() {
+	const std::vector<Color> dest = generate_colors(5);
+	const Color src(0.9f, 0.4f, 0.2f, 0.7f);
+	std::vector<float> coverage(span_size);
+	for(int i = 0; i < span_size; ++i)
+		coverage[i] = i % 4 ? i/(float)span_size : 0.f;
+
+	for(int method = 0; method < Color::BLEND_END; ++method) {
+		std::vector<Color> result = dest;
+		Color::blend_coverage_span(&result.front(), src, &coverage.front(), span_size, 0.5f, (Color::BlendMethod)method);
+		for(int i = 0; i < span_size; ++i) {
+			Color expected = Color::blend(src, dest[i], 0.5f*coverage[i], (Color::BlendMethod)method);
+			ASSERT(colors_approximate_equal(expected, result[i]));
+		}
+	}
+}
+
+int main() {
+
+	TEST_SUITE_BEGIN()
+		TEST_FUNCTION(test_blend_span_matches_blend_for_all_methods);
+		TEST_FUNCTION(test_blend_span_with_zero_amount_keeps_dest);
+		TEST_FUNCTION(test_blend_span_with_short_spans);
+		TEST_FUNCTION(test_blend_coverage_span_matches_blend_for_all_methods);
+	TEST_SUITE_END()
+
+	return tst_exit_status;
+}
@@ -0,0 +1,189 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file contour.cpp
+**	\brief Test rasterization of contours
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <synfig/matrix.h>
+#include <synfig/real.h>
+#include <synfig/surface.h>
+#include <synfig/rendering/primitive/contour.h>
+#include <synfig/rendering/primitive/polyspan.h>
+#include <synfig/rendering/software/function/contour.h>
+
+#include "test_base.h"
+
+using namespace synfig;
+using namespace rendering;
+
+static const int width = 160;
+static const int height = 90;
+
+//! star with thin spikes over the whole frame, a lot of edge crossings per row
+static Contour::Handle
+create_star(int points)
+{
+	Contour::Handle contour(new Contour());
+	for(int i = 0; i < points; ++i) {
+		Real angle = 2.0*PI*i/points;
+		Real r = i % 2 ? 0.05 : 1.0;
+		Vector p(r*cos(angle), r*sin(angle));
+		if (i) contour->line_to(p); else contour->move_to(p);
+	}
+	contour->close();
+	return contour;
+}
+
+//! self-intersecting pseudo-random polyline, a lot of crossings in every cell
+static Contour::Handle
+create_scribble(int points)
+{
+	Contour::Handle contour(new Contour());
+	contour->winding_style = Contour::WINDING_EVEN_ODD;
+	unsigned int seed = 12345;
+	for(int i = 0; i < points; ++i) {
+		seed = seed*1103515245u + 12345u;
+		Real x = (seed >> 8 & 0xffff)/32768.0 - 1.0;
+		seed = seed*1103515245u + 12345u;
+		Real y = (seed >> 8 & 0xffff)/32768.0 - 1.0;
+		if (i) contour->line_to(Vector(x, y)); else contour->move_to(Vector(x, y));
+	}
+	contour->close();
+	return contour;
+}
+
+//! closed spline through 6 vertices, like Region layer
+static Contour::Handle
+create_region()
+{
+	const int count = 6;
+	std::vector<Vector> points(count);
+	for(int i = 0; i < count; ++i) {
+		Real angle = 2.0*PI*i/count, r = i % 2 ? 0.6 : 0.9;
+		points[i] = Vector(r*cos(angle), r*sin(angle));
+	}
+
+	Contour::Handle contour(new Contour());
+	contour->move_to(points[0]);
+	for(int i = 0; i < count; ++i) {
+		const Vector &p0 = points[i], &p1 = points[(i + 1) % count];
+		Vector t0 = (p1 - points[(i + count - 1) % count])*0.5;
+		Vector t1 = (points[(i + 2) % count] - p0)*0.5;
+		contour->cubic_to(p1, p0 + t0/3.0, p1 - t1/3.0);
+	}
+	contour->close();
+	return contour;
+}
+
+//! 8 conic segments, as in Circle::sync_vfunc()
+static Contour::Handle
+create_circle()
+{
+	const Real radius = 0.8, k = 1.0/cos(PI/8.0);
+	Contour::Handle contour(new Contour());
+	contour->move_to(Vector(radius, 0.0));
+	for(int i = 0; i < 8; ++i) {
+		Real a0 = PI*(2*i + 1)/8.0, a1 = PI*(2*i + 2)/8.0;
+		contour->conic_to(
+			Vector(radius*cos(a1), radius*sin(a1)),
+			Vector(k*radius*cos(a0), k*radius*sin(a0)) );
+	}
+	contour->close();
+	return contour;
+}
+
+//! unit square fits into frame
+static void
+render(synfig::Surface &surface, const Contour::Handle &contour, Polyspan::Accumulator accumulator, bool invert, Color::value_type opacity)
+{
+	Matrix matrix;
+	matrix.m00 = matrix.m11 = 0.5*std::min(width, height);
+	matrix.m20 = 0.5*width;
+	matrix.m21 = 0.5*height;
+
+	surface.set_wh(width, height);
+	surface.clear();
+	Polyspan polyspan;
+	polyspan.set_accumulator(accumulator);
+	polyspan.init(0, 0, width, height);
+	software::Contour::build_polyspan(contour->get_chunks(), matrix, polyspan);
+	polyspan.close();
+	polyspan.sort_marks();
+	software::Contour::render_polyspan(
+		surface, polyspan, invert, true, contour->winding_style,
+		Color::white(), opacity, Color::BLEND_COMPOSITE );
+}
+
+//! accumulators differ only by order of summation
+static void
+check_accumulators(const Contour::Handle &contour)
+{
+	synfig::Surface sorted, buckets;
+	render(sorted, contour, Polyspan::ACCUMULATOR_SORT, false, 1.f);
+	render(buckets, contour, Polyspan::ACCUMULATOR_BUCKETS, false, 1.f);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			ASSERT(std::fabs(sorted[y][x].get_a() - buckets[y][x].get_a()) <= 1e-4f);
+}
+
+//! inverted shape should complement the normal one
+static void
+check_inverted(const Contour::Handle &contour)
+{
+	for(int pass = 0; pass < 2; ++pass) {
+		const Color::value_type opacity = pass ? 0.5f : 1.f;
+		synfig::Surface normal, inverted;
+		render(normal, contour, Polyspan::ACCUMULATOR_BUCKETS, false, opacity);
+		render(inverted, contour, Polyspan::ACCUMULATOR_BUCKETS, true, opacity);
+		for(int y = 0; y < height; ++y)
+			for(int x = 0; x < width; ++x)
+				ASSERT(std::fabs(normal[y][x].get_a() + inverted[y][x].get_a() - opacity) <= 1e-4f);
+	}
+}
+
+void test_accumulators_give_the_same_coverage() {
+	check_accumulators(create_star(400));
+	check_accumulators(create_scribble(400));
+	check_accumulators(create_region());
+	check_accumulators(create_circle());
+}
+
+void test_inverted_contour_complements_normal_one() {
+	check_inverted(create_star(10));
+	check_inverted(create_scribble(40));
+	check_inverted(create_region());
+	check_inverted(create_circle());
+}
+
+int main() {
+
+	TEST_SUITE_BEGIN()
+		TEST_FUNCTION(test_accumulators_give_the_same_coverage);
+		TEST_FUNCTION(test_inverted_contour_complements_normal_one);
+	TEST_SUITE_END()
+
+	return tst_exit_status;
+}
@@ -0,0 +1,283 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file importer.cpp
+**	\brief Test the frame cache of importers
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <atomic>
+#include <fstream>
+#include <vector>
+
+#include <glib.h>
+
+#include <ETL/stringf>
+
+#include <synfig/filesystemnative.h>
+#include <synfig/importer.h>
+#include <synfig/importerframecache.h>
+#include <synfig/listimporter.h>
+#include <synfig/renddesc.h>
+#include <synfig/surface.h>
+#include <synfig/threadpool.h>
+#include <synfig/type.h>
+
+#include "test_base.h"
+
+using namespace synfig;
+
+static const int frames = 12;
+
+//! importer of synthetic images, each file name gives its own image, files don't exist
+class TestImporter: public Importer
+{
+public:
+	static std::atomic<int> decodes;
+
+	explicit TestImporter(const FileSystem::Identifier &identifier):
+		Importer(identifier) { }
+
+	static Importer* create(const FileSystem::Identifier &identifier)
+		{ return new TestImporter(identifier); }
+
+	static Color pixel(int seed, int x, int y)
+	{
+		return Color(
+			(Real)((x + seed)%256)/255,
+			(Real)((y*3 + seed)%256)/255,
+			(Real)((x/16 + y/16 + seed)%2 ? 255 : 0)/255,
+			1.0 );
+	}
+
+	static int seed(const String &filename)
+	{
+		int seed = 0;
+		for(String::const_iterator i = filename.begin(); i != filename.end(); ++i)
+			seed = (seed*31 + *i) & 0xffff;
+		return seed;
+	}
+
+	virtual bool get_frame(synfig::Surface &surface, const RendDesc & /* renddesc */, Time /* time */, ProgressCallback * /* callback */)
+	{
+		++decodes;
+		const int s = seed(identifier.filename);
+		surface.set_wh(64, 36);
+		for(int y = 0; y < surface.get_h(); ++y)
+			for(int x = 0; x < surface.get_w(); ++x)
+				surface[y][x] = pixel(s, x, y);
+		return true;
+	}
+};
+
+std::atomic<int> TestImporter::decodes(0);
+
+//! importer of synthetic images given by the content of file, which is the seed of image
+class TestFileImporter: public Importer
+{
+public:
+	explicit TestFileImporter(const FileSystem::Identifier &identifier):
+		Importer(identifier) { }
+
+	static Importer* create(const FileSystem::Identifier &identifier)
+		{ return new TestFileImporter(identifier); }
+
+	virtual bool get_frame(synfig::Surface &surface, const RendDesc & /* renddesc */, Time /* time */, ProgressCallback * /* callback */)
+	{
+		int seed = 0;
+		std::ifstream file(identifier.filename.c_str());
+		if (!(file >> seed))
+			return false;
+		surface.set_wh(64, 36);
+		for(int y = 0; y < surface.get_h(); ++y)
+			for(int x = 0; x < surface.get_w(); ++x)
+				surface[y][x] = TestImporter::pixel(seed, x, y);
+		return true;
+	}
+};
+
+static String
+temporary_file_name(const String &name)
+{
+	gchar *file_name = g_build_filename(g_get_tmp_dir(), name.c_str(), nullptr);
+	String filename(file_name);
+	g_free(file_name);
+	return filename;
+}
+
+static String
+frame_file_name(int frame)
+	{ return etl::strprintf("synfig-test-%03d.testframe", frame); }
+
+//! image sequence of synthetic images
+static String
+write_sequence()
+{
+	const String filename = temporary_file_name("synfig-test-sequence.lst");
+	std::ofstream file(filename.c_str());
+	file << "FPS 24\n";
+	for(int i = 0; i < frames; ++i)
+		file << frame_file_name(i) << "\n";
+	return filename;
+}
+
+//! scrubs forward, backward and forward again, returns count of frames with wrong content
+static int
+scrub(const String &filename, bool prefetch)
+{
+	RendDesc renddesc;
+	renddesc.set_frame_rate(24);
+	Importer::Handle importer = Importer::open(FileSystemNative::instance()->get_identifier(filename), true);
+	ASSERT(importer);
+
+	int mismatches = 0;
+	for(int pass = 0; pass < 3; ++pass)
+		for(int i = 0; i < frames; ++i) {
+			const int frame = pass == 1 ? frames - 1 - i : i;
+			const Time t(frame/renddesc.get_frame_rate());
+			rendering::Surface::Handle surface = importer->get_frame(renddesc, t);
+			if (prefetch)
+				ImporterFrameCache::instance().prefetch(importer, renddesc, t);
+
+			const int x = frame*3, y = frame*2;
+			const int seed = TestImporter::seed(temporary_file_name(frame_file_name(frame)));
+			std::vector<Color> pixels(surface ? surface->get_pixels_count() : 0);
+			if ( pixels.empty() || !surface->get_pixels(&pixels.front())
+			  || pixels[y*surface->get_width() + x] != TestImporter::pixel(seed, x, y) )
+				++mismatches;
+		}
+	ImporterFrameCache::instance().wait_prefetch();
+	return mismatches;
+}
+
+void test_frame_cache_decodes_every_frame_once() {
+	const String filename = write_sequence();
+	ImporterFrameCache &cache = ImporterFrameCache::instance();
+	cache.clear();
+	TestImporter::decodes = 0;
+
+	const int mismatches = scrub(filename, false);
+	FileSystemNative::instance()->file_remove(filename);
+	ASSERT_EQUAL(0, mismatches);
+	ASSERT_EQUAL(frames, (int)TestImporter::decodes);
+}
+
+void test_frame_cache_with_prefetch_decodes_every_frame_once() {
+	const String filename = write_sequence();
+	ImporterFrameCache &cache = ImporterFrameCache::instance();
+	cache.clear();
+	TestImporter::decodes = 0;
+
+	const int mismatches = scrub(filename, true);
+	FileSystemNative::instance()->file_remove(filename);
+	ASSERT_EQUAL(0, mismatches);
+	ASSERT_EQUAL(frames, (int)TestImporter::decodes);
+}
+
+void test_small_frame_cache_gives_right_frames() {
+	const String filename = write_sequence();
+	ImporterFrameCache &cache = ImporterFrameCache::instance();
+	const size_t max_bytes = cache.get_max_bytes();
+
+	// memory for a half of the frames, a single frame should not take more than a quarter of cache
+	RendDesc renddesc;
+	Importer::Handle probe = Importer::open(FileSystemNative::instance()->get_identifier(filename));
+	rendering::Surface::Handle surface = probe ? probe->get_frame(renddesc, Time(0)) : rendering::Surface::Handle();
+	ASSERT(surface);
+	cache.set_max_bytes(surface->get_memory_size()*(frames/2));
+	cache.clear();
+	cache.reset_stats();
+	TestImporter::decodes = 0;
+
+	const int mismatches = scrub(filename, false);
+	const ImporterFrameCache::Stats stats = cache.get_stats();
+	cache.set_max_bytes(max_bytes);
+	cache.clear();
+	FileSystemNative::instance()->file_remove(filename);
+
+	ASSERT_EQUAL(0, mismatches);
+	ASSERT(stats.evictions > 0);
+	ASSERT(stats.bytes <= stats.max_bytes);
+}
+
+static void
+write_seed_file(const String &filename, const char *seed)
+{
+	std::ofstream file(filename.c_str());
+	file << seed << "\n";
+}
+
+static Color
+frame_pixel(const Importer::Handle &importer, int x, int y)
+{
+	rendering::Surface::Handle surface = importer->get_frame(RendDesc(), Time(0));
+	std::vector<Color> pixels(surface ? surface->get_pixels_count() : 0);
+	if (pixels.empty() || !surface->get_pixels(&pixels.front()))
+		throw SynfigTestException{__FUNCTION__, __LINE__, "\t - frame is not decoded\n"};
+	return pixels[y*surface->get_width() + x];
+}
+
+void test_frame_cache_gives_new_frame_of_rewritten_file() {
+	const String filename = temporary_file_name("synfig-test-rewritten.testfile");
+	const FileSystem::Identifier identifier = FileSystemNative::instance()->get_identifier(filename);
+	ImporterFrameCache::instance().clear();
+
+	write_seed_file(filename, "1");
+	Importer::Handle importer = Importer::open(identifier);
+	ASSERT(importer);
+	ASSERT(frame_pixel(importer, 5, 3) == TestImporter::pixel(1, 5, 3));
+
+	// file is changed while its importer is open, size differs even if time is the same
+	write_seed_file(filename, "1000");
+	ASSERT(frame_pixel(importer, 5, 3) == TestImporter::pixel(1000, 5, 3));
+
+	// file is changed after its importer is closed, size and time may be the same as at first
+	importer.reset();
+	write_seed_file(filename, "7");
+	importer = Importer::open(identifier);
+	ASSERT(importer);
+	ASSERT(frame_pixel(importer, 5, 3) == TestImporter::pixel(7, 5, 3));
+
+	importer.reset();
+	FileSystemNative::instance()->file_remove(filename);
+}
+
+int main() {
+	Type::subsys_init();
+	ThreadPool::subsys_init();
+	Importer::subsys_init();
+	Importer::book()["testframe"] = Importer::BookEntry(&TestImporter::create, false);
+	Importer::book()["testfile"] = Importer::BookEntry(&TestFileImporter::create, false);
+	Importer::book()["lst"] = Importer::BookEntry(&ListImporter::create, false);
+
+	TEST_SUITE_BEGIN()
+		TEST_FUNCTION(test_frame_cache_decodes_every_frame_once);
+		TEST_FUNCTION(test_frame_cache_with_prefetch_decodes_every_frame_once);
+		TEST_FUNCTION(test_small_frame_cache_gives_right_frames);
+		TEST_FUNCTION(test_frame_cache_gives_new_frame_of_rewritten_file);
+	TEST_SUITE_END()
+
+	ImporterFrameCache::instance().wait_prefetch();
+	Importer::subsys_stop();
+	ThreadPool::subsys_stop();
+	Type::subsys_stop();
+
+	return tst_exit_status;
+}
@@ -0,0 +1,211 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file loadcanvas.cpp
+**	\brief Test loading of .sif files
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <fstream>
+
+#include <glib.h>
+
+#include <ETL/stringf>
+
+#include <synfig/canvas.h>
+#include <synfig/context.h>
+#include <synfig/filesystemnative.h>
+#include <synfig/importer.h>
+#include <synfig/layer.h>
+#include <synfig/loadcanvas.h>
+#include <synfig/savecanvas.h>
+#include <synfig/threadpool.h>
+#include <synfig/token.h>
+#include <synfig/transformation.h>
+#include <synfig/type.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/valuenodes/valuenode_bone.h>
+#include <synfig/valuenodes/valuenode_bonelink.h>
+#include <synfig/valuenodes/valuenode_const.h>
+
+#include "test_base.h"
+
+using namespace synfig;
+
+static String
+temporary_file_name(const char *name)
+{
+	gchar *file_name = g_build_filename(g_get_tmp_dir(), name, nullptr);
+	String filename(file_name);
+	g_free(file_name);
+	return filename;
+}
+
+//! writes a file with exported value nodes, which refer to each other,
+//! and with group layers linked to them
+static String
+write_exported_file(const char *name, int count, int layers)
+{
+	const String filename = temporary_file_name(name);
+	std::ofstream file(filename.c_str());
+	file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	     << "<canvas version=\"1.2\" width=\"480\" height=\"270\" view-box=\"-4 2.25 4 -2.25\">\n"
+	     << "<defs>\n";
+	// half of the nodes are constants, others link two earlier nodes
+	for(int i = 0; i < count; ++i) {
+		if (i < 2 || i % 2 == 0)
+			file << etl::strprintf("<real id=\"v%d\" value=\"%d\"/>\n", i, i);
+		else
+			file << etl::strprintf("<add type=\"real\" id=\"v%d\" lhs=\"v%d\" rhs=\"v%d\" scalar=\"v0\"/>\n",
+				i, i/2, i - 1 );
+	}
+	file << "</defs>\n";
+	for(int i = 0; i < layers; ++i)
+		file << etl::strprintf(
+			"<layer type=\"group\" active=\"true\" desc=\"layer %d\">\n"
+			"<param name=\"amount\" use=\"v%d\"/>\n"
+			"<param name=\"origin\"><vector><x>%d</x><y>0</y></vector></param>\n"
+			"<param name=\"canvas\"><canvas></canvas></param>\n"
+			"</layer>\n", i, 2*(i % (count/2)), i );
+	file << "</canvas>\n";
+	return filename;
+}
+
+static Canvas::Handle
+load(const String &filename, bool streaming)
+{
+	String errors;
+	CanvasParser parser;
+	parser.set_streaming(streaming);
+	Canvas::Handle canvas = parser.parse_from_file_as(FileSystemNative::instance()->get_identifier(filename), filename, errors);
+	if (!canvas)
+		throw SynfigTestException{__FUNCTION__, __LINE__, "\t - " + errors + "\n"};
+	return canvas;
+}
+
+//! writes a file with a chain of two bones, the leaf bone is referenced only by a layer
+static String
+write_bones_file(const char *name)
+{
+	const String filename = temporary_file_name(name);
+	Canvas::Handle canvas = Canvas::create();
+	canvas->rend_desc().set_wh(480, 270);
+
+	Bone bone;
+	bone.set_name("parent");
+	ValueNode_Bone::Handle parent = ValueNode_Bone::create(bone, canvas);
+	bone.set_name("leaf");
+	bone.set_parent(parent.get());
+	ValueNode_Bone::Handle leaf = ValueNode_Bone::create(bone, canvas);
+
+	ValueNode_BoneLink::Handle link = ValueNode_BoneLink::create(Transformation());
+	link->set_link("bone", ValueNode_Const::create(leaf));
+	Layer::Handle layer = Layer::create("group");
+	layer->connect_dynamic_param("transformation", ValueNode::LooseHandle(link));
+	canvas->push_back(layer);
+
+	if (!save_canvas(FileSystemNative::instance()->get_identifier(filename), canvas))
+		throw SynfigTestException{__FUNCTION__, __LINE__, "\t - unable to save " + filename + "\n"};
+	return filename;
+}
+
+void test_exported_value_nodes_are_found() {
+	const int count = 200;
+	const String filename = write_exported_file("synfig-test-exported.sif", count, 0);
+	String errors, warnings;
+	Canvas::Handle canvas = open_canvas_as(FileSystemNative::instance()->get_identifier(filename), filename, errors, warnings);
+	FileSystemNative::instance()->file_remove(filename);
+
+	ASSERT(canvas);
+	ASSERT_EQUAL(count, (int)canvas->value_node_list().size());
+	for(int i = count - 1; i >= 0; --i)
+		ASSERT(canvas->value_node_list().count(etl::strprintf("v%d", i)));
+}
+
+void test_streaming_parser_gives_the_same_canvas_as_dom() {
+	const int count = 40, layers = 30;
+	const String filename = write_exported_file("synfig-test-loader.sif", count, layers);
+	Canvas::Handle dom = load(filename, false);
+	Canvas::Handle streaming = load(filename, true);
+	FileSystemNative::instance()->file_remove(filename);
+
+	ASSERT_EQUAL(layers, (int)dom->size());
+	ASSERT_EQUAL(dom->size(), streaming->size());
+	ASSERT_EQUAL(dom->value_node_list().size(), streaming->value_node_list().size());
+
+	Canvas::const_iterator a = dom->begin(), b = streaming->begin();
+	for(; a != dom->end() && b != streaming->end(); ++a, ++b) {
+		ASSERT_EQUAL((*a)->get_description(), (*b)->get_description());
+		ASSERT_EQUAL((*a)->get_param("amount").get(Real()), (*b)->get_param("amount").get(Real()));
+		ASSERT_EQUAL((*a)->get_param("origin").get(Vector())[0], (*b)->get_param("origin").get(Vector())[0]);
+		ASSERT_EQUAL((*a)->dynamic_param_list().size(), (*b)->dynamic_param_list().size());
+	}
+}
+
+//! bones are referenced by guid, so they should live until the layers are loaded
+static void
+check_leaf_bone_is_loaded(const String &filename, bool streaming)
+{
+	Canvas::Handle canvas = load(filename, streaming);
+	ASSERT_EQUAL(1, (int)canvas->size());
+	ASSERT_EQUAL(2, (int)ValueNode_Bone::get_bone_map(canvas).size());
+
+	Layer::DynamicParamList::const_iterator i = (*canvas->begin())->dynamic_param_list().find("transformation");
+	ASSERT(i != (*canvas->begin())->dynamic_param_list().end());
+	ValueNode_BoneLink::Handle link = ValueNode_BoneLink::Handle::cast_dynamic(i->second);
+	ASSERT(link);
+	ValueNode_Bone::Handle leaf = (*link->get_link("bone"))(Time()).get(ValueNode_Bone::Handle());
+	ASSERT(leaf);
+	ASSERT_EQUAL(String("leaf"), leaf->get_bone_name(Time()));
+
+	ValueNode_Bone::Handle parent = (*leaf->get_link("parent"))(Time()).get(ValueNode_Bone::Handle());
+	ASSERT(parent);
+	ASSERT_EQUAL(String("parent"), parent->get_bone_name(Time()));
+}
+
+void test_leaf_bone_referenced_by_layer_is_loaded() {
+	const String filename = write_bones_file("synfig-test-bones.sif");
+	check_leaf_bone_is_loaded(filename, false);
+	check_leaf_bone_is_loaded(filename, true);
+	FileSystemNative::instance()->file_remove(filename);
+}
+
+int main() {
+	Type::subsys_init();
+	ThreadPool::subsys_init();
+	rendering::Renderer::subsys_init();
+	Layer::subsys_init();
+	Importer::subsys_init();
+	Token::rebuild();
+
+	TEST_SUITE_BEGIN()
+		TEST_FUNCTION(test_exported_value_nodes_are_found);
+		TEST_FUNCTION(test_streaming_parser_gives_the_same_canvas_as_dom);
+		TEST_FUNCTION(test_leaf_bone_referenced_by_layer_is_loaded);
+	TEST_SUITE_END()
+
+	Importer::subsys_stop();
+	Layer::subsys_stop();
+	rendering::Renderer::subsys_stop();
+	ThreadPool::subsys_stop();
+	Type::subsys_stop();
+
+	return tst_exit_status;
+}
@@ -0,0 +1,113 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file pixelformat.cpp
+**	\brief Test conversion of colors into pixel formats
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <synfig/color/color.h>
+#include <synfig/color/pixelformat.h>
+
+#include "test_base.h"
+
+using namespace synfig;
+
+// odd width to check the tail of vectorized loops
+static const int width = 37;
+static const int height = 11;
+
+static std::vector<Color>
+generate_colors()
+{
+	std::vector<Color> pixels(width*height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			pixels[y*width + x] = Color(
+				(Real)x/width,
+				(Real)((x*7 + y*13)%1024)/1023,
+				(Real)(y*29%300)/256 - 0.1,
+				(Real)((x*3 + y)%260)/255 );
+	// out of range, undefined and almost transparent colors
+	pixels[0] = Color(-1, 2, 0, 0);
+	pixels[1] = Color(NAN, 0.5, NAN, NAN);
+	pixels[2] = Color(1, 1, 1, 1);
+	pixels[3] = Color(0.5, 0.25, 0.125, 1e-6);
+	return pixels;
+}
+
+//! returns max difference of bytes from the reference conversion
+static int
+check_pixel_format(PixelFormat pf, const Gamma *gamma)
+{
+	const std::vector<Color> pixels = generate_colors();
+	const int size = pixel_size(pf);
+	std::vector<unsigned char> bytes(size*width*height), reference_bytes(bytes.size());
+	color_to_pixelformat_reference(&reference_bytes.front(), &pixels.front(), pf, gamma, width, height);
+	color_to_pixelformat(&bytes.front(), &pixels.front(), pf, gamma, width, height);
+
+	int max_error = 0;
+	for(size_t i = 0; i < bytes.size(); ++i)
+		max_error = std::max(max_error, std::abs((int)bytes[i] - (int)reference_bytes[i]));
+
+	// decoding has no gamma, so it should be exactly the same
+	std::vector<Color> colors(width*height), reference_colors(width*height);
+	pixelformat_to_color_reference(&reference_colors.front(), &reference_bytes.front(), pf, width, height);
+	pixelformat_to_color(&colors.front(), &reference_bytes.front(), pf, width, height);
+	ASSERT(!memcmp(&colors.front(), &reference_colors.front(), colors.size()*sizeof(Color)));
+
+	return max_error;
+}
+
+void test_pixel_formats_match_reference_conversion() {
+	const PixelFormat formats[] = {
+		PF_RGB,
+		PF_BGR,
+		PF_RGB|PF_A,
+		PF_BGR|PF_A,
+		PF_A_START|PF_RGB,
+		PF_BGR|PF_A|PF_A_PREMULT,
+		PF_A_START|PF_RGB|PF_A_PREMULT,
+		PF_A_START|PF_BGR|PF_A_PREMULT,
+		PF_GRAY|PF_A };
+	for(int i = 0; i < (int)(sizeof(formats)/sizeof(*formats)); ++i)
+		ASSERT_EQUAL(0, check_pixel_format(formats[i], NULL));
+}
+
+void test_pixel_formats_with_gamma_match_reference_conversion() {
+	const Gamma gamma(1/2.2);
+	ASSERT_EQUAL(0, check_pixel_format(PF_RGB, &gamma));
+	ASSERT_EQUAL(0, check_pixel_format(PF_BGR|PF_A|PF_A_PREMULT, &gamma));
+}
+
+int main() {
+
+	TEST_SUITE_BEGIN()
+		TEST_FUNCTION(test_pixel_formats_match_reference_conversion);
+		TEST_FUNCTION(test_pixel_formats_with_gamma_match_reference_conversion);
+	TEST_SUITE_END()
+
+	return tst_exit_status;
+}
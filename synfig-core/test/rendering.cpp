@@ -0,0 +1,440 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file rendering.cpp
+**	\brief Test scheduling, caching and tasks of software renderer
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include <glib.h>
+
+#include <synfig/real.h>
+#include <synfig/surface.h>
+#include <synfig/threadpool.h>
+#include <synfig/token.h>
+#include <synfig/type.h>
+#include <synfig/debug/trace.h>
+#include <synfig/rendering/rendercache.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/renderqueue.h>
+#include <synfig/rendering/common/task/taskblend.h>
+#include <synfig/rendering/common/task/taskblur.h>
+#include <synfig/rendering/common/task/taskcontour.h>
+#include <synfig/rendering/common/task/taskdistort.h>
+#include <synfig/rendering/common/task/taskescapetime.h>
+#include <synfig/rendering/common/task/taskpixelprocessor.h>
+#include <synfig/rendering/software/surfaceswpool.h>
+
+#include "test_base.h"
+
+using namespace synfig;
+using namespace rendering;
+
+static Task::Handle
+create_constant_task(const Color &color)
+{
+	TaskPixelColorMatrix::Handle task(new TaskPixelColorMatrix());
+	task->matrix.set_constant(color);
+	return task;
+}
+
+static Task::Handle
+create_contour_task(const Vector &center, Real radius, const Color &color)
+{
+	Contour::Handle contour(new Contour());
+	contour->color = color;
+	for(int i = 0; i < 10; ++i) {
+		Real angle = 2.0*PI*i/10.0;
+		Real r = i % 2 ? radius*0.4 : radius;
+		Vector p = center + Vector(r*cos(angle), r*sin(angle));
+		if (i) contour->line_to(p); else contour->move_to(p);
+	}
+	contour->close();
+
+	TaskContour::Handle task(new TaskContour());
+	task->contour = contour;
+	return task;
+}
+
+static void
+set_target(const Task::Handle &task, int size, const Rect &rect)
+{
+	task->target_surface = new SurfaceResource();
+	task->target_surface->create(size, size);
+	task->target_rect = RectInt(0, 0, size, size);
+	task->source_rect = rect;
+}
+
+//! static blurred background and a moving star at foreground
+static Task::Handle
+create_frame_task(int frame, int size)
+{
+	TaskBlur::Handle background(new TaskBlur());
+	background->blur.size = Vector(0.1, 0.1);
+	background->blur.type = Blur::GAUSSIAN;
+	background->sub_task() = create_contour_task(Vector(), 0.9, Color(0.2, 0.6, 0.2, 1.0));
+
+	TaskBlend::Handle blend(new TaskBlend());
+	blend->blend_method = Color::BLEND_COMPOSITE;
+	blend->sub_task_a() = background;
+	blend->sub_task_b() = create_contour_task(Vector(-0.5 + 0.04*frame, 0.0), 0.3, Color(0.8, 0.2, 0.2, 1.0));
+	set_target(blend, size, Rect(-1.0, -1.0, 1.0, 1.0));
+	return blend;
+}
+
+//! stack of semi-transparent stars, each one is rendered into own intermediate surface
+static Task::Handle
+create_layers_task(int frame, int size, int layers)
+{
+	Task::Handle task;
+	for(int i = 0; i < layers; ++i) {
+		TaskBlend::Handle blend(new TaskBlend());
+		blend->blend_method = Color::BLEND_COMPOSITE;
+		blend->amount = 0.8;
+		blend->sub_task_a() = task;
+		blend->sub_task_b() = create_contour_task(
+			Vector(-0.5 + 1.0*i/layers, -0.5 + 0.01*frame), 0.5,
+			Color((Real)i/layers, 0.5, 1.0 - (Real)i/layers, 1.0) );
+		task = blend;
+	}
+	set_target(task, size, Rect(-1.0, -1.0, 1.0, 1.0));
+	return task;
+}
+
+static std::vector<Color>
+render(const Task::Handle &task)
+{
+	if (!Renderer::get_renderer("software")->run(Task::List(1, task), true))
+		throw SynfigTestException{__FUNCTION__, __LINE__, "\t - task is not rendered\n"};
+
+	SurfaceResource::LockReadBase lock(task->target_surface);
+	if (!lock.convert(rendering::Surface::Token::Handle(), false, true))
+		throw SynfigTestException{__FUNCTION__, __LINE__, "\t - result is not readable\n"};
+	std::vector<Color> pixels(lock.get_surface()->get_pixels_count());
+	lock.get_surface()->get_pixels(&pixels.front());
+	return pixels;
+}
+
+static Real
+premultiplied_difference(const Color &straight_a, const Color &straight_b)
+{
+	const Color a = straight_a.premult_alpha(), b = straight_b.premult_alpha();
+	return std::max(
+		std::max(std::fabs(a.get_r() - b.get_r()), std::fabs(a.get_g() - b.get_g())),
+		std::max(std::fabs(a.get_b() - b.get_b()), std::fabs(a.get_a() - b.get_a())) );
+}
+
+static Real
+max_difference(const std::vector<Color> &a, const std::vector<Color> &b)
+{
+	ASSERT_EQUAL(a.size(), b.size());
+	Real difference = 0.0;
+	for(int i = 0; i < (int)a.size(); ++i)
+		difference = std::max(difference, premultiplied_difference(a[i], b[i]));
+	return difference;
+}
+
+static long long
+executed_tasks()
+{
+	RenderQueue::ThreadStatsList stats;
+	Renderer::get_queue()->get_stats(stats);
+	long long tasks = 0;
+	for(RenderQueue::ThreadStatsList::const_iterator i = stats.begin(); i != stats.end(); ++i)
+		tasks += i->tasks;
+	return tasks;
+}
+
+//! tiny independent blends enqueued by several batches at once, like studio does for tiles
+static void
+run_blend_batches(int jobs, int batches)
+{
+	const int size = 4;
+	std::vector<Task::List> lists(batches);
+	for(int i = 0; i < jobs; ++i) {
+		TaskBlend::Handle blend(new TaskBlend());
+		blend->blend_method = Color::BLEND_COMPOSITE;
+		blend->amount = 0.5;
+		blend->sub_task_a() = create_constant_task(Color(1.0, 0.0, 0.0, 1.0));
+		blend->sub_task_b() = create_constant_task(Color(0.0, 0.0, 1.0, 0.5));
+		set_target(blend, size, Rect(0.0, 0.0, 1.0, 1.0));
+		lists[i % batches].push_back(blend);
+	}
+
+	std::vector<TaskEvent::Handle> events;
+	for(int i = 0; i < batches; ++i) {
+		events.push_back(new TaskEvent());
+		Renderer::get_renderer("software")->enqueue(lists[i], events.back(), true);
+	}
+	for(int i = 0; i < batches; ++i) {
+		events[i]->wait();
+		ASSERT(events[i]->is_done());
+	}
+}
+
+void test_render_queue_runs_all_batches() {
+	Renderer::get_queue()->reset_stats();
+	run_blend_batches(256, 16);
+	ASSERT(executed_tasks() >= 256);
+}
+
+void test_trace_records_every_executed_task() {
+	gchar *name = g_build_filename(g_get_tmp_dir(), "synfig-test-trace.json", nullptr);
+	const String filename(name);
+	g_free(name);
+
+	debug::Trace::clear();
+	debug::Trace::set_enabled(true);
+	Renderer::get_queue()->reset_stats();
+	run_blend_batches(64, 4);
+	debug::Trace::set_enabled(false);
+	const long long tasks = executed_tasks();
+
+	ASSERT(debug::Trace::count() >= tasks);
+	ASSERT(debug::Trace::save(filename));
+
+	// one event per line
+	long long task_events = 0;
+	std::ifstream stream(filename.c_str());
+	for(String line; std::getline(stream, line); )
+		if (line.find("\"cat\":\"task\"") != String::npos) ++task_events;
+	stream.close();
+	std::remove(filename.c_str());
+	ASSERT_EQUAL(tasks, task_events);
+
+	debug::Trace::clear();
+	ASSERT_EQUAL(0, debug::Trace::count());
+}
+
+void test_render_cache_does_not_change_frames() {
+	const int frames = 4, size = 96;
+	RenderCache *cache = Renderer::get_cache();
+	const size_t max_bytes = cache->get_max_bytes();
+
+	cache->clear();
+	cache->set_max_bytes(0);
+	std::vector< std::vector<Color> > expected;
+	for(int i = 0; i < frames; ++i)
+		expected.push_back(render(create_frame_task(i, size)));
+
+	cache->set_max_bytes(16*1024*1024);
+	cache->reset_stats();
+	for(int i = 0; i < frames; ++i)
+		ASSERT(max_difference(expected[i], render(create_frame_task(i, size))) <= 1e-5);
+
+	// background is requested the first time and stored, later it's taken from cache,
+	// smaller surfaces are not cached
+	const long long hits = cache->get_stats().hits;
+	cache->clear();
+	cache->set_max_bytes(max_bytes);
+	cache->reset_stats();
+	ASSERT(hits >= frames - 2);
+}
+
+void test_surface_pool_does_not_change_frames() {
+	const int frames = 4, size = 32, layers = 4;
+	RenderCache *cache = Renderer::get_cache();
+	SurfaceSWPool &pool = SurfaceSWPool::instance();
+	const size_t cache_bytes = cache->get_max_bytes();
+	const size_t pool_bytes = pool.get_max_bytes();
+
+	// cached results would hide the intermediate surfaces
+	cache->set_max_bytes(0);
+	pool.set_max_bytes(0);
+	pool.clear();
+	std::vector< std::vector<Color> > expected;
+	for(int i = 0; i < frames; ++i)
+		expected.push_back(render(create_layers_task(i, size, layers)));
+
+	pool.set_max_bytes(16*1024*1024);
+	pool.reset_stats();
+	for(int i = 0; i < frames; ++i)
+		ASSERT(max_difference(expected[i], render(create_layers_task(i, size, layers))) <= 1e-5);
+
+	const SurfaceSWPool::Stats stats = pool.get_stats();
+	pool.set_max_bytes(pool_bytes);
+	cache->set_max_bytes(cache_bytes);
+	ASSERT(stats.reuses >= stats.allocations);
+}
+
+//! twirl around the origin, like Twirl layer of lyr_std module
+class TestTwirl: public Distortion
+{
+protected:
+	virtual bool map_vfunc(const Point &point, Point &source_point) const
+	{
+		const Real radius = 0.8, mag = point.mag();
+		if (mag >= radius)
+			{ source_point = point; return true; }
+		const Real a = 2.0*PI*(mag - radius)/radius;
+		const Real s = sin(a), c = cos(a);
+		source_point = Point(c*point[0] - s*point[1], s*point[0] + c*point[1]);
+		return true;
+	}
+};
+
+static Task::Handle
+create_distort_source()
+{
+	TaskBlend::Handle blend(new TaskBlend());
+	blend->blend_method = Color::BLEND_COMPOSITE;
+	blend->sub_task_a() = create_contour_task(Vector(), 0.9, Color(0.2, 0.6, 0.2, 1.0));
+	blend->sub_task_b() = create_contour_task(Vector(0.3, 0.0), 0.4, Color(0.8, 0.2, 0.2, 1.0));
+	return blend;
+}
+
+void test_distort_task_matches_per_pixel_sampling() {
+	const int size = 64, src_size = 2*size;
+	const Real upp = 2.0/size;
+	const Distortion::Handle distortion(new TestTwirl());
+
+	// source covers twice larger area than the result
+	Task::Handle source = create_distort_source();
+	set_target(source, src_size, Rect(-2.0, -2.0, 2.0, 2.0));
+	const std::vector<Color> source_pixels = render(source);
+	synfig::Surface surface(src_size, src_size);
+	for(int y = 0; y < src_size; ++y)
+		for(int x = 0; x < src_size; ++x)
+			surface[y][x] = source_pixels[y*src_size + x];
+
+	// sampling of pixels one by one, like distortion layers did by Layer::get_color()
+	std::vector<Color> expected(size*size, Color::alpha());
+	for(int y = 0; y < size; ++y)
+		for(int x = 0; x < size; ++x) {
+			Point s;
+			if (!distortion->map(Point(-1.0 + upp*x, -1.0 + upp*y), s)) continue;
+			const Vector p((s[0] + 2.0)/upp, (s[1] + 2.0)/upp);
+			if (p[0] >= 0.0 && p[1] >= 0.0 && p[0] <= src_size - 1 && p[1] <= src_size - 1)
+				expected[y*size + x] = surface.linear_sample(p[0], p[1]);
+		}
+
+	TaskDistort::Handle task(new TaskDistort());
+	task->distortion = distortion;
+	task->sub_task() = create_distort_source();
+	set_target(task, size, Rect(-1.0, -1.0, 1.0, 1.0));
+	ASSERT(max_difference(expected, render(task)) <= 1e-3);
+}
+
+//! colors by count of iterations, like Mandelbrot layer with solid gradients
+class TestEscapeTime: public EscapeTime
+{
+protected:
+	virtual Color shade_vfunc(const Point&, const Orbit &orbit, int iterations, const Source&) const
+	{
+		if (!orbit.escaped())
+			return Color(0.0, 0.0, 0.0, 1.0);
+		const ColorReal k = (ColorReal)orbit.escape/iterations;
+		return Color(k, 1 - k, orbit.mag > 16 ? 1 : 0, 1.0);
+	}
+	virtual bool uses_source_vfunc() const
+		{ return false; }
+};
+
+class TestEmptySource: public EscapeTime::Source
+{
+public:
+	virtual Color get_color(const Point&) const
+		{ return Color::alpha(); }
+};
+
+static bool
+same_real(Real a, Real b)
+	{ return a == b || (std::isnan(a) && std::isnan(b)); }
+
+static void
+check_escape_time(EscapeTime::Formula formula, bool broken)
+{
+	const int size = 64, iterations = 64;
+	etl::handle<TestEscapeTime> escape_time(new TestEscapeTime());
+	escape_time->formula = formula;
+	escape_time->seed = Point(-0.8, 0.156);
+	escape_time->broken = broken;
+	escape_time->iterations = iterations;
+
+	const Rect rect(-2.0, -1.5, 1.0, 1.5);
+	const Vector upp(rect.get_width()/size, rect.get_height()/size);
+	const Vector step(upp[0], 0.0);
+
+	// rows should give exactly the same orbits as single points
+	std::vector<EscapeTime::Orbit> expected(size*size), rows(size*size);
+	for(int y = 0; y < size; ++y) {
+		const Point point(rect.minx + upp[0]*0.5, rect.miny + upp[1]*(y + 0.5));
+		for(int x = 0; x < size; ++x)
+			escape_time->iterate_row(point + step*x, Vector(), &expected[y*size + x], 1);
+		escape_time->iterate_row(point, step, &rows[y*size], size);
+	}
+	for(int i = 0; i < size*size; ++i) {
+		ASSERT_EQUAL(expected[i].escape, rows[i].escape);
+		ASSERT(same_real(expected[i].mag, rows[i].mag));
+		ASSERT(same_real(expected[i].zr, rows[i].zr));
+		ASSERT(same_real(expected[i].zi, rows[i].zi));
+	}
+
+	// points of task are calculated by blocks, so a few of them may differ by rounding
+	TaskEscapeTime::Handle task(new TaskEscapeTime());
+	task->escape_time = escape_time;
+	set_target(task, size, rect);
+	const std::vector<Color> pixels = render(task);
+	const TestEmptySource source;
+	int different_pixels = 0;
+	for(int i = 0; i < size*size; ++i) {
+		const Color a = pixels[i];
+		const Color b = escape_time->shade(Point(), expected[i], iterations, source);
+		if ( std::fabs(a.get_r() - b.get_r()) > 1e-5
+		  || std::fabs(a.get_g() - b.get_g()) > 1e-5
+		  || std::fabs(a.get_b() - b.get_b()) > 1e-5 )
+			++different_pixels;
+	}
+	ASSERT(different_pixels*100 <= size*size);
+}
+
+void test_escape_time_matches_single_points() {
+	check_escape_time(EscapeTime::MANDELBROT, false);
+	check_escape_time(EscapeTime::MANDELBROT, true);
+	check_escape_time(EscapeTime::JULIA, false);
+	check_escape_time(EscapeTime::JULIA, true);
+}
+
+int main() {
+	Type::subsys_init();
+	ThreadPool::subsys_init();
+	Renderer::subsys_init();
+	Token::rebuild();
+
+	TEST_SUITE_BEGIN()
+		TEST_FUNCTION(test_render_queue_runs_all_batches);
+		TEST_FUNCTION(test_trace_records_every_executed_task);
+		TEST_FUNCTION(test_render_cache_does_not_change_frames);
+		TEST_FUNCTION(test_surface_pool_does_not_change_frames);
+		TEST_FUNCTION(test_distort_task_matches_per_pixel_sampling);
+		TEST_FUNCTION(test_escape_time_matches_single_points);
+	TEST_SUITE_END()
+
+	Renderer::subsys_stop();
+	ThreadPool::subsys_stop();
+	Type::subsys_stop();
+
+	return tst_exit_status;
+}
@@ -0,0 +1,183 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file surface.cpp
+**	\brief Test compact and packed software surfaces
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <synfig/token.h>
+#include <synfig/type.h>
+#include <synfig/rendering/software/surfacesw.h>
+#include <synfig/rendering/software/surfaceswrgba16f.h>
+#include <synfig/rendering/software/surfaceswrgba8.h>
+#include <synfig/rendering/software/function/packedsurface.h>
+
+#include "test_base.h"
+
+using namespace synfig;
+using namespace rendering;
+
+static const int width = 67;
+static const int height = 45;
+
+static std::vector<Color>
+generate_pixels()
+{
+	std::vector<Color> pixels(width*height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			pixels[y*width + x] = Color(
+				(Real)x/width,
+				(Real)y/height,
+				(Real)((x*7 + y*13)%256)/255,
+				(Real)((x + y)%64)/63 );
+	return pixels;
+}
+
+//! error is measured for premultiplied components
+static Real
+max_surface_error(const rendering::Surface::Token::Handle &token)
+{
+	const std::vector<Color> pixels = generate_pixels();
+	rendering::Surface::Handle surface = token->fabric();
+	ASSERT(surface);
+	ASSERT(surface->assign(&pixels.front(), width, height));
+	ASSERT_EQUAL(width, surface->get_width());
+	ASSERT_EQUAL(height, surface->get_height());
+
+	Real error = 0.0;
+	std::vector<Color> row(width);
+	for(int y = 0; y < height; ++y) {
+		ASSERT(surface->get_pixels_row(0, y, width, &row.front()));
+		for(int x = 0; x < width; ++x) {
+			const Color a = pixels[y*width + x].premult_alpha(), b = row[x].premult_alpha();
+			error = std::max(error, (Real)std::fabs(a.get_r() - b.get_r()));
+			error = std::max(error, (Real)std::fabs(a.get_g() - b.get_g()));
+			error = std::max(error, (Real)std::fabs(a.get_b() - b.get_b()));
+			error = std::max(error, (Real)std::fabs(a.get_a() - b.get_a()));
+		}
+	}
+	return error;
+}
+
+void test_rgba16f_surface_keeps_colors() {
+	ASSERT(max_surface_error(SurfaceSWRGBA16F::token.handle()) <= 1e-3);
+}
+
+void test_rgba8_surface_keeps_colors() {
+	ASSERT(max_surface_error(SurfaceSWRGBA8::token.handle()) <= 1.0/255.0);
+}
+
+void test_compact_surfaces_use_less_memory() {
+	const std::vector<Color> pixels = generate_pixels();
+	SurfaceSW reference;
+	reference.assign(&pixels.front(), width, height);
+	rendering::Surface::Handle half = SurfaceSWRGBA16F::token.handle()->fabric();
+	rendering::Surface::Handle byte = SurfaceSWRGBA8::token.handle()->fabric();
+	half->assign(&pixels.front(), width, height);
+	byte->assign(&pixels.front(), width, height);
+
+	ASSERT(2*half->get_memory_size() <= reference.get_memory_size());
+	ASSERT(4*byte->get_memory_size() <= reference.get_memory_size());
+}
+
+//! pixels of unpacked surface are compared with the surface packed by codec,
+//! whole and by reader along rotated rows, with and without the cache of chunks
+static void
+check_packed_surface(software::PackedSurface::Codec codec)
+{
+	typedef software::PackedSurface PackedSurface;
+	const int width = 300, height = 200;
+
+	// flat areas and gradients of 8-bit image
+	std::vector<Color> pixels(width*height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			pixels[y*width + x] = Color(
+				(Real)(x*255/width)/255,
+				(Real)((y/64)%2 ? 255 : 0)/255,
+				(Real)((x/48 + y/48)%4*64)/255,
+				(Real)(x < width/2 ? 255 : (x*7 + y*13)%256)/255 );
+
+	const PackedSurface::Codec default_codec = PackedSurface::get_default_codec();
+	PackedSurface::set_default_codec(PackedSurface::CodecNone);
+	PackedSurface reference;
+	reference.set_pixels(&pixels.front(), width, height);
+	PackedSurface::set_default_codec(codec);
+	PackedSurface surface;
+	surface.set_pixels(&pixels.front(), width, height);
+	PackedSurface::set_default_codec(default_codec);
+
+	std::vector<Color> expected(width*height), result(width*height);
+	reference.get_pixels(&expected.front());
+	surface.get_pixels(&result.front());
+	for(int i = 0; i < width*height; ++i)
+		ASSERT(expected[i] == result[i]);
+
+	PackedSurface::ChunkCache &cache = PackedSurface::ChunkCache::instance();
+	const size_t cache_bytes = cache.get_max_bytes();
+	const Real angle = 0.3, dx = std::cos(angle), dy = std::sin(angle);
+	int mismatches = 0;
+	for(int pass = 0; pass < 2; ++pass) {
+		cache.set_max_bytes(pass ? std::max(cache_bytes, (size_t)16*1024*1024) : 0);
+		PackedSurface::Reader reader(surface);
+		for(int row = 0; row < height; ++row)
+			for(int col = 0; col < width; ++col) {
+				int x = (int)std::floor(col*dx - row*dy + width/2) % width;
+				int y = (int)std::floor(col*dy + row*dx) % height;
+				if (x < 0) x += width;
+				if (y < 0) y += height;
+				if (!(reader.get_pixel(x, y) == expected[y*width + x]))
+					++mismatches;
+			}
+	}
+	cache.set_max_bytes(cache_bytes);
+	ASSERT_EQUAL(0, mismatches);
+}
+
+void test_packed_surface_zlib_codec_restores_pixels() {
+	check_packed_surface(software::PackedSurface::CodecZlib);
+}
+
+void test_packed_surface_lz_codec_restores_pixels() {
+	check_packed_surface(software::PackedSurface::CodecLZ);
+}
+
+int main() {
+	Type::subsys_init();
+	Token::rebuild();
+
+	TEST_SUITE_BEGIN()
+		TEST_FUNCTION(test_rgba16f_surface_keeps_colors);
+		TEST_FUNCTION(test_rgba8_surface_keeps_colors);
+		TEST_FUNCTION(test_compact_surfaces_use_less_memory);
+		TEST_FUNCTION(test_packed_surface_zlib_codec_restores_pixels);
+		TEST_FUNCTION(test_packed_surface_lz_codec_restores_pixels);
+	TEST_SUITE_END()
+
+	Type::subsys_stop();
+
+	return tst_exit_status;
+}
@@ -0,0 +1,188 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file target.cpp
+**	\brief Test background encoding of frames by targets
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+
+#include <vector>
+
+#include <synfig/color.h>
+#include <synfig/surface.h>
+#include <synfig/target_scanline.h>
+#include <synfig/threadpool.h>
+#include <synfig/type.h>
+
+#include "test_base.h"
+
+using namespace synfig;
+
+static const int width = 64;
+static const int height = 36;
+static const int frames = 6;
+
+static Color
+pixel(int frame, int x, int y)
+{
+	return Color(
+		(Real)((x + frame*7)%256)/255,
+		(Real)((y*3 + frame)%256)/255,
+		(Real)((x/16 + y/16 + frame)%2 ? 255 : 0)/255,
+		1.0 );
+}
+
+//! image sequence target which keeps only checksums of the frames,
+//! encoding of the frame given by fail_frame fails, frame given by drop_frame is not encoded
+class TestTarget: public Target_Scanline
+{
+	class FrameJob: public EncodeJob
+	{
+	public:
+		TestTarget *target;
+		int frame;
+		std::vector<unsigned char> pixels;
+
+		FrameJob(): target(), frame() { }
+
+		virtual bool run()
+		{
+			if (frame == target->fail_frame)
+				return false;
+			unsigned int checksum = 0;
+			for(std::vector<unsigned char>::const_iterator i = pixels.begin(); i != pixels.end(); ++i)
+				checksum = checksum*31 + *i;
+			// frames are finished in any order, but each writes only its own entry
+			target->checksums[frame] = checksum;
+			return true;
+		}
+	};
+
+	etl::handle<FrameJob> job;
+	std::vector<Color> row;
+	int y;
+
+public:
+	std::vector<unsigned int> checksums;
+	int fail_frame;
+	int drop_frame;
+
+	TestTarget(int queue, int fail_frame = -1): y(), fail_frame(fail_frame), drop_frame(-1)
+	{
+		desc.set_wh(width, height);
+		desc.set_frame_start(0);
+		desc.set_frame_end(frames - 1);
+		row.resize(width);
+		checksums.resize(frames);
+		set_encoding_queue(queue);
+	}
+
+	virtual bool start_frame(ProgressCallback * /* cb */)
+	{
+		job = new FrameJob();
+		job->target = this;
+		job->frame = curr_frame_++;
+		job->pixels.resize(4*width*height);
+		y = 0;
+		return true;
+	}
+
+	virtual Color* start_scanline(int /* scanline */)
+		{ return &row.front(); }
+
+	virtual bool end_scanline()
+	{
+		unsigned char *p = &job->pixels[4*width*y++];
+		for(std::vector<Color>::const_iterator i = row.begin(); i != row.end(); ++i) {
+			*p++ = (unsigned char)(255*i->get_r());
+			*p++ = (unsigned char)(255*i->get_g());
+			*p++ = (unsigned char)(255*i->get_b());
+			*p++ = (unsigned char)(255*i->get_a());
+		}
+		return true;
+	}
+
+	virtual void end_frame()
+	{
+		// like a frame which is not complete, it is not passed to the queue
+		if (job->frame == drop_frame)
+			set_encoding_failed();
+		else
+			enqueue_encode_job(job);
+		job.reset();
+	}
+};
+
+//! returns true when all frames are encoded successfully
+static bool
+encode(TestTarget &target)
+{
+	bool success = true;
+	for(int frame = 0; frame < frames; ++frame) {
+		synfig::Surface surface(width, height);
+		for(int y = 0; y < height; ++y)
+			for(int x = 0; x < width; ++x)
+				surface[y][x] = pixel(frame, x, y);
+		success = target.add_frame(&surface, nullptr) && success;
+	}
+	return target.wait_encode_jobs() && success;
+}
+
+void test_background_encoding_writes_the_same_frames() {
+	TestTarget serial(0), background(4);
+	ASSERT(encode(serial));
+	ASSERT(encode(background));
+	for(int frame = 0; frame < frames; ++frame)
+		ASSERT_EQUAL(serial.checksums[frame], background.checksums[frame]);
+}
+
+void test_failed_encoding_is_reported() {
+	TestTarget serial(0, 2), background(4, 2);
+	ASSERT(!encode(serial));
+	ASSERT(!encode(background));
+
+	// error is cleared when it is reported
+	background.fail_frame = -1;
+	ASSERT(background.wait_encode_jobs());
+}
+
+void test_dropped_frame_is_reported() {
+	TestTarget serial(0), background(4);
+	serial.drop_frame = background.drop_frame = 3;
+	ASSERT(!encode(serial));
+	ASSERT(!encode(background));
+}
+
+int main() {
+	Type::subsys_init();
+	ThreadPool::subsys_init();
+
+	TEST_SUITE_BEGIN()
+		TEST_FUNCTION(test_background_encoding_writes_the_same_frames);
+		TEST_FUNCTION(test_failed_encoding_is_reported);
+		TEST_FUNCTION(test_dropped_frame_is_reported);
+	TEST_SUITE_END()
+
+	ThreadPool::subsys_stop();
+	Type::subsys_stop();
+
+	return tst_exit_status;
+}
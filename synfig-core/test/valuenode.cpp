@@ -0,0 +1,105 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file valuenode.cpp
+**	\brief Test evaluation of animated value nodes
+**
+**	\legal
+**	Copyright (c) 2022 Synfig contributors
+**
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <cmath>
+#include <vector>
+
+#include <synfig/real.h>
+#include <synfig/type.h>
+#include <synfig/waypoint.h>
+#include <synfig/valuenodes/valuenode_animated.h>
+
+#include "test_base.h"
+
+using namespace synfig;
+
+static const Real fps = 24.0;
+static const int waypoints = 100;
+static const int subframes = 4;
+
+//! a waypoint per frame
+static ValueNode_Animated::Handle
+create_animated()
+{
+	ValueNode_Animated::Handle node = ValueNode_Animated::create(type_real);
+	for(int i = 0; i < waypoints; ++i) {
+		Waypoint waypoint(ValueBase(Real(std::sin(0.1*i))), Time(i/fps));
+		waypoint.set_parent_value_node(node.get());
+		node->editable_waypoint_list().push_back(waypoint);
+	}
+	node->changed();
+	return node;
+}
+
+void test_animated_passes_through_waypoints() {
+	ValueNode_Animated::Handle node = create_animated();
+	for(int i = 0; i < waypoints; ++i)
+		ASSERT_APPROX_EQUAL(std::sin(0.1*i), (*node)(Time(i/fps)).get(Real()));
+}
+
+void test_animated_does_not_depend_on_order_of_evaluation() {
+	ValueNode_Animated::Handle node = create_animated();
+	const int count = (waypoints - 1)*subframes + 1;
+
+	// whole timeline forward, like playback or rendering
+	std::vector<Real> forward(count);
+	for(int i = 0; i < count; ++i)
+		forward[i] = (*node)(Time(i/(fps*subframes))).get(Real());
+
+	// scattered over the timeline, like studio does while scrubbing
+	ValueNode_Animated::Handle other = create_animated();
+	for(int i = 0; i < count; ++i) {
+		const int j = i*7919 % count;
+		ASSERT_EQUAL(forward[j], (*other)(Time(j/(fps*subframes))).get(Real()));
+	}
+
+	// and before and after the animation
+	ASSERT_APPROX_EQUAL(std::sin(0.0), (*node)(Time(-1.0)).get(Real()));
+	ASSERT_APPROX_EQUAL(std::sin(0.1*(waypoints - 1)), (*node)(Time(waypoints/fps + 1.0)).get(Real()));
+}
+
+void test_animated_follows_changes_of_waypoints() {
+	ValueNode_Animated::Handle node = create_animated();
+	const Time time(10/fps);
+	ASSERT_APPROX_EQUAL(std::sin(1.0), (*node)(time).get(Real()));
+
+	node->editable_waypoint_list()[10].set_value(ValueBase(Real(5.0)));
+	node->changed();
+	ASSERT_APPROX_EQUAL(5.0, (*node)(time).get(Real()));
+}
+
+int main() {
+	Type::subsys_init();
+
+	TEST_SUITE_BEGIN()
+		TEST_FUNCTION(test_animated_passes_through_waypoints);
+		TEST_FUNCTION(test_animated_does_not_depend_on_order_of_evaluation);
+		TEST_FUNCTION(test_animated_follows_changes_of_waypoints);
+	TEST_SUITE_END()
+
+	Type::subsys_stop();
+
+	return tst_exit_status;
+}
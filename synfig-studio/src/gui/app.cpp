@@ -1035,6 +1035,7 @@ DEFINE_ACTION("help-tutorials", Gtk::Stock::HELP)
 DEFINE_ACTION("help-reference", Gtk::Stock::HELP)
 DEFINE_ACTION("help-faq",       Gtk::Stock::HELP)
 DEFINE_ACTION("help-support",   Gtk::Stock::HELP)
+DEFINE_ACTION("toggle-render-trace", _("Record Render Trace"))
 DEFINE_ACTION("help-about",     Gtk::StockID("synfig-about"))
 
 // actions: Keyframe
@@ -1192,6 +1193,7 @@ DEFINE_ACTION("keyframe-properties", _("Properties"))
 "		<menuitem action='help-faq'/>"
 "		<separator name='sep-help2'/>"
 "		<menuitem action='help-support'/>"
+"		<menuitem action='toggle-render-trace'/>"
 "		<separator name='sep-help3'/>"
 "		<menuitem action='help-about'/>"
 "	</menu>";
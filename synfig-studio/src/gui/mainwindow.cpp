@@ -35,6 +35,7 @@
 #include <gui/mainwindow.h>
 
 #include <gtkmm/box.h>
+#include <gtkmm/filechooserdialog.h>
 #include <gtkmm/stock.h>
 #include <gtkmm/textview.h>
 
@@ -49,6 +50,8 @@
 #include <gui/widgets/widget_time.h>
 #include <gui/widgets/widget_vector.h>
 
+#include <synfig/debug/trace.h>
+
 #include <synfigapp/main.h>
 
 #endif
@@ -223,6 +226,11 @@ MainWindow::init_menus()
 		sigc::ptr_fun(studio::App::dialog_about)
 	);
 
+	// timings of rendering tasks, saved when recording is stopped
+	Glib::RefPtr<Gtk::ToggleAction> toggle_trace = Gtk::ToggleAction::create("toggle-render-trace", _("Record Render Trace"));
+	toggle_trace->set_active(debug::Trace::is_enabled());
+	action_group->add(toggle_trace, sigc::mem_fun(*this, &studio::MainWindow::toggle_render_trace));
+
 	// TODO: open recent
 	//filemenu->items().push_back(Gtk::Menu_Helpers::MenuElem(_("Open Recent"),*recent_files_menu));
 
@@ -250,6 +258,31 @@ MainWindow::toggle_show_menubar()
 		menubar->hide();
 }
 
+void
+MainWindow::toggle_render_trace()
+{
+	if (!debug::Trace::is_enabled()) {
+		debug::Trace::clear();
+		debug::Trace::set_enabled(true);
+		return;
+	}
+	debug::Trace::set_enabled(false);
+
+	Gtk::FileChooserDialog dialog(*this, _("Save Render Trace"), Gtk::FILE_CHOOSER_ACTION_SAVE);
+	dialog.add_button(Gtk::Stock::CANCEL, Gtk::RESPONSE_CANCEL);
+	dialog.add_button(Gtk::Stock::SAVE,   Gtk::RESPONSE_ACCEPT);
+	dialog.set_do_overwrite_confirmation(true);
+	dialog.set_current_name("trace.json");
+
+	Glib::RefPtr<Gtk::FileFilter> filter_json = Gtk::FileFilter::create();
+	filter_json->set_name(_("Chrome trace files (*.json)"));
+	filter_json->add_pattern("*.json");
+	dialog.add_filter(filter_json);
+
+	if (dialog.run() == Gtk::RESPONSE_ACCEPT && !debug::Trace::save(dialog.get_filename()))
+		App::dialog_message_1b("ERROR", _("Unable to save render trace."), "details", _("Close"));
+}
+
 void
 MainWindow::toggle_show_toolbar()
 {
@@ -64,6 +64,7 @@ namespace studio {
 		void on_dockable_unregistered(Dockable* dockable);
 		void toggle_show_menubar();
 		void toggle_show_toolbar();
+		void toggle_render_trace();
 
 		guint save_workspace_merge_id;
 		guint custom_workspaces_merge_id;